@@ -1,6 +1,8 @@
 #include "back_end/eval.h"
 #include "front_end/anal/anal.h"
+#include "front_end/anal/visitor.h"
 #include "front_end/ast/ast.h"
+#include "front_end/ast/ast_cache.h"
 #include "front_end/ast/ast_dump.h"
 #include "front_end/lex/lex.h"
 #include "front_end/parse/parse.h"
@@ -11,26 +13,32 @@
 #include "middle_end/ir/type.h"
 #include "middle_end/opt/opt.h"
 #include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/thread.h"
 #include <errno.h>
+#include <limits.h>
+#include <signal.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 void *diag_error_memstream = NULL;
 void *diag_warn_memstream = NULL;
 
-extern FILE *yyin;
-extern int yylex();
-extern int yylex_destroy();
+/* Kept mapped while diagnostics can refer to it. */
+static struct source source;
+/* Print time of each analyzer. */
+static bool time_analysis;
+/* Directory of AST cache. If not set, cache is not used. */
+static const char *ast_cache_dir;
 
 
 
 void tokens_cleanup(tok_array_t *toks)
 {
-    for (uint64_t i = 0; i < toks->count; ++i) {
-        struct token *t = &toks->data[i];
-        if (t->data)
-            free(t->data);
-    }
-    vector_free(*toks);
+    /* Token data is interned and outlives tokens. */
+    tok_array_free(toks);
 }
 
 
@@ -39,45 +47,121 @@ void tokens_cleanup(tok_array_t *toks)
  **********************************************/
 void analyze(struct ast_node *ast)
 {
-    ana_var_usage(ast);
-    ana_fn(ast);
-    ana_type(ast);
+    ana_set_timing(time_analysis);
+    ana_run(ast);
+
+    if (time_analysis)
+        ana_dump_timings(stdout);
 }
 
 /**********************************************
  **             Generators                   **
  **********************************************/
-tok_array_t *gen_tokens(const char *filename)
+void open_source(const char *filename)
 {
-    lex_reset_state();
-    lex_init_state();
-
-    if (!yyin) yyin = fopen(filename, "r");
-    else yyin = freopen(filename, "r", yyin);
-    if (yyin == NULL) {
+    source_close(&source);
+    if (!source_open(&source, filename)) {
         printf("Could not open filename %s: %s\n", filename, strerror(errno));
-        exit(1);
+        /* Handled as compile error, see run(). */
+        longjmp(weak_fatal_error_buf, 1);
     }
-    yylex();
-    fseek(yyin, 0, SEEK_SET);
-    weak_set_source_stream(yyin);
+    weak_set_source(&source);
+}
+
+/* Lex already opened source. */
+tok_array_t *lex_opened_source()
+{
+    lex_reset_state();
+    lex_init_state();
+    lex_source(&source);
 
     return lex_consumed_tokens();
 }
 
-struct ast_node *gen_ast(const char *filename)
+tok_array_t *gen_tokens(const char *filename)
+{
+    open_source(filename);
+    return lex_opened_source();
+}
+
+/* Parse already opened source. */
+struct ast_node *parse_opened_source()
 {
-    tok_array_t *t = gen_tokens(filename);
-    struct ast_node *ast = parse(t->data, t->data + t->count);
+#ifdef CONFIG_USE_NATIVE_LEXER
+    /* Tokens are pulled by parser on demand, so
+       whole token array is never stored. */
+    return parse_source(&source);
+#else
+    tok_array_t *t = lex_opened_source();
+    struct ast_node *ast = parse(t);
     tokens_cleanup(t);
     return ast;
+#endif /* CONFIG_USE_NATIVE_LEXER */
+}
+
+struct ast_node *parse_file(const char *filename)
+{
+    open_source(filename);
+    return parse_opened_source();
+}
+
+/* Take AST from cache if file contents are not changed
+   since it was stored, otherwise parse and store it. */
+struct ast_node *gen_ast_cached(const char *filename)
+{
+    char path[PATH_MAX] = {0};
+
+    open_source(filename);
+
+    if (!ast_cache_path(path, sizeof (path), ast_cache_dir, &source)) {
+        printf("Could not use AST cache in %s: %s\n", ast_cache_dir, strerror(errno));
+        return parse_opened_source();
+    }
+
+    struct ast_node *ast = ast_cache_load(path, &source);
+    if (ast)
+        return ast;
+
+    /* Stored AST must match exactly contents hashed above,
+       so the file is not opened again. */
+    ast = parse_opened_source();
+
+    if (!ast_cache_store(path, ast, &source))
+        printf("Could not write AST cache %s: %s\n", path, strerror(errno));
+
+    return ast;
+}
+
+struct ast_node *gen_ast(const char *filename)
+{
+    if (ast_cache_dir)
+        return gen_ast_cached(filename);
+
+    return parse_file(filename);
 }
 
+/* AST is released here, also if analysis failed. */
 struct ir_unit gen_ir(const char *filename)
 {
     struct ast_node *ast = gen_ast(filename);
+    jmp_buf          saved;
+
+    memcpy(saved, weak_fatal_error_buf, sizeof (jmp_buf));
+
+    if (setjmp(weak_fatal_error_buf)) {
+        memcpy(weak_fatal_error_buf, saved, sizeof (jmp_buf));
+        ast_node_cleanup(ast);
+        longjmp(weak_fatal_error_buf, 1);
+    }
+
     analyze(ast);
-    return ir_gen(ast);
+
+    memcpy(weak_fatal_error_buf, saved, sizeof (jmp_buf));
+
+    struct ir_unit unit = ir_gen(ast);
+    ast_node_cleanup(ast);
+
+    return unit;
 }
 
 
@@ -92,14 +176,15 @@ void dump_tokens(tok_array_t *toks)
         "|             |               |                 \n"
         "------------------------------------------------\n"
     );
-    for (uint64_t i = 0; i < toks->count; ++i) {
-        struct token *t = &toks->data[i];
+    for (uint64_t i = 0; i < tok_array_count(toks); ++i) {
+        struct token t;
+        tok_array_get(toks, i, &t);
         printf(
-            "% 4hd:% 4hd     %-15s %s\n",
-            t->line_no,
-            t->col_no,
-            tok_to_string(t->type),
-            t->data ? t->data : ""
+            "%5u:%5u     %-15s %s\n",
+            t.line_no,
+            t.col_no,
+            tok_to_string(t.type),
+            t.data ? t.data : ""
         );
     }
 }
@@ -123,13 +208,6 @@ void opt(struct ir_unit *ir)
     ir_type_pass(ir);
     ir_opt_reorder(ir);
     ir_opt_arith(ir);
-
-    struct ir_node *it = ir->fn_decls;
-    while (it) {
-        struct ir_fn_decl *decl = it->ir;
-        ir_cfg_build(decl);
-        it = it->next;
-    }
 }
 
 #ifdef CONFIG_USE_BACKEND_EVAL
@@ -140,6 +218,8 @@ void run_backend(const char *filename)
 
     int r = eval(&unit);
     printf("Exit with %d\n", r);
+
+    ir_unit_cleanup(&unit);
 }
 #endif /* CONFIG_USE_BACKEND_EVAL */
 
@@ -161,13 +241,14 @@ void configure_ast(bool simple)
 /**********************************************
  **             Driver code                  **
  **********************************************/
-void parse_cmdline(int argc, char *argv[])
+int parse_cmdline(int argc, char *argv[])
 {
     bool  tokens      = 0;
     bool  ast         = 0;
     bool  ast_simple  = 0;
     bool  ir          = 0;
     bool  read_bin_ir = 0;
+    bool  ir_stats    = 0;
     int   file_i      = -1;
     char *file        = NULL;
 
@@ -182,11 +263,15 @@ void parse_cmdline(int argc, char *argv[])
         else if (!strcmp(argv[i], "--dump-ast-simple")) ast_simple  = 1;
         else if (!strcmp(argv[i], "--dump-ir"))         ir          = 1;
         else if (!strcmp(argv[i], "--read-ir"))         read_bin_ir = 1;
+        else if (!strcmp(argv[i], "--ir-stats"))        ir_stats    = 1;
+        else if (!strcmp(argv[i], "--time-analysis"))   time_analysis = 1;
+        else if (!strcmp(argv[i], "--ast-cache") && i + 1 < argc)
+                                                        ast_cache_dir = argv[++i];
         else                                            file_i      = i;
 
     if (file_i == -1) {
         puts("No input file was given.");
-        return;
+        return 0;
     }
 
     file = argv[file_i];
@@ -195,7 +280,7 @@ void parse_cmdline(int argc, char *argv[])
         tok_array_t *t = gen_tokens(file);
         dump_tokens(t);
         tokens_cleanup(t);
-        exit(0);
+        return 0;
     }
 
     if (ast_simple)
@@ -206,24 +291,346 @@ void parse_cmdline(int argc, char *argv[])
         struct ast_node *ast = gen_ast(file);
         dump_ast(ast);
         ast_node_cleanup(ast);
-        exit(0);
+        return 0;
     }
 
     if (ir) {
         struct ir_unit unit = gen_ir(file);
         dump_ir(&unit);
         ir_unit_cleanup(&unit);
-        exit(0);
+        return 0;
+    }
+
+    if (ir_stats) {
+        struct ir_unit unit = gen_ir(file);
+        ir_unit_dump_stats(stdout, &unit);
+        ir_unit_cleanup(&unit);
+        return 0;
     }
 
     if (read_bin_ir) {
         struct ir_unit unit = ir_read_binary(file);
         dump_ir(&unit);
         ir_unit_cleanup(&unit);
-        exit(0);
+        return 0;
     }
 
     run_backend(file);
+    return 0;
+}
+
+/* Run one driver invocation. Options are reset, since
+   server runs many of them in one process. Compile error
+   jumps back here, so server survives it. State of
+   interrupted stages is freed then, so next request
+   starts from scratch and nothing is leaked.
+
+   \return Exit code. */
+int run(int argc, char *argv[])
+{
+    time_analysis = 0;
+    ast_cache_dir = NULL;
+
+    if (setjmp(weak_fatal_error_buf)) {
+        lex_reset_state();
+        weak_thread_cleanup();
+        return 1;
+    }
+
+    return parse_cmdline(argc, argv);
+}
+
+/**********************************************
+ **             Compile server               **
+ **********************************************/
+/* Compiler process started once with --server keeps
+   interned strings, hashmaps and other allocated state
+   warm between requests, and client with --client only
+   forwards its command line there. This saves process
+   startup and cold allocations on each compiler run.
+
+   Request is header followed by `size` bytes of working
+   directory and `argc` arguments, each terminated by NUL.
+   Client stdout and stderr descriptors are passed along
+   with header (SCM_RIGHTS), so output goes directly to the
+   client's terminal or pipe. Server replies with int exit
+   code. Requests are served one by one. */
+struct server_request {
+    uint32_t argc;
+    uint32_t size;
+};
+
+#define SERVER_MAX_ARGC 256
+#define SERVER_MAX_SIZE 65536
+
+static bool read_all(int fd, void *buf, uint64_t size)
+{
+    char *p = buf;
+
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p    += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+static bool write_all(int fd, const void *buf, uint64_t size)
+{
+    const char *p = buf;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p    += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+static bool send_request(int fd, struct server_request *req, int fds[2])
+{
+    char            ctl[CMSG_SPACE(sizeof (int) * 2)] = {0};
+    struct iovec    iov = {
+        .iov_base = req,
+        .iov_len  = sizeof (*req)
+    };
+    struct msghdr   msg = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = ctl,
+        .msg_controllen = sizeof (ctl)
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof (int) * 2);
+    memcpy(CMSG_DATA(c), fds, sizeof (int) * 2);
+
+    return sendmsg(fd, &msg, 0) == sizeof (*req);
+}
+
+/* Close all descriptors passed in control messages. */
+static void close_passed_fds(struct msghdr *msg)
+{
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        uint64_t cnt = (c->cmsg_len - CMSG_LEN(0)) / sizeof (int);
+
+        for (uint64_t i = 0; i < cnt; ++i) {
+            int passed = -1;
+            memcpy(&passed, CMSG_DATA(c) + i * sizeof (int), sizeof (int));
+            close(passed);
+        }
+    }
+}
+
+static bool recv_request(int fd, struct server_request *req, int fds[2])
+{
+    char            ctl[CMSG_SPACE(sizeof (int) * 2)] = {0};
+    struct iovec    iov = {
+        .iov_base = req,
+        .iov_len  = sizeof (*req)
+    };
+    struct msghdr   msg = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = ctl,
+        .msg_controllen = sizeof (ctl)
+    };
+
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0)
+        return 0;
+
+    /* Exactly one message with both descriptors is expected.
+       Otherwise all passed ones are closed, not to leak them
+       into the server. */
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (n == 0 ||
+        msg.msg_flags & MSG_CTRUNC ||
+        !c ||
+        c->cmsg_level != SOL_SOCKET ||
+        c->cmsg_type  != SCM_RIGHTS ||
+        c->cmsg_len   != CMSG_LEN(sizeof (int) * 2) ||
+        CMSG_NXTHDR(&msg, c)) {
+        close_passed_fds(&msg);
+        return 0;
+    }
+
+    memcpy(fds, CMSG_DATA(c), sizeof (int) * 2);
+
+    /* Stream socket can split header. */
+    return read_all(fd, (char *) req + n, sizeof (*req) - n);
+}
+
+static int unix_socket(const char *path, struct sockaddr_un *addr)
+{
+    if (strlen(path) >= sizeof (addr->sun_path)) {
+        printf("Socket path %s is too long\n", path);
+        exit(1);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Could not create socket: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    memset(addr, 0, sizeof (*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return fd;
+}
+
+/* Run request of client with its working directory
+   and output.
+
+   \return Exit code. */
+static int serve_request(struct server_request *req, char *buf, int fds[2])
+{
+    static char *argv[SERVER_MAX_ARGC + 1];
+    char        *end  = buf + req->size;
+    char        *p    = buf + strlen(buf) + 1;
+    int          code = 1;
+
+    argv[0] = "weak_compiler";
+
+    for (uint32_t i = 1; i <= req->argc; ++i) {
+        if (p >= end)
+            return 1;
+        argv[i] = p;
+        p += strlen(p) + 1;
+    }
+
+    int out = dup(STDOUT_FILENO);
+    int err = dup(STDERR_FILENO);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+
+    if (chdir(buf) < 0)
+        printf("Could not change directory to %s: %s\n", buf, strerror(errno));
+    else
+        code = run(req->argc + 1, argv);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(out, STDOUT_FILENO);
+    dup2(err, STDERR_FILENO);
+    close(out);
+    close(err);
+
+    return code;
+}
+
+int serve(const char *path)
+{
+    /* Request arguments are referred from options
+       (e.g. --ast-cache <dir>) while request is running. */
+    static char        buf[SERVER_MAX_SIZE + 1];
+    struct sockaddr_un addr;
+    int                fd = unix_socket(path, &addr);
+
+    /* Client can go away before reply. */
+    signal(SIGPIPE, SIG_IGN);
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen(fd, 64) < 0) {
+        printf("Could not listen on %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    while (1) {
+        struct server_request req    = {0};
+        int                   fds[2] = {-1, -1};
+        int                   code   = 1;
+        int                   conn   = accept(fd, NULL, NULL);
+
+        if (conn < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("Could not accept connection: %s\n", strerror(errno));
+            return 1;
+        }
+
+        if (recv_request(conn, &req, fds) &&
+            req.argc <= SERVER_MAX_ARGC &&
+            req.size > 0 &&
+            req.size <= SERVER_MAX_SIZE &&
+            read_all(conn, buf, req.size) &&
+            buf[req.size - 1] == '\0') {
+            buf[req.size] = '\0';
+            code = serve_request(&req, buf, fds);
+            write_all(conn, &code, sizeof (code));
+        }
+
+        if (fds[0] >= 0)
+            close(fds[0]);
+        if (fds[1] >= 0)
+            close(fds[1]);
+        close(conn);
+    }
+}
+
+/* Forward command line and working directory to server.
+
+   \return Exit code of request. */
+int client(const char *path, int argc, char *argv[])
+{
+    static char        buf[SERVER_MAX_SIZE];
+    struct sockaddr_un    addr;
+    struct server_request req    = {0};
+    int                   fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+    int                   code   = 1;
+    int                   fd     = unix_socket(path, &addr);
+
+    if (!getcwd(buf, PATH_MAX)) {
+        printf("Could not get working directory: %s\n", strerror(errno));
+        return 1;
+    }
+
+    req.size = strlen(buf) + 1;
+
+    for (int i = 0; i < argc; ++i) {
+        uint64_t len = strlen(argv[i]) + 1;
+        if (i >= SERVER_MAX_ARGC || req.size + len > SERVER_MAX_SIZE) {
+            puts("Command line is too long for server");
+            return 1;
+        }
+        memcpy(buf + req.size, argv[i], len);
+        req.size += len;
+    }
+    req.argc = argc;
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+        printf("Could not connect to %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (!send_request(fd, &req, fds) ||
+        !write_all(fd, buf, req.size) ||
+        !read_all(fd, &code, sizeof (code))) {
+        printf("Server %s closed connection\n", path);
+        return 1;
+    }
+
+    close(fd);
+    return code;
 }
 
 void help();
@@ -244,7 +651,16 @@ int main(int argc, char *argv[])
 
     configure_diag();
 
-    parse_cmdline(argc, argv);
+    /* Server and client modes are only recognized in
+       first argument, rest of client command line goes
+       to server as is. */
+    if (argc >= 3 && !strcmp(argv[1], "--server"))
+        return serve(argv[2]);
+
+    if (argc >= 3 && !strcmp(argv[1], "--client"))
+        return client(argv[2], argc - 3, argv + 3);
+
+    return run(argc, argv);
 }
 
 void help()
@@ -257,6 +673,11 @@ void help()
         "\t--dump-ast-simple\n"
         "\t--dump-ir\n"
         "\t--read-ir\n"
+        "\t--ir-stats\n"
+        "\t--time-analysis\n"
+        "\t--ast-cache <dir>\n"
+        "\t--server <socket>\n"
+        "\t--client <socket> <options...> | <input-file>\n"
     );
     exit(0);
 }
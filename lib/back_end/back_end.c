@@ -3,9 +3,9 @@
 #include "util/compiler.h"
 #include <string.h>
 
-static struct codegen_output *output_code;
-static instr_vector_t        *text_section;
-static uint64_t               text_seek;
+static _Thread_local struct codegen_output *output_code;
+static _Thread_local instr_vector_t        *text_section;
+static _Thread_local uint64_t               text_seek;
 
 uint64_t back_end_seek()
 {
@@ -31,8 +31,8 @@
 #define ELF64_ST_TYPE(info)         ((info) & 0xf)
 #define ELF64_ST_INFO(bind, type)   (((bind) << 4) + ((type) & 0xf))
 
-static int   elf_fd;
-static char *elf_map;
+static _Thread_local int   elf_fd;
+static _Thread_local char *elf_map;
 
 #define emit(addr, byte_string) \
     { strcpy(&elf_map[addr], byte_string); }
@@ -14,7 +14,7 @@
 #include "middle_end/ir/ir.h"
 #include "util/compiler.h"
 #include "util/hashmap.h"
-#include "util/crc32.h"
+#include "util/intern.h"
 #include "util/unreachable.h"
 #include <stdbool.h>
 #include <string.h>
@@ -26,17 +26,17 @@
 
 /* How much stack space is occupied by
    variables. */
-static uint64_t stack_off;
+static _Thread_local uint64_t stack_off;
 
 /* key:   CRC-32 name of a function
    value: .text offset */
-static hashmap_t mapping_fn;
+static _Thread_local hashmap_t mapping_fn;
 /* key:   CRC-32 name of a variable
    value: stack offset */
-static hashmap_t mapping;
+static _Thread_local hashmap_t mapping;
 /* key:   CRC-32 name
    value: type */
-static hashmap_t mapping_type;
+static _Thread_local hashmap_t mapping_type;
 
 /**********************************************
  * Codegen                                    *
@@ -72,10 +72,10 @@ struct tmp_reg {
     int busy;
 };
 
-static struct tmp_reg __tmp_reg_1 = { .reg = risc_v_reg_t0, /* busy */ 0 };
-static struct tmp_reg __tmp_reg_2 = { .reg = risc_v_reg_t1, /* busy */ 0 };
+static _Thread_local struct tmp_reg __tmp_reg_1 = { .reg = risc_v_reg_t0, /* busy */ 0 };
+static _Thread_local struct tmp_reg __tmp_reg_2 = { .reg = risc_v_reg_t1, /* busy */ 0 };
 
-static struct tmp_reg *__tmp_reg_active;
+static _Thread_local struct tmp_reg *__tmp_reg_active;
 
 static struct tmp_reg *select_tmp_reg()
 {
@@ -156,17 +156,17 @@ static void visit_fn_usual(unused struct ir_fn_decl *ir)
 
    For now it contains only one instruction,
    but will be useful to make generic API. */
-static uint64_t _start_size  = 0x04;
+static _Thread_local uint64_t _start_size  = 0x04;
 /* This is setup before `main` code generation
    in order to jump from _start. */
-static uint64_t main_seek    = 0x00;
-static bool     main_emitted = 0;
+static _Thread_local uint64_t main_seek    = 0x00;
+static _Thread_local bool     main_emitted = 0;
 
 static void visit_fn_call(struct ir_fn_call *ir)
 {
-    uint64_t crc = crc32_string(ir->name);
+    uint64_t id  = intern_id(ir->name);
     bool     ok  = 0;
-    uint64_t off = hashmap_get(&mapping_fn, crc, &ok);
+    uint64_t off = hashmap_get(&mapping_fn, id, &ok);
 
     if (!ok)
         weak_fatal_error("Cannot find `%s` function.", ir->name);
@@ -188,7 +188,7 @@ static void visit_fn_call(struct ir_fn_call *ir)
 static void visit_fn_decl(struct ir_fn_decl *ir)
 {
 
-    uint64_t crc = crc32_string(ir->name);
+    uint64_t id = intern_id(ir->name);
 
     if (!strcmp(ir->name, "main")) {
         main_emitted = 1;
@@ -198,7 +198,7 @@ static void visit_fn_decl(struct ir_fn_decl *ir)
 
         uint64_t seek = back_end_seek() + _start_size;
 
-        hashmap_put(&mapping_fn, crc, main_seek);
+        hashmap_put(&mapping_fn, id, main_seek);
 
         back_end_seek_set(0);
         back_end_native_call(main_seek);
@@ -214,7 +214,7 @@ static void visit_fn_decl(struct ir_fn_decl *ir)
             : back_end_seek() + _start_size;
 
         back_end_emit_sym(ir->name, off);
-        hashmap_put(&mapping_fn, crc, off);
+        hashmap_put(&mapping_fn, id, off);
         visit_fn_usual(ir);
     }
 }
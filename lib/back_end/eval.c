@@ -6,9 +6,12 @@
 
 #include "back_end/eval.h"
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_flat.h"
 #include "middle_end/ir/ir_dump.h"
-#include "util/crc32.h"
+#include "util/alloc.h"
+#include "util/intern.h"
 #include "util/hashmap.h"
+#include "util/thread.h"
 #include "util/unreachable.h"
 #include "util/vector.h"
 #include "execution.h"
@@ -37,12 +40,12 @@
          values.
 
          Stack contains `struct value`. */
-static char     stack[STACK_SIZE_BYTES];
+static _Thread_local char     stack[STACK_SIZE_BYTES];
 /* Index: sym_idx
    Value: sp */
-static char     stack_map[STACK_SIZE_BYTES];
+static _Thread_local char     stack_map[STACK_SIZE_BYTES];
 /* Global stack pointer. Named as assembly register. */
-static uint64_t sp;
+static _Thread_local uint64_t sp;
 
 
 
@@ -62,12 +65,12 @@ static inline void push(uint64_t sym_idx, uint64_t imm_siz)
     sp += imm_siz;
 }
 
-static inline void set(uint64_t sym_idx, struct value *v, struct type *traits)
+static inline void set(uint64_t sym_idx, struct value *v, uint64_t bytes)
 {
     uint64_t sp_ptr = stack_map[sym_idx];
 
     /* __string is biggest union value. Rework this crap. */
-    memcpy(&stack[sp_ptr], &v->__string, traits->bytes);
+    memcpy(&stack[sp_ptr], &v->__string, bytes);
 }
 
 static inline void set_string(uint64_t sym_idx, char *imm)
@@ -76,15 +79,15 @@ static inline void set_string(uint64_t sym_idx, char *imm)
     strcpy(&stack[sp_ptr], imm);
 }
 
-static inline struct value get(uint64_t sym_idx, struct type *traits)
+static inline struct value get(uint64_t sym_idx, enum data_type dt, uint64_t bytes)
 {
     uint64_t sp_ptr = stack_map[sym_idx];
 
     struct value v = {
-        .dt = traits->dt
+        .dt = dt
     };
     /* __string is biggest union value. Rework this crap. */
-    memcpy(&v.__string, &stack[sp_ptr], traits->bytes);
+    memcpy(&v.__string, &stack[sp_ptr], bytes);
 
     return v;
 }
@@ -94,11 +97,14 @@ static inline struct value get(uint64_t sym_idx, struct type *traits)
 /**********************************************
  **        Instructions routines             **
  **********************************************/
-static void call_eval(struct ir_fn_call *call);
-static void instr_eval(struct ir_node *ir);
+static void call_eval(const char *name, const struct ir_flat_op *args, uint32_t args_size);
+static void instr_eval(const struct ir_flat_instr *ir);
 
-static struct ir_node *instr_ptr;
-static struct value   last;
+/* Function being executed and index of current statement
+   in it. Set to IR_FLAT_NONE by return. */
+static _Thread_local const struct ir_flat_fn *fn_ptr;
+static _Thread_local uint32_t                 instr_ptr;
+static _Thread_local struct value             last;
 
 
 
@@ -114,12 +120,12 @@ static uint64_t dt_size(enum data_type dt)
     }
 }
 
-static uint64_t alloca_size(struct ir_alloca *alloca)
+static uint64_t alloca_size(enum data_type dt, uint64_t ptr_depth)
 {
-    if (alloca->ptr_depth > 0)
+    if (ptr_depth > 0)
         return 8;
 
-    return dt_size(alloca->dt);
+    return dt_size(dt);
 }
 
 static uint64_t alloca_array_size(struct ir_alloca_array *alloca)
@@ -133,10 +139,10 @@ static uint64_t alloca_array_size(struct ir_alloca_array *alloca)
     return siz;
 }
 
-static void eval_alloca(struct ir_alloca *alloca)
+static void eval_alloca(const struct ir_flat_instr *alloca)
 {
-    uint64_t i     = alloca->idx;
-    uint64_t bytes = alloca_size(alloca);
+    uint64_t i     = alloca->alloca.idx;
+    uint64_t bytes = alloca_size(alloca->aux, alloca->alloca.ptr_depth);
 
     push(i, bytes);
 }
@@ -151,29 +157,46 @@ static void eval_alloca_array(struct ir_alloca_array *alloca)
 
 
 
-static void eval_imm(struct ir_imm *imm)
+static const struct ir_flat_instr *value_at(ir_ref_t ref)
+{
+    return &vector_at(fn_ptr->values, ref);
+}
+
+static void eval_imm(enum ir_imm_type type, union ir_imm_val imm)
 {
     struct value v = {0};
-    switch (imm->type) {
-    case IMM_BOOL:  v.dt = D_T_BOOL;  v.__bool  = imm->imm.__bool;  break;
-    case IMM_CHAR:  v.dt = D_T_CHAR;  v.__char  = imm->imm.__char;  break;
-    case IMM_FLOAT: v.dt = D_T_FLOAT; v.__float = imm->imm.__float; break;
-    case IMM_INT:   v.dt = D_T_INT;   v.__int   = imm->imm.__int;   break;
+    switch (type) {
+    case IMM_BOOL:  v.dt = D_T_BOOL;  v.__bool  = imm.__bool;  break;
+    case IMM_CHAR:  v.dt = D_T_CHAR;  v.__char  = imm.__char;  break;
+    case IMM_FLOAT: v.dt = D_T_FLOAT; v.__float = imm.__float; break;
+    case IMM_INT:   v.dt = D_T_INT;   v.__int   = imm.__int;   break;
     default:
         weak_unreachable("Should not reach there.");
     }
     memcpy(&last, &v, sizeof (struct value));
 }
 
-static void eval_sym(struct ir_node *sym)
+static void eval_sym(const struct ir_flat_instr *sym)
 {
-    struct ir_sym *s = sym->ir;
-    struct type   *t = &s->type_info;
-    struct value   v = get(s->idx, t);
+    struct value v = get(sym->sym.idx, sym->aux, sym->sym.bytes);
 
     memcpy(&last, &v, sizeof(struct value));
 }
 
+static void eval_op(const struct ir_flat_op *op)
+{
+    switch (op->kind) {
+    case IR_FLAT_OP_IMM:
+        eval_imm(op->imm_type, op->imm);
+        break;
+    case IR_FLAT_OP_REF:
+        instr_eval(value_at(op->ref));
+        break;
+    default:
+        weak_unreachable("Unknown operand kind (numeric: %d).", op->kind);
+    }
+}
+
 
 
 static void eval_bools(enum token_type op, bool l, bool r)
@@ -309,28 +332,22 @@ static void compute(enum token_type op, struct value *l, struct value *r)
     }
 }
 
-static void eval_bin(struct ir_bin *bin)
+static void eval_bin(const struct ir_flat_instr *bin)
 {
-    instr_eval(bin->lhs);
+    eval_op(&bin->bin.lhs);
     struct value l = last;
 
-    instr_eval(bin->rhs);
+    eval_op(&bin->bin.rhs);
     struct value r = last;
 
-    compute(bin->op, &l, &r);
+    compute(bin->aux, &l, &r);
 }
 
 
 
-static void eval_store_imm(struct ir_store *store)
+static void eval_store_imm(const struct ir_flat_op *from, const struct ir_flat_instr *to)
 {
-    assert(store->idx->type == IR_SYM && "TODO: Implement arrays");
-
-    struct ir_imm *from    = store->body->ir;
-    struct ir_sym *to      = store->idx->ir;
-    struct type   *to_type = &to->type_info;
-
-    switch (from->type) {
+    switch (from->imm_type) {
     case IMM_BOOL:  last.dt = D_T_BOOL;  last.__bool  = from->imm.__bool;  break;
     case IMM_CHAR:  last.dt = D_T_CHAR;  last.__char  = from->imm.__char;  break;
     case IMM_FLOAT: last.dt = D_T_FLOAT; last.__float = from->imm.__float; break;
@@ -339,72 +356,59 @@ static void eval_store_imm(struct ir_store *store)
         weak_unreachable("Should not reach there");
     }
 
-    set(to->idx, &last, to_type);
+    set(to->sym.idx, &last, to->sym.bytes);
 }
 
-static void eval_store_sym(struct ir_store *store)
+static void eval_store_sym(const struct ir_flat_instr *from, const struct ir_flat_instr *to)
 {
     /* Copy from one stack location to another. */
-    assert(store->idx->type == IR_SYM && "TODO: Implement arrays");
-
-    struct ir_sym *from      = store->body->ir;
-    struct ir_sym *to        = store->idx ->ir;
-    struct type   *from_type = &from->type_info;
-    struct type   *  to_type = &to  ->type_info;
-
-    struct value v = get(from->idx, from_type);
-    set(to->idx, &v, to_type);
+    struct value v = get(from->sym.idx, from->aux, from->sym.bytes);
+    set(to->sym.idx, &v, to->sym.bytes);
 }
 
-static void eval_store_bin(struct ir_store *store)
+static void eval_store_bin(const struct ir_flat_instr *from, const struct ir_flat_instr *to)
 {
-    instr_eval(store->body);
-    assert(store->idx->type == IR_SYM && "TODO: Implement arrays");
-
-    struct ir_sym *sym     = store->idx->ir;
-    struct type   *to_type = &sym->type_info;
-
-    set(sym->idx, &last, to_type);
+    instr_eval(from);
+    set(to->sym.idx, &last, to->sym.bytes);
 }
 
-static void eval_store_string(struct ir_store *store)
+static void eval_store_string(const struct ir_flat_instr *from, const struct ir_flat_instr *to)
 {
-    struct ir_string *s = store->body->ir;
-    assert(store->idx->type == IR_SYM && "TODO: Implement arrays");
+    struct ir_string *s = from->payload;
 
-    struct ir_sym *sym = store->idx->ir;
+    set_string(to->sym.idx, s->imm);
+}
 
-    set_string(sym->idx, s->imm);
+static void eval_store_call(const struct ir_flat_instr *from, const struct ir_flat_instr *to)
+{
+    instr_eval(from);
+    set(to->sym.idx, &last, to->sym.bytes);
 }
 
-static void eval_store_call(struct ir_store *store)
+static void eval_store(const struct ir_flat_instr *store)
 {
-    instr_eval(store->body);
-    assert(store->idx->type == IR_SYM && "TODO: Implement arrays");
+    const struct ir_flat_instr *to = value_at(store->store.idx.ref);
+    assert(to->type == IR_SYM && "TODO: Implement arrays");
 
-    struct ir_sym *sym     =  store->idx->ir;
-    struct type   *to_type = &sym->type_info;
+    if (store->store.body.kind == IR_FLAT_OP_IMM) {
+        eval_store_imm(&store->store.body, to);
+        return;
+    }
 
-    set(sym->idx, &last, to_type);
-}
+    const struct ir_flat_instr *from = value_at(store->store.body.ref);
 
-static void eval_store(struct ir_store *store)
-{
-    switch (store->body->type) {
-    case IR_IMM:
-        eval_store_imm(store);
-        break;
+    switch (from->type) {
     case IR_SYM:
-        eval_store_sym(store);
+        eval_store_sym(from, to);
         break;
     case IR_BIN:
-        eval_store_bin(store);
+        eval_store_bin(from, to);
         break;
     case IR_STRING:
-        eval_store_string(store);
+        eval_store_string(from, to);
         break;
     case IR_FN_CALL:
-        eval_store_call(store);
+        eval_store_call(from, to);
         break;
     default:
         break;
@@ -412,47 +416,43 @@ static void eval_store(struct ir_store *store)
 }
 
 
-static void eval_jmp(struct ir_node *jmp)
+static void eval_jmp(const struct ir_flat_instr *jmp)
 {
-    instr_ptr = vector_at(jmp->cfg.succs, 0);
+    instr_ptr = jmp->jump.target;
 }
 
-static void eval_cond(struct ir_node *__cond)
+static void eval_cond(const struct ir_flat_instr *cond)
 {
-    struct ir_cond *cond = __cond->ir;
-    instr_eval(cond->cond);
+    eval_op(&cond->cond.cond);
 
     /* Take biggest union value and compare
        with 0. No difference, which type. */
     bool should_jump = last.__int != 0;
 
     if (should_jump)
-        instr_ptr = cond->target; /* True branch. */
+        instr_ptr = cond->cond.target; /* True branch. */
     else
-        instr_ptr = __cond->next; /* False branch. */
+        ++instr_ptr; /* False branch. */
 }
 
-static void eval_ret(struct ir_ret *ret)
+static void eval_ret(const struct ir_flat_instr *ret)
 {
-    if (ret->body)
-        instr_eval(ret->body);
+    if (ret->ret.body.kind != IR_FLAT_OP_NONE)
+        eval_op(&ret->ret.body);
 
-    instr_ptr = NULL;
+    instr_ptr = IR_FLAT_NONE;
 }
 
 
 
-static void instr_eval(struct ir_node *ir)
+static void instr_eval(const struct ir_flat_instr *ir)
 {
     switch (ir->type) {
     case IR_ALLOCA:
-        eval_alloca(ir->ir);
+        eval_alloca(ir);
         break;
     case IR_ALLOCA_ARRAY:
-        eval_alloca_array(ir->ir);
-        break;
-    case IR_IMM:
-        eval_imm(ir->ir);
+        eval_alloca_array(ir->payload);
         break;
     case IR_SYM:
         eval_sym(ir);
@@ -465,16 +465,16 @@ static void instr_eval(struct ir_node *ir)
     case IR_FN_DECL:
         break;
     case IR_FN_CALL:
-        call_eval(ir->ir);
+        call_eval(ir->call.name, &vector_at(fn_ptr->args, ir->call.args), ir->call.args_size);
         break;
     case IR_STORE:
-        eval_store(ir->ir);
+        eval_store(ir);
         break;
     case IR_BIN:
-        eval_bin(ir->ir);
+        eval_bin(ir);
         break;
     case IR_RET:
-        eval_ret(ir->ir);
+        eval_ret(ir);
         break;
     case IR_COND:
         eval_cond(ir);
@@ -507,7 +507,7 @@ struct call_stack_entry {
 
 typedef vector_t(struct call_stack_entry) call_stack_t;
 
-static uint64_t call_depth;
+static _Thread_local uint64_t call_depth;
 
 /* TODO: Builtin function that prints stacktrace at
          the moment.
@@ -539,77 +539,110 @@ static void call_stack_tail()
 /**********************************************
  **           Functions routines             **
  **********************************************/
-static hashmap_t funs;
+/* Functions are executed in flat form, built once
+   per eval() call. */
+static _Thread_local hashmap_t          funs;
+static _Thread_local struct ir_flat_fn *flat_funs;
+static _Thread_local uint64_t           flat_funs_size;
 
 static void fun_list_init(struct ir_node *ir)
 {
-    while (ir) {
+    flat_funs_size = 0;
+    for (struct ir_node *it = ir; it; it = it->next)
+        ++flat_funs_size;
+
+    flat_funs = weak_calloc(flat_funs_size, sizeof (*flat_funs));
+
+    for (uint64_t i = 0; ir; ++i, ir = ir->next) {
         struct ir_fn_decl *fun = ir->ir;
-        hashmap_put(&funs, crc32_string(fun->name), (uint64_t) fun);
-        ir = ir->next;
+        ir_flat_build(&flat_funs[i], fun);
+        hashmap_put(&funs, intern_id(fun->name), (uint64_t) &flat_funs[i]);
     }
 }
 
-static struct ir_fn_decl *fun_lookup(const char *name)
+static void fun_list_free()
+{
+    for (uint64_t i = 0; i < flat_funs_size; ++i)
+        ir_flat_free(&flat_funs[i]);
+
+    weak_free(flat_funs);
+    flat_funs = NULL;
+    flat_funs_size = 0;
+}
+
+static void fun_map_free()
+{
+    fun_list_free();
+    hashmap_destroy(&funs);
+}
+
+static const struct ir_flat_fn *fun_lookup(const char *name)
 {
-    uint64_t hash = crc32_string(name);
+    uint64_t hash = intern_id(name);
 
     bool ok = 0;
     uint64_t got = hashmap_get(&funs, hash, &ok);
     if (!ok)
         weak_unreachable("Function lookup failed for `%s`, CRC32: %lu", name, hash);
 
-    return (struct ir_fn_decl *) got;
+    return (const struct ir_flat_fn *) got;
 }
 
-static void fun_eval(struct ir_fn_decl *decl)
+static void fun_eval(const struct ir_flat_fn *fn)
 {
-    struct ir_node *it = decl->body;
-
-    instr_ptr = it;
+    fn_ptr = fn;
+    instr_ptr = 0;
 
-    while (instr_ptr) {
-        struct ir_node *prev_ptr = instr_ptr;
-        instr_eval(instr_ptr);
+    /* Return sets instruction pointer past the end. */
+    while (instr_ptr < fn->stmts.count) {
+        const struct ir_flat_instr *instr = &vector_at(fn->stmts, instr_ptr);
+        instr_eval(instr);
 
         /* Conditional and jump statements set up their
            successor instructions manually. Elsewise,
            we just peek the next one. */
-        switch (prev_ptr->type) {
+        switch (instr->type) {
         case IR_COND:
         case IR_JUMP:
+        case IR_RET:
             break;
         default:
-            if (instr_ptr)
-                instr_ptr = vector_at(instr_ptr->cfg.succs, 0);
+            ++instr_ptr;
         }
     }
 }
 
 
 
-static void set_call_arg(struct ir_node *arg, uint64_t *sym)
+static void set_call_arg(const struct ir_flat_op *arg, uint64_t *sym)
 {
-    struct type *t = NULL;
+    uint64_t bytes = 0;
 
-    switch (arg->type) {
-    case IR_SYM: t = &((struct ir_sym *) arg->ir)->type_info; break;
-    case IR_IMM: t = &((struct ir_imm *) arg->ir)->type_info; break;
-    /* TODO: Struct member access. */
-    default:
-        weak_unreachable(
-            "Cannot pass `%s` as function argument",
-            ir_type_to_string(arg->type)
-        );
+    if (arg->kind == IR_FLAT_OP_IMM) {
+        /* Immediate has no size until ir_type_pass(). */
+        if (arg->typed)
+            bytes = dt_size(last.dt);
+    } else {
+        const struct ir_flat_instr *val = value_at(arg->ref);
+
+        switch (val->type) {
+        case IR_SYM: bytes = val->sym.bytes; break;
+        /* TODO: Struct member access. */
+        default:
+            weak_unreachable(
+                "Cannot pass `%s` as function argument",
+                ir_type_to_string(val->type)
+            );
+        }
     }
 
-    set((*sym)++, &last, t);
+    set((*sym)++, &last, bytes);
 }
 
-static void push_call_arg(struct ir_node *arg, uint64_t *sym)
+static void push_call_arg(const struct ir_flat_op *arg, uint64_t *sym)
 {
     /* 1. Evaluate in current stack frame. */
-    instr_eval(arg);
+    eval_op(arg);
     /* 2. Push to the callee stack frame. */
     if (last.dt == D_T_STRING)
         push(*sym, strlen(last.__string));
@@ -619,31 +652,29 @@ static void push_call_arg(struct ir_node *arg, uint64_t *sym)
     set_call_arg(arg, sym);
 }
 
-static void call_eval(struct ir_fn_call *fcall)
+static void call_eval(const char *name, const struct ir_flat_op *args, uint32_t args_size)
 {
     /* Prologue @{ */
-    uint64_t        sym            = 0;
-    uint64_t        bp             = sp;
-    struct ir_node *save_instr_ptr = instr_ptr;
-    char            stack_map_copy[STACK_SIZE_BYTES];
+    uint64_t                 sym            = 0;
+    uint64_t                 bp             = sp;
+    const struct ir_flat_fn *save_fn_ptr    = fn_ptr;
+    uint32_t                 save_instr_ptr = instr_ptr;
+    char                     stack_map_copy[STACK_SIZE_BYTES];
 
-    call_stack_head(fcall->name);
+    call_stack_head(name);
     memcpy(stack_map_copy, stack_map, STACK_SIZE_BYTES);
 
-    struct ir_node *arg = fcall->args;
-    while (arg) {
-        push_call_arg(arg, &sym);
-        arg = arg->next;
-    }
+    for (uint32_t i = 0; i < args_size; ++i)
+        push_call_arg(&args[i], &sym);
     /* }@ */
 
     /* Body @{ */
-    struct ir_fn_decl *fun = fun_lookup(fcall->name);
-    fun_eval(fun);
+    fun_eval(fun_lookup(name));
     /* }@ */
 
     /* Epilogue @{ */
     sp = bp;
+    fn_ptr = save_fn_ptr;
     instr_ptr = save_instr_ptr;
     memcpy(stack_map, stack_map_copy, STACK_SIZE_BYTES);
     call_stack_tail();
@@ -659,17 +690,15 @@ int32_t eval(struct ir_unit *unit)
 {
     reset();
     hashmap_reset(&funs, 512);
+    weak_thread_atexit(fun_map_free);
 
     fun_list_init(unit->fn_decls);
-
-    struct ir_fn_call main = {
-        .name = "main"
-    };
-    call_eval(&main);
+    call_eval(intern("main"), NULL, 0);
+    fun_list_free();
 
     /* Required to be int. */
     if (last.dt != D_T_INT)
         weak_unreachable("main() return only ints.");
 
     return last.__int;
-}
\ No newline at end of file
+}
@@ -15,7 +15,7 @@
 #define FREE_REG_START  5  // Start from `t0` (register 5)
 #define FREE_REG_END   31  // End at `t6` (register 31)
 
-static int reg_lru[MAX_REGISTERS] = {0};
+static _Thread_local int reg_lru[MAX_REGISTERS] = {0};
 
 __attribute__ ((constructor)) static void init_lru()
 {
@@ -0,0 +1,19 @@
+/* anal.c - Analysis pipeline.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/anal.h"
+#include "front_end/anal/visitor.h"
+
+void ana_run(struct ast_node *root)
+{
+    const struct ana_pass *passes[] = {
+        &ana_var_usage_pass,
+        &ana_fn_pass,
+        &ana_type_pass
+    };
+
+    ana_run_passes(root, passes, __weak_array_size(passes));
+}
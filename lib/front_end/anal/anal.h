@@ -10,6 +10,20 @@
 #include <stdbool.h>
 
 struct ast_node;
+struct ana_pass;
+
+/** \brief Run variable usage, function and type analyzers.
+
+    Variable usage and function analyzers share single
+    traversal (see visitor.h). Diagnostics are the same as
+    of ana_var_usage(), ana_fn() and ana_type() called one
+    after another. */
+void ana_run(struct ast_node *root);
+
+/** Passes of analyzers below, for ana_run_passes(). */
+extern const struct ana_pass ana_var_usage_pass;
+extern const struct ana_pass ana_fn_pass;
+extern const struct ana_pass ana_type_pass;
 
 /** \brief Variable usage analyzer.
   
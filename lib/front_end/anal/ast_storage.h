@@ -9,8 +9,8 @@
 
 #include "front_end/ast/ast.h"
 #include "front_end/lex/data_type.h"
+#include "front_end/anal/sym_table.h"
 #include "util/compiler.h"
-#include "util/hashmap.h"
 #include "util/vector.h"
 
 struct ast_storage_decl {
@@ -23,15 +23,18 @@ struct ast_storage_decl {
     uint16_t         depth;      /** How much variable is nested. */
 };
 
+/** Declarations visible at current point of AST traversal.
+
+    \note Inner declaration shadows outer one with the same
+          name until end of its scope. */
 struct ast_storage {
-    uint64_t         scope_depth;
-    hashmap_t        scopes;
+    struct sym_table table;
 };
 
 typedef vector_t(struct ast_storage_decl *) ast_storage_decl_array_t;
 
 /** Initialize internal data, needed for correct scope depth
-    resolution. */
+    resolution. Does not allocate. */
 void ast_storage_init(struct ast_storage *s);
 
 /** Reset all internal data. */
@@ -40,10 +43,16 @@ void ast_storage_free(struct ast_storage *s);
 /** Increment scope depth. */
 void ast_storage_start_scope(struct ast_storage *s);
 
-/** Decrement scope depth, cleanup all most top scope records. */
+/** Decrement scope depth, cleanup all most top scope records.
+
+    \note Complexity is O(declarations in this scope). */
 void ast_storage_end_scope(struct ast_storage *s);
 
-/** Add record at current depth. */
+/** Add record at current depth.
+
+    \note Variable name must be interned. It is used as key.
+    \note Record shadows one with the same name from outer
+          scope. */
 void ast_storage_push(struct ast_storage *s, const char *var_name, struct ast_node *ast);
 
 /** \copydoc ast_storage_push(const char *, struct ast_node *) */
@@ -78,9 +87,8 @@ void ast_storage_add_write_use(struct ast_storage *s, const char *var_name);
 /** Collect all variable usages in current scope. Don't care
     about reads and writes, though.
    
-    \todo  Order of output uses is undefined, since it operates on
-           hashmap, hence we don't have properly sorted by occurrence
-           warnings. Maybe, just sort result array? */
+    \note Uses are in declaration order, so warnings
+          does not depend on hashmap order. */
 void ast_storage_current_scope_uses(
     struct ast_storage       *s,
     ast_storage_decl_array_t *out_set
@@ -7,17 +7,20 @@
 #include "front_end/anal/const.h"
 #include "front_end/anal/ast_storage.h"
 #include "front_end/ast/ast.h"
+#include "util/thread.h"
 #include "util/unreachable.h"
 
-static struct ast_storage storage;
+static _Thread_local struct ast_storage storage;
 
 void const_init()
 {
     ast_storage_init(&storage);
+    weak_thread_atexit(const_reset);
 }
 
 void const_reset()
 {
+    ast_storage_free(&storage);
     ast_storage_init(&storage);
 }
 
@@ -94,10 +97,8 @@ bool is_const_evaluable(struct ast_node *ast)
 
 void const_statistics(FILE *stream)
 {
-    hashmap_foreach(&storage.scopes, k, v) {
-        (void) k;
-
-        struct ast_storage_decl *decl = (struct ast_storage_decl *) v;
+    sym_table_foreach(&storage.table, b) {
+        struct ast_storage_decl *decl = b->data;
 
         fprintf(stream, "const: `%s`\n", decl->name);
     }
@@ -5,10 +5,9 @@
  */
 
 #include "front_end/anal/anal.h"
-#include "front_end/anal/fn_storage.h"
+#include "front_end/anal/visitor.h"
 #include "front_end/ast/ast.h"
 #include "util/diagnostic.h"
-#include "util/hashmap.h"
 #include "util/unreachable.h"
 #include "builtins.h"
 #include <assert.h>
@@ -18,185 +17,160 @@
 
    \pre All fields set to 0 at the start
         of each function. */
-static struct {
-    uint16_t line_no;
-    uint16_t col_no;
+static _Thread_local struct {
+    uint32_t line_no;
+    uint32_t col_no;
     bool     occurred;
 } last_ret = {0};
 
-static fn_storage_t fn_storage;
-
 static void init()
 {
     memset(&last_ret, 0, sizeof (last_ret));
-    fn_storage_init(&fn_storage);
-}
-
-static void reset()
-{
-    fn_storage_free(&fn_storage);
 }
 
 /* \note Interesting in this context things are only in the
          conditional and iteration statements body, not in
-         the conditions. */
-static void visit(struct ast_node *ast);
-
-static void visit_compound(struct ast_node *ast)
+         the conditions, and not in expressions except
+         function call arguments. */
+static bool skip(unused struct ana_ctx *ctx, unused struct ast_node *ast)
 {
-    struct ast_compound *stmt = ast->ast;
-    for (uint64_t i = 0; i < stmt->size; ++i)
-        visit(stmt->stmts[i]);
+    return false;
 }
 
-static void visit_if(struct ast_node *ast)
+/* Condition, initializer or increment of statement. */
+static bool in_stmt_header(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_if *stmt = ast->ast;
-    visit(stmt->body);
-    if (stmt->else_body)
-        visit(stmt->else_body);
-}
+    struct ast_node *child = NULL;
+    struct ast_node *stmt  = ana_enclosing_stmt(ctx, ast, &child);
 
-static void visit_for(struct ast_node *ast)
-{
-    struct ast_for *stmt = ast->ast;
-    visit(stmt->body);
-}
+    if (!stmt)
+        return false;
 
-static void visit_while(struct ast_node *ast)
-{
-    struct ast_while *stmt = ast->ast;
-    visit(stmt->body);
-}
-
-static void visit_do_while(struct ast_node *ast)
-{
-    struct ast_do_while *stmt = ast->ast;
-    visit(stmt->body);
+    switch (stmt->type) {
+    case AST_IF_STMT: {
+        struct ast_if *if_stmt = stmt->ast;
+        return child != if_stmt->body && child != if_stmt->else_body;
+    }
+    case AST_FOR_STMT:
+        return ( (struct ast_for *) stmt->ast )->body != child;
+    case AST_WHILE_STMT:
+        return ( (struct ast_while *) stmt->ast )->body != child;
+    case AST_DO_WHILE_STMT:
+        return ( (struct ast_do_while *) stmt->ast )->body != child;
+    default:
+        return false;
+    }
 }
 
-static void visit_return(struct ast_node *ast)
+static void post_return(unused struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_ret *stmt = ast->ast;
     if (stmt->op) {
-        visit(stmt->op);
         last_ret.line_no = ast->line_no;
         last_ret.col_no = ast->col_no;
         last_ret.occurred = true;
     }
 }
 
-static void visit_fn_decl(struct ast_node *ast)
+static void post_fn_decl(unused struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_fn_decl *decl = ast->ast;
-    fn_storage_push(&fn_storage, decl->name, decl);
-    /* Don't need to analyze arguments though. */
-    visit(decl->body);
 
-    uint16_t line_no = last_ret.line_no;
-    uint16_t col_no = last_ret.col_no;
+    uint32_t line_no = last_ret.line_no;
+    uint32_t col_no = last_ret.col_no;
 
-    if (last_ret.occurred && decl->data_type == D_T_VOID) {
-        reset();
+    if (last_ret.occurred && decl->data_type == D_T_VOID)
         weak_compile_error(
             line_no, col_no,
             "Cannot return value from void function"
         );
-    }
 
-    if (!last_ret.occurred && decl->data_type != D_T_VOID) {
-        reset();
+    if (!last_ret.occurred && decl->data_type != D_T_VOID)
         weak_compile_error(
             ast->line_no, ast->col_no,
             "Expected return value"
         );
+}
+
+static struct builtin_fn *builtin_lookup(const char *name)
+{
+    for (uint64_t i = 0; i < __weak_array_size(builtin_fns); ++i)
+         if (strcmp(builtin_fns[i].name, name) == 0)
+            return &builtin_fns[i];
+
+    return NULL;
+}
+
+/* \return Count of function arguments or -1 if it is not found. */
+static int64_t fn_args_cnt(struct ana_ctx *ctx, const char *name)
+{
+    struct ast_storage_decl *decl = ast_storage_lookup(&ctx->storage, name);
+
+    if (decl && decl->ast->type == AST_FUNCTION_DECL) {
+        struct ast_fn_decl *fn = decl->ast->ast;
+        return ( (struct ast_compound *) fn->args->ast )->size;
     }
+
+    struct builtin_fn *builtin = builtin_lookup(name);
+    if (builtin)
+        return builtin->args_cnt;
+
+    return -1;
 }
 
-static void visit_fn_call(struct ast_node *ast)
+static bool pre_fn_call(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_fn_call  *stmt      = ast->ast;
-    struct builtin_fn   *fn        = fn_storage_lookup(&fn_storage, stmt->name);
     struct ast_compound *call_args = stmt->args->ast;
 
-    if (call_args->size != fn->args_cnt)
+    if (in_stmt_header(ctx, ast))
+        return false;
+
+    int64_t args_cnt = fn_args_cnt(ctx, stmt->name);
+
+    /* Not a function, reported by type checker. */
+    if (args_cnt < 0)
+        return true;
+
+    if (call_args->size != (uint64_t) args_cnt)
         weak_compile_error(
             ast->line_no,
             ast->col_no,
             "Arguments size mismatch: %u got, but %u expected",
             call_args->size,
-            fn->args_cnt
+            args_cnt
         );
 
-    for (uint64_t i = 0; i < call_args->size; ++i)
-        visit(call_args->stmts[i]);
+    return true;
 }
 
-static void visit_cast(struct ast_node *ast)
+static bool pre_cast(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_implicit_cast *cast = ast->ast;
-    visit(cast->body);
+    return !in_stmt_header(ctx, ast);
 }
 
-void visit(struct ast_node *ast)
-{
-    assert(ast);
-
-    switch (ast->type) {
-    case AST_CHAR: /* Unused. */
-    case AST_INT: /* Unused. */
-    case AST_FLOAT: /* Unused. */
-    case AST_STRING: /* Unused. */
-    case AST_BOOL: /* Unused. */
-    case AST_STRUCT_DECL: /* Unused. */
-    case AST_BREAK_STMT: /* Unused. */
-    case AST_CONTINUE_STMT: /* Unused. */
-    case AST_VAR_DECL: /* Unused. */
-    case AST_SYMBOL: /* Unused. */
-    case AST_ARRAY_DECL: /* Unused. */
-    case AST_BINARY: /* Unused. */
-    case AST_PREFIX_UNARY: /* Unused. */
-    case AST_POSTFIX_UNARY: /* Unused. */
-    case AST_ARRAY_ACCESS: /* Unused. */
-    case AST_MEMBER: /* Unused. */
-        break;
-    case AST_COMPOUND_STMT:
-        visit_compound(ast);
-        break;
-    case AST_IF_STMT:
-        visit_if(ast);
-        break;
-    case AST_FOR_STMT:
-        visit_for(ast);
-        break;
-    case AST_WHILE_STMT:
-        visit_while(ast);
-        break;
-    case AST_DO_WHILE_STMT:
-        visit_do_while(ast);
-        break;
-    case AST_RETURN_STMT:
-        visit_return(ast);
-        break;
-    case AST_FUNCTION_DECL:
-        visit_fn_decl(ast);
-        break;
-    case AST_FUNCTION_CALL:
-        visit_fn_call(ast);
-        break;
-    case AST_IMPLICIT_CAST:
-        visit_cast(ast);
-        break;
-    default: {
-        enum ast_type t = ast->type;
-        weak_unreachable("Unknown AST type (%d, %s).", t, ast_type_to_string(t));
-    }
+const struct ana_pass ana_fn_pass = {
+    .name = "fn",
+    .init = init,
+    .pre = {
+        [AST_VAR_DECL]      = skip,
+        [AST_ARRAY_DECL]    = skip,
+        [AST_BINARY]        = skip,
+        [AST_PREFIX_UNARY]  = skip,
+        [AST_POSTFIX_UNARY] = skip,
+        [AST_ARRAY_ACCESS]  = skip,
+        [AST_MEMBER]        = skip,
+        [AST_FUNCTION_CALL] = pre_fn_call,
+        [AST_IMPLICIT_CAST] = pre_cast,
+    },
+    .post = {
+        [AST_RETURN_STMT]   = post_return,
+        [AST_FUNCTION_DECL] = post_fn_decl,
     }
-}
+};
 
 void ana_fn(struct ast_node *root)
 {
-    init();
-    visit(root);
-    reset();
-}
\ No newline at end of file
+    const struct ana_pass *passes[] = { &ana_fn_pass };
+    ana_run_passes(root, passes, 1);
+}
@@ -7,23 +7,19 @@
 #include "front_end/anal/fn_storage.h"
 #include "front_end/ast/ast.h"
 #include "util/alloc.h"
-#include "util/crc32.h"
 #include "builtins.h"
 #include <string.h>
 
 void fn_storage_init(fn_storage_t *s)
 {
-    hashmap_reset(s, 512);
+    sym_table_init(s);
 }
 
 void fn_storage_free(fn_storage_t *s)
 {
-    hashmap_foreach(s, k, v) {
-        (void) k;
-        struct builtin_fn *fn = (struct builtin_fn *) v;
-        weak_free(fn);
-    }
-    hashmap_destroy(s);
+    sym_table_foreach(s, b)
+        weak_free(b->data);
+    sym_table_free(s);
 }
 
 void fn_storage_push(
@@ -43,8 +39,7 @@ void fn_storage_push(
         fn->args[i] = arg->dt;
     }
 
-    hashmap_put(s, crc32_string(name), (uint64_t) fn);
-
+    sym_table_put(s, name, fn);
 }
 
 
@@ -62,12 +57,10 @@ struct builtin_fn *fn_storage_lookup(
     fn_storage_t *s,
     const char   *name
 ) {
-    uint64_t hash = crc32_string(name);
-    bool     ok   = 0;
-    uint64_t addr = hashmap_get(s, hash, &ok);
+    struct builtin_fn *fn = sym_table_get(s, name);
 
-    if (!ok || addr == 0)
+    if (!fn)
         return fn_builtin_lookup(name);
 
-    return (struct builtin_fn *) addr;
+    return fn;
 }
\ No newline at end of file
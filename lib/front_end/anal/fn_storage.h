@@ -7,17 +7,20 @@
 #ifndef WEAK_COMPILER_FRONTEND_ANALYSIS_FN_STORAGE_H
 #define WEAK_COMPILER_FRONTEND_ANALYSIS_FN_STORAGE_H
 
-#include "util/hashmap.h"
+#include "front_end/anal/sym_table.h"
 
 struct ast_fn_decl;
 struct builtin_fn;
 
-/** - Key:   CRC-32 of function name.
+/** - Key:   Interned function name.
     - Value: Pointer to malloc()'ed struct builtin.
 
+   Functions are declared only at global scope, so table
+   always has depth 0.
+
    \note Storages for AST and functions are different
          because of bit different semantics. */
-typedef hashmap_t fn_storage_t;
+typedef struct sym_table fn_storage_t;
 
 void fn_storage_init(fn_storage_t *s);
 void fn_storage_free(fn_storage_t *s);
@@ -0,0 +1,82 @@
+/* sym_table.c - Scoped symbol table.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/sym_table.h"
+#include "util/intern.h"
+#include <string.h>
+
+void sym_table_init(struct sym_table *t)
+{
+    memset(t, 0, sizeof (*t));
+}
+
+void sym_table_free(struct sym_table *t)
+{
+    hashmap_destroy(&t->index);
+    vector_free(t->log);
+    vector_free(t->scopes);
+}
+
+void sym_table_start_scope(struct sym_table *t)
+{
+    vector_push_back(t->scopes, t->log.count);
+}
+
+void sym_table_end_scope(struct sym_table *t)
+{
+    uint64_t begin = sym_table_scope_begin(t);
+
+    /* Reverse order, so that redeclarations in the same
+       scope restore correctly. */
+    while (t->log.count > begin) {
+        struct sym_table_binding *b  = &vector_back(t->log);
+        uint64_t                  id = intern_id(b->name);
+
+        if (b->shadowed != SYM_TABLE_NO_SHADOW)
+            hashmap_put(&t->index, id, b->shadowed);
+        else
+            hashmap_remove(&t->index, id);
+
+        --t->log.count;
+    }
+
+    if (t->scopes.count > 0)
+        --t->scopes.count;
+}
+
+uint64_t sym_table_depth(struct sym_table *t)
+{
+    return t->scopes.count;
+}
+
+void sym_table_put(struct sym_table *t, const char *name, void *data)
+{
+    uint64_t id       = intern_id(name);
+    bool     ok       = 0;
+    uint64_t shadowed = hashmap_get(&t->index, id, &ok);
+
+    struct sym_table_binding b = {
+        .name     = name,
+        .data     = data,
+        .shadowed = ok ? shadowed : SYM_TABLE_NO_SHADOW
+    };
+
+    hashmap_put(&t->index, id, t->log.count);
+    vector_push_back(t->log, b);
+}
+
+void *sym_table_get(struct sym_table *t, const char *name)
+{
+    bool     ok  = 0;
+    uint64_t idx = hashmap_get(&t->index, intern_id(name), &ok);
+
+    return ok ? t->log.data[idx].data : NULL;
+}
+
+uint64_t sym_table_scope_begin(struct sym_table *t)
+{
+    return t->scopes.count > 0 ? vector_back(t->scopes) : 0;
+}
@@ -0,0 +1,80 @@
+/* sym_table.h - Scoped symbol table.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_ANALYSIS_SYM_TABLE_H
+#define WEAK_COMPILER_FRONTEND_ANALYSIS_SYM_TABLE_H
+
+#include "util/compiler.h"
+#include "util/hashmap.h"
+#include "util/vector.h"
+#include <stdint.h>
+
+#define SYM_TABLE_NO_SHADOW ((uint64_t) -1)
+
+struct sym_table_binding {
+    const char *name;
+    void       *data;
+    /** Binding of the same name in outer scope, restored when
+        this one goes out of scope. Index in log or
+        SYM_TABLE_NO_SHADOW. */
+    uint64_t    shadowed;
+};
+
+/** Symbol table with lexical scopes.
+
+    All bindings are kept in a log (stack) in declaration order.
+    Scope start remembers log size; scope end pops bindings back
+    to it, so it costs O(declarations in scope), independently
+    of table size. Name in inner scope shadows outer one, which
+    becomes visible again after inner scope ends.
+
+    Hashmap maps interned id of name to log index of innermost
+    binding.
+
+    \note Memory is allocated lazily on first insertion.
+    \note Names must be interned. */
+struct sym_table {
+    hashmap_t                          index;
+    vector_t(struct sym_table_binding) log;
+    /** Log size at the start of each open scope. */
+    vector_t(uint64_t)                 scopes;
+};
+
+void sym_table_init(struct sym_table *t);
+void sym_table_free(struct sym_table *t);
+
+void sym_table_start_scope(struct sym_table *t);
+
+/** Drop all bindings of innermost scope. Data pointers
+    are not freed, use sym_table_scope_foreach() before if
+    needed. */
+void sym_table_end_scope(struct sym_table *t);
+
+/** \return Count of open scopes. 0 means global scope. */
+wur uint64_t sym_table_depth(struct sym_table *t);
+
+/** Bind name in the current scope. */
+void sym_table_put(struct sym_table *t, const char *name, void *data);
+
+/** \return Data of innermost visible binding or NULL. */
+wur void *sym_table_get(struct sym_table *t, const char *name);
+
+/** \return Log index of first binding of innermost scope. */
+wur uint64_t sym_table_scope_begin(struct sym_table *t);
+
+/** Iterate over bindings of innermost scope in declaration order. */
+#define sym_table_scope_foreach(t, b)                                    \
+    for (struct sym_table_binding *b = (t)->log.data +                   \
+            sym_table_scope_begin((t));                                  \
+         b < (t)->log.data + (t)->log.count; ++b)
+
+/** Iterate over all bindings, including shadowed ones, in
+    declaration order. */
+#define sym_table_foreach(t, b)                                          \
+    for (struct sym_table_binding *b = (t)->log.data;                    \
+         b < (t)->log.data + (t)->log.count; ++b)
+
+#endif // WEAK_COMPILER_FRONTEND_ANALYSIS_SYM_TABLE_H
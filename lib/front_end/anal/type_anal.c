@@ -6,43 +6,68 @@
 
 #include "front_end/anal/anal.h"
 #include "front_end/anal/ast_storage.h"
+#include "front_end/anal/visitor.h"
 #include "front_end/ast/ast.h"
+#include "front_end/ast/ast_walk.h"
 #include "util/diagnostic.h"
 #include "util/lexical.h"
+#include "util/thread.h"
 #include "util/unreachable.h"
 #include <assert.h>
 
-static enum data_type     last_dt = D_T_UNKNOWN;
-static uint16_t           last_indir_lvl = 0;
-static enum data_type     last_return_dt = D_T_UNKNOWN;
-static struct ast_storage storage;
+static _Thread_local enum data_type     last_dt = D_T_UNKNOWN;
+static _Thread_local uint16_t           last_indir_lvl = 0;
+static _Thread_local enum data_type     last_return_dt = D_T_UNKNOWN;
+static _Thread_local struct ast_storage storage;
+/* Kept between calls, since errors exit with longjmp. */
+static _Thread_local struct ast_walk    walk;
+
+static void reset()
+{
+    last_dt = D_T_UNKNOWN;
+    last_return_dt = D_T_UNKNOWN;
+    ast_storage_free(&storage);
+    ast_walk_free(&walk);
+}
 
 static void init()
 {
     ast_storage_init(&storage);
+    weak_thread_atexit(reset);
 }
 
-static void reset()
+/* Each visit_* function is called with node on top of walk
+   once at start and once after each child it pushed. Type
+   of visited child is then in last_dt and last_indir_lvl. */
+static void visit(struct ast_node *ast)
 {
-    last_dt = D_T_UNKNOWN;
-    last_return_dt = D_T_UNKNOWN;
-    ast_storage_free(&storage);
+    ast_walk_push(&walk, ast);
 }
 
-static void visit(struct ast_node *ast);
+static void leave()
+{
+    ast_walk_pop(&walk);
+}
 
-static void visit_char  () { last_indir_lvl = 0; last_dt = D_T_CHAR; }
-static void visit_num   () { last_indir_lvl = 0; last_dt = D_T_INT; }
-static void visit_float () { last_indir_lvl = 0; last_dt = D_T_FLOAT; }
-static void visit_string() { last_indir_lvl = 0; last_dt = D_T_STRING; }
-static void visit_bool  () { last_indir_lvl = 0; last_dt = D_T_BOOL; }
+static void visit_char  () { last_indir_lvl = 0; last_dt = D_T_CHAR;   leave(); }
+static void visit_num   () { last_indir_lvl = 0; last_dt = D_T_INT;    leave(); }
+static void visit_float () { last_indir_lvl = 0; last_dt = D_T_FLOAT;  leave(); }
+static void visit_string() { last_indir_lvl = 0; last_dt = D_T_STRING; leave(); }
+static void visit_bool  () { last_indir_lvl = 0; last_dt = D_T_BOOL;   leave(); }
 
-static void visit_implicit_cast(struct ast_node *ast)
+static void visit_implicit_cast(struct ast_walk_frame *f)
 {
-    struct ast_implicit_cast *cast = ast->ast;
+    struct ast_implicit_cast *cast = f->ast->ast;
 
-    last_dt = cast->to;
-    visit(cast->body);
+    switch (f->step++) {
+    case 0:
+        last_dt = cast->to;
+        visit(cast->body);
+        break;
+    default:
+        leave();
+        break;
+    }
 }
 
 static bool correct_bin_ops(enum token_type op, enum data_type t)
@@ -107,15 +132,28 @@ static bool correct_bin_ops(enum token_type op, enum data_type t)
     return are_correct;
 }
 
-static void visit_binary(struct ast_node *ast)
+static void visit_binary(struct ast_walk_frame *f)
 {
+    struct ast_node   *ast  = f->ast;
     struct ast_binary *stmt = ast->ast;
 
-    visit(stmt->lhs);
-    enum data_type l_dt = last_dt;
-    uint16_t l_indir_lvl = last_indir_lvl;
+    switch (f->step++) {
+    case 0:
+        visit(stmt->lhs);
+        return;
+    case 1:
+        f->data[0] = last_dt;
+        f->data[1] = last_indir_lvl;
+        visit(stmt->rhs);
+        return;
+    default:
+        break;
+    }
+
+    enum data_type l_dt = f->data[0];
+    uint16_t l_indir_lvl = f->data[1];
+    leave();
 
-    visit(stmt->rhs);
     enum data_type r_dt = last_dt;
     uint16_t r_indir_lvl = last_indir_lvl;
 
@@ -149,10 +187,17 @@ static void visit_binary(struct ast_node *ast)
     }
 }
 
-static void visit_unary(struct ast_node *ast)
+static void visit_unary(struct ast_walk_frame *f)
 {
+    struct ast_node  *ast  = f->ast;
     struct ast_unary *stmt = ast->ast;
-    visit(stmt->operand);
+
+    if (f->step++ == 0) {
+        visit(stmt->operand);
+        return;
+    }
+
+    leave();
     enum data_type dt = last_dt;
 
     switch (stmt->op) {
@@ -191,13 +236,22 @@ static void visit_symbol(struct ast_node *ast)
 
     last_dt = record->data_type;
     last_indir_lvl = record->ptr_depth;
+    leave();
 }
 
-static void visit_var_decl(struct ast_node *ast)
+static void visit_var_decl(struct ast_walk_frame *f)
 {
+    struct ast_node     *ast  = f->ast;
     struct ast_var_decl *decl = ast->ast;
-    if (decl->body) {
+
+    if (f->step++ == 0 && decl->body) {
         visit(decl->body);
+        return;
+    }
+
+    leave();
+
+    if (decl->body) {
         bool are_correct = 0;
         are_correct |= decl->dt == last_dt;
         are_correct |= decl->ptr_depth == 1 && last_dt == D_T_STRING;
@@ -233,6 +287,7 @@ static void visit_array_decl(struct ast_node *ast)
     ast_storage_push_typed(&storage, decl->name, decl->dt, decl->ptr_depth, ast);
     last_dt = decl->dt;
     last_indir_lvl = decl->ptr_depth;
+    leave();
 }
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -280,9 +335,32 @@ static void out_of_range_analysis(struct ast_node *decl_indices_ast, struct ast_
 }
 #undef MIN
 
-static void visit_array_access(struct ast_node *ast)
+static void visit_array_access(struct ast_walk_frame *f)
 {
-    struct ast_array_access *stmt = ast->ast;
+    struct ast_node         *ast       = f->ast;
+    struct ast_array_access *stmt      = ast->ast;
+    struct ast_compound     *enclosure = stmt->indices->ast;
+    uint32_t                 i         = f->step++;
+
+    if (i > 0) {
+        /* Index `i - 1` is visited. */
+        if (last_dt != D_T_INT)
+            weak_compile_error(
+                enclosure->stmts[i - 1]->line_no,
+                enclosure->stmts[i - 1]->col_no,
+                "Expected integer as array index, got %s",
+                data_type_to_string(last_dt)
+            );
+
+        if (i < enclosure->size) {
+            visit(enclosure->stmts[i]);
+        } else {
+            last_dt = f->data[0];
+            leave();
+        }
+        return;
+    }
+
     struct ast_node *record = ast_storage_lookup(&storage, stmt->name)->ast;
     enum data_type decl_dt = D_T_UNKNOWN;
 
@@ -302,19 +380,15 @@ static void visit_array_access(struct ast_node *ast)
             );
         decl_dt = decl->dt;
     }
-    struct ast_compound *enclosure = stmt->indices->ast;
-    for (uint64_t i = 0; i < enclosure->size; ++i) {
-        visit(enclosure->stmts[i]);
-        if (last_dt != D_T_INT)
-            weak_compile_error(
-                enclosure->stmts[i]->line_no,
-                enclosure->stmts[i]->col_no,
-                "Expected integer as array index, got %s",
-                data_type_to_string(last_dt)
-            );
-    }
 
-    last_dt = decl_dt;
+    f->data[0] = decl_dt;
+
+    if (enclosure->size > 0) {
+        visit(enclosure->stmts[0]);
+    } else {
+        last_dt = decl_dt;
+        leave();
+    }
 }
 
 static void require_last_dt_convertible_to_bool(struct ast_node *location)
@@ -329,65 +403,125 @@ static void require_last_dt_convertible_to_bool(struct ast_node *location)
         );
 }
 
-static void visit_if(struct ast_node *ast)
+/* Optional children are pushed as NULL, which only moves
+   to the next step. */
+static void visit_if(struct ast_walk_frame *f)
 {
-    struct ast_if *stmt = ast->ast;
-    visit(stmt->condition);
-    require_last_dt_convertible_to_bool(ast);
+    struct ast_node *ast  = f->ast;
+    struct ast_if   *stmt = ast->ast;
 
-    visit(stmt->body);
-    if (stmt->else_body)
+    switch (f->step++) {
+    case 0:
+        visit(stmt->condition);
+        break;
+    case 1:
+        require_last_dt_convertible_to_bool(ast);
+        visit(stmt->body);
+        break;
+    case 2:
         visit(stmt->else_body);
+        break;
+    default:
+        leave();
+        break;
+    }
 }
 
-static void visit_for(struct ast_node *ast)
+static void visit_for(struct ast_walk_frame *f)
 {
-    struct ast_for *stmt = ast->ast;
-    if (stmt->init)
+    struct ast_node *ast  = f->ast;
+    struct ast_for  *stmt = ast->ast;
+
+    switch (f->step++) {
+    case 0:
         visit(stmt->init);
-    if (stmt->condition) {
+        break;
+    case 1:
         visit(stmt->condition);
-        require_last_dt_convertible_to_bool(ast);
-    }
-    if (stmt->increment)
+        break;
+    case 2:
+        if (stmt->condition)
+            require_last_dt_convertible_to_bool(ast);
         visit(stmt->increment);
-    visit(stmt->body);
+        break;
+    case 3:
+        visit(stmt->body);
+        break;
+    default:
+        leave();
+        break;
+    }
 }
 
-static void visit_while(struct ast_node *ast)
+static void visit_while(struct ast_walk_frame *f)
 {
+    struct ast_node  *ast  = f->ast;
     struct ast_while *stmt = ast->ast;
-    visit(stmt->cond);
-    require_last_dt_convertible_to_bool(ast);
-    visit(stmt->body);
+
+    switch (f->step++) {
+    case 0:
+        visit(stmt->cond);
+        break;
+    case 1:
+        require_last_dt_convertible_to_bool(ast);
+        visit(stmt->body);
+        break;
+    default:
+        leave();
+        break;
+    }
 }
 
-static void visit_do_while(struct ast_node *ast)
+static void visit_do_while(struct ast_walk_frame *f)
 {
+    struct ast_node     *ast  = f->ast;
     struct ast_do_while *stmt = ast->ast;
-    visit(stmt->body);
-    visit(stmt->condition);
-    require_last_dt_convertible_to_bool(ast);
+
+    switch (f->step++) {
+    case 0:
+        visit(stmt->body);
+        break;
+    case 1:
+        visit(stmt->condition);
+        break;
+    default:
+        leave();
+        require_last_dt_convertible_to_bool(ast);
+        break;
+    }
 }
 
-static void visit_return(struct ast_node *ast)
+static void visit_return(struct ast_walk_frame *f)
 {
-    struct ast_ret *stmt = ast->ast;
-    if (stmt->op)
+    struct ast_ret *stmt = f->ast->ast;
+
+    if (f->step++ == 0) {
         visit(stmt->op);
+        return;
+    }
+
     last_return_dt = last_dt;
+    leave();
 }
 
-static void visit_compound(struct ast_node *ast)
+static void visit_compound(struct ast_walk_frame *f)
 {
-    struct ast_compound *stmt = ast->ast;
-    ast_storage_start_scope(&storage);
-    for (uint64_t i = 0; i < stmt->size; ++i)
+    struct ast_compound *stmt = f->ast->ast;
+    uint32_t             i    = f->step++;
+
+    if (i == 0)
+        ast_storage_start_scope(&storage);
+
+    if (i < stmt->size) {
         visit(stmt->stmts[i]);
+        return;
+    }
+
     ast_storage_end_scope(&storage);
+    leave();
 }
 
-static char *decl_name(struct ast_node *decl)
+static const char *decl_name(struct ast_node *decl)
 {
     if (decl->type == AST_VAR_DECL)
         return ( (struct ast_var_decl *) decl->ast )->name;
@@ -398,19 +532,28 @@ static char *decl_name(struct ast_node *decl)
     weak_unreachable("Declaration expected.");
 }
 
-static void visit_fn_call(struct ast_node *ast)
+/* Each argument takes two steps: declaration of function
+   argument and then expression passed. */
+static void visit_fn_call(struct ast_walk_frame *f)
 {
+    struct ast_node    *ast  = f->ast;
     struct ast_fn_call *call = ast->ast;
-    struct ast_node *decl = ast_storage_lookup(&storage, call->name)->ast;
-    if (decl->type != AST_FUNCTION_DECL)
-        weak_compile_error(
-            ast->line_no,
-            ast->col_no,
-            "`%s` is not a function",
-            call->name
-        );
+    uint32_t            step = f->step++;
+
+    if (step == 0) {
+        struct ast_node *decl = ast_storage_lookup(&storage, call->name)->ast;
+        if (decl->type != AST_FUNCTION_DECL)
+            weak_compile_error(
+                ast->line_no,
+                ast->col_no,
+                "`%s` is not a function",
+                call->name
+            );
+
+        f->data[0] = (uint64_t) decl->ast;
+    }
 
-    struct ast_fn_decl *fun = decl->ast;
+    struct ast_fn_decl *fun = (struct ast_fn_decl *) f->data[0];
     struct ast_compound *fun_args = fun->args->ast;
     struct ast_compound *call_args = call->args->ast;
     assert(
@@ -418,12 +561,19 @@ static void visit_fn_call(struct ast_node *ast)
         "Call arguments size checked in function analyzer."
     );
 
-    for (uint64_t i = 0; i < call_args->size; ++i) {
-        visit(fun_args->stmts[i]);
-        enum data_type l_dt = last_dt;
-        uint64_t l_indir_lvl = last_indir_lvl;
+    if (step % 2 == 1) {
+        f->data[1] = last_dt;
+        f->data[2] = last_indir_lvl;
+        visit(call_args->stmts[step / 2]);
+        return;
+    }
+
+    if (step > 0) {
+        uint64_t i = step / 2 - 1;
+
+        enum data_type l_dt = f->data[1];
+        uint64_t l_indir_lvl = f->data[2];
 
-        visit(call_args->stmts[i]);
         enum data_type r_dt = last_dt;
         uint64_t r_indir_lvl = last_indir_lvl;
 
@@ -446,27 +596,49 @@ static void visit_fn_call(struct ast_node *ast)
                 r_indir_lvl
             );
     }
+
+    if (step / 2 < call_args->size) {
+        visit(fun_args->stmts[step / 2]);
+        return;
+    }
+
     last_dt = fun->data_type;
     last_indir_lvl = fun->ptr_depth;
+    leave();
 }
 
-static void visit_fn_decl(struct ast_node *ast)
+static void visit_fn_decl(struct ast_walk_frame *f)
 {
+    struct ast_node *ast = f->ast;
     struct ast_fn_decl *decl = ast->ast;
     enum data_type dt = decl->data_type;
     if (decl->body == NULL) { /* Function prototype. */
         ast_storage_push_typed(&storage, decl->name, D_T_FUNC, decl->ptr_depth, ast);
+        leave();
         return;
     }
-    ast_storage_start_scope(&storage);
-    /* This is to have function in recursive calls. */
-    ast_storage_push_typed(&storage, decl->name, D_T_FUNC, decl->ptr_depth, ast);
     /* Don't just visit compound AST, which creates and terminates scope. */
     struct ast_compound *args = decl->args->ast;
-    for (uint64_t i = 0; i < args->size; ++i)
+    uint32_t             i    = f->step++;
+
+    if (i == 0) {
+        ast_storage_start_scope(&storage);
+        /* This is to have function in recursive calls. */
+        ast_storage_push_typed(&storage, decl->name, D_T_FUNC, decl->ptr_depth, ast);
+    }
+
+    if (i < args->size) {
         visit(args->stmts[i]);
+        return;
+    }
+
+    if (i == args->size) {
+        visit(decl->body);
+        return;
+    }
+
+    leave();
 
-    visit(decl->body);
     if (dt != D_T_VOID && dt != last_return_dt)
         weak_compile_error(
             ast->line_no,
@@ -480,15 +652,16 @@ static void visit_fn_decl(struct ast_node *ast)
     ast_storage_push_typed(&storage, decl->name, D_T_FUNC, decl->ptr_depth, ast);
 }
 
-void visit(struct ast_node *ast)
+static void visit_step(struct ast_walk_frame *f)
 {
-    assert(ast);
+    struct ast_node *ast = f->ast;
 
     switch (ast->type) {
     case AST_MEMBER: /* Unused... Or should be used? */
     case AST_STRUCT_DECL: /* Unused... Or should be used? */
     case AST_BREAK_STMT: /* Unused. */
     case AST_CONTINUE_STMT: /* Unused. */
+        leave();
         break;
     case AST_CHAR:
         visit_char();
@@ -509,47 +682,47 @@ void visit(struct ast_node *ast)
         visit_symbol(ast);
         break;
     case AST_VAR_DECL:
-        visit_var_decl(ast);
+        visit_var_decl(f);
         break;
     case AST_ARRAY_DECL:
         visit_array_decl(ast);
         break;
     case AST_BINARY:
-        visit_binary(ast);
+        visit_binary(f);
         break;
     case AST_PREFIX_UNARY:
     case AST_POSTFIX_UNARY: /* Fall through. */
-        visit_unary(ast);
+        visit_unary(f);
         break;
     case AST_ARRAY_ACCESS:
-        visit_array_access(ast);
+        visit_array_access(f);
         break;
     case AST_IF_STMT:
-        visit_if(ast);
+        visit_if(f);
         break;
     case AST_FOR_STMT:
-        visit_for(ast);
+        visit_for(f);
         break;
     case AST_WHILE_STMT:
-        visit_while(ast);
+        visit_while(f);
         break;
     case AST_DO_WHILE_STMT:
-        visit_do_while(ast);
+        visit_do_while(f);
         break;
     case AST_RETURN_STMT:
-        visit_return(ast);
+        visit_return(f);
         break;
     case AST_COMPOUND_STMT:
-        visit_compound(ast);
+        visit_compound(f);
         break;
     case AST_FUNCTION_DECL:
-        visit_fn_decl(ast);
+        visit_fn_decl(f);
         break;
     case AST_FUNCTION_CALL:
-        visit_fn_call(ast);
+        visit_fn_call(f);
         break;
     case AST_IMPLICIT_CAST:
-        visit_implicit_cast(ast);
+        visit_implicit_cast(f);
         break;
     default: {
         enum ast_type t = ast->type;
@@ -560,7 +733,21 @@ void visit(struct ast_node *ast)
 
 void ana_type(struct ast_node *root)
 {
+    struct ast_walk_frame *f = NULL;
+
     init();
-    visit(root);
+    ast_walk_init(&walk, root);
+
+    while ((f = ast_walk_top(&walk)))
+        visit_step(f);
+
     reset();
 }
+
+/* Type of expression is computed from children in own
+   order (e.g. do-while body before condition), so this
+   walks tree by itself. */
+const struct ana_pass ana_type_pass = {
+    .name = "type",
+    .walk = ana_type
+};
@@ -6,6 +6,7 @@
 
 #include "front_end/anal/anal.h"
 #include "front_end/anal/ast_storage.h"
+#include "front_end/anal/visitor.h"
 #include "front_end/ast/ast.h"
 #include "util/diagnostic.h"
 #include "util/unreachable.h"
@@ -14,45 +15,6 @@
 #include <assert.h>
 #include <string.h>
 
-typedef vector_t         (struct ast_node *)  ast_array_t;
-typedef vector_t(vector_t(struct ast_node *)) ast_usage_stack_t;
-
-static struct ast_storage storage;
-
-static ast_usage_stack_t usages = {0};
-
-static void use_start_scope()
-{
-    vector_emplace_back(usages);
-}
-
-static void use_end_scope()
-{
-    vector_erase(usages, usages.count - 1);
-}
-
-static void init()
-{
-    /* Initialize first stack entry for the first
-       scope depth. */
-    use_start_scope();
-    ast_storage_init(&storage);
-}
-
-static void reset()
-{
-    vector_foreach(usages, i) {
-        vector_free(usages.data[i]);
-    }
-    vector_free(usages);
-    ast_storage_free(&storage);
-}
-
-static void collect_ast(struct ast_node *ast)
-{
-    vector_push_back(vector_back(usages), ast);
-}
-
 static bool is_assignment_op(enum token_type e)
 {
     switch (e) {
@@ -96,7 +58,7 @@ static const char *ast_decl_or_expr_to_string(struct ast_node *ast)
     }
 }
 
-static void add_use(struct ast_node *ast, bool is_write)
+static void add_use(struct ast_storage *storage, struct ast_node *ast, bool is_write)
 {
     void (*usage_add_fun)(struct ast_storage *, const char *) = is_write
         ? ast_storage_add_write_use
@@ -105,24 +67,24 @@ static void add_use(struct ast_node *ast, bool is_write)
     switch (ast->type) {
     case AST_FUNCTION_CALL: {
         struct ast_fn_call *stmt = ast->ast;
-        usage_add_fun(&storage, stmt->name);
+        usage_add_fun(storage, stmt->name);
         break;
     }
     case AST_SYMBOL: {
         struct ast_sym *sym = ast->ast;
-        usage_add_fun(&storage, sym->value);
+        usage_add_fun(storage, sym->value);
         break;
     }
     case AST_ARRAY_ACCESS: {
         struct ast_array_access *access = ast->ast;
-        usage_add_fun(&storage, access->name);
+        usage_add_fun(storage, access->name);
         break;
     }
     case AST_MEMBER: {
         struct ast_member *member = ast->ast;
         if (member->structure->type == AST_SYMBOL) {
             struct ast_sym *sym = member->structure->ast;
-            usage_add_fun(&storage, sym->value);
+            usage_add_fun(storage, sym->value);
         }
         /* Otherwise it can be unary statement like
            *(var).member. */
@@ -132,20 +94,42 @@ static void add_use(struct ast_node *ast, bool is_write)
     }
 }
 
-static void use_add_read(struct ast_node *ast)
+static void use_add_read(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    add_use(ast, /*is_write=*/false);
+    add_use(&ctx->storage, ast, /*is_write=*/false);
 }
 
-static void use_add_write(struct ast_node *ast)
+static void use_add_write(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    add_use(ast, /*is_write=*/true);
+    add_use(&ctx->storage, ast, /*is_write=*/true);
 }
 
-static void uses_mark_top_scope_as_read()
+/* Loop condition is evaluated on each iteration, so all
+   variables in it are read. */
+static bool in_loop_condition(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    for (uint64_t i = 0; i < vector_back(usages).count; ++i)
-        use_add_read(vector_back(usages).data[i]);
+    struct ast_node *child = NULL;
+    struct ast_node *stmt  = ana_enclosing_stmt(ctx, ast, &child);
+
+    if (!stmt)
+        return false;
+
+    switch (stmt->type) {
+    case AST_FOR_STMT:
+        return ( (struct ast_for *) stmt->ast )->condition == child;
+    case AST_WHILE_STMT:
+        return ( (struct ast_while *) stmt->ast )->cond == child;
+    case AST_DO_WHILE_STMT:
+        return ( (struct ast_do_while *) stmt->ast )->condition == child;
+    default:
+        return false;
+    }
+}
+
+static void collect_ast(struct ana_ctx *ctx, struct ast_node *ast)
+{
+    if (in_loop_condition(ctx, ast))
+        use_add_read(ctx, ast);
 }
 
 static bool is_builtin(const char *name)
@@ -157,10 +141,10 @@ static bool is_builtin(const char *name)
     return 0;
 }
 
-static void assert_is_declared(const char *name, struct ast_node *loc)
+static void assert_is_declared(struct ana_ctx *ctx, const char *name, struct ast_node *loc)
 {
     if (is_builtin(name)) return;
-    if (ast_storage_lookup(&storage, name)) return;
+    if (ast_storage_lookup(&ctx->storage, name)) return;
     weak_compile_error(
         loc->line_no,
         loc->col_no,
@@ -169,9 +153,9 @@ static void assert_is_declared(const char *name, struct ast_node *loc)
     );
 }
 
-static void assert_is_not_declared(const char *name, struct ast_node *loc)
+static void assert_is_not_declared(struct ana_ctx *ctx, const char *name, struct ast_node *loc)
 {
-    struct ast_storage_decl *decl = ast_storage_lookup(&storage, name);
+    struct ast_storage_decl *decl = ast_storage_lookup(&ctx->storage, name);
 
     if (!decl) return;
     weak_compile_error(
@@ -184,10 +168,10 @@ static void assert_is_not_declared(const char *name, struct ast_node *loc)
     );
 }
 
-void make_unused_var_analysis()
+static void make_unused_var_analysis(struct ana_ctx *ctx)
 {
     ast_storage_decl_array_t set = {0};
-    ast_storage_current_scope_uses(&storage, &set);
+    ast_storage_current_scope_uses(&ctx->storage, &set);
 
     for (uint64_t i = 0; i < set.count; ++i) {
         struct ast_storage_decl *use = set.data[i];
@@ -206,10 +190,10 @@ void make_unused_var_analysis()
     vector_free(set);
 }
 
-void make_unused_var_and_func_analysis()
+static void make_unused_var_and_func_analysis(struct ana_ctx *ctx)
 {
     ast_storage_decl_array_t set = {0};
-    ast_storage_current_scope_uses(&storage, &set);
+    ast_storage_current_scope_uses(&ctx->storage, &set);
 
     for (uint64_t i = 0; i < set.count; ++i) {
         struct ast_storage_decl *use = set.data[i];
@@ -233,49 +217,46 @@ void make_unused_var_and_func_analysis()
     vector_free(set);
 }
 
-static void visit(struct ast_node *ast);
-
-static void visit_symbol(struct ast_node *ast)
+/* Children are visited and declarations are bound by
+   traversal (see visitor.h). */
+static bool pre_symbol(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_sym *sym = ast->ast;
-    assert_is_declared(sym->value, ast);
+    assert_is_declared(ctx, sym->value, ast);
 
-    collect_ast(ast);
+    collect_ast(ctx, ast);
     /* We will decide if there is write use of this statement
        inside binary/unary operator logic.  */
+    return true;
 }
 
-static void visit_var_decl(struct ast_node *ast)
+static bool pre_var_decl(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_var_decl *decl = ast->ast;
-    assert_is_not_declared(decl->name, ast);
-    ast_storage_push(&storage, decl->name, ast);
-    if (decl->body)
-        visit(decl->body);
+    assert_is_not_declared(ctx, decl->name, ast);
+    return true;
 }
 
-static void visit_array_decl(struct ast_node *ast)
+static bool pre_array_decl(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_var_decl *decl = ast->ast;
-    assert_is_not_declared(decl->name, ast);
-    ast_storage_push(&storage, decl->name, ast);
+    struct ast_array_decl *decl = ast->ast;
+    assert_is_not_declared(ctx, decl->name, ast);
+    return true;
 }
 
-static void visit_binary(struct ast_node *ast)
+static void post_binary(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_binary *stmt = ast->ast;
-    visit(stmt->lhs);
-    visit(stmt->rhs);
 
     /* Only left hand side can be writeable. */
     if (is_assignment_op(stmt->op))
-        use_add_write(stmt->lhs);
+        use_add_write(ctx, stmt->lhs);
     else
-        use_add_read(stmt->lhs);
-    use_add_read(stmt->rhs);
+        use_add_read(ctx, stmt->lhs);
+    use_add_read(ctx, stmt->rhs);
 }
 
-static void visit_unary(struct ast_node *ast)
+static bool pre_unary(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_unary *stmt = ast->ast;
     struct ast_node *op = stmt->operand;
@@ -294,204 +275,104 @@ static void visit_unary(struct ast_node *ast)
     switch (stmt->op) {
     case TOK_INC: /* ++var */
     case TOK_DEC: /* --var */
-        use_add_write(op);
+        use_add_write(ctx, op);
         break;
     case TOK_STAR: /* *var */
     case TOK_BIT_AND: /* &var */
-        use_add_read(op);
+        use_add_read(ctx, op);
         break;
     default:
         weak_unreachable("Unknown unary operator `%s`.", tok_to_string(stmt->op));
     }
-    visit(op);
+    return true;
 }
 
-/* \todo: What if (*mem_ptr)[0][1][2]? */
-static void visit_array_access(struct ast_node *ast)
+/* \todo: Indices are not analyzed. What if (*mem_ptr)[0][1][2]? */
+static bool pre_array_access(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_array_access *stmt = ast->ast;
-    collect_ast(ast);
-    assert(stmt->indices->type == AST_COMPOUND_STMT);
-    visit(stmt->indices->ast);
+    collect_ast(ctx, ast);
+    return false;
 }
 
-static void visit_member(struct ast_node *ast)
+static bool pre_member(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    collect_ast(ast);
+    collect_ast(ctx, ast);
+    return false;
 }
 
-static void visit_if(struct ast_node *ast)
+static void post_return(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_if *stmt = ast->ast;
-    visit(stmt->condition);
-    visit(stmt->body);
-    if (stmt->else_body)
-        visit(stmt->else_body);
+    struct ast_ret *stmt = ast->ast;
+    if (stmt->op)
+        use_add_read(ctx, stmt->op);
 }
 
-static void visit_for(struct ast_node *ast)
+static void post_compound(struct ana_ctx *ctx, unused struct ast_node *ast)
 {
-    struct ast_for *stmt = ast->ast;
-    ast_storage_start_scope(&storage);
-    if (stmt->init)
-        visit(stmt->init);
-    if (stmt->condition) {
-        use_start_scope();
-        visit(stmt->condition);
-        uses_mark_top_scope_as_read();
-        use_end_scope();
-    }
-    if (stmt->increment)
-        visit(stmt->increment);
-    visit(stmt->body);
-    ast_storage_end_scope(&storage);
+    make_unused_var_and_func_analysis(ctx);
 }
 
-static void visit_while(struct ast_node *ast)
+static bool pre_fn_decl(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_while *stmt = ast->ast;
-    use_start_scope();
-    visit(stmt->cond);
-    uses_mark_top_scope_as_read();
-    use_end_scope();
-    visit(stmt->body);
+    struct ast_fn_decl *decl = ast->ast;
+    assert_is_not_declared(ctx, decl->name, ast);
+    return true;
 }
 
-static void visit_do_while(struct ast_node *ast)
+static void post_fn_decl(struct ana_ctx *ctx, unused struct ast_node *ast)
 {
-    struct ast_do_while *stmt = ast->ast;
-    use_start_scope();
-    visit(stmt->condition);
-    uses_mark_top_scope_as_read();
-    use_end_scope();
-    visit(stmt->body);
+    /* Scope of function itself and its arguments. */
+    make_unused_var_analysis(ctx);
 }
 
-static void visit_return(struct ast_node *ast)
+static bool pre_fn_call(struct ana_ctx *ctx, struct ast_node *ast)
 {
-    struct ast_ret *stmt = ast->ast;
-    if (stmt->op) {
-        visit(stmt->op);
-        use_add_read(stmt->op);
-    }
-}
+    struct ast_fn_call *stmt = ast->ast;
 
-static void visit_compound(struct ast_node *ast)
-{
-    struct ast_compound *stmt = ast->ast;
-    ast_storage_start_scope(&storage);
-    for (uint64_t i = 0; i < stmt->size; ++i)
-        visit(stmt->stmts[i]);
-    make_unused_var_and_func_analysis();
-    ast_storage_end_scope(&storage);
-}
+    if (is_builtin(stmt->name)) return false;
 
-static void visit_fn_decl(struct ast_node *ast)
-{
-    struct ast_fn_decl *decl = ast->ast;
-    assert_is_not_declared(decl->name, ast);
+    assert_is_declared(ctx, stmt->name, ast);
+    use_add_read(ctx, ast);
 
-    ast_storage_start_scope(&storage);
-    /* This is to have function in recursive calls. */
-    ast_storage_push(&storage, decl->name, ast);
-    /* Don't just visit compound AST, which creates and terminates scope. */
-    struct ast_compound *args = decl->args->ast;
-    for (uint64_t i = 0; i < args->size; ++i)
-        visit(args->stmts[i]);
-    visit(decl->body);
-    make_unused_var_analysis();
-    ast_storage_end_scope(&storage);
-    /* This is to have function outside. */
-    ast_storage_push(&storage, decl->name, ast);
+    assert(stmt->args->type == AST_COMPOUND_STMT);
+    return true;
 }
 
-static void visit_fn_call(struct ast_node *ast)
+static void post_fn_call(struct ana_ctx *ctx, struct ast_node *ast)
 {
     struct ast_fn_call *stmt = ast->ast;
 
     if (is_builtin(stmt->name)) return;
 
-    assert_is_declared(stmt->name, ast);
-    use_add_read(ast);
-
-    assert(stmt->args->type == AST_COMPOUND_STMT);
     struct ast_compound *args = stmt->args->ast;
-    for (uint64_t i = 0; i < args->size; ++i) {
-        visit(args->stmts[i]);
-        use_add_read(args->stmts[i]);
-    }
-}
-
-void visit(struct ast_node *ast)
-{
-    assert(ast);
-
-    switch (ast->type) {
-    case AST_CHAR: /* Unused. */
-    case AST_INT: /* Unused. */
-    case AST_FLOAT: /* Unused. */
-    case AST_STRING: /* Unused. */
-    case AST_BOOL: /* Unused. */
-    case AST_STRUCT_DECL: /* Unused. */
-    case AST_BREAK_STMT: /* Unused. */
-    case AST_CONTINUE_STMT: /* Unused. */
-        break;
-    case AST_SYMBOL:
-        visit_symbol(ast);
-        break;
-    case AST_VAR_DECL:
-        visit_var_decl(ast);
-        break;
-    case AST_ARRAY_DECL:
-        visit_array_decl(ast);
-        break;
-    case AST_BINARY:
-        visit_binary(ast);
-        break;
-    case AST_PREFIX_UNARY:
-    case AST_POSTFIX_UNARY: /* Fall through. */
-        visit_unary(ast);
-        break;
-    case AST_ARRAY_ACCESS:
-        visit_array_access(ast);
-        break;
-    case AST_MEMBER:
-        visit_member(ast);
-        break;
-    case AST_IF_STMT:
-        visit_if(ast);
-        break;
-    case AST_FOR_STMT:
-        visit_for(ast);
-        break;
-    case AST_WHILE_STMT:
-        visit_while(ast);
-        break;
-    case AST_DO_WHILE_STMT:
-        visit_do_while(ast);
-        break;
-    case AST_RETURN_STMT:
-        visit_return(ast);
-        break;
-    case AST_COMPOUND_STMT:
-        visit_compound(ast);
-        break;
-    case AST_FUNCTION_DECL:
-        visit_fn_decl(ast);
-        break;
-    case AST_FUNCTION_CALL:
-        visit_fn_call(ast);
-        break;
-    default: {
-        enum ast_type t = ast->type;
-        weak_unreachable("Unknown AST type (%d, %s).", t, ast_type_to_string(t));
-    }
+    for (uint64_t i = 0; i < args->size; ++i)
+        use_add_read(ctx, args->stmts[i]);
+}
+
+const struct ana_pass ana_var_usage_pass = {
+    .name = "var_usage",
+    .pre = {
+        [AST_SYMBOL]        = pre_symbol,
+        [AST_VAR_DECL]      = pre_var_decl,
+        [AST_ARRAY_DECL]    = pre_array_decl,
+        [AST_PREFIX_UNARY]  = pre_unary,
+        [AST_POSTFIX_UNARY] = pre_unary,
+        [AST_ARRAY_ACCESS]  = pre_array_access,
+        [AST_MEMBER]        = pre_member,
+        [AST_FUNCTION_DECL] = pre_fn_decl,
+        [AST_FUNCTION_CALL] = pre_fn_call,
+    },
+    .post = {
+        [AST_BINARY]        = post_binary,
+        [AST_RETURN_STMT]   = post_return,
+        [AST_COMPOUND_STMT] = post_compound,
+        [AST_FUNCTION_DECL] = post_fn_decl,
+        [AST_FUNCTION_CALL] = post_fn_call,
     }
-}
+};
 
 void ana_var_usage(struct ast_node *root)
 {
-    init();
-    visit(root);
-    reset();
+    const struct ana_pass *passes[] = { &ana_var_usage_pass };
+    ana_run_passes(root, passes, 1);
 }
@@ -0,0 +1,447 @@
+/* visitor.c - Fused AST traversal for analyzers.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/visitor.h"
+#include "front_end/ast/ast.h"
+#include "front_end/ast/ast_walk.h"
+#include "util/diagnostic.h"
+#include "util/thread.h"
+#include "util/unreachable.h"
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+struct ana_timing {
+    const char *name;
+    double      time;
+};
+
+static _Thread_local struct ana_ctx          ana_ctx;
+/* Kept between calls, since errors exit with longjmp. */
+static _Thread_local struct ast_walk         ana_walk;
+/* Passes of the current fused group. Copied, since array
+   of caller is gone after error jump. */
+static _Thread_local const struct ana_pass  *ana_passes[ANA_MAX_PASSES];
+static _Thread_local uint32_t                ana_passes_cnt;
+/* Bit per pass. Failed pass is cleared with all next
+   ones, since they can rely on what it checks. */
+static _Thread_local uint32_t                ana_alive;
+/* Failed pass with the smallest index or ana_passes_cnt. */
+static _Thread_local uint32_t                ana_failed;
+
+static _Thread_local bool                         ana_timing_on;
+static _Thread_local vector_t(struct ana_timing)  ana_timings;
+/* Index of the first pass of current group in timings. */
+static _Thread_local uint64_t                     ana_timing_base;
+
+static double ana_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool ana_call_unchecked(const struct ana_pass *p, struct ast_node *ast, bool pre)
+{
+    if (pre)
+        return p->pre[ast->type](&ana_ctx, ast);
+
+    p->post[ast->type](&ana_ctx, ast);
+    return 1;
+}
+
+/* Error of the first pass is reported at once. For others
+   it only disables pass, and is reported later, when it is
+   known that passes before did not fail. */
+static bool ana_call_deferred(uint32_t i, struct ast_node *ast, bool pre)
+{
+    volatile bool visit = 0;
+    jmp_buf       saved;
+
+    memcpy(saved, weak_fatal_error_buf, sizeof (jmp_buf));
+    weak_diag_set_silent(1);
+
+    if (!setjmp(weak_fatal_error_buf)) {
+        visit = ana_call_unchecked(ana_passes[i], ast, pre);
+    } else {
+        ana_alive &= (1U << i) - 1;
+        ana_failed = i;
+    }
+
+    weak_diag_set_silent(0);
+    memcpy(weak_fatal_error_buf, saved, sizeof (jmp_buf));
+
+    return visit;
+}
+
+/* \return Whether pass wants to visit children. */
+static bool ana_call(uint32_t i, struct ast_node *ast, bool pre)
+{
+    const struct ana_pass *p = ana_passes[i];
+
+    if (pre ? !p->pre[ast->type] : !p->post[ast->type])
+        return 1;
+
+    double start = ana_timing_on ? ana_now() : 0.0;
+    bool   visit = i == 0
+        ? ana_call_unchecked(p, ast, pre)
+        : ana_call_deferred(i, ast, pre);
+
+    if (ana_timing_on)
+        ana_timings.data[ana_timing_base + i].time += ana_now() - start;
+
+    return visit;
+}
+
+static void ana_bind(struct ast_node *ast)
+{
+    struct ast_storage *s = &ana_ctx.storage;
+
+    switch (ast->type) {
+    case AST_VAR_DECL: {
+        struct ast_var_decl *decl = ast->ast;
+        ast_storage_push_typed(s, decl->name, decl->dt, decl->ptr_depth, ast);
+        break;
+    }
+    case AST_ARRAY_DECL: {
+        struct ast_array_decl *decl = ast->ast;
+        ast_storage_push_typed(s, decl->name, decl->dt, decl->ptr_depth, ast);
+        break;
+    }
+    case AST_FUNCTION_DECL: {
+        struct ast_fn_decl *decl = ast->ast;
+        ast_storage_push_typed(s, decl->name, D_T_FUNC, decl->ptr_depth, ast);
+        break;
+    }
+    default:
+        weak_unreachable("Declaration expected, got `%s`.", ast_type_to_string(ast->type));
+    }
+}
+
+/* Declarations are visible to children. */
+static void ana_enter(struct ast_node *ast)
+{
+    struct ast_storage *s = &ana_ctx.storage;
+
+    switch (ast->type) {
+    case AST_VAR_DECL:
+    case AST_ARRAY_DECL: /* Fall through. */
+        ana_bind(ast);
+        break;
+    case AST_FOR_STMT:
+    case AST_FOR_RANGE_STMT:
+    case AST_COMPOUND_STMT: /* Fall through. */
+        ast_storage_start_scope(s);
+        break;
+    case AST_FUNCTION_DECL:
+        ast_storage_start_scope(s);
+        /* This is to have function in recursive calls. */
+        ana_bind(ast);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool ana_stmt(struct ast_node *compound, uint64_t i, struct ast_node **child)
+{
+    struct ast_compound *stmt = compound->ast;
+
+    if (i >= stmt->size)
+        return 0;
+
+    *child = stmt->stmts[i];
+    return 1;
+}
+
+/* Children in order of analysis. Lists of indices and
+   arguments are not visited as compound statements, since
+   they open no scope. */
+static bool ana_child(struct ast_node *ast, uint64_t i, struct ast_node **child)
+{
+    switch (ast->type) {
+    case AST_ARRAY_DECL:
+    case AST_STRUCT_DECL: /* Fall through. */
+        return 0;
+    case AST_ARRAY_ACCESS: {
+        struct ast_array_access *stmt = ast->ast;
+        return ana_stmt(stmt->indices, i, child);
+    }
+    case AST_MEMBER: {
+        /* Right side is field name, not an expression. */
+        struct ast_member *stmt = ast->ast;
+        *child = stmt->structure;
+        return i == 0;
+    }
+    case AST_DO_WHILE_STMT: {
+        /* Condition first, as variable usage analyzer did. */
+        struct ast_do_while *stmt = ast->ast;
+        *child = i == 0 ? stmt->condition : stmt->body;
+        return i < 2;
+    }
+    case AST_FUNCTION_DECL: {
+        /* Arguments are in the function scope, not in
+           scope of compound statement. */
+        struct ast_fn_decl  *decl = ast->ast;
+        struct ast_compound *args = decl->args->ast;
+        if (i < args->size)
+            return ana_stmt(decl->args, i, child);
+        *child = decl->body;
+        return i == args->size;
+    }
+    case AST_FUNCTION_CALL: {
+        struct ast_fn_call *stmt = ast->ast;
+        return ana_stmt(stmt->args, i, child);
+    }
+    default:
+        return ast_child(ast, i, child);
+    }
+}
+
+/* Scopes are closed after post-callbacks, so they can see
+   declarations of scope. */
+static void ana_leave(struct ast_node *ast)
+{
+    struct ast_storage *s = &ana_ctx.storage;
+
+    switch (ast->type) {
+    case AST_FOR_STMT:
+    case AST_FOR_RANGE_STMT:
+    case AST_COMPOUND_STMT: /* Fall through. */
+        ast_storage_end_scope(s);
+        break;
+    case AST_FUNCTION_DECL:
+        ast_storage_end_scope(s);
+        /* This is to have function outside. */
+        ana_bind(ast);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Call pre-callbacks. Frame keeps mask of passes visiting
+   node in data[0] and of passes visiting children in data[1].
+
+   \return Whether node is visited by any pass. */
+static bool ana_pre(struct ast_walk_frame *f)
+{
+    uint32_t mask     = f->data[0] & ana_alive;
+    uint32_t children = 0;
+
+    if (!mask)
+        return 0;
+
+    for (uint32_t i = 0; i < ana_passes_cnt; ++i)
+        if (mask & (1U << i) && ana_call(i, f->ast, /*pre=*/1))
+            children |= 1U << i;
+
+    f->data[0] = mask;
+    f->data[1] = children;
+
+    vector_push_back(ana_ctx.path, f->ast);
+    ana_enter(f->ast);
+    return 1;
+}
+
+static void ana_post(struct ast_node *ast, uint32_t mask)
+{
+    vector_pop_back(ana_ctx.path);
+
+    mask &= ana_alive;
+
+    for (uint32_t i = 0; i < ana_passes_cnt; ++i)
+        if (mask & (1U << i))
+            ana_call(i, ast, /*pre=*/0);
+
+    ana_leave(ast);
+}
+
+static void ana_visit(struct ast_node *root, uint32_t mask)
+{
+    struct ast_walk       *w = &ana_walk;
+    struct ast_walk_frame *f = NULL;
+
+    ast_walk_init(w, root);
+    ast_walk_top(w)->data[0] = mask;
+
+    while ((f = ast_walk_top(w))) {
+        if (f->step++ == 0) {
+            if (!ana_pre(f))
+                ast_walk_pop(w);
+            continue;
+        }
+
+        struct ast_node *child    = NULL;
+        uint32_t         children = f->data[1] & ana_alive;
+
+        if (children && ana_child(f->ast, f->step - 2, &child)) {
+            if (child) {
+                ast_walk_push(w, child);
+                ast_walk_top(w)->data[0] = children;
+            }
+            continue;
+        }
+
+        struct ast_node *ast = f->ast;
+        mask = f->data[0];
+        ast_walk_pop(w);
+        ana_post(ast, mask);
+    }
+}
+
+static void ana_run_fused(struct ast_node *root, const struct ana_pass **passes, uint32_t cnt)
+{
+    assert(cnt <= ANA_MAX_PASSES);
+
+    ana_timing_base = ana_timings.count;
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        struct ana_timing t = { .name = passes[i]->name, .time = 0.0 };
+        vector_push_back(ana_timings, t);
+    }
+
+    struct ana_timing walk = { .name = "(traversal)", .time = 0.0 };
+    vector_push_back(ana_timings, walk);
+
+    memcpy(ana_passes, passes, cnt * sizeof (*passes));
+    ana_passes_cnt = cnt;
+    ana_alive = cnt == ANA_MAX_PASSES ? ~0U : (1U << cnt) - 1;
+    ana_failed = cnt;
+
+    for (uint32_t i = 0; i < cnt; ++i)
+        if (passes[i]->init)
+            passes[i]->init();
+
+    ast_storage_init(&ana_ctx.storage);
+    vector_clear(ana_ctx.path);
+
+    double start = ana_timing_on ? ana_now() : 0.0;
+    ana_visit(root, ana_alive);
+
+    if (ana_timing_on) {
+        double *total = &vector_back(ana_timings).time;
+        *total = ana_now() - start;
+        for (uint32_t i = 0; i < cnt; ++i)
+            *total -= ana_timings.data[ana_timing_base + i].time;
+    }
+
+    for (uint32_t i = 0; i < cnt; ++i)
+        if (passes[i]->reset)
+            passes[i]->reset();
+
+    ana_passes_cnt = 0;
+    ast_storage_free(&ana_ctx.storage);
+    vector_free(ana_ctx.path);
+    ast_walk_free(&ana_walk);
+
+    if (ana_failed != cnt) {
+        const struct ana_pass **failed = &passes[ana_failed];
+        /* Error is reported as if pass is run alone. */
+        ana_run_fused(root, failed, 1);
+        weak_unreachable("Pass `%s` failed only in fused traversal.", (*failed)->name);
+    }
+}
+
+/* Passes of group are left initialized if error
+   interrupted traversal. */
+static void ana_free_state()
+{
+    for (uint32_t i = 0; i < ana_passes_cnt; ++i)
+        if (ana_passes[i]->reset)
+            ana_passes[i]->reset();
+
+    ana_passes_cnt = 0;
+    ast_storage_free(&ana_ctx.storage);
+    vector_free(ana_ctx.path);
+    ast_walk_free(&ana_walk);
+    vector_free(ana_timings);
+}
+
+void ana_run_passes(struct ast_node *root, const struct ana_pass **passes, uint32_t cnt)
+{
+    vector_clear(ana_timings);
+    weak_thread_atexit(ana_free_state);
+
+    for (uint32_t i = 0; i < cnt;) {
+        if (passes[i]->walk) {
+            double start = ana_timing_on ? ana_now() : 0.0;
+            passes[i]->walk(root);
+
+            struct ana_timing t = {
+                .name = passes[i]->name,
+                .time = ana_timing_on ? ana_now() - start : 0.0
+            };
+            vector_push_back(ana_timings, t);
+            ++i;
+            continue;
+        }
+
+        uint32_t end = i;
+        while (end < cnt && !passes[end]->walk && end - i < ANA_MAX_PASSES)
+            ++end;
+
+        ana_run_fused(root, &passes[i], end - i);
+        i = end;
+    }
+}
+
+struct ast_node *ana_parent(struct ana_ctx *ctx)
+{
+    return ctx->path.count ? vector_back(ctx->path) : NULL;
+}
+
+static bool ana_is_expr(struct ast_node *ast)
+{
+    switch (ast->type) {
+    case AST_BINARY:
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY:
+    case AST_ARRAY_ACCESS:
+    case AST_MEMBER:
+    case AST_FUNCTION_CALL:
+    case AST_IMPLICIT_CAST: /* Fall through. */
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+struct ast_node *ana_enclosing_stmt(
+    struct ana_ctx   *ctx,
+    struct ast_node  *ast,
+    struct ast_node **child
+) {
+    *child = ast;
+
+    vector_foreach_back(ctx->path, i) {
+        struct ast_node *it = ctx->path.data[i];
+
+        if (!ana_is_expr(it))
+            return it;
+
+        *child = it;
+    }
+
+    return NULL;
+}
+
+void ana_set_timing(bool enabled)
+{
+    ana_timing_on = enabled;
+}
+
+void ana_dump_timings(FILE *stream)
+{
+    double total = 0.0;
+
+    vector_foreach(ana_timings, i) {
+        fprintf(stream, "%-16s %10.3f ms\n", ana_timings.data[i].name, ana_timings.data[i].time * 1e3);
+        total += ana_timings.data[i].time;
+    }
+
+    fprintf(stream, "%-16s %10.3f ms\n", "total", total * 1e3);
+}
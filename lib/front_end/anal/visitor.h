@@ -0,0 +1,93 @@
+/* visitor.h - Fused AST traversal for analyzers.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_ANAL_VISITOR_H
+#define WEAK_COMPILER_FRONTEND_ANAL_VISITOR_H
+
+#include "front_end/anal/ast_storage.h"
+#include "front_end/ast/ast_type.h"
+#include "util/compiler.h"
+#include "util/vector.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define ANA_AST_TYPES  (AST_IMPLICIT_CAST + 1)
+#define ANA_MAX_PASSES 32
+
+/** State of traversal, shared by all passes. */
+struct ana_ctx {
+    /** Declarations visible at current node.
+
+        Traversal binds variables, arrays and functions
+        itself, after pre-callbacks of declaration: scopes
+        are opened by compound statement, `for` loop and
+        function (for its arguments). Function name is
+        bound twice: in own scope for recursive calls and
+        after it in outer scope. */
+    struct ast_storage          storage;
+    /** Ancestors of current node, root first. */
+    vector_t(struct ast_node *) path;
+};
+
+/** Called before children of node.
+
+    \return false to not visit children by this pass. */
+typedef bool (*ana_pre_t )(struct ana_ctx *ctx, struct ast_node *ast);
+/** Called after children of node. */
+typedef void (*ana_post_t)(struct ana_ctx *ctx, struct ast_node *ast);
+
+/** Analysis, which registers callbacks for node types.
+
+    Passes with callbacks are fused: they share single
+    traversal and symbol table, and for each node are
+    called in order of registration. Diagnostics are the
+    same as of passes run one after another: errors of
+    pass are held back until all passes before it end
+    traversal without error, and other passes are run
+    again separately to report them.
+
+    \note Only first pass of fused group may emit warnings.
+    \note Pass, which computes result of node from its
+          children in own order, sets `walk` instead. */
+struct ana_pass {
+    const char *name;
+    void      (*init)();
+    void      (*reset)();
+    ana_pre_t   pre [ANA_AST_TYPES];
+    ana_post_t  post[ANA_AST_TYPES];
+    /** Traverse whole tree by itself, not fused. */
+    void      (*walk)(struct ast_node *root);
+};
+
+/** Run passes in given order. Consecutive passes without
+    `walk` share traversal. */
+void ana_run_passes(struct ast_node *root, const struct ana_pass **passes, uint32_t cnt);
+
+/** \return Parent of current node or NULL for root. */
+wur struct ast_node *ana_parent(struct ana_ctx *ctx);
+
+/** Find nearest ancestor of `ast`, which is not an expression.
+
+    \param  child Set to child of found ancestor on path to
+                  `ast` (or to `ast` itself).
+    \return Ancestor or NULL if there is no such. */
+wur struct ast_node *ana_enclosing_stmt(
+    struct ana_ctx   *ctx,
+    struct ast_node  *ast,
+    struct ast_node **child
+);
+
+/** Measure time spent by each pass. Disabled by default,
+    since clock is read around each callback. */
+void ana_set_timing(bool enabled);
+
+/** Print times of passes from the last ana_run_passes()
+    call. Time of fused traversal itself (walk and symbol
+    table) is reported separately. */
+void ana_dump_timings(FILE *stream);
+
+#endif // WEAK_COMPILER_FRONTEND_ANAL_VISITOR_H
@@ -5,16 +5,95 @@
  */
 
 #include "front_end/ast/ast.h"
+#include "front_end/ast/ast_walk.h"
 #include "util/alloc.h"
+#include "util/arena.h"
 #include "util/unreachable.h"
+#include <string.h>
+
+#ifdef CONFIG_USE_AST_ARENA
+/* Arena of the tree being built by the current thread. */
+static _Thread_local struct arena *ast_arena = NULL;
+#endif /* CONFIG_USE_AST_ARENA */
+
+
+/**********************************************
+ **              Memory                      **
+ **********************************************/
+struct arena *ast_arena_init()
+{
+#ifdef CONFIG_USE_AST_ARENA
+    struct arena *arena = weak_calloc(1, sizeof (struct arena));
+    arena_init(arena);
+    return arena;
+#else
+    return NULL;
+#endif /* CONFIG_USE_AST_ARENA */
+}
+
+struct arena *ast_arena_set(unused struct arena *arena)
+{
+#ifdef CONFIG_USE_AST_ARENA
+    struct arena *prev = ast_arena;
+    ast_arena = arena;
+    return prev;
+#else
+    return NULL;
+#endif /* CONFIG_USE_AST_ARENA */
+}
+
+struct arena *ast_arena_of(struct ast_node *root)
+{
+    if (!root || root->type != AST_COMPOUND_STMT)
+        return NULL;
+
+    return ( (struct ast_compound *) root->ast )->arena;
+}
+
+void *ast_alloc(uint64_t size)
+{
+#ifdef CONFIG_USE_AST_ARENA
+    if (ast_arena)
+        return arena_alloc(ast_arena, size);
+#endif /* CONFIG_USE_AST_ARENA */
+    return weak_calloc(1, size);
+}
+
+void ast_free(void *addr)
+{
+#ifdef CONFIG_USE_AST_ARENA
+    if (ast_arena)
+        return;
+#endif /* CONFIG_USE_AST_ARENA */
+    weak_free(addr);
+}
+
+void ast_arena_merge(struct arena *arena, struct arena *from)
+{
+    if (!from)
+        return;
+
+    arena_merge(arena, from);
+    weak_free(from);
+}
+
+static void ast_arena_release(struct arena *arena)
+{
+#ifdef CONFIG_USE_AST_ARENA
+    if (ast_arena == arena)
+        ast_arena = NULL;
+#endif /* CONFIG_USE_AST_ARENA */
+    arena_release(arena);
+    weak_free(arena);
+}
 
 
 /**********************************************
  **              Array access                **
  **********************************************/
-struct ast_node *ast_array_access_init(char *name, struct ast_node *indices, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_array_access_init(const char *name, struct ast_node *indices, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_array_access *ast = weak_calloc(1, sizeof (struct ast_array_access));
+    struct ast_array_access *ast = ast_alloc(sizeof (struct ast_array_access));
     ast->name = name;
     ast->indices = indices;
     return ast_node_init(AST_ARRAY_ACCESS, ast, line_no, col_no);
@@ -23,7 +102,6 @@ struct ast_node *ast_array_access_init(char *name, struct ast_node *indices, uin
 void ast_array_access_cleanup(struct ast_array_access *ast)
 {
     ast_node_cleanup(ast->indices);
-    weak_free(ast->name);
     weak_free(ast);
 }
 
@@ -33,15 +111,15 @@ void ast_array_access_cleanup(struct ast_array_access *ast)
  **********************************************/
 struct ast_node *ast_array_decl_init(
     enum data_type   dt,
-    char            *name,
-    char            *type_name,
+    const char      *name,
+    const char      *type_name,
     struct ast_node *arity,
     uint16_t         ptr_depth,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_array_decl *ast = weak_calloc(1, sizeof (struct ast_array_decl));
+    struct ast_array_decl *ast = ast_alloc(sizeof (struct ast_array_decl));
     ast->dt = dt;
     ast->name = name;
     ast->type_name = type_name;
@@ -55,9 +133,6 @@ void ast_array_decl_cleanup(struct ast_array_decl *ast)
 {
     ast_node_cleanup(ast->arity);
     ast_node_cleanup(ast->body);
-    if (ast->type_name)
-        weak_free(ast->type_name);
-    weak_free(ast->name);
     weak_free(ast);
 }
 
@@ -69,10 +144,10 @@ struct ast_node *ast_binary_init(
     enum token_type  op,
     struct ast_node *lhs,
     struct ast_node *rhs,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_binary *ast = weak_calloc(1, sizeof (struct ast_binary));
+    struct ast_binary *ast = ast_alloc(sizeof (struct ast_binary));
     ast->op = op;
     ast->lhs = lhs;
     ast->rhs = rhs;
@@ -90,9 +165,9 @@ void ast_binary_cleanup(struct ast_binary *ast)
 /**********************************************
  **              Boolean                     **
  **********************************************/
-struct ast_node *ast_bool_init(bool value, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_bool_init(bool value, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_bool *ast = weak_calloc(1, sizeof (struct ast_bool));
+    struct ast_bool *ast = ast_alloc(sizeof (struct ast_bool));
     ast->value = value;
     return ast_node_init(AST_BOOL, ast, line_no, col_no);
 }
@@ -106,9 +181,9 @@ void ast_bool_cleanup(struct ast_bool *ast)
 /**********************************************
  **              Break statement             **
  **********************************************/
-struct ast_node *ast_break_init(uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_break_init(uint32_t line_no, uint32_t col_no)
 {
-    struct ast_break *ast = weak_calloc(1, sizeof (struct ast_break));
+    struct ast_break *ast = ast_alloc(sizeof (struct ast_break));
     return ast_node_init(AST_BREAK_STMT, ast, line_no, col_no);
 }
 
@@ -121,9 +196,9 @@ void ast_break_cleanup(struct ast_break *ast)
 /**********************************************
  **              Character                   **
  **********************************************/
-struct ast_node *ast_char_init(char value, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_char_init(char value, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_char *ast = weak_calloc(1, sizeof (struct ast_char));
+    struct ast_char *ast = ast_alloc(sizeof (struct ast_char));
     ast->value = value;
     return ast_node_init(AST_CHAR, ast, line_no, col_no);
 }
@@ -140,12 +215,20 @@ void ast_char_cleanup(struct ast_char *ast)
 struct ast_node *ast_compound_init(
     uint64_t          size,
     struct ast_node **stmts,
-    uint16_t          line_no,
-    uint16_t          col_no
+    uint32_t          line_no,
+    uint32_t          col_no
 ) {
-    struct ast_compound *ast = weak_calloc(1, sizeof (struct ast_compound));
+    struct ast_compound *ast = ast_alloc(sizeof (struct ast_compound));
     ast->size = size;
     ast->stmts = stmts;
+#ifdef CONFIG_USE_AST_ARENA
+    if (ast_arena && stmts) {
+        /* Keep child arrays contiguous with nodes. */
+        ast->stmts = arena_alloc(ast_arena, size * sizeof (struct ast_node *));
+        memcpy(ast->stmts, stmts, size * sizeof (struct ast_node *));
+        weak_free(stmts);
+    }
+#endif /* CONFIG_USE_AST_ARENA */
     return ast_node_init(AST_COMPOUND_STMT, ast, line_no, col_no);
 }
 
@@ -162,9 +245,9 @@ void ast_compound_cleanup(struct ast_compound *ast)
 /**********************************************
  **              Continue statement          **
  **********************************************/
-struct ast_node *ast_continue_init(uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_continue_init(uint32_t line_no, uint32_t col_no)
 {
-    struct ast_continue *ast = weak_calloc(1, sizeof (struct ast_continue));
+    struct ast_continue *ast = ast_alloc(sizeof (struct ast_continue));
     return ast_node_init(AST_CONTINUE_STMT, ast, line_no, col_no);
 }
 
@@ -180,10 +263,10 @@ void ast_continue_cleanup(struct ast_continue *ast)
 struct ast_node *ast_do_while_init(
     struct ast_node *body,
     struct ast_node *condition,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_do_while *ast = weak_calloc(1, sizeof (struct ast_do_while));
+    struct ast_do_while *ast = ast_alloc(sizeof (struct ast_do_while));
     ast->body = body;
     ast->condition = condition;
     return ast_node_init(AST_DO_WHILE_STMT, ast, line_no, col_no);
@@ -200,9 +283,9 @@ void ast_do_while_cleanup(struct ast_do_while *ast)
 /**********************************************
  **          Floating point literal          **
  **********************************************/
-struct ast_node *ast_float_init(double value, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_float_init(double value, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_float *ast = weak_calloc(1, sizeof (struct ast_float));
+    struct ast_float *ast = ast_alloc(sizeof (struct ast_float));
     ast->value = value;
     return ast_node_init(AST_FLOAT, ast, line_no, col_no);
 }
@@ -221,10 +304,10 @@ struct ast_node *ast_for_init(
     struct ast_node *condition,
     struct ast_node *increment,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_for *ast = weak_calloc(1, sizeof (struct ast_for));
+    struct ast_for *ast = ast_alloc(sizeof (struct ast_for));
     ast->init = init;
     ast->condition = condition;
     ast->increment = increment;
@@ -249,10 +332,10 @@ struct ast_node *ast_for_range_init(
     struct ast_node *iter,
     struct ast_node *range_target,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_for_range *ast = weak_calloc(1, sizeof (struct ast_for_range));
+    struct ast_for_range *ast = ast_alloc(sizeof (struct ast_for_range));
     ast->iter = iter;
     ast->range_target = range_target;
     ast->body = body;
@@ -272,15 +355,15 @@ void ast_for_range_cleanup(struct ast_for_range *ast)
  **              Function call               **
  **********************************************/
 struct ast_node *ast_fn_call_init(
-    char            *name,
+    const char      *name,
     struct ast_node *args,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
     if (args->type != AST_COMPOUND_STMT)
         weak_fatal_error("Expected compound statement as function call arguments list.");
 
-    struct ast_fn_call *ast = weak_calloc(1, sizeof (struct ast_fn_call));
+    struct ast_fn_call *ast = ast_alloc(sizeof (struct ast_fn_call));
     ast->name = name;
     ast->args = args;
     return ast_node_init(AST_FUNCTION_CALL, ast, line_no, col_no);
@@ -289,7 +372,6 @@ struct ast_node *ast_fn_call_init(
 void ast_fn_call_cleanup(struct ast_fn_call *ast)
 {
     ast_node_cleanup(ast->args);
-    weak_free(ast->name);
     weak_free(ast);
 }
 
@@ -300,13 +382,13 @@ void ast_fn_call_cleanup(struct ast_fn_call *ast)
 struct ast_node *ast_fn_decl_init(
     enum data_type   data_type,
     uint16_t         ptr_depth,
-    char            *name,
+    const char      *name,
     struct ast_node *args,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_fn_decl *ast = weak_calloc(1, sizeof (struct ast_fn_decl));
+    struct ast_fn_decl *ast = ast_alloc(sizeof (struct ast_fn_decl));
     ast->data_type = data_type;
     ast->ptr_depth = ptr_depth;
     ast->name = name;
@@ -319,7 +401,6 @@ void ast_fn_decl_cleanup(struct ast_fn_decl *ast)
 {
     ast_node_cleanup(ast->args);
     ast_node_cleanup(ast->body);
-    weak_free(ast->name);
     weak_free(ast);
 }
 
@@ -331,10 +412,10 @@ struct ast_node *ast_if_init(
     struct ast_node *condition,
     struct ast_node *body,
     struct ast_node *else_body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_if *ast = weak_calloc(1, sizeof (struct ast_if));
+    struct ast_if *ast = ast_alloc(sizeof (struct ast_if));
     ast->condition = condition;
     ast->body = body;
     ast->else_body = else_body;
@@ -357,10 +438,10 @@ void ast_if_cleanup(struct ast_if *ast)
 struct ast_node *ast_member_init(
     struct ast_node *structure,
     struct ast_node *member,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_member *ast = weak_calloc(1, sizeof (struct ast_member));
+    struct ast_member *ast = ast_alloc(sizeof (struct ast_member));
     ast->structure = structure;
     ast->member = member;
     return ast_node_init(AST_MEMBER, ast, line_no, col_no);
@@ -376,9 +457,9 @@ void ast_member_cleanup(struct ast_member *ast)
 /**********************************************
  **              Integral literal            **
  **********************************************/
-struct ast_node *ast_int_init(int32_t value, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_int_init(int32_t value, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_int *ast = weak_calloc(1, sizeof (struct ast_int));
+    struct ast_int *ast = ast_alloc(sizeof (struct ast_int));
     ast->value = value;
     return ast_node_init(AST_INT, ast, line_no, col_no);
 }
@@ -392,9 +473,9 @@ void ast_int_cleanup(struct ast_int *ast)
 /**********************************************
  **              Return statement            **
  **********************************************/
-struct ast_node *ast_ret_init(struct ast_node *op, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_ret_init(struct ast_node *op, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_ret *ast = weak_calloc(1, sizeof (struct ast_ret));
+    struct ast_ret *ast = ast_alloc(sizeof (struct ast_ret));
     ast->op = op;
     return ast_node_init(AST_RETURN_STMT, ast, line_no, col_no);
 }
@@ -411,12 +492,12 @@ void ast_ret_cleanup(struct ast_ret *ast)
  **              String literal              **
  **********************************************/
 struct ast_node *ast_string_init(
-    uint64_t  len,
-    char     *value,
-    uint16_t  line_no,
-    uint16_t  col_no
+    uint64_t    len,
+    const char *value,
+    uint32_t    line_no,
+    uint32_t    col_no
 ) {
-    struct ast_string *ast = weak_calloc(1, sizeof (struct ast_string));
+    struct ast_string *ast = ast_alloc(sizeof (struct ast_string));
     ast->len = len;
     ast->value = value;
     return ast_node_init(AST_STRING, ast, line_no, col_no);
@@ -424,7 +505,6 @@ struct ast_node *ast_string_init(
 
 void ast_string_cleanup(struct ast_string *ast)
 {
-    weak_free(ast->value);
     weak_free(ast);
 }
 
@@ -432,9 +512,9 @@ void ast_string_cleanup(struct ast_string *ast)
 /**********************************************
  **          Structure declaration           **
  **********************************************/
-struct ast_node *ast_struct_decl_init(char *name, struct ast_node *decls, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_struct_decl_init(const char *name, struct ast_node *decls, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_struct_decl *ast = weak_calloc(1, sizeof (struct ast_struct_decl));
+    struct ast_struct_decl *ast = ast_alloc(sizeof (struct ast_struct_decl));
     ast->name = name;
     ast->decls = decls;
     return ast_node_init(AST_STRUCT_DECL, ast, line_no, col_no);
@@ -443,7 +523,6 @@ struct ast_node *ast_struct_decl_init(char *name, struct ast_node *decls, uint16
 void ast_struct_decl_cleanup(struct ast_struct_decl *ast)
 {
     ast_node_cleanup(ast->decls);
-    weak_free(ast->name);
     weak_free(ast);
 }
 
@@ -451,16 +530,15 @@ void ast_struct_decl_cleanup(struct ast_struct_decl *ast)
 /**********************************************
  **              Symbol                      **
  **********************************************/
-struct ast_node *ast_sym_init(char *value, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_sym_init(const char *value, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_sym *ast = weak_calloc(1, sizeof (struct ast_sym));
+    struct ast_sym *ast = ast_alloc(sizeof (struct ast_sym));
     ast->value = value;
     return ast_node_init(AST_SYMBOL, ast, line_no, col_no);
 }
 
 void ast_sym_cleanup(struct ast_sym *ast)
 {
-    weak_free(ast->value);
     weak_free(ast);
 }
 
@@ -472,14 +550,14 @@ struct ast_node *ast_unary_init(
     enum ast_type    type,
     enum token_type  op,
     struct ast_node *operand,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
     if (type != AST_PREFIX_UNARY && type != AST_POSTFIX_UNARY) {
         weak_fatal_error("Expected prefix or postfix unary type.");
     }
 
-    struct ast_unary *ast = weak_calloc(1, sizeof (struct ast_unary));
+    struct ast_unary *ast = ast_alloc(sizeof (struct ast_unary));
     ast->op = op;
     ast->operand = operand;
     return ast_node_init(type, ast, line_no, col_no);
@@ -497,14 +575,14 @@ void ast_unary_cleanup(struct ast_unary *ast)
  **********************************************/
 struct ast_node *ast_var_decl_init(
     enum data_type   dt,
-    char            *name,
-    char            *type_name,
+    const char      *name,
+    const char      *type_name,
     uint16_t         ptr_depth,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_var_decl *ast = weak_calloc(1, sizeof (struct ast_var_decl));
+    struct ast_var_decl *ast = ast_alloc(sizeof (struct ast_var_decl));
     ast->dt = dt;
     ast->name = name;
     ast->type_name = type_name;
@@ -515,11 +593,6 @@ struct ast_node *ast_var_decl_init(
 
 void ast_var_decl_cleanup(struct ast_var_decl *ast)
 {
-    weak_free(ast->name);
-
-    if (ast->type_name)
-        weak_free(ast->type_name);
-
     ast_node_cleanup(ast->body);
     weak_free(ast);
 }
@@ -531,10 +604,10 @@ void ast_var_decl_cleanup(struct ast_var_decl *ast)
 struct ast_node *ast_while_init(
     struct ast_node *cond,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_while *ast = weak_calloc(1, sizeof (struct ast_while));
+    struct ast_while *ast = ast_alloc(sizeof (struct ast_while));
     ast->cond = cond;
     ast->body = body;
     return ast_node_init(AST_WHILE_STMT, ast, line_no, col_no);
@@ -551,9 +624,9 @@ void ast_while_cleanup(struct ast_while *ast)
 /**********************************************
  **              AST Node                    **
  **********************************************/
-struct ast_node *ast_node_init(enum ast_type type, void *ast, uint16_t line_no, uint16_t col_no)
+struct ast_node *ast_node_init(enum ast_type type, void *ast, uint32_t line_no, uint32_t col_no)
 {
-    struct ast_node *node = weak_calloc(1, sizeof (struct ast_node));
+    struct ast_node *node = ast_alloc(sizeof (struct ast_node));
     node->type = type;
     node->ast = ast;
     node->line_no = line_no;
@@ -568,10 +641,10 @@ struct ast_node *ast_node_init(enum ast_type type, void *ast, uint16_t line_no,
 wur struct ast_node *ast_implicit_cast_init(
     enum data_type   to,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 ) {
-    struct ast_implicit_cast *ast = weak_calloc(1, sizeof (struct ast_implicit_cast));
+    struct ast_implicit_cast *ast = ast_alloc(sizeof (struct ast_implicit_cast));
     ast->to = to;
     ast->body = body;
     return ast_node_init(AST_IMPLICIT_CAST, ast, line_no, col_no);
@@ -584,90 +657,51 @@ void ast_implicit_cast_cleanup(struct ast_implicit_cast *ast)
 }
 
 
+/* Node is freed after its children, so they are reachable
+   until then. Not recursive, since tree can be as deep as
+   input is long. */
+static void ast_node_free(struct ast_node *ast)
+{
+    if (ast->type == AST_COMPOUND_STMT) {
+        struct ast_compound *stmt = ast->ast;
+        weak_free(stmt->stmts);
+    }
+
+    weak_free(ast->ast);
+    weak_free(ast);
+}
+
 void ast_node_cleanup(struct ast_node *ast)
 {
     if (!ast) return;
-    switch (ast->type) {
-    case AST_CHAR:
-        ast_char_cleanup(ast->ast);
-        break;
-    case AST_INT:
-        ast_int_cleanup(ast->ast);
-        break;
-    case AST_FLOAT:
-        ast_float_cleanup(ast->ast);
-        break;
-    case AST_STRING:
-        ast_string_cleanup(ast->ast);
-        break;
-    case AST_BOOL:
-        ast_bool_cleanup(ast->ast);
-        break;
-    case AST_SYMBOL:
-        ast_sym_cleanup(ast->ast);
-        break;
-    case AST_VAR_DECL:
-        ast_var_decl_cleanup(ast->ast);
-        break;
-    case AST_ARRAY_DECL:
-        ast_array_decl_cleanup(ast->ast);
-        break;
-    case AST_STRUCT_DECL:
-        ast_struct_decl_cleanup(ast->ast);
-        break;
-    case AST_BREAK_STMT:
-        ast_break_cleanup(ast->ast);
-        break;
-    case AST_CONTINUE_STMT:
-        ast_continue_cleanup(ast->ast);
-        break;
-    case AST_BINARY:
-        ast_binary_cleanup(ast->ast);
-        break;
-    case AST_PREFIX_UNARY:
-    case AST_POSTFIX_UNARY: /* Fall through. */
-        ast_unary_cleanup(ast->ast);
-        break;
-    case AST_ARRAY_ACCESS:
-        ast_array_access_cleanup(ast->ast);
-        break;
-    case AST_MEMBER:
-        ast_member_cleanup(ast->ast);
-        break;
-    case AST_IF_STMT:
-        ast_if_cleanup(ast->ast);
-        break;
-    case AST_FOR_STMT:
-        ast_for_cleanup(ast->ast);
-        break;
-    case AST_FOR_RANGE_STMT:
-        ast_for_range_cleanup(ast->ast);
-        break;
-    case AST_WHILE_STMT:
-        ast_while_cleanup(ast->ast);
-        break;
-    case AST_DO_WHILE_STMT:
-        ast_do_while_cleanup(ast->ast);
-        break;
-    case AST_RETURN_STMT:
-        ast_ret_cleanup(ast->ast);
-        break;
-    case AST_COMPOUND_STMT:
-        ast_compound_cleanup(ast->ast);
-        break;
-    case AST_FUNCTION_DECL:
-        ast_fn_decl_cleanup(ast->ast);
-        break;
-    case AST_FUNCTION_CALL:
-        ast_fn_call_cleanup(ast->ast);
-        break;
-    case AST_IMPLICIT_CAST:
-        ast_implicit_cast_cleanup(ast->ast);
-        break;
-    default: {
-        enum ast_type t = ast->type;
-        weak_unreachable("Unknown AST type (%d, %s).", t, ast_type_to_string(t));
+
+    if (ast->type == AST_COMPOUND_STMT) {
+        struct ast_compound *root = ast->ast;
+        if (root->arena) {
+            ast_arena_release(root->arena);
+            return;
+        }
     }
+
+#ifdef CONFIG_USE_AST_ARENA
+    /* Subtree of the tree being owned by arena. Freed
+       with the root. */
+    if (ast_arena)
+        return;
+#endif /* CONFIG_USE_AST_ARENA */
+    struct ast_walk        w = {0};
+    struct ast_walk_frame *f = NULL;
+
+    ast_walk_init(&w, ast);
+
+    while ((f = ast_walk_top(&w))) {
+        if (ast_walk_child(&w))
+            continue;
+
+        struct ast_node *node = f->ast;
+        ast_walk_pop(&w);
+        ast_node_free(node);
     }
-    weak_free(ast);
+
+    ast_walk_free(&w);
 }
\ No newline at end of file
@@ -30,18 +30,55 @@
 struct ast_node {
     enum ast_type  type;
     void          *ast;
-    uint16_t       line_no;
-    uint16_t       col_no;
+    uint32_t       line_no;
+    uint32_t       col_no;
 };
 
+/** Create new arena. Root returned by parse() owns it.
+
+    \note If CONFIG_USE_AST_ARENA is not defined, each node is
+          allocated and freed separately (useful to catch memory
+          errors with ASan). Then NULL is returned. */
+struct arena *ast_arena_init();
+
+/** Make `arena` current for the calling thread. All AST
+    allocations are placed there until previous arena is
+    restored. If no arena is current, nodes are allocated
+    on the heap. parse() makes its arena current only until
+    it returns (also with compile error), so trees built by
+    hand or by other parse() never go there.
+
+    \return Previously current arena. */
+struct arena *ast_arena_set(struct arena *arena);
+
+/** \return Arena owning tree of `root` or NULL. Passes
+            adding nodes to the tree (see sema.h) make it
+            current while they run. */
+struct arena *ast_arena_of(struct ast_node *root);
+
+/** Move all nodes of `from` arena to `arena` and free `from`.
+    Used to join trees built by different threads, since
+    each of them has own current arena.
+
+    \note No-op if `from` is NULL. */
+void ast_arena_merge(struct arena *arena, struct arena *from);
+
+/** Allocate zeroed memory for AST node or its part. */
+wur void *ast_alloc(uint64_t size);
+/** Free memory got from ast_alloc().
+    No-op if it is owned by the arena. */
+void ast_free(void *addr);
+
 /** Allocate AST node of given type. */
-wur struct ast_node *ast_node_init(enum ast_type type, void *ast, uint16_t line_no, uint16_t col_no);
+wur struct ast_node *ast_node_init(enum ast_type type, void *ast, uint32_t line_no, uint32_t col_no);
 
-/** Cleanup whole given AST tree through call
-    to proper functions for each node type.
+/** Cleanup whole given AST tree. Tree is walked without
+    recursion, so it can be of any depth.
    
-    \note Implemented in ast_cleanup.c file because for that
-          needed all AST header files. */
+    \note If tree is owned by the arena, this releases
+          whole arena when called on the root. Cleanup of
+          subtrees is no-op while any arena is current,
+          since they are released with the root. */
 void ast_node_cleanup(struct ast_node *ast);
 
 
@@ -49,15 +86,15 @@ void ast_node_cleanup(struct ast_node *ast);
  **              Array access                **
  **********************************************/
 struct ast_array_access {
-    char            *name;    /** \note Must be dynamically allocated. */
+    const char      *name;    /** \note Interned. */
     struct ast_node *indices; /** \note Must be of type ast_compound */
 };
 
 wur struct ast_node *ast_array_access_init(
-    char            *name,
+    const char      *name,
     struct ast_node *indices,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_array_access_cleanup(struct ast_array_access *ast);
 
@@ -71,13 +108,13 @@ struct ast_array_decl {
 
     /** Variable name.
 
-        \note Must be dynamically allocated. */
-    char *name;
+        \note Interned. */
+    const char *name;
 
     /** Optional type name for arrays of structure type.
 
-        \note If present, must be dynamically allocated. */
-    char *type_name;
+        \note If present, interned. */
+    const char *type_name;
 
     /** This stores information about array arity (dimension)
         and size for each dimension, e.g.,
@@ -106,13 +143,13 @@ struct ast_array_decl {
 /** \note type_name may be NULL. */
 wur struct ast_node *ast_array_decl_init(
     enum data_type   dt,
-    char            *name,
-    char            *type_name,
+    const char      *name,
+    const char      *type_name,
     struct ast_node *arity,
     uint16_t         ptr_depth,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_array_decl_cleanup(struct ast_array_decl *ast);
 
@@ -130,8 +167,8 @@ wur struct ast_node *ast_binary_init(
     enum token_type  op,
     struct ast_node *lhs,
     struct ast_node *rhs,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_binary_cleanup(struct ast_binary *ast);
 
@@ -144,7 +181,7 @@ struct ast_bool {
 };
 
 wur
-struct ast_node *ast_bool_init(bool value, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_bool_init(bool value, uint32_t line_no, uint32_t col_no);
 void             ast_bool_cleanup(struct ast_bool *ast);
 
 
@@ -156,7 +193,7 @@ struct ast_break {
 };
 
 wur
-struct ast_node *ast_break_init(uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_break_init(uint32_t line_no, uint32_t col_no);
 void             ast_break_cleanup(struct ast_break *ast);
 
 
@@ -168,7 +205,7 @@ struct ast_char {
 };
 
 wur
-struct ast_node *ast_char_init(char value, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_char_init(char value, uint32_t line_no, uint32_t col_no);
 void             ast_char_cleanup(struct ast_char *ast);
 
 
@@ -178,13 +215,18 @@ void             ast_char_cleanup(struct ast_char *ast);
 struct ast_compound {
     uint64_t          size;
     struct ast_node **stmts;
+    /** Set only for the root returned by parse(). Owns
+        memory of the whole tree. */
+    struct arena     *arena;
 };
 
+/** \note Takes ownership of `stmts`, which must be
+          allocated by weak_calloc() or vector. */
 wur struct ast_node *ast_compound_init(
     uint64_t          size,
     struct ast_node **stmts,
-    uint16_t          line_no,
-    uint16_t          col_no
+    uint32_t          line_no,
+    uint32_t          col_no
 );
 void ast_compound_cleanup(struct ast_compound *ast);
 
@@ -197,7 +239,7 @@ struct ast_continue {
 };
 
 wur
-struct ast_node *ast_continue_init(uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_continue_init(uint32_t line_no, uint32_t col_no);
 void             ast_continue_cleanup(struct ast_continue *ast);
 
 
@@ -212,8 +254,8 @@ struct ast_do_while {
 wur struct ast_node *ast_do_while_init(
     struct ast_node *body,
     struct ast_node *condition,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_do_while_cleanup(struct ast_do_while *ast);
 
@@ -226,7 +268,7 @@ struct ast_float {
 };
 
 wur
-struct ast_node *ast_float_init(double value, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_float_init(double value, uint32_t line_no, uint32_t col_no);
 void             ast_float_cleanup(struct ast_float *ast);
 
 
@@ -245,8 +287,8 @@ wur struct ast_node *ast_for_init(
     struct ast_node *condition,
     struct ast_node *increment,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_for_cleanup(struct ast_for *ast);
 
@@ -264,8 +306,8 @@ wur struct ast_node *ast_for_range_init(
     struct ast_node *iter,
     struct ast_node *range_target,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_for_range_cleanup(struct ast_for_range *ast);
 
@@ -274,15 +316,15 @@ void ast_for_range_cleanup(struct ast_for_range *ast);
  **              Function call               **
  **********************************************/
 struct ast_fn_call {
-    char            *name; /** \note Must be dynamically allocated. */
+    const char      *name; /** \note Interned. */
     struct ast_node *args;
 };
 
 wur struct ast_node *ast_fn_call_init(
-    char            *name,
+    const char      *name,
     struct ast_node *args,
-    uint16_t        line_no,
-    uint16_t        col_no
+    uint32_t        line_no,
+    uint32_t        col_no
 );
 void ast_fn_call_cleanup(struct ast_fn_call *ast);
 
@@ -293,7 +335,7 @@ void ast_fn_call_cleanup(struct ast_fn_call *ast);
 struct ast_fn_decl {
     enum data_type   data_type;
     uint16_t         ptr_depth;
-    char            *name; /** \note Must be dynamically allocated. */
+    const char      *name; /** \note Interned. */
     struct ast_node *args;
     struct ast_node *body; /** \note May be NULL. If so, this statement represents
                                      function prototype. */
@@ -302,11 +344,11 @@ struct ast_fn_decl {
 wur struct ast_node *ast_fn_decl_init(
     enum data_type   data_type,
     uint16_t         ptr_depth,
-    char            *name,
+    const char      *name,
     struct ast_node *args,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_fn_decl_cleanup(struct ast_fn_decl *ast);
 
@@ -324,8 +366,8 @@ wur struct ast_node *ast_if_init(
     struct ast_node *condition,
     struct ast_node *body,
     struct ast_node *else_body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_if_cleanup(struct ast_if *ast);
 
@@ -345,8 +387,8 @@ struct ast_member {
 wur struct ast_node *ast_member_init(
     struct ast_node *structure,
     struct ast_node *member,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_member_cleanup(struct ast_member *ast);
 
@@ -359,7 +401,7 @@ struct ast_int {
 };
 
 wur
-struct ast_node *ast_int_init(int32_t value, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_int_init(int32_t value, uint32_t line_no, uint32_t col_no);
 void             ast_int_cleanup(struct ast_int *ast);
 
 
@@ -372,7 +414,7 @@ struct ast_ret {
 };
 
 wur
-struct ast_node *ast_ret_init(struct ast_node *op, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_ret_init(struct ast_node *op, uint32_t line_no, uint32_t col_no);
 void             ast_ret_cleanup(struct ast_ret *ast);
 
 
@@ -380,16 +422,16 @@ void             ast_ret_cleanup(struct ast_ret *ast);
  **              String literal              **
  **********************************************/
 struct ast_string {
-    uint64_t  len;
-    char     *value; /** \note Must be dynamically allocated. */
+    uint64_t    len;
+    const char *value; /** \note Interned. */
 };
 
 wur
 struct ast_node *ast_string_init(
-    uint64_t  len,
-    char     *value,
-    uint16_t  line_no,
-    uint16_t col_no
+    uint64_t    len,
+    const char *value,
+    uint32_t    line_no,
+    uint32_t    col_no
 );
 void ast_string_cleanup(struct ast_string *ast);
 
@@ -398,15 +440,15 @@ void ast_string_cleanup(struct ast_string *ast);
  **          Structure declaration           **
  **********************************************/
 struct ast_struct_decl {
-    char            *name; /** \note Must be dynamically allocated. */
+    const char      *name; /** \note Interned. */
     struct ast_node *decls;
 };
 
 wur struct ast_node *ast_struct_decl_init(
-    char            *name,
+    const char      *name,
     struct ast_node *decls,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_struct_decl_cleanup(struct ast_struct_decl *ast);
 
@@ -415,11 +457,11 @@ void ast_struct_decl_cleanup(struct ast_struct_decl *ast);
  **              Symbol                      **
  **********************************************/
 struct ast_sym {
-    char *value; /** \note Must be dynamically allocated. */
+    const char *value; /** \note Interned. */
 };
 
 wur
-struct ast_node *ast_sym_init(char *value, uint16_t line_no, uint16_t col_no);
+struct ast_node *ast_sym_init(const char *value, uint32_t line_no, uint32_t col_no);
 void             ast_sym_cleanup(struct ast_sym *ast);
 
 
@@ -436,8 +478,8 @@ wur struct ast_node *ast_unary_init(
     enum ast_type    type,
     enum token_type  op,
     struct ast_node *operand,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_unary_cleanup(struct ast_unary *ast);
 
@@ -451,15 +493,15 @@ struct ast_var_decl {
 
     /** Variable name.
        
-        \note Must be dynamically allocated. */
-    char *name;
+        \note Interned. */
+    const char *name;
 
     /** Optional type name for arrays of structure type.
        
-        \note - If present, must be dynamically allocated.
+        \note - If present, interned.
               - May be NULL. If so, this statement represents
                 primitive type declaration. */
-    char *type_name;
+    const char *type_name;
 
     /** Depth of pointer, like for
         int ***ptr, ptr depth = 3, for
@@ -477,12 +519,12 @@ struct ast_var_decl {
 /** \note type_name may be NULL. */
 wur struct ast_node *ast_var_decl_init(
     enum data_type    dt,
-    char             *name,
-    char             *type_name,
+    const char       *name,
+    const char       *type_name,
     uint16_t          ptr_depth,
     struct ast_node  *body,
-    uint16_t          line_no,
-    uint16_t          col_no
+    uint32_t          line_no,
+    uint32_t          col_no
 );
 void ast_var_decl_cleanup(struct ast_var_decl *ast);
 
@@ -498,8 +540,8 @@ struct ast_while {
 wur struct ast_node *ast_while_init(
     struct ast_node *cond,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_while_cleanup(struct ast_while *ast);
 
@@ -515,8 +557,8 @@ struct ast_implicit_cast {
 wur struct ast_node *ast_implicit_cast_init(
     enum data_type   to,
     struct ast_node *body,
-    uint16_t         line_no,
-    uint16_t         col_no
+    uint32_t         line_no,
+    uint32_t         col_no
 );
 void ast_implicit_cast_cleanup(struct ast_implicit_cast *ast);
 
@@ -0,0 +1,627 @@
+/* ast_cache.c - Binary AST cache (.wast files).
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast_cache.h"
+#include "front_end/ast/ast_flat.h"
+#include "util/alloc.h"
+#include "util/hashmap.h"
+#include "util/intern.h"
+#include "util/source.h"
+#include "util/vector.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* All pools of flat AST, in order they are placed in file. */
+#define AST_CACHE_POOLS(x) \
+    x(nodes)               \
+    x(lists)               \
+    x(floats)              \
+    x(strings)             \
+    x(compounds)           \
+    x(var_decls)           \
+    x(array_decls)         \
+    x(array_accesses)      \
+    x(struct_decls)        \
+    x(binaries)            \
+    x(unaries)             \
+    x(members)             \
+    x(ifs)                 \
+    x(fors)                \
+    x(for_ranges)          \
+    x(whiles)              \
+    x(do_whiles)           \
+    x(fn_decls)            \
+    x(fn_calls)            \
+    x(casts)
+
+#define __count(name) + 1
+#define AST_CACHE_POOLS_COUNT (0 AST_CACHE_POOLS(__count))
+
+struct ast_cache_section {
+    uint64_t offset;
+    uint64_t count;
+    /** Size of element, to reject files written with other
+        layout of structures. */
+    uint64_t elem;
+};
+
+/** Entry of string table. */
+struct ast_cache_string {
+    uint32_t offset; /** In `chars` section. */
+    uint32_t len;
+};
+
+struct ast_cache_header {
+    char                     magic[4];
+    uint32_t                 version;
+    uint64_t                 source_hash;
+    uint64_t                 source_size;
+    struct ast_cache_section pools[AST_CACHE_POOLS_COUNT];
+    /** String with index i in table has local id i + 1, so
+        INTERN_NO_ID is kept as is. */
+    struct ast_cache_section strings;
+    struct ast_cache_section chars;
+};
+
+static const char ast_cache_magic[4] = {'W', 'A', 'S', 'T'};
+
+/* Pool of flat AST viewed regardless of element type. All
+   vector_t's have the same layout. */
+struct ast_cache_pool {
+    void   **data;
+    size_t  *count;
+    uint64_t elem;
+};
+
+static void cache_pools(struct ast_flat *flat, struct ast_cache_pool *out)
+{
+    uint64_t i = 0;
+
+#define __pool(name)                          \
+    out[i++] = (struct ast_cache_pool) {      \
+        .data  = (void **) &flat->name.data,  \
+        .count = &flat->name.count,           \
+        .elem  = sizeof (*flat->name.data)    \
+    };
+    AST_CACHE_POOLS(__pool)
+#undef __pool
+}
+
+/* Replace each name id in `flat` with map(id). INTERN_NO_ID
+   (absent optional name) is not passed to map. */
+static void cache_remap(
+    struct ast_flat *flat,
+    uint32_t       (*map)(uint32_t id, void *arg),
+    void            *arg
+) {
+#define __remap(field) \
+    if ((field) != INTERN_NO_ID) (field) = map((field), arg);
+
+    vector_foreach(flat->nodes, i)
+        if (flat->nodes.data[i].type == AST_SYMBOL)
+            __remap(flat->nodes.data[i].payload);
+
+    vector_foreach(flat->strings, i)
+        __remap(flat->strings.data[i].value);
+
+    vector_foreach(flat->var_decls, i) {
+        __remap(flat->var_decls.data[i].name);
+        __remap(flat->var_decls.data[i].type_name);
+    }
+
+    vector_foreach(flat->array_decls, i) {
+        __remap(flat->array_decls.data[i].name);
+        __remap(flat->array_decls.data[i].type_name);
+    }
+
+    vector_foreach(flat->array_accesses, i)
+        __remap(flat->array_accesses.data[i].name);
+
+    vector_foreach(flat->struct_decls, i)
+        __remap(flat->struct_decls.data[i].name);
+
+    vector_foreach(flat->fn_decls, i)
+        __remap(flat->fn_decls.data[i].name);
+
+    vector_foreach(flat->fn_calls, i)
+        __remap(flat->fn_calls.data[i].name);
+#undef __remap
+}
+
+static uint64_t cache_source_hash(const struct source *src)
+{
+    return intern_hash(src->data, src->size);
+}
+
+bool ast_cache_path(char *out, uint64_t size, const char *dir, const struct source *src)
+{
+    int len = snprintf(out, size, "%s/%016lx.wast", dir, cache_source_hash(src));
+
+    if (len < 0 || (uint64_t) len >= size) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/**********************************************
+ **              Store                       **
+ **********************************************/
+struct ast_cache_names {
+    /** Interned id -> local id. */
+    hashmap_t           ids;
+    /** Local id - 1 -> interned id. */
+    vector_t(uint32_t)  table;
+};
+
+static uint32_t cache_local_id(uint32_t id, void *arg)
+{
+    struct ast_cache_names *names = arg;
+    bool                    ok    = 0;
+    uint64_t                local = hashmap_get(&names->ids, id, &ok);
+
+    if (ok)
+        return local;
+
+    vector_push_back(names->table, id);
+    local = names->table.count;
+    hashmap_put(&names->ids, id, local);
+
+    return local;
+}
+
+static uint64_t cache_align(uint64_t offset)
+{
+    return (offset + 7) & ~7ULL;
+}
+
+static bool cache_write(FILE *f, uint64_t *offset, const void *data, uint64_t size)
+{
+    static const char zeros[8] = {0};
+    uint64_t          aligned  = cache_align(*offset);
+
+    if (fwrite(zeros, 1, aligned - *offset, f) != aligned - *offset)
+        return 0;
+    if (size > 0 && fwrite(data, 1, size, f) != size)
+        return 0;
+
+    *offset = aligned + size;
+    return 1;
+}
+
+static bool cache_write_file(FILE *f, struct ast_flat *flat, struct ast_cache_names *names, const struct source *src)
+{
+    struct ast_cache_header           header                       = {0};
+    struct ast_cache_pool             pools[AST_CACHE_POOLS_COUNT] = {0};
+    vector_t(struct ast_cache_string) table                        = {0};
+    uint64_t                          offset                       = sizeof (header);
+    uint64_t                          chars                        = 0;
+    bool                              ok                           = 1;
+
+    memcpy(header.magic, ast_cache_magic, sizeof (header.magic));
+    header.version     = AST_CACHE_VERSION;
+    header.source_hash = cache_source_hash(src);
+    header.source_size = src->size;
+
+    cache_pools(flat, pools);
+
+    vector_foreach(names->table, i) {
+        uint32_t len = strlen(intern_str(names->table.data[i]));
+
+        vector_push_back(table, ((struct ast_cache_string) {.offset = chars, .len = len}));
+        chars += len;
+    }
+
+    /* Layout. */
+    for (uint64_t i = 0; i < AST_CACHE_POOLS_COUNT; ++i) {
+        offset = cache_align(offset);
+        header.pools[i] = (struct ast_cache_section) {
+            .offset = offset,
+            .count  = *pools[i].count,
+            .elem   = pools[i].elem
+        };
+        offset += *pools[i].count * pools[i].elem;
+    }
+
+    offset = cache_align(offset);
+    header.strings = (struct ast_cache_section) {
+        .offset = offset,
+        .count  = table.count,
+        .elem   = sizeof (struct ast_cache_string)
+    };
+    offset += table.count * sizeof (struct ast_cache_string);
+
+    header.chars = (struct ast_cache_section) {
+        .offset = cache_align(offset),
+        .count  = chars,
+        .elem   = 1
+    };
+
+    /* Contents. Offsets are the same as computed above. */
+    offset = 0;
+    ok = cache_write(f, &offset, &header, sizeof (header));
+
+    for (uint64_t i = 0; ok && i < AST_CACHE_POOLS_COUNT; ++i)
+        ok = cache_write(f, &offset, *pools[i].data, *pools[i].count * pools[i].elem);
+
+    if (ok)
+        ok = cache_write(f, &offset, table.data, table.count * sizeof (struct ast_cache_string));
+
+    /* Strings are packed one after another, without
+       alignment. */
+    if (ok)
+        ok = cache_write(f, &offset, NULL, 0);
+
+    vector_foreach(names->table, i) {
+        uint32_t len = table.data[i].len;
+
+        if (!ok)
+            break;
+        ok = fwrite(intern_str(names->table.data[i]), 1, len, f) == len;
+    }
+
+    vector_free(table);
+    return ok;
+}
+
+bool ast_cache_store(const char *path, struct ast_node *ast, const struct source *src)
+{
+    static const char      suffix[] = ".XXXXXX";
+    struct ast_flat        flat     = {0};
+    struct ast_cache_names names    = {0};
+    uint64_t               len      = strlen(path);
+    char                  *tmp      = weak_malloc(len + sizeof (suffix));
+    bool                   ok       = 0;
+    int                    fd       = -1;
+    FILE                  *f        = NULL;
+
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, suffix, sizeof (suffix));
+
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        weak_free(tmp);
+        return 0;
+    }
+
+    f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        unlink(tmp);
+        weak_free(tmp);
+        return 0;
+    }
+
+    ast_flat_build(&flat, ast);
+    hashmap_init(&names.ids, 64);
+    cache_remap(&flat, cache_local_id, &names);
+
+    ok = cache_write_file(f, &flat, &names, src);
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok)
+        ok = rename(tmp, path) == 0;
+    if (!ok)
+        unlink(tmp);
+
+    hashmap_destroy(&names.ids);
+    vector_free(names.table);
+    ast_flat_free(&flat);
+    weak_free(tmp);
+
+    return ok;
+}
+
+
+/**********************************************
+ **              Load                        **
+ **********************************************/
+struct ast_cache_ids {
+    /** Local id - 1 -> interned id. */
+    uint32_t *ids;
+    uint64_t  count;
+    bool      ok;
+};
+
+static uint32_t cache_intern_id(uint32_t local, void *arg)
+{
+    struct ast_cache_ids *ids = arg;
+
+    if (local > ids->count) {
+        ids->ok = 0;
+        return INTERN_NO_ID;
+    }
+
+    return ids->ids[local - 1];
+}
+
+static bool cache_section_ok(const struct ast_cache_section *s, uint64_t elem, uint64_t file_size)
+{
+    if (s->elem != elem || s->offset % 8 != 0 || s->offset > file_size)
+        return 0;
+
+    return s->count <= (file_size - s->offset) / elem;
+}
+
+static bool cache_header_ok(
+    const struct ast_cache_header *h,
+    const struct ast_cache_pool   *pools,
+    uint64_t                       file_size,
+    const struct source           *src
+) {
+    if (memcmp(h->magic, ast_cache_magic, sizeof (h->magic)) != 0)
+        return 0;
+    if (h->version != AST_CACHE_VERSION)
+        return 0;
+    if (h->source_size != src->size || h->source_hash != cache_source_hash(src))
+        return 0;
+
+    for (uint64_t i = 0; i < AST_CACHE_POOLS_COUNT; ++i)
+        if (!cache_section_ok(&h->pools[i], pools[i].elem, file_size))
+            return 0;
+
+    return cache_section_ok(&h->strings, sizeof (struct ast_cache_string), file_size)
+        && cache_section_ok(&h->chars, 1, file_size);
+}
+
+/* Each node except root must be child of exactly one node
+   with lesser index. Otherwise ast_flat_unflatten() would
+   take child, which is not built yet, or give it to two
+   parents. */
+struct ast_cache_check {
+    const struct ast_flat *flat;
+    uint8_t               *has_parent;
+    bool                   ok;
+};
+
+static void cache_check_kid(struct ast_cache_check *c, ast_idx_t parent, ast_idx_t kid)
+{
+    if (kid == AST_FLAT_NONE)
+        return;
+
+    if (kid <= parent || kid >= c->flat->nodes.count || c->has_parent[kid]) {
+        c->ok = 0;
+        return;
+    }
+
+    c->has_parent[kid] = 1;
+}
+
+/* Check payload and children indices of node against
+   counts of pools and nodes. */
+static bool cache_node_ok(struct ast_cache_check *c, ast_idx_t idx)
+{
+    const struct ast_flat      *flat = c->flat;
+    const struct ast_flat_node *node = &flat->nodes.data[idx];
+
+#define __in_pool(pool)     if (node->payload >= flat->pool.count) return 0;
+#define __kid(i) cache_check_kid(c, idx, (i))
+
+    switch (node->type) {
+    case AST_INT:
+    case AST_CHAR:
+    case AST_BOOL:
+    case AST_SYMBOL:
+    case AST_BREAK_STMT:
+    case AST_CONTINUE_STMT: /* Fall through. */
+        break;
+    case AST_RETURN_STMT:
+        __kid(node->payload);
+        break;
+    case AST_FLOAT:
+        __in_pool(floats);
+        break;
+    case AST_STRING:
+        __in_pool(strings);
+        break;
+    case AST_COMPOUND_STMT: {
+        __in_pool(compounds);
+        const struct ast_flat_compound *s = ast_flat_get(flat, compounds, idx);
+        if ((uint64_t) s->begin + s->size > flat->lists.count)
+            return 0;
+        for (uint32_t i = 0; i < s->size; ++i)
+            __kid(flat->lists.data[s->begin + i]);
+        break;
+    }
+    case AST_VAR_DECL:
+        __in_pool(var_decls);
+        __kid(ast_flat_get(flat, var_decls, idx)->body);
+        break;
+    case AST_ARRAY_DECL: {
+        __in_pool(array_decls);
+        const struct ast_flat_array_decl *d = ast_flat_get(flat, array_decls, idx);
+        __kid(d->arity);
+        __kid(d->body);
+        break;
+    }
+    case AST_ARRAY_ACCESS:
+        __in_pool(array_accesses);
+        __kid(ast_flat_get(flat, array_accesses, idx)->indices);
+        break;
+    case AST_STRUCT_DECL:
+        __in_pool(struct_decls);
+        __kid(ast_flat_get(flat, struct_decls, idx)->decls);
+        break;
+    case AST_BINARY: {
+        __in_pool(binaries);
+        const struct ast_flat_binary *s = ast_flat_get(flat, binaries, idx);
+        __kid(s->lhs);
+        __kid(s->rhs);
+        break;
+    }
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY: /* Fall through. */
+        __in_pool(unaries);
+        __kid(ast_flat_get(flat, unaries, idx)->operand);
+        break;
+    case AST_MEMBER: {
+        __in_pool(members);
+        const struct ast_flat_member *s = ast_flat_get(flat, members, idx);
+        __kid(s->structure);
+        __kid(s->member);
+        break;
+    }
+    case AST_IF_STMT: {
+        __in_pool(ifs);
+        const struct ast_flat_if *s = ast_flat_get(flat, ifs, idx);
+        __kid(s->condition);
+        __kid(s->body);
+        __kid(s->else_body);
+        break;
+    }
+    case AST_FOR_STMT: {
+        __in_pool(fors);
+        const struct ast_flat_for *s = ast_flat_get(flat, fors, idx);
+        __kid(s->init);
+        __kid(s->condition);
+        __kid(s->increment);
+        __kid(s->body);
+        break;
+    }
+    case AST_FOR_RANGE_STMT: {
+        __in_pool(for_ranges);
+        const struct ast_flat_for_range *s = ast_flat_get(flat, for_ranges, idx);
+        __kid(s->iter);
+        __kid(s->range_target);
+        __kid(s->body);
+        break;
+    }
+    case AST_WHILE_STMT: {
+        __in_pool(whiles);
+        const struct ast_flat_while *s = ast_flat_get(flat, whiles, idx);
+        __kid(s->cond);
+        __kid(s->body);
+        break;
+    }
+    case AST_DO_WHILE_STMT: {
+        __in_pool(do_whiles);
+        const struct ast_flat_do_while *s = ast_flat_get(flat, do_whiles, idx);
+        __kid(s->body);
+        __kid(s->condition);
+        break;
+    }
+    case AST_FUNCTION_DECL: {
+        __in_pool(fn_decls);
+        const struct ast_flat_fn_decl *d = ast_flat_get(flat, fn_decls, idx);
+        __kid(d->args);
+        __kid(d->body);
+        break;
+    }
+    case AST_FUNCTION_CALL:
+        __in_pool(fn_calls);
+        __kid(ast_flat_get(flat, fn_calls, idx)->args);
+        break;
+    case AST_IMPLICIT_CAST:
+        __in_pool(casts);
+        __kid(ast_flat_get(flat, casts, idx)->body);
+        break;
+    default:
+        return 0;
+    }
+#undef __kid
+#undef __in_pool
+
+    return c->ok;
+}
+
+static bool cache_nodes_ok(const struct ast_flat *flat)
+{
+    uint64_t               count = flat->nodes.count;
+    struct ast_cache_check c     = {.flat = flat, .ok = 1};
+
+    /* Root is compound, which owns the whole tree. */
+    if (count == 0 || flat->nodes.data[0].type != AST_COMPOUND_STMT)
+        return 0;
+
+    c.has_parent = weak_calloc(count, sizeof (uint8_t));
+
+    for (uint64_t i = 0; c.ok && i < count; ++i)
+        c.ok = cache_node_ok(&c, i);
+
+    /* Node without parent would be leaked. */
+    for (uint64_t i = 1; c.ok && i < count; ++i)
+        c.ok = c.has_parent[i];
+
+    weak_free(c.has_parent);
+    return c.ok;
+}
+
+struct ast_node *ast_cache_load(const char *path, const struct source *src)
+{
+    struct ast_cache_header *h                            = NULL;
+    struct ast_cache_pool    pools[AST_CACHE_POOLS_COUNT] = {0};
+    struct ast_flat          flat                         = {0};
+    struct ast_cache_ids     ids                          = {.ok = 1};
+    struct ast_node         *ast                          = NULL;
+    struct stat              st                           = {0};
+    char                    *base                         = NULL;
+    int                      fd                           = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) < 0 || (uint64_t) st.st_size < sizeof (*h)) {
+        close(fd);
+        return NULL;
+    }
+
+    /* Private writable mapping: names are fixed up in place
+       and written pages are never visible in file. */
+    base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return NULL;
+
+    h = (struct ast_cache_header *) base;
+
+    cache_pools(&flat, pools);
+
+    if (!cache_header_ok(h, pools, st.st_size, src))
+        goto out;
+
+    /* Pointer fix-up. Vectors are only viewed and never
+       freed, capacity is left 0. */
+    for (uint64_t i = 0; i < AST_CACHE_POOLS_COUNT; ++i) {
+        *pools[i].data  = base + h->pools[i].offset;
+        *pools[i].count = h->pools[i].count;
+    }
+
+    /* String table. */
+    const struct ast_cache_string *table = (void *) (base + h->strings.offset);
+    const char                    *chars = base + h->chars.offset;
+
+    ids.count = h->strings.count;
+    ids.ids   = weak_calloc(ids.count + 1, sizeof (uint32_t));
+
+    for (uint64_t i = 0; i < ids.count; ++i) {
+        const struct ast_cache_string *s = &table[i];
+
+        if ((uint64_t) s->offset + s->len > h->chars.count)
+            goto out;
+
+        ids.ids[i] = intern_id(intern_n(chars + s->offset, s->len));
+    }
+
+    cache_remap(&flat, cache_intern_id, &ids);
+    if (!ids.ok || !cache_nodes_ok(&flat))
+        goto out;
+
+    ast = ast_flat_unflatten(&flat);
+
+out:
+    weak_free(ids.ids);
+    munmap(base, st.st_size);
+    return ast;
+}
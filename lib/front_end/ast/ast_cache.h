@@ -0,0 +1,65 @@
+/* ast_cache.h - Binary AST cache (.wast files).
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_AST_AST_CACHE_H
+#define WEAK_COMPILER_FRONTEND_AST_AST_CACHE_H
+
+#include "util/compiler.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ast_node;
+struct source;
+
+/** AST of source file saved to skip lexing and parsing
+    when file is not changed.
+
+    File is image of flat AST (see ast_flat.h): header,
+    then pools of nodes and payloads as they are in memory,
+    then string table. Everything is referred by offsets
+    and indices, so file is position-independent. Names
+    are indices in string table of the file.
+
+    File is loaded with single mmap(). Fix-up sets pool
+    pointers to mapped sections and replaces string table
+    indices with ids of interned strings. Mapping is
+    private, so file is never modified.
+
+    Entry is keyed by hash and size of source contents,
+    both stored in header and checked on load.
+
+    \note Header, sections bounds and all indices of nodes
+          and payloads are checked on load, and file failed
+          to pass check is treated as missing. Other fields,
+          such as operators and types, are trusted, since
+          cache is produced by compiler itself. */
+
+/** Version of file format. Bumped on every change of AST
+    or of file layout. */
+#define AST_CACHE_VERSION 1
+
+/** Get cache file name for `src` in directory `dir`.
+    Name is made of source contents hash.
+
+    \return 1 on success, 0 with errno set to ENAMETOOLONG
+            if name does not fit in `size` bytes. */
+wur bool ast_cache_path(char *out, uint64_t size, const char *dir, const struct source *src);
+
+/** Save AST of `src` to `path`. File is written under
+    temporary name and renamed, so concurrent readers never
+    see it partially written.
+
+    \return 1 on success, 0 on error with errno set. */
+wur bool ast_cache_store(const char *path, struct ast_node *ast, const struct source *src);
+
+/** Load AST of `src` from `path`.
+
+    \return AST, freed by ast_node_cleanup(), or NULL if
+            there is no valid entry for exactly this
+            source contents. */
+wur struct ast_node *ast_cache_load(const char *path, const struct source *src);
+
+#endif // WEAK_COMPILER_FRONTEND_AST_AST_CACHE_H
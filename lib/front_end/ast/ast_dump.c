@@ -13,7 +13,7 @@
 #include <stdio.h>
 #include <string.h>
 
-static uint32_t ast_indent = 0;
+static _Thread_local uint32_t ast_indent = 0;
 
 static struct ast_dump_config config = {
     .colored  = 0,
@@ -0,0 +1,516 @@
+/* ast_flat.c - Flat, index-based AST.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast_flat.h"
+#include "front_end/ast/ast_walk.h"
+#include "util/alloc.h"
+#include "util/intern.h"
+#include "util/unreachable.h"
+#include <assert.h>
+
+/**********************************************
+ **              Building                    **
+ **********************************************/
+static uint32_t flat_id(const char *name)
+{
+    return name ? intern_id(name) : INTERN_NO_ID;
+}
+
+static const char *flat_str(uint32_t id)
+{
+    return id != INTERN_NO_ID ? intern_str(id) : NULL;
+}
+
+static void flat_clear(struct ast_flat *flat)
+{
+    vector_clear(flat->nodes);
+    vector_clear(flat->lists);
+    vector_clear(flat->floats);
+    vector_clear(flat->strings);
+    vector_clear(flat->compounds);
+    vector_clear(flat->var_decls);
+    vector_clear(flat->array_decls);
+    vector_clear(flat->array_accesses);
+    vector_clear(flat->struct_decls);
+    vector_clear(flat->binaries);
+    vector_clear(flat->unaries);
+    vector_clear(flat->members);
+    vector_clear(flat->ifs);
+    vector_clear(flat->fors);
+    vector_clear(flat->for_ranges);
+    vector_clear(flat->whiles);
+    vector_clear(flat->do_whiles);
+    vector_clear(flat->fn_decls);
+    vector_clear(flat->fn_calls);
+    vector_clear(flat->casts);
+}
+
+/* Append node with payload. Children are set to
+   AST_FLAT_NONE and filled by flat_set_child() as
+   they are added. */
+static ast_idx_t flat_node(struct ast_flat *flat, struct ast_node *node)
+{
+    uint32_t payload = 0;
+    void    *ast     = node->ast;
+
+/* Push payload and remember its index. */
+#define flat_push(pool, ...) \
+    vector_push_back(flat->pool, ((typeof (*flat->pool.data)) __VA_ARGS__)); \
+    payload = flat->pool.count - 1;
+
+    switch (node->type) {
+    case AST_INT:
+        payload = (uint32_t) ((struct ast_int *) ast)->value;
+        break;
+    case AST_CHAR:
+        payload = (uint8_t) ((struct ast_char *) ast)->value;
+        break;
+    case AST_BOOL:
+        payload = ((struct ast_bool *) ast)->value;
+        break;
+    case AST_SYMBOL:
+        payload = intern_id(((struct ast_sym *) ast)->value);
+        break;
+    case AST_BREAK_STMT:
+    case AST_CONTINUE_STMT:
+    case AST_RETURN_STMT: /* Fall through. */
+        break;
+    case AST_FLOAT:
+        flat_push(floats, ((struct ast_float *) ast)->value);
+        break;
+    case AST_STRING: {
+        struct ast_string *s = ast;
+        flat_push(strings, {.value = intern_id(s->value), .len = s->len});
+        break;
+    }
+    case AST_COMPOUND_STMT: {
+        struct ast_compound *s = ast;
+        flat_push(compounds, {.begin = flat->lists.count, .size = s->size});
+        for (uint64_t i = 0; i < s->size; ++i)
+            vector_push_back(flat->lists, AST_FLAT_NONE);
+        break;
+    }
+    case AST_VAR_DECL: {
+        struct ast_var_decl *d = ast;
+        flat_push(var_decls, {
+            .dt        = d->dt,
+            .name      = flat_id(d->name),
+            .type_name = flat_id(d->type_name),
+            .ptr_depth = d->ptr_depth
+        });
+        break;
+    }
+    case AST_ARRAY_DECL: {
+        struct ast_array_decl *d = ast;
+        flat_push(array_decls, {
+            .dt        = d->dt,
+            .name      = flat_id(d->name),
+            .type_name = flat_id(d->type_name),
+            .ptr_depth = d->ptr_depth
+        });
+        break;
+    }
+    case AST_ARRAY_ACCESS:
+        flat_push(array_accesses, {.name = flat_id(((struct ast_array_access *) ast)->name)});
+        break;
+    case AST_STRUCT_DECL:
+        flat_push(struct_decls, {.name = flat_id(((struct ast_struct_decl *) ast)->name)});
+        break;
+    case AST_BINARY:
+        flat_push(binaries, {.op = ((struct ast_binary *) ast)->op});
+        break;
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY: /* Fall through. */
+        flat_push(unaries, {.op = ((struct ast_unary *) ast)->op});
+        break;
+    case AST_MEMBER:
+        flat_push(members, {0});
+        break;
+    case AST_IF_STMT:
+        flat_push(ifs, {0});
+        break;
+    case AST_FOR_STMT:
+        flat_push(fors, {0});
+        break;
+    case AST_FOR_RANGE_STMT:
+        flat_push(for_ranges, {0});
+        break;
+    case AST_WHILE_STMT:
+        flat_push(whiles, {0});
+        break;
+    case AST_DO_WHILE_STMT:
+        flat_push(do_whiles, {0});
+        break;
+    case AST_FUNCTION_DECL: {
+        struct ast_fn_decl *d = ast;
+        flat_push(fn_decls, {
+            .data_type = d->data_type,
+            .ptr_depth = d->ptr_depth,
+            .name      = flat_id(d->name)
+        });
+        break;
+    }
+    case AST_FUNCTION_CALL:
+        flat_push(fn_calls, {.name = flat_id(((struct ast_fn_call *) ast)->name)});
+        break;
+    case AST_IMPLICIT_CAST:
+        flat_push(casts, {.to = ((struct ast_implicit_cast *) ast)->to});
+        break;
+    default:
+        weak_unreachable("Unknown AST type (%d, %s).", node->type, ast_type_to_string(node->type));
+    }
+#undef flat_push
+
+    vector_push_back(flat->nodes, ((struct ast_flat_node) {
+        .type    = node->type,
+        .payload = payload,
+        .line_no = node->line_no,
+        .col_no  = node->col_no
+    }));
+
+    return flat->nodes.count - 1;
+}
+
+/* Set `i`-th child of node `idx`. Order is the same as
+   of ast_child(). */
+static void flat_set_child(struct ast_flat *flat, ast_idx_t idx, uint64_t i, ast_idx_t child)
+{
+    ast_idx_t *c[4] = {0};
+
+    switch (flat->nodes.data[idx].type) {
+    case AST_COMPOUND_STMT:
+        ast_flat_stmt(flat, idx, i) = child;
+        return;
+    case AST_RETURN_STMT:
+        flat->nodes.data[idx].payload = child;
+        return;
+    case AST_VAR_DECL: {
+        struct ast_flat_var_decl *d = ast_flat_get(flat, var_decls, idx);
+        c[0] = &d->body;
+        break;
+    }
+    case AST_ARRAY_DECL: {
+        struct ast_flat_array_decl *d = ast_flat_get(flat, array_decls, idx);
+        c[0] = &d->arity;
+        c[1] = &d->body;
+        break;
+    }
+    case AST_ARRAY_ACCESS:
+        c[0] = &ast_flat_get(flat, array_accesses, idx)->indices;
+        break;
+    case AST_STRUCT_DECL:
+        c[0] = &ast_flat_get(flat, struct_decls, idx)->decls;
+        break;
+    case AST_BINARY: {
+        struct ast_flat_binary *s = ast_flat_get(flat, binaries, idx);
+        c[0] = &s->lhs;
+        c[1] = &s->rhs;
+        break;
+    }
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY: /* Fall through. */
+        c[0] = &ast_flat_get(flat, unaries, idx)->operand;
+        break;
+    case AST_MEMBER: {
+        struct ast_flat_member *s = ast_flat_get(flat, members, idx);
+        c[0] = &s->structure;
+        c[1] = &s->member;
+        break;
+    }
+    case AST_IF_STMT: {
+        struct ast_flat_if *s = ast_flat_get(flat, ifs, idx);
+        c[0] = &s->condition;
+        c[1] = &s->body;
+        c[2] = &s->else_body;
+        break;
+    }
+    case AST_FOR_STMT: {
+        struct ast_flat_for *s = ast_flat_get(flat, fors, idx);
+        c[0] = &s->init;
+        c[1] = &s->condition;
+        c[2] = &s->increment;
+        c[3] = &s->body;
+        break;
+    }
+    case AST_FOR_RANGE_STMT: {
+        struct ast_flat_for_range *s = ast_flat_get(flat, for_ranges, idx);
+        c[0] = &s->iter;
+        c[1] = &s->range_target;
+        c[2] = &s->body;
+        break;
+    }
+    case AST_WHILE_STMT: {
+        struct ast_flat_while *s = ast_flat_get(flat, whiles, idx);
+        c[0] = &s->cond;
+        c[1] = &s->body;
+        break;
+    }
+    case AST_DO_WHILE_STMT: {
+        struct ast_flat_do_while *s = ast_flat_get(flat, do_whiles, idx);
+        c[0] = &s->body;
+        c[1] = &s->condition;
+        break;
+    }
+    case AST_FUNCTION_DECL: {
+        struct ast_flat_fn_decl *d = ast_flat_get(flat, fn_decls, idx);
+        c[0] = &d->args;
+        c[1] = &d->body;
+        break;
+    }
+    case AST_FUNCTION_CALL:
+        c[0] = &ast_flat_get(flat, fn_calls, idx)->args;
+        break;
+    case AST_IMPLICIT_CAST:
+        c[0] = &ast_flat_get(flat, casts, idx)->body;
+        break;
+    default:
+        weak_unreachable("AST type %s has no children.", ast_type_to_string(flat->nodes.data[idx].type));
+    }
+
+    assert(i < 4 && c[i]);
+    *c[i] = child;
+}
+
+/* Node is appended when its walk frame is entered, so
+   nodes are in pre-order. Index of node is kept in
+   data[0] of frame; index of just finished child is
+   stored to parent when parent is on top again. */
+void ast_flat_build(struct ast_flat *flat, struct ast_node *ast)
+{
+    struct ast_walk        w    = {0};
+    struct ast_walk_frame *f    = NULL;
+    ast_idx_t              last = AST_FLAT_NONE;
+
+    flat_clear(flat);
+    ast_walk_init(&w, ast);
+
+    while ((f = ast_walk_top(&w))) {
+        if (f->step == 0)
+            f->data[0] = flat_node(flat, f->ast);
+        else
+            flat_set_child(flat, f->data[0], f->step - 1, last);
+
+        ast_idx_t idx = f->data[0];
+
+        /* Remains so if child is absent. */
+        last = AST_FLAT_NONE;
+
+        if (!ast_walk_child(&w)) {
+            last = idx;
+            ast_walk_pop(&w);
+        }
+    }
+
+    ast_walk_free(&w);
+}
+
+void ast_flat_free(struct ast_flat *flat)
+{
+    vector_free(flat->nodes);
+    vector_free(flat->lists);
+    vector_free(flat->floats);
+    vector_free(flat->strings);
+    vector_free(flat->compounds);
+    vector_free(flat->var_decls);
+    vector_free(flat->array_decls);
+    vector_free(flat->array_accesses);
+    vector_free(flat->struct_decls);
+    vector_free(flat->binaries);
+    vector_free(flat->unaries);
+    vector_free(flat->members);
+    vector_free(flat->ifs);
+    vector_free(flat->fors);
+    vector_free(flat->for_ranges);
+    vector_free(flat->whiles);
+    vector_free(flat->do_whiles);
+    vector_free(flat->fn_decls);
+    vector_free(flat->fn_calls);
+    vector_free(flat->casts);
+}
+
+
+/**********************************************
+ **              Unflattening                **
+ **********************************************/
+static struct ast_node *unflatten_node(
+    const struct ast_flat  *flat,
+    ast_idx_t               idx,
+    struct ast_node       **built
+) {
+    const struct ast_flat_node *node = &flat->nodes.data[idx];
+    uint32_t                    l    = node->line_no;
+    uint32_t                    c    = node->col_no;
+
+/* Children have greater indices, so they are built. */
+#define kid(i) ((i) != AST_FLAT_NONE ? built[i] : NULL)
+
+    switch (node->type) {
+    case AST_INT:
+        return ast_int_init((int32_t) node->payload, l, c);
+    case AST_CHAR:
+        return ast_char_init((char) node->payload, l, c);
+    case AST_BOOL:
+        return ast_bool_init(node->payload, l, c);
+    case AST_SYMBOL:
+        return ast_sym_init(intern_str(node->payload), l, c);
+    case AST_BREAK_STMT:
+        return ast_break_init(l, c);
+    case AST_CONTINUE_STMT:
+        return ast_continue_init(l, c);
+    case AST_RETURN_STMT:
+        return ast_ret_init(kid(node->payload), l, c);
+    case AST_FLOAT:
+        return ast_float_init(flat->floats.data[node->payload], l, c);
+    case AST_STRING: {
+        const struct ast_flat_string *s = ast_flat_get(flat, strings, idx);
+        return ast_string_init(s->len, intern_str(s->value), l, c);
+    }
+    case AST_COMPOUND_STMT: {
+        const struct ast_flat_compound  *s     = ast_flat_get(flat, compounds, idx);
+        struct ast_node                **stmts = NULL;
+
+        if (s->size > 0)
+            stmts = weak_calloc(s->size, sizeof (struct ast_node *));
+
+        for (uint32_t i = 0; i < s->size; ++i)
+            stmts[i] = kid(flat->lists.data[s->begin + i]);
+
+        return ast_compound_init(s->size, stmts, l, c);
+    }
+    case AST_VAR_DECL: {
+        const struct ast_flat_var_decl *d = ast_flat_get(flat, var_decls, idx);
+        return ast_var_decl_init(
+            d->dt, intern_str(d->name), flat_str(d->type_name),
+            d->ptr_depth, kid(d->body), l, c
+        );
+    }
+    case AST_ARRAY_DECL: {
+        const struct ast_flat_array_decl *d = ast_flat_get(flat, array_decls, idx);
+        return ast_array_decl_init(
+            d->dt, intern_str(d->name), flat_str(d->type_name),
+            kid(d->arity), d->ptr_depth, kid(d->body), l, c
+        );
+    }
+    case AST_ARRAY_ACCESS: {
+        const struct ast_flat_array_access *s = ast_flat_get(flat, array_accesses, idx);
+        return ast_array_access_init(intern_str(s->name), kid(s->indices), l, c);
+    }
+    case AST_STRUCT_DECL: {
+        const struct ast_flat_struct_decl *d = ast_flat_get(flat, struct_decls, idx);
+        return ast_struct_decl_init(intern_str(d->name), kid(d->decls), l, c);
+    }
+    case AST_BINARY: {
+        const struct ast_flat_binary *s = ast_flat_get(flat, binaries, idx);
+        return ast_binary_init(s->op, kid(s->lhs), kid(s->rhs), l, c);
+    }
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY: { /* Fall through. */
+        const struct ast_flat_unary *s = ast_flat_get(flat, unaries, idx);
+        return ast_unary_init(node->type, s->op, kid(s->operand), l, c);
+    }
+    case AST_MEMBER: {
+        const struct ast_flat_member *s = ast_flat_get(flat, members, idx);
+        return ast_member_init(kid(s->structure), kid(s->member), l, c);
+    }
+    case AST_IF_STMT: {
+        const struct ast_flat_if *s = ast_flat_get(flat, ifs, idx);
+        return ast_if_init(kid(s->condition), kid(s->body), kid(s->else_body), l, c);
+    }
+    case AST_FOR_STMT: {
+        const struct ast_flat_for *s = ast_flat_get(flat, fors, idx);
+        return ast_for_init(kid(s->init), kid(s->condition), kid(s->increment), kid(s->body), l, c);
+    }
+    case AST_FOR_RANGE_STMT: {
+        const struct ast_flat_for_range *s = ast_flat_get(flat, for_ranges, idx);
+        return ast_for_range_init(kid(s->iter), kid(s->range_target), kid(s->body), l, c);
+    }
+    case AST_WHILE_STMT: {
+        const struct ast_flat_while *s = ast_flat_get(flat, whiles, idx);
+        return ast_while_init(kid(s->cond), kid(s->body), l, c);
+    }
+    case AST_DO_WHILE_STMT: {
+        const struct ast_flat_do_while *s = ast_flat_get(flat, do_whiles, idx);
+        return ast_do_while_init(kid(s->body), kid(s->condition), l, c);
+    }
+    case AST_FUNCTION_DECL: {
+        const struct ast_flat_fn_decl *d = ast_flat_get(flat, fn_decls, idx);
+        return ast_fn_decl_init(
+            d->data_type, d->ptr_depth, intern_str(d->name),
+            kid(d->args), kid(d->body), l, c
+        );
+    }
+    case AST_FUNCTION_CALL: {
+        const struct ast_flat_fn_call *s = ast_flat_get(flat, fn_calls, idx);
+        return ast_fn_call_init(intern_str(s->name), kid(s->args), l, c);
+    }
+    case AST_IMPLICIT_CAST: {
+        const struct ast_flat_implicit_cast *s = ast_flat_get(flat, casts, idx);
+        return ast_implicit_cast_init(s->to, kid(s->body), l, c);
+    }
+    default:
+        weak_unreachable("Unknown AST type (%d, %s).", node->type, ast_type_to_string(node->type));
+    }
+#undef kid
+}
+
+/* Since nodes are in pre-order, walk them backwards:
+   children of each node are already built when it is
+   reached. */
+struct ast_node *ast_flat_unflatten(const struct ast_flat *flat)
+{
+    uint64_t          count = flat->nodes.count;
+    struct ast_node **built = NULL;
+    struct ast_node  *root  = NULL;
+
+    if (count == 0)
+        return NULL;
+
+    built = weak_calloc(count, sizeof (struct ast_node *));
+
+    for (uint64_t i = count; i-- > 0;)
+        built[i] = unflatten_node(flat, i, built);
+
+    root = built[0];
+    weak_free(built);
+
+    return root;
+}
+
+
+/**********************************************
+ **              Walk                        **
+ **********************************************/
+void ast_flat_walk_init(struct ast_flat_walk *w, ast_idx_t root)
+{
+    vector_clear(w->stack);
+    vector_emplace_back(w->stack);
+    vector_back(w->stack).idx = root;
+}
+
+void ast_flat_walk_free(struct ast_flat_walk *w)
+{
+    vector_free(w->stack);
+}
+
+struct ast_flat_walk_frame *ast_flat_walk_top(struct ast_flat_walk *w)
+{
+    return w->stack.count ? &vector_back(w->stack) : NULL;
+}
+
+void ast_flat_walk_push(struct ast_flat_walk *w, ast_idx_t idx)
+{
+    if (idx == AST_FLAT_NONE)
+        return;
+
+    vector_emplace_back(w->stack);
+    vector_back(w->stack).idx = idx;
+}
+
+void ast_flat_walk_pop(struct ast_flat_walk *w)
+{
+    assert(w->stack.count > 0);
+    --w->stack.count;
+}
@@ -0,0 +1,214 @@
+/* ast_flat.h - Flat, index-based AST.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_AST_AST_FLAT_H
+#define WEAK_COMPILER_FRONTEND_AST_AST_FLAT_H
+
+#include "front_end/ast/ast.h"
+#include "util/compiler.h"
+#include "util/vector.h"
+#include <stdint.h>
+
+/** AST stored in one contiguous array of nodes.
+
+    Nodes are placed in pre-order, so each subtree occupies
+    contiguous range right after its root, and child index
+    is always greater than parent index. Traversal goes
+    forward through memory instead of chasing pointers to
+    separately allocated payloads.
+
+    Node refers to its payload by index in pool of its kind,
+    payload refers to children by node index. Names are
+    32-bit ids of interned strings (see intern_id()).
+
+    Nodes with single 32-bit value have no pool, payload
+    index holds value itself:
+    - AST_INT, AST_CHAR, AST_BOOL: value,
+    - AST_SYMBOL: name id,
+    - AST_RETURN_STMT: operand node index.
+
+    \note Flat tree is built from pointer-based one and is
+          read-only after that. */
+
+/** Index of node in ast_flat.nodes. */
+typedef uint32_t ast_idx_t;
+
+/** Absent optional child. Root always has index 0 and is
+    never child of anything, so 0 is free to use. */
+#define AST_FLAT_NONE 0
+
+struct ast_flat_node {
+    enum ast_type type;
+    uint32_t      payload;
+    uint32_t      line_no;
+    uint32_t      col_no;
+};
+
+struct ast_flat_string {
+    uint32_t value; /** Interned id. */
+    uint32_t len;
+};
+
+/** Range in ast_flat.lists. */
+struct ast_flat_compound {
+    uint32_t begin;
+    uint32_t size;
+};
+
+struct ast_flat_var_decl {
+    enum data_type dt;
+    uint32_t       name;
+    uint32_t       type_name; /** INTERN_NO_ID if absent. */
+    uint32_t       ptr_depth;
+    ast_idx_t      body;
+};
+
+struct ast_flat_array_decl {
+    enum data_type dt;
+    uint32_t       name;
+    uint32_t       type_name; /** INTERN_NO_ID if absent. */
+    uint32_t       ptr_depth;
+    ast_idx_t      arity;
+    ast_idx_t      body;
+};
+
+struct ast_flat_array_access {
+    uint32_t  name;
+    ast_idx_t indices;
+};
+
+struct ast_flat_struct_decl {
+    uint32_t  name;
+    ast_idx_t decls;
+};
+
+struct ast_flat_binary {
+    enum token_type op;
+    ast_idx_t       lhs;
+    ast_idx_t       rhs;
+};
+
+struct ast_flat_unary {
+    enum token_type op;
+    ast_idx_t       operand;
+};
+
+struct ast_flat_member {
+    ast_idx_t structure;
+    ast_idx_t member;
+};
+
+struct ast_flat_if {
+    ast_idx_t condition;
+    ast_idx_t body;
+    ast_idx_t else_body;
+};
+
+struct ast_flat_for {
+    ast_idx_t init;
+    ast_idx_t condition;
+    ast_idx_t increment;
+    ast_idx_t body;
+};
+
+struct ast_flat_for_range {
+    ast_idx_t iter;
+    ast_idx_t range_target;
+    ast_idx_t body;
+};
+
+struct ast_flat_while {
+    ast_idx_t cond;
+    ast_idx_t body;
+};
+
+struct ast_flat_do_while {
+    ast_idx_t body;
+    ast_idx_t condition;
+};
+
+struct ast_flat_fn_decl {
+    enum data_type data_type;
+    uint32_t       ptr_depth;
+    uint32_t       name;
+    ast_idx_t      args;
+    ast_idx_t      body; /** AST_FLAT_NONE for prototype. */
+};
+
+struct ast_flat_fn_call {
+    uint32_t  name;
+    ast_idx_t args;
+};
+
+struct ast_flat_implicit_cast {
+    enum data_type to;
+    ast_idx_t      body;
+};
+
+struct ast_flat {
+    vector_t(struct ast_flat_node)          nodes;
+    /** Children of compound statements. */
+    vector_t(ast_idx_t)                     lists;
+    vector_t(double)                        floats;
+    vector_t(struct ast_flat_string)        strings;
+    vector_t(struct ast_flat_compound)      compounds;
+    vector_t(struct ast_flat_var_decl)      var_decls;
+    vector_t(struct ast_flat_array_decl)    array_decls;
+    vector_t(struct ast_flat_array_access)  array_accesses;
+    vector_t(struct ast_flat_struct_decl)   struct_decls;
+    vector_t(struct ast_flat_binary)        binaries;
+    vector_t(struct ast_flat_unary)         unaries;
+    vector_t(struct ast_flat_member)        members;
+    vector_t(struct ast_flat_if)            ifs;
+    vector_t(struct ast_flat_for)           fors;
+    vector_t(struct ast_flat_for_range)     for_ranges;
+    vector_t(struct ast_flat_while)         whiles;
+    vector_t(struct ast_flat_do_while)      do_whiles;
+    vector_t(struct ast_flat_fn_decl)       fn_decls;
+    vector_t(struct ast_flat_fn_call)       fn_calls;
+    vector_t(struct ast_flat_implicit_cast) casts;
+};
+
+/** Payload of node `idx` from given pool, e.g.
+    ast_flat_get(flat, binaries, idx)->lhs. */
+#define ast_flat_get(flat, pool, idx) \
+    (&(flat)->pool.data[(flat)->nodes.data[idx].payload])
+
+/** \return `i`-th statement of compound node `idx`. */
+#define ast_flat_stmt(flat, idx, i) \
+    ((flat)->lists.data[ast_flat_get(flat, compounds, idx)->begin + (i)])
+
+/** Build flat tree from `ast`. Previous contents of `flat`
+    are dropped, memory is reused.
+
+    \pre All names in `ast` are interned. */
+void ast_flat_build(struct ast_flat *flat, struct ast_node *ast);
+
+/** Build pointer-based tree from flat one. Resulting tree
+    is owned by caller and freed with ast_node_cleanup(). */
+wur struct ast_node *ast_flat_unflatten(const struct ast_flat *flat);
+
+void ast_flat_free(struct ast_flat *flat);
+
+/** Same as struct ast_walk, but for flat tree. */
+struct ast_flat_walk_frame {
+    ast_idx_t idx;
+    uint32_t  step;
+    uint64_t  data[4];
+};
+
+struct ast_flat_walk {
+    vector_t(struct ast_flat_walk_frame) stack;
+};
+
+void ast_flat_walk_init(struct ast_flat_walk *w, ast_idx_t root);
+void ast_flat_walk_free(struct ast_flat_walk *w);
+wur struct ast_flat_walk_frame *ast_flat_walk_top(struct ast_flat_walk *w);
+/** No-op if `idx` is AST_FLAT_NONE. */
+void ast_flat_walk_push(struct ast_flat_walk *w, ast_idx_t idx);
+void ast_flat_walk_pop(struct ast_flat_walk *w);
+
+#endif // WEAK_COMPILER_FRONTEND_AST_AST_FLAT_H
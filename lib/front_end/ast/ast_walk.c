@@ -0,0 +1,189 @@
+/* ast_walk.c - AST traversal without recursion.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast_walk.h"
+#include "front_end/ast/ast.h"
+#include "util/unreachable.h"
+#include <assert.h>
+
+void ast_walk_init(struct ast_walk *w, struct ast_node *root)
+{
+    vector_clear(w->stack);
+    ast_walk_push(w, root);
+}
+
+void ast_walk_free(struct ast_walk *w)
+{
+    vector_free(w->stack);
+}
+
+struct ast_walk_frame *ast_walk_top(struct ast_walk *w)
+{
+    return w->stack.count ? &vector_back(w->stack) : NULL;
+}
+
+void ast_walk_push(struct ast_walk *w, struct ast_node *ast)
+{
+    if (!ast)
+        return;
+
+    vector_emplace_back(w->stack);
+    vector_back(w->stack).ast = ast;
+}
+
+void ast_walk_pop(struct ast_walk *w)
+{
+    assert(w->stack.count > 0);
+    --w->stack.count;
+}
+
+bool ast_walk_child(struct ast_walk *w)
+{
+    struct ast_walk_frame *f     = ast_walk_top(w);
+    struct ast_node       *child = NULL;
+
+    if (!ast_child(f->ast, f->step, &child))
+        return 0;
+
+    ++f->step;
+    ast_walk_push(w, child);
+    return 1;
+}
+
+static bool ast_stmt(struct ast_node *compound, uint64_t i, struct ast_node **child)
+{
+    struct ast_compound *stmt = compound->ast;
+
+    if (i >= stmt->size)
+        return 0;
+
+    *child = stmt->stmts[i];
+    return 1;
+}
+
+bool ast_child(struct ast_node *ast, uint64_t i, struct ast_node **child)
+{
+    struct ast_node *c[4] = {0};
+    uint64_t         n    = 0;
+
+    switch (ast->type) {
+    case AST_CHAR:
+    case AST_INT:
+    case AST_FLOAT:
+    case AST_STRING:
+    case AST_BOOL:
+    case AST_SYMBOL:
+    case AST_BREAK_STMT:
+    case AST_CONTINUE_STMT: /* Fall through. */
+        break;
+    case AST_COMPOUND_STMT:
+        return ast_stmt(ast, i, child);
+    case AST_VAR_DECL: {
+        struct ast_var_decl *decl = ast->ast;
+        c[n++] = decl->body;
+        break;
+    }
+    case AST_ARRAY_DECL: {
+        struct ast_array_decl *decl = ast->ast;
+        c[n++] = decl->arity;
+        c[n++] = decl->body;
+        break;
+    }
+    case AST_STRUCT_DECL: {
+        struct ast_struct_decl *decl = ast->ast;
+        c[n++] = decl->decls;
+        break;
+    }
+    case AST_BINARY: {
+        struct ast_binary *stmt = ast->ast;
+        c[n++] = stmt->lhs;
+        c[n++] = stmt->rhs;
+        break;
+    }
+    case AST_PREFIX_UNARY:
+    case AST_POSTFIX_UNARY: { /* Fall through. */
+        struct ast_unary *stmt = ast->ast;
+        c[n++] = stmt->operand;
+        break;
+    }
+    case AST_ARRAY_ACCESS: {
+        struct ast_array_access *stmt = ast->ast;
+        c[n++] = stmt->indices;
+        break;
+    }
+    case AST_MEMBER: {
+        struct ast_member *stmt = ast->ast;
+        c[n++] = stmt->structure;
+        c[n++] = stmt->member;
+        break;
+    }
+    case AST_IF_STMT: {
+        struct ast_if *stmt = ast->ast;
+        c[n++] = stmt->condition;
+        c[n++] = stmt->body;
+        c[n++] = stmt->else_body;
+        break;
+    }
+    case AST_FOR_STMT: {
+        struct ast_for *stmt = ast->ast;
+        c[n++] = stmt->init;
+        c[n++] = stmt->condition;
+        c[n++] = stmt->increment;
+        c[n++] = stmt->body;
+        break;
+    }
+    case AST_FOR_RANGE_STMT: {
+        struct ast_for_range *stmt = ast->ast;
+        c[n++] = stmt->iter;
+        c[n++] = stmt->range_target;
+        c[n++] = stmt->body;
+        break;
+    }
+    case AST_WHILE_STMT: {
+        struct ast_while *stmt = ast->ast;
+        c[n++] = stmt->cond;
+        c[n++] = stmt->body;
+        break;
+    }
+    case AST_DO_WHILE_STMT: {
+        struct ast_do_while *stmt = ast->ast;
+        c[n++] = stmt->body;
+        c[n++] = stmt->condition;
+        break;
+    }
+    case AST_RETURN_STMT: {
+        struct ast_ret *stmt = ast->ast;
+        c[n++] = stmt->op;
+        break;
+    }
+    case AST_FUNCTION_DECL: {
+        struct ast_fn_decl *decl = ast->ast;
+        c[n++] = decl->args;
+        c[n++] = decl->body;
+        break;
+    }
+    case AST_FUNCTION_CALL: {
+        struct ast_fn_call *stmt = ast->ast;
+        c[n++] = stmt->args;
+        break;
+    }
+    case AST_IMPLICIT_CAST: {
+        struct ast_implicit_cast *cast = ast->ast;
+        c[n++] = cast->body;
+        break;
+    }
+    default: {
+        enum ast_type t = ast->type;
+        weak_unreachable("Unknown AST type (%d, %s).", t, ast_type_to_string(t));
+    }
+    }
+
+    if (i >= n)
+        return 0;
+
+    *child = c[i];
+    return 1;
+}
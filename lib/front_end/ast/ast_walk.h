@@ -0,0 +1,73 @@
+/* ast_walk.h - AST traversal without recursion.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_AST_AST_WALK_H
+#define WEAK_COMPILER_FRONTEND_AST_AST_WALK_H
+
+#include "util/compiler.h"
+#include "util/vector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ast_node;
+
+/** Node being visited and state of its visitor. */
+struct ast_walk_frame {
+    struct ast_node *ast;
+    /** Set to 0 on push, further used by visitor to
+        know where to continue, usually as index of
+        the next child. */
+    uint32_t         step;
+    /** Values, which visitor keeps between children.
+        Zeroed on push. */
+    uint64_t         data[4];
+};
+
+/** Explicit stack of nodes being visited.
+
+    Depth of AST is limited only by input (long chain of
+    binary operators is as deep as long it is), so visitors
+    of whole tree are written as state machine instead
+    of recursion: visitor takes top frame, does work of its
+    current step, and either pushes child or pops frame.
+    When child is done, parent is on top again.
+
+    \note Frame pointers are invalidated by ast_walk_push(),
+          so push must be the last action on frame. */
+struct ast_walk {
+    vector_t(struct ast_walk_frame) stack;
+};
+
+/** Start walk from `root`. Memory of previous walk is
+    reused, so walk can be kept between calls (useful if
+    visitor exits with longjmp on error). */
+void ast_walk_init(struct ast_walk *w, struct ast_node *root);
+void ast_walk_free(struct ast_walk *w);
+
+/** \return Frame to be processed or NULL, when walk is finished. */
+wur struct ast_walk_frame *ast_walk_top(struct ast_walk *w);
+
+/** Visit `ast` before continuing with current top.
+    No-op if `ast` is NULL, so optional children are
+    pushed the same way, and the next step is done. */
+void ast_walk_push(struct ast_walk *w, struct ast_node *ast);
+void ast_walk_pop(struct ast_walk *w);
+
+/** Push next child of top frame in order of ast_child()
+    and count it in step.
+
+    \return 0 if all children are already visited. */
+bool ast_walk_child(struct ast_walk *w);
+
+/** Get `i`-th child of node. Children are ordered as they
+    appear in source code.
+
+    \param  child Set to child or to NULL, if optional child
+                  (e.g. `else` part) is not present.
+    \return 0 if node has not so many children. */
+bool ast_child(struct ast_node *ast, uint64_t i, struct ast_node **child);
+
+#endif // WEAK_COMPILER_FRONTEND_AST_AST_WALK_H
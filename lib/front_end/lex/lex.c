@@ -8,11 +8,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static tok_array_t tokens = {0};
+static _Thread_local tok_array_t tokens = {0};
+
+void lex_consume_source(const struct source *s)
+{
+    tokens.src = s;
+}
 
 void lex_consume_token(struct token *tok)
 {
-    vector_push_back(tokens, *tok);
+    tok_array_push(&tokens, tok);
 }
 
 tok_array_t *lex_consumed_tokens()
@@ -22,10 +27,10 @@ tok_array_t *lex_consumed_tokens()
 
 void lex_init_state()
 {
-    vector_init(tokens);
+    tok_array_init(&tokens, NULL);
 }
 
 void lex_reset_state()
 {
-    vector_free(tokens);
+    tok_array_free(&tokens);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-/* lex.h - flex-based lexical analyzer.
+/* lex.h - Lexical analyzer.
  * Copyright (C) 2022 epoll-reactor <glibcxx.chrono@gmail.com>
  *
  * This file is distributed under the MIT license.
@@ -8,19 +8,73 @@
 #define WEAK_COMPILER_FRONTEND_LEX_LEX_H
 
 #include "front_end/lex/tok.h"
+#include "front_end/lex/tok_array.h"
 #include "util/compiler.h"
-#include "util/vector.h"
+
+struct source;
+
+/** Scan mapped source in place. Tokens are appended to
+    lex_consumed_tokens().
+
+    \note Implemented in file, generated by flex, or by
+          lex_native_source() if built with
+          CONFIG_USE_NATIVE_LEXER.
+
+    \note flex scanner is not reentrant, so flex-based
+          version must not be called by several threads at
+          once, and traps if it is. Hand-written lexer keeps
+          state in struct lex_native and has no such limit. */
+void lex_source(struct source *s);
+
+/** Hand-written lexer. Produces the same tokens as flex
+    grammar, but does not depend on flex. */
+void lex_native_source(struct source *s);
+
+/** Split source into chunks at line starts and scan them
+    by native lexer in `threads` threads. Tokens are the same
+    as from lex_native_source().
+
+    \note Chunk split inside of multi-line string is detected
+          when joining chunks and its part is scanned again
+          sequentially. */
+void lex_parallel_source(struct source *s, uint32_t threads);
+
+/** State of hand-written lexer, which can be also used to
+    pull tokens one by one. */
+struct lex_native {
+    const char   *base;
+    const char   *p;
+    const char   *end;
+    uint32_t      line_no;
+    uint32_t      col_no;
+    struct token *out;
+    bool          emitted;
+    /** Intern text of tokens. Not needed if tokens are
+        stored in tok_array_t, which recovers it itself. */
+    bool          intern;
+    /** Stop scanning on illegal input and set `failed`
+        instead of abort. */
+    bool          recover;
+    bool          failed;
+};
+
+void lex_native_init(struct lex_native *l, struct source *s);
+
+/** Scan next token.
+
+    \return 0 at the end of input. */
+wur bool lex_native_next(struct lex_native *l, struct token *out);
+
+/** Called by lex_source() before scanning. Consumed tokens
+    refer to this source. */
+void lex_consume_source(const struct source *s);
 
 /** This function is called inside file, generated by flex on
     each processed token. May be used for example to collect
-    all tokens into some array. */
-void lex_consume_token(struct token *tok);
+    all tokens into some array.
 
-/** Array type. Needed to represent sequence of tokens,
-    needed to be parsed.
-   
-    \note Parser requires random access memory layout of the buffer. */
-typedef vector_t(struct token) tok_array_t;
+    \note Only type, offset and len of token are used. */
+void lex_consume_token(struct token *tok);
 
 /** Get the array of all processed before tokens.
    
@@ -0,0 +1,551 @@
+/* lex_native.c - Hand-written lexical analyzer.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/lex.h"
+#include "util/intern.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdnoreturn.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
+
+/* Produces exactly the same tokens as lex/grammar.lex,
+   including its corner cases:
+   - `-` directly followed by digit is part of number,
+   - `//` comment requires trailing newline,
+   - block comment spans to the last `*` `/` on the same line,
+   - `*=` is not an operator. */
+
+/**********************************************
+ **           Character classes              **
+ **********************************************/
+enum {
+    C_ILLEGAL = 0,
+    C_SPACE,
+    C_IDENT,
+    C_DIGIT,
+    C_QUOTE,
+    C_APOS,
+    C_OP
+};
+
+static const uint8_t lex_class[256] = {
+    ['\t' ... '\r'] = C_SPACE,
+    [' ']           = C_SPACE,
+    ['a' ... 'z']   = C_IDENT,
+    ['A' ... 'Z']   = C_IDENT,
+    ['_']           = C_IDENT,
+    ['0' ... '9']   = C_DIGIT,
+    ['"']           = C_QUOTE,
+    ['\'']          = C_APOS,
+    ['=']           = C_OP,
+    ['/']           = C_OP,
+    ['%']           = C_OP,
+    ['+']           = C_OP,
+    ['-']           = C_OP,
+    ['>']           = C_OP,
+    ['<']           = C_OP,
+    ['&']           = C_OP,
+    ['|']           = C_OP,
+    ['^']           = C_OP,
+    ['!']           = C_OP,
+    ['*']           = C_OP,
+    ['.']           = C_OP,
+    [',']           = C_OP,
+    [':']           = C_OP,
+    [';']           = C_OP,
+    ['[']           = C_OP,
+    [']']           = C_OP,
+    ['(']           = C_OP,
+    [')']           = C_OP,
+    ['{']           = C_OP,
+    ['}']           = C_OP
+};
+
+static inline bool is_ident(char c)
+{
+    uint8_t cls = lex_class[(uint8_t) c];
+    return cls == C_IDENT || cls == C_DIGIT;
+}
+
+static inline bool is_digit(char c)
+{
+    return lex_class[(uint8_t) c] == C_DIGIT;
+}
+
+/**********************************************
+ **           Run classification             **
+ **********************************************/
+/* Each function returns end of run of some character class
+   starting at p. Vector loop never reads past the end. */
+#ifdef __SSE2__
+#define LEX_VEC_SIZE 16
+
+/* Bitmask of bytes in [lo, hi]. Non-ASCII bytes are negative
+   and never match. */
+static inline uint32_t vec_range(__m128i v, char lo, char hi)
+{
+    __m128i ge = _mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1));
+    __m128i le = _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1));
+    return _mm_movemask_epi8(_mm_and_si128(ge, le));
+}
+
+static inline uint32_t vec_eq(__m128i v, char c)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static inline __m128i vec_load(const char *p)
+{
+    return _mm_loadu_si128((const __m128i *) p);
+}
+
+static const char *ident_run(const char *p, const char *end)
+{
+    for (; p + LEX_VEC_SIZE <= end; p += LEX_VEC_SIZE) {
+        __m128i  v = vec_load(p);
+        uint32_t m = vec_range(v, 'a', 'z') |
+                     vec_range(v, 'A', 'Z') |
+                     vec_range(v, '0', '9') |
+                     vec_eq(v, '_');
+        if (m != 0xFFFF)
+            return p + __builtin_ctz(~m);
+    }
+
+    while (p < end && is_ident(*p))
+        ++p;
+
+    return p;
+}
+
+static const char *digit_run(const char *p, const char *end)
+{
+    for (; p + LEX_VEC_SIZE <= end; p += LEX_VEC_SIZE) {
+        uint32_t m = vec_range(vec_load(p), '0', '9');
+        if (m != 0xFFFF)
+            return p + __builtin_ctz(~m);
+    }
+
+    while (p < end && is_digit(*p))
+        ++p;
+
+    return p;
+}
+#else
+static const char *ident_run(const char *p, const char *end)
+{
+    while (p < end && is_ident(*p))
+        ++p;
+
+    return p;
+}
+
+static const char *digit_run(const char *p, const char *end)
+{
+    while (p < end && is_digit(*p))
+        ++p;
+
+    return p;
+}
+#endif /* __SSE2__ */
+
+/**********************************************
+ **              Keywords                    **
+ **********************************************/
+#define KW_MIN_LEN    2
+#define KW_MAX_LEN    8
+#define KW_TABLE_SIZE 32
+
+struct keyword {
+    const char      *str;
+    uint32_t         len;
+    enum token_type  type;
+};
+
+/* Shared by all threads, built once. */
+static struct keyword keywords[KW_TABLE_SIZE];
+static pthread_once_t keywords_once = PTHREAD_ONCE_INIT;
+
+/* Perfect for keywords of tok_type.c. Checked when table
+   is built. */
+static inline uint32_t kw_hash(const char *s, uint32_t len)
+{
+    return ((uint8_t) s[0] * 3 + (uint8_t) s[len - 1] * 24 + len) & (KW_TABLE_SIZE - 1);
+}
+
+static void keywords_init()
+{
+    for (enum token_type t = TOK_BOOL; t <= TOK_WHILE; ++t) {
+        const char *str = tok_to_string(t);
+        uint32_t    len = strlen(str);
+        uint32_t    h   = kw_hash(str, len);
+
+        if (keywords[h].str)
+            weak_unreachable("Keyword hash collision: `%s` and `%s`.", str, keywords[h].str);
+
+        keywords[h].str = str;
+        keywords[h].len = len;
+        keywords[h].type = t;
+    }
+}
+
+static inline enum token_type kw_lookup(const char *s, uint32_t len)
+{
+    if (len < KW_MIN_LEN || len > KW_MAX_LEN)
+        return TOK_SYMBOL;
+
+    struct keyword *kw = &keywords[kw_hash(s, len)];
+
+    if (kw->len == len && memcmp(kw->str, s, len) == 0)
+        return kw->type;
+
+    return TOK_SYMBOL;
+}
+
+/**********************************************
+ **              Scanner                     **
+ **********************************************/
+enum tok_data {
+    DATA_NONE,
+    DATA_WORD,
+    DATA_QUOTED
+};
+
+static void emit(struct lex_native *s, enum token_type type, uint32_t len, enum tok_data data)
+{
+    struct token t = {
+        .data    = NULL,
+        .type    = type,
+        .line_no = s->line_no,
+        .col_no  = s->col_no,
+        .offset  = s->p - s->base,
+        .len     = len
+    };
+
+    if (s->intern && data == DATA_WORD)
+        t.data = intern_n(s->p, len);
+    else if (s->intern && data == DATA_QUOTED)
+        t.data = intern_n(s->p + 1, len - 2);
+
+    *s->out = t;
+    s->emitted = 1;
+}
+
+/* Move past lexeme without newlines. */
+static inline void skip(struct lex_native *s, uint32_t len)
+{
+    s->p += len;
+    s->col_no += len;
+}
+
+/* Move past lexeme, that may contain newlines. */
+static void skip_lines(struct lex_native *s, uint32_t len)
+{
+    const char *end = s->p + len;
+    const char *nl  = NULL;
+
+    while ((nl = memchr(s->p, '\n', end - s->p)) != NULL) {
+        ++s->line_no;
+        s->col_no = 1;
+        s->p = nl + 1;
+    }
+
+    skip(s, end - s->p);
+}
+
+static void skip_space(struct lex_native *s)
+{
+#ifdef __SSE2__
+    while (s->p + LEX_VEC_SIZE <= s->end) {
+        __m128i  v   = vec_load(s->p);
+        uint32_t m   = vec_range(v, '\t', '\r') | vec_eq(v, ' ');
+        uint32_t run = m == 0xFFFF ? LEX_VEC_SIZE : __builtin_ctz(~m);
+        uint32_t nl  = vec_eq(v, '\n') & ((1U << run) - 1);
+
+        if (nl) {
+            uint32_t last = 31 - __builtin_clz(nl);
+            s->line_no += __builtin_popcount(nl);
+            s->col_no = run - last;
+        } else {
+            s->col_no += run;
+        }
+        s->p += run;
+
+        if (run < LEX_VEC_SIZE)
+            return;
+    }
+#endif /* __SSE2__ */
+
+    while (s->p < s->end && lex_class[(uint8_t) *s->p] == C_SPACE) {
+        if (*s->p == '\n') {
+            ++s->line_no;
+            s->col_no = 1;
+        } else {
+            ++s->col_no;
+        }
+        ++s->p;
+    }
+}
+
+static inline char peek(struct lex_native *s, uint32_t off)
+{
+    return s->p + off < s->end ? s->p[off] : '\0';
+}
+
+/* Stops scanning if errors are recoverable, aborts otherwise.
+   Caller should return after call. */
+static void illegal(struct lex_native *s)
+{
+    if (s->recover) {
+        s->failed = 1;
+        s->p = s->end;
+        return;
+    }
+
+    fprintf(stderr, "Illegal token `%c`\n", *s->p);
+    fflush (stderr);
+    __builtin_trap();
+}
+
+/* -?[0-9]+ or -?[0-9]+\.[0-9]+ */
+static void lex_number(struct lex_native *s, uint32_t sign_len)
+{
+    const char *q    = digit_run(s->p + sign_len, s->end);
+    enum token_type t = TOK_INT_LITERAL;
+
+    if (q + 1 < s->end && *q == '.' && is_digit(q[1])) {
+        q = digit_run(q + 1, s->end);
+        t = TOK_FLOAT_LITERAL;
+    }
+
+    uint32_t len = q - s->p;
+    emit(s, t, len, DATA_WORD);
+    skip(s, len);
+}
+
+static void lex_ident(struct lex_native *s)
+{
+    uint32_t len = ident_run(s->p, s->end) - s->p;
+
+    emit(s, kw_lookup(s->p, len), len, DATA_WORD);
+    skip(s, len);
+}
+
+/* \"(([^\"\\]|\\.)*)\" */
+static void lex_string(struct lex_native *s)
+{
+    const char *q = s->p + 1;
+
+    while (q < s->end && *q != '"') {
+        if (*q == '\\') {
+            if (q + 1 >= s->end || q[1] == '\n') {
+                illegal(s);
+                return;
+            }
+            q += 2;
+        } else {
+            ++q;
+        }
+    }
+
+    if (q >= s->end) {
+        illegal(s);
+        return;
+    }
+
+    uint32_t len = q + 1 - s->p;
+    emit(s, TOK_STRING_LITERAL, len, DATA_QUOTED);
+    skip_lines(s, len);
+}
+
+/* \'.\' */
+static void lex_char(struct lex_native *s)
+{
+    if (s->p + 2 >= s->end || s->p[1] == '\n' || s->p[2] != '\'') {
+        illegal(s);
+        return;
+    }
+
+    emit(s, TOK_CHAR_LITERAL, 3, DATA_QUOTED);
+    skip(s, 3);
+}
+
+/* \/\/.*\n and \/\*.*\*\/
+   \return 1 if comment was skipped. */
+static bool lex_comment(struct lex_native *s)
+{
+    const char *line_end = memchr(s->p, '\n', s->end - s->p);
+
+    if (peek(s, 1) == '/') {
+        if (!line_end)
+            return 0;
+
+        ++s->line_no;
+        s->col_no = 1;
+        s->p = line_end + 1;
+        return 1;
+    }
+
+    if (peek(s, 1) == '*') {
+        const char *last = NULL;
+
+        if (!line_end)
+            line_end = s->end;
+
+        /* Greedy match: up to the last terminator on line. */
+        for (const char *q = s->p + 2; q + 1 < line_end; ++q)
+            if (q[0] == '*' && q[1] == '/')
+                last = q;
+
+        if (!last)
+            return 0;
+
+        skip(s, last + 2 - s->p);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void lex_op(struct lex_native *s)
+{
+    char            c0  = peek(s, 0);
+    char            c1  = peek(s, 1);
+    char            c2  = peek(s, 2);
+    uint32_t        len = 1;
+    enum token_type t   = TOK_SYMBOL;
+
+#define OP1(tok)              { t = tok; len = 1; }
+#define OP2(ch, tok)          if (c1 == ch) { t = tok; len = 2; break; }
+#define OP3(ch1, ch2, tok)    if (c1 == ch1 && c2 == ch2) { t = tok; len = 3; break; }
+
+    switch (c0) {
+    case '=': OP2('=', TOK_EQ)               OP1(TOK_ASSIGN)     break;
+    case '/': OP2('=', TOK_DIV_ASSIGN)       OP1(TOK_SLASH)      break;
+    case '%': OP2('=', TOK_MOD_ASSIGN)       OP1(TOK_MOD)        break;
+    case '+': OP2('=', TOK_PLUS_ASSIGN)
+              OP2('+', TOK_INC)              OP1(TOK_PLUS)       break;
+    case '-': OP2('=', TOK_MINUS_ASSIGN)
+              OP2('-', TOK_DEC)              OP1(TOK_MINUS)      break;
+    case '>': OP3('>', '=', TOK_SHR_ASSIGN)
+              OP2('>', TOK_SHR)
+              OP2('=', TOK_GE)               OP1(TOK_GT)         break;
+    case '<': OP3('<', '=', TOK_SHL_ASSIGN)
+              OP2('<', TOK_SHL)
+              OP2('=', TOK_LE)               OP1(TOK_LT)         break;
+    case '&': OP2('=', TOK_BIT_AND_ASSIGN)
+              OP2('&', TOK_AND)              OP1(TOK_BIT_AND)    break;
+    case '|': OP2('=', TOK_BIT_OR_ASSIGN)
+              OP2('|', TOK_OR)               OP1(TOK_BIT_OR)     break;
+    case '^': OP2('=', TOK_XOR_ASSIGN)       OP1(TOK_XOR)        break;
+    case '!': OP2('=', TOK_NEQ)              OP1(TOK_NOT)        break;
+    case '*':                                OP1(TOK_STAR)       break;
+    case '.':                                OP1(TOK_DOT)        break;
+    case ',':                                OP1(TOK_COMMA)      break;
+    case ':':                                OP1(TOK_COLON)      break;
+    case ';':                                OP1(TOK_SEMICOLON)  break;
+    case '[':                                OP1(TOK_OPEN_BOX_BRACKET)     break;
+    case ']':                                OP1(TOK_CLOSE_BOX_BRACKET)    break;
+    case '(':                                OP1(TOK_OPEN_PAREN)           break;
+    case ')':                                OP1(TOK_CLOSE_PAREN)          break;
+    case '{':                                OP1(TOK_OPEN_CURLY_BRACKET)   break;
+    case '}':                                OP1(TOK_CLOSE_CURLY_BRACKET)  break;
+    default:
+        illegal(s);
+        return;
+    }
+
+#undef OP3
+#undef OP2
+#undef OP1
+
+    emit(s, t, len, DATA_NONE);
+    skip(s, len);
+}
+
+void lex_native_init(struct lex_native *s, struct source *src)
+{
+    s->base = src->data;
+    s->p = src->data;
+    s->end = src->data + src->size;
+    s->line_no = 1;
+    s->col_no = 1;
+    s->out = NULL;
+    s->emitted = 0;
+    s->intern = 1;
+    s->recover = 0;
+    s->failed = 0;
+
+    pthread_once(&keywords_once, keywords_init);
+}
+
+bool lex_native_next(struct lex_native *s, struct token *out)
+{
+    s->out = out;
+    s->emitted = 0;
+
+    while (s->p < s->end) {
+        switch (lex_class[(uint8_t) *s->p]) {
+        case C_SPACE:
+            skip_space(s);
+            break;
+        case C_IDENT:
+            lex_ident(s);
+            break;
+        case C_DIGIT:
+            lex_number(s, 0);
+            break;
+        case C_QUOTE:
+            lex_string(s);
+            break;
+        case C_APOS:
+            lex_char(s);
+            break;
+        case C_OP:
+            if (*s->p == '-' && is_digit(peek(s, 1))) {
+                lex_number(s, 1);
+                break;
+            }
+            if (*s->p == '/' && lex_comment(s))
+                break;
+            lex_op(s);
+            break;
+        default:
+            illegal(s);
+        }
+
+        if (s->emitted)
+            return 1;
+    }
+
+    return 0;
+}
+
+void lex_native_source(struct source *src)
+{
+    struct lex_native s;
+    struct token      t;
+
+    lex_native_init(&s, src);
+    lex_consume_source(src);
+    /* Consumed tokens keep only slice of source. */
+    s.intern = 0;
+
+    while (lex_native_next(&s, &t))
+        lex_consume_token(&t);
+}
+
+#ifdef CONFIG_USE_NATIVE_LEXER
+void lex_source(struct source *s)
+{
+    lex_native_source(s);
+}
+#endif /* CONFIG_USE_NATIVE_LEXER */
@@ -0,0 +1,205 @@
+/* lex_parallel.c - Multithreaded lexing of large inputs.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/lex.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include <pthread.h>
+#include <string.h>
+
+/** Smaller chunks are not worth thread start. */
+#define LEX_PARALLEL_MIN_CHUNK (64 * 1024)
+#define LEX_PARALLEL_MAX_THREADS 64
+/** How many lines to look forward for line without quotes. */
+#define LEX_PARALLEL_SPLIT_LOOKUP 64
+
+/* Only multi-line string can cross line boundary: char
+   literals and both kinds of comments end on the same line.
+
+   Chunk scanning can start inside such string. Lexer state
+   between tokens is only position, so tokens of chunk are
+   correct from the first one, which starts exactly where
+   previous chunk stopped. If there is no such token, chunk
+   is scanned again from that position. */
+struct lex_chunk {
+    struct source *src;
+    /** Chunk contains tokens, started at [begin, end). */
+    uint32_t       begin;
+    uint32_t       end;
+    tok_array_t    toks;
+    /** Start of first token after chunk or size of input. */
+    uint32_t       resume;
+    /** First token, which is not covered by previous chunk. */
+    uint64_t       first;
+    bool           failed;
+    pthread_t      thread;
+};
+
+static void lex_chunk_scan(struct lex_chunk *c, uint32_t from, bool recover)
+{
+    struct lex_native l;
+    struct token      t;
+
+    lex_native_init(&l, c->src);
+    /* Location is not tracked, since it is not stored in
+       tok_array_t anyway. */
+    l.p       = l.base + from;
+    l.intern  = 0;
+    l.recover = recover;
+
+    c->resume = c->src->size;
+
+    while (lex_native_next(&l, &t)) {
+        if (t.offset >= c->end) {
+            c->resume = t.offset;
+            break;
+        }
+        tok_array_push(&c->toks, &t);
+    }
+
+    c->failed = l.failed;
+}
+
+static void *lex_chunk_worker(void *arg)
+{
+    struct lex_chunk *c = arg;
+
+    lex_chunk_scan(c, c->begin, /*recover=*/1);
+    return NULL;
+}
+
+/* Find line start not before `offset`. Prefer line after one
+   without quotes, since it cannot end inside a string. */
+static uint32_t lex_split_point(const struct source *s, uint32_t offset)
+{
+    const char *end   = s->data + s->size;
+    const char *p     = s->data + offset;
+    const char *first = NULL;
+
+    for (uint32_t i = 0; i < LEX_PARALLEL_SPLIT_LOOKUP && p < end; ++i) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (!nl)
+            break;
+
+        if (!first)
+            first = nl + 1;
+
+        if (!memchr(p, '"', nl - p))
+            return (uint32_t) (nl + 1 - s->data);
+
+        p = nl + 1;
+    }
+
+    return first ? (uint32_t) (first - s->data) : s->size;
+}
+
+static uint64_t lex_find_offset(const tok_array_t *toks, uint32_t offset)
+{
+    uint64_t lo = 0;
+    uint64_t hi = tok_array_count(toks);
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if (toks->offsets.data[mid] < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void lex_parallel_source(struct source *s, uint32_t threads)
+{
+    struct lex_chunk chunks[LEX_PARALLEL_MAX_THREADS];
+    uint32_t         cnt = 0;
+
+    if (threads > LEX_PARALLEL_MAX_THREADS)
+        threads = LEX_PARALLEL_MAX_THREADS;
+
+    if (threads > s->size / LEX_PARALLEL_MIN_CHUNK)
+        threads = s->size / LEX_PARALLEL_MIN_CHUNK;
+
+    if (threads <= 1) {
+        lex_native_source(s);
+        return;
+    }
+
+    /* Chunks can be fewer than threads if lines are long. */
+    for (uint32_t begin = 0; begin < s->size && cnt < threads; ++cnt) {
+        uint32_t end = cnt == threads - 1
+            ? s->size
+            : lex_split_point(s, (uint64_t) s->size * (cnt + 1) / threads);
+
+        memset(&chunks[cnt], 0, sizeof (*chunks));
+        chunks[cnt].src   = s;
+        chunks[cnt].begin = begin;
+        chunks[cnt].end   = end;
+        tok_array_init(&chunks[cnt].toks, s);
+
+        begin = end;
+    }
+
+    for (uint32_t i = 1; i < cnt; ++i) {
+        errno = pthread_create(&chunks[i].thread, NULL, lex_chunk_worker, &chunks[i]);
+        if (errno != 0)
+            weak_fatal_errno("pthread_create()");
+    }
+
+    lex_chunk_worker(&chunks[0]);
+
+    for (uint32_t i = 1; i < cnt; ++i) {
+        errno = pthread_join(chunks[i].thread, NULL);
+        if (errno != 0)
+            weak_fatal_errno("pthread_join()");
+    }
+
+    lex_consume_source(s);
+
+    tok_array_t *out   = lex_consumed_tokens();
+    uint64_t     total = tok_array_count(out);
+    uint32_t     pos   = 0;
+
+    /* Find first valid token of each chunk. Resulting array
+       is then allocated once. */
+    for (uint32_t i = 0; i < cnt; ++i) {
+        struct lex_chunk *c = &chunks[i];
+
+        /* Previous token covers whole chunk. */
+        if (pos >= c->end) {
+            c->first = tok_array_count(&c->toks);
+            continue;
+        }
+
+        c->first = lex_find_offset(&c->toks, pos);
+
+        /* Here c->begin <= pos < c->end, so chunk is in sync
+           only if it has token exactly at pos. */
+        bool synced = pos == c->begin ||
+                      (c->first < tok_array_count(&c->toks) &&
+                       c->toks.offsets.data[c->first] == pos);
+
+        if (!synced || c->failed) {
+            /* Scan again as serial lexer does. Illegal input
+               aborts here, as in serial lexer. */
+            tok_array_free(&c->toks);
+            tok_array_init(&c->toks, s);
+            lex_chunk_scan(c, pos, /*recover=*/0);
+            c->first = 0;
+        }
+
+        total += tok_array_count(&c->toks) - c->first;
+        pos = c->resume;
+    }
+
+    tok_array_reserve(out, total);
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        tok_array_append(out, &chunks[i].toks, chunks[i].first);
+        tok_array_free(&chunks[i].toks);
+    }
+}
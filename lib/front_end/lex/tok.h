@@ -13,10 +13,17 @@
 #include <stdint.h>
 
 struct token {
-    char            *data;
+    /** Interned text of keyword, identifier or literal.
+
+        \note NULL for operators. Never freed. */
+    const char      *data;
     enum token_type  type;
-    uint16_t         line_no;
-    uint16_t         col_no;
+    uint32_t         line_no;
+    uint32_t         col_no;
+    /** Lexeme slice in source buffer, including quotes
+        of literals. */
+    uint32_t         offset;
+    uint32_t         len;
 };
 
 wur bool tok_is(const struct token *tok, char symbol);
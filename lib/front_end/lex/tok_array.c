@@ -0,0 +1,101 @@
+/* tok_array.c - Compact storage of all tokens of input.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/tok_array.h"
+#include "util/intern.h"
+#include "util/source.h"
+#include <string.h>
+
+void tok_array_init(tok_array_t *a, const struct source *src)
+{
+    a->src = src;
+    vector_init(a->types);
+    vector_init(a->offsets);
+    vector_init(a->lens);
+}
+
+void tok_array_free(tok_array_t *a)
+{
+    vector_free(a->types);
+    vector_free(a->offsets);
+    vector_free(a->lens);
+}
+
+void tok_array_push(tok_array_t *a, const struct token *t)
+{
+    vector_push_back(a->types, (uint8_t) t->type);
+    vector_push_back(a->offsets, t->offset);
+    vector_push_back(a->lens, t->len);
+}
+
+#define tok_column_reserve(col, cnt) do {                                 \
+    if ((cnt) > (col).size) {                                             \
+        (col).size = (cnt);                                               \
+        (col).data = weak_realloc((col).data, (col).size * sizeof (*(col).data)); \
+    }                                                                     \
+} while (0)
+
+#define tok_column_append(to, from, first) do {                           \
+    uint64_t __n = (from).count - (first);                                \
+    tok_column_reserve(to, (to).count + __n);                             \
+    memcpy((to).data + (to).count, (from).data + (first), __n * sizeof (*(to).data)); \
+    (to).count += __n;                                                    \
+} while (0)
+
+void tok_array_reserve(tok_array_t *a, uint64_t count)
+{
+    tok_column_reserve(a->types, count);
+    tok_column_reserve(a->offsets, count);
+    tok_column_reserve(a->lens, count);
+}
+
+void tok_array_append(tok_array_t *a, const tok_array_t *from, uint64_t first)
+{
+    if (first >= tok_array_count(from))
+        return;
+
+    tok_column_append(a->types, from->types, first);
+    tok_column_append(a->offsets, from->offsets, first);
+    tok_column_append(a->lens, from->lens, first);
+}
+
+#undef tok_column_append
+#undef tok_column_reserve
+
+uint64_t tok_array_count(const tok_array_t *a)
+{
+    return a->types.count;
+}
+
+void tok_array_get(const tok_array_t *a, uint64_t i, struct token *out)
+{
+    const char *lexeme = a->src->data + a->offsets.data[i];
+
+    out->type   = a->types.data[i];
+    out->offset = a->offsets.data[i];
+    out->len    = a->lens.data[i];
+
+    switch (out->type) {
+    case TOK_BOOL ... TOK_WHILE:
+    case TOK_INT_LITERAL:
+    case TOK_FLOAT_LITERAL:
+    case TOK_SYMBOL:
+        out->data = intern_n(lexeme, out->len);
+        break;
+    /* Don't include quotes. */
+    case TOK_CHAR_LITERAL:
+    case TOK_STRING_LITERAL:
+        out->data = intern_n(lexeme + 1, out->len - 2);
+        break;
+    /* Operator has no data, since all information about it
+       contained in type. */
+    default:
+        out->data = NULL;
+        break;
+    }
+
+    source_locate(a->src, out->offset, &out->line_no, &out->col_no);
+}
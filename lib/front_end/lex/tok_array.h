@@ -0,0 +1,53 @@
+/* tok_array.h - Compact storage of all tokens of input.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_LEX_TOK_ARRAY_H
+#define WEAK_COMPILER_FRONTEND_LEX_TOK_ARRAY_H
+
+#include "front_end/lex/tok.h"
+#include "util/compiler.h"
+#include "util/vector.h"
+
+struct source;
+
+/** Tokens of whole input in structure-of-arrays layout.
+
+    Only type and lexeme slice of each token are stored,
+    9 bytes per token. Text and location are recovered from
+    source by tok_array_get(), so source must stay open
+    while tokens are used.
+
+    \note Line and column are computed by binary search in
+          line index of source, so access in any order is
+          valid. */
+typedef struct tok_array {
+    const struct source *src;
+    vector_t(uint8_t)    types;
+    vector_t(uint32_t)   offsets;
+    vector_t(uint32_t)   lens;
+} tok_array_t;
+
+void tok_array_init(tok_array_t *a, const struct source *src);
+void tok_array_free(tok_array_t *a);
+
+/** Append token. Only type, offset and len are used. */
+void tok_array_push(tok_array_t *a, const struct token *t);
+
+/** Make room for `count` tokens in total. */
+void tok_array_reserve(tok_array_t *a, uint64_t count);
+
+/** Append tokens of `from` starting from index `first`. */
+void tok_array_append(tok_array_t *a, const tok_array_t *from, uint64_t first);
+
+wur uint64_t tok_array_count(const tok_array_t *a);
+
+/** Build full token by index.
+
+    \note Text of words and literals is interned on each
+          call. */
+void tok_array_get(const tok_array_t *a, uint64_t i, struct token *out);
+
+#endif // WEAK_COMPILER_FRONTEND_LEX_TOK_ARRAY_H
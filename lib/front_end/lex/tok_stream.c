@@ -0,0 +1,78 @@
+/* tok_stream.c - Bounded stream of tokens.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/tok_stream.h"
+#include "util/unreachable.h"
+
+#define TOK_STREAM_MASK (TOK_STREAM_SIZE - 1)
+
+void tok_stream_init(struct tok_stream *s, struct source *src)
+{
+    lex_native_init(&s->lex, src);
+    s->array = NULL;
+    s->begin = 0;
+    s->end = 0;
+    s->filled = 0;
+    s->eof = 0;
+}
+
+void tok_stream_init_array(struct tok_stream *s, const tok_array_t *array)
+{
+    tok_stream_init_range(s, array, 0, tok_array_count(array));
+}
+
+void tok_stream_init_range(
+    struct tok_stream *s,
+    const tok_array_t *array,
+    uint64_t           begin,
+    uint64_t           end
+) {
+    s->array = array;
+    s->begin = begin;
+    s->end = end;
+    s->filled = begin;
+    s->eof = 0;
+}
+
+static bool tok_stream_fill(struct tok_stream *s, struct token *out)
+{
+    if (!s->array)
+        return lex_native_next(&s->lex, out);
+
+    if (s->filled >= s->end)
+        return 0;
+
+    tok_array_get(s->array, s->filled, out);
+    return 1;
+}
+
+struct token *tok_stream_at(struct tok_stream *s, uint64_t pos)
+{
+    while (pos >= s->filled) {
+        if (s->eof)
+            return NULL;
+
+        if (!tok_stream_fill(s, &s->ring[s->filled & TOK_STREAM_MASK])) {
+            s->eof = 1;
+            return NULL;
+        }
+
+        ++s->filled;
+    }
+
+    if (pos + TOK_STREAM_SIZE < s->filled)
+        weak_unreachable("Token %lu is out of stream window (%lu scanned).", pos, s->filled);
+
+    return &s->ring[pos & TOK_STREAM_MASK];
+}
+
+struct token *tok_stream_last(struct tok_stream *s)
+{
+    if (s->filled == s->begin)
+        return NULL;
+
+    return &s->ring[(s->filled - 1) & TOK_STREAM_MASK];
+}
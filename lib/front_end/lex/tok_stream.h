@@ -0,0 +1,62 @@
+/* tok_stream.h - Bounded stream of tokens.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_FRONTEND_LEX_TOK_STREAM_H
+#define WEAK_COMPILER_FRONTEND_LEX_TOK_STREAM_H
+
+#include "front_end/lex/lex.h"
+#include "front_end/lex/tok.h"
+#include "util/compiler.h"
+
+/** Must be power of two. */
+#define TOK_STREAM_SIZE 1024
+
+/** Ring buffer of tokens, filled on demand by native lexer
+    or from array of already scanned tokens.
+
+    Memory does not depend on input size: only last
+    TOK_STREAM_SIZE scanned tokens are kept. This is enough
+    for lookahead and backtracking of parser, which holds
+    copies of tokens needed longer.
+
+    \note Tokens are referenced by absolute position in input. */
+struct tok_stream {
+    struct lex_native  lex;
+    /** If set, tokens are taken from it instead of lexer. */
+    const tok_array_t *array;
+    struct token       ring[TOK_STREAM_SIZE];
+    /** Array tokens [begin, end) are streamed. */
+    uint64_t           begin;
+    uint64_t           end;
+    /** Absolute position of the next token to scan. */
+    uint64_t           filled;
+    bool               eof;
+};
+
+void tok_stream_init(struct tok_stream *s, struct source *src);
+void tok_stream_init_array(struct tok_stream *s, const tok_array_t *array);
+
+/** Stream only [begin, end) part of array. Positions stay
+    absolute, so first token is at `begin`, and end of input
+    is reported at `end`. */
+void tok_stream_init_range(
+    struct tok_stream *s,
+    const tok_array_t *array,
+    uint64_t           begin,
+    uint64_t           end
+);
+
+/** Get token by absolute position, scanning input up to it.
+
+    \return Token or NULL if position is after end of input.
+    \note   Token is valid until TOK_STREAM_SIZE more tokens
+            are scanned. */
+wur struct token *tok_stream_at(struct tok_stream *s, uint64_t pos);
+
+/** \return Last scanned token or NULL if there is no tokens. */
+wur struct token *tok_stream_last(struct tok_stream *s);
+
+#endif // WEAK_COMPILER_FRONTEND_LEX_TOK_STREAM_H
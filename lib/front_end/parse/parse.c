@@ -6,19 +6,45 @@
 
 #include "front_end/ast/ast.h"
 #include "front_end/lex/data_type.h"
+#include "front_end/lex/tok_stream.h"
 #include "front_end/parse/parse.h"
 #include "util/alloc.h"
 #include "util/diagnostic.h"
+#include "util/thread.h"
 #include "util/unreachable.h"
 #include "util/vector.h"
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
 #include <string.h>
+#include <unistd.h>
 
 typedef vector_t(struct ast_node *) ast_array_t;
 
-static struct token *tok_begin;
-static struct token *tok_end;
-static uint32_t      loops_depth = 0;
+/* Smaller inputs are not worth thread start. */
+#define PARSE_PARALLEL_MIN_TOKENS  (64 * 1024)
+#define PARSE_PARALLEL_MAX_THREADS 64
+
+/* Parser state is per-thread, since global declarations
+   can be parsed in parallel (see parse_parallel()). */
+
+/* Window of tokens, taken from lexer or from array. Static,
+   so not freed on compile error. */
+static _Thread_local struct tok_stream tok_stream;
+/* Absolute position of current token. */
+static _Thread_local uint64_t          tok_pos;
+static _Thread_local uint32_t          loops_depth = 0;
+/* Operand and operator stacks of all expressions being
+   parsed. Nested expressions (in parentheses, calls, etc.)
+   use their tops, so no recursion is needed for operators.
+   Reset by parse_global_decls() after compile error. */
+static _Thread_local ast_array_t            expr_operands;
+static _Thread_local vector_t(struct token) expr_operators;
+/* Nodes of all lists being parsed (blocks, arguments, etc.).
+   Each list uses top of the stack from its base, taken with
+   list_base(), so list interrupted by compile error is not
+   leaked. Reset by parse_global_decls(). */
+static _Thread_local ast_array_t            list_nodes;
 
 static enum data_type tok_to_data_type(enum token_type t)
 {
@@ -37,14 +63,41 @@ static enum data_type tok_to_data_type(enum token_type t)
     }
 }
 
+/* \return NULL after end of input. */
+static struct token *tok_lookup(uint64_t pos)
+{
+    return tok_stream_at(&tok_stream, pos);
+}
+
+static noreturn void unexpected_end()
+{
+    struct token *last = tok_stream_last(&tok_stream);
+
+    weak_compile_error(
+        last ? last->line_no : 0,
+        last ? last->col_no  : 0,
+        "Unexpected end of input"
+    );
+}
+
+static struct token *tok_at(uint64_t pos)
+{
+    struct token *t = tok_lookup(pos);
+
+    if (!t)
+        unexpected_end();
+
+    return t;
+}
+
 static struct token *peek_current()
 {
-    return tok_begin;
+    return tok_at(tok_pos);
 }
 
 static struct token *peek_next()
 {
-    return tok_begin++;
+    return tok_at(tok_pos++);
 }
 
 struct token *require_token(enum token_type t)
@@ -59,7 +112,7 @@ struct token *require_token(enum token_type t)
             tok_to_string(t), tok_to_string(curr_tok->type)
         );
 
-    ++tok_begin;
+    ++tok_pos;
     return curr_tok;
 }
 
@@ -68,8 +121,6 @@ struct token *require_char(char c)
     return require_token(tok_char_to_tok(c));
 }
 
-static struct ast_node *parse_additive();
-static struct ast_node *parse_and();
 static struct ast_node *parse_array_access();
 static struct ast_node *parse_array_decl();
 static struct ast_node *parse_array_decl_without_initializer();
@@ -79,25 +130,18 @@ static struct ast_node *parse_constant();
 static struct ast_node *parse_decl();
 static struct ast_node *parse_decl_without_initializer();
 static struct ast_node *parse_do_while();
-static struct ast_node *parse_equality();
-static struct ast_node *parse_exclusive_or();
 static struct ast_node *parse_expr();
 static struct ast_node *parse_for();
 static struct ast_node *parse_function_call();
 static struct ast_node *parse_function_decl();
-static struct ast_node *parse_inclusive_or();
 static struct ast_node *parse_iteration_block();
 static struct ast_node *parse_iteration_stmt();
 static struct ast_node *parse_jump_stmt();
-static struct ast_node *parse_logical_and();
 static struct ast_node *parse_logical_or();
-static struct ast_node *parse_multiplicative();
 static struct ast_node *parse_postfix_unary();
 static struct ast_node *parse_prefix_unary();
 static struct ast_node *parse_primary();
-static struct ast_node *parse_relational();
 static struct ast_node *parse_selection_stmt();
-static struct ast_node *parse_shift();
 static struct ast_node *parse_stmt();
 static struct ast_node *parse_struct_decl();
 static struct ast_node *parse_struct_field_access();
@@ -106,53 +150,329 @@ static struct ast_node *parse_symbol();
 static struct ast_node *parse_var_decl_without_initializer();
 static struct ast_node *parse_while();
 
-struct ast_node *parse(const struct token *begin, const struct token *end)
+static struct ast_node *parse_global_decl()
+{
+    struct token *curr = peek_current();
+
+    switch (curr->type) {
+    case TOK_STRUCT:
+        return parse_struct_decl();
+    case TOK_VOID:
+    case TOK_INT:
+    case TOK_CHAR:
+    case TOK_FLOAT:
+    case TOK_BOOL: /* Fall through. */
+        return parse_function_decl();
+    default:
+        weak_compile_error(
+            curr->line_no,
+            curr->col_no,
+            "Unexpected token in global context: %s\n",
+            tok_to_string(curr->type)
+        );
+    }
+}
+
+static void parse_free_state()
+{
+    vector_free(expr_operands);
+    vector_free(expr_operators);
+    vector_free(list_nodes);
+}
+
+static uint64_t list_base()
+{
+    return list_nodes.count;
+}
+
+/* Make compound of nodes pushed to `list_nodes` since `base`
+   and pop them. */
+static struct ast_node *list_compound(uint64_t base, uint32_t line_no, uint32_t col_no)
+{
+    uint64_t          size  = list_nodes.count - base;
+    struct ast_node **stmts = NULL;
+
+    if (size > 0) {
+        stmts = weak_calloc(size, sizeof (struct ast_node *));
+        memcpy(stmts, &list_nodes.data[base], size * sizeof (struct ast_node *));
+    }
+
+    list_nodes.count = base;
+
+    return ast_compound_init(size, stmts, line_no, col_no);
+}
+
+/* Parse global declarations from current position up to
+   the end of token stream. */
+static void parse_global_decls(ast_array_t *out)
+{
+    loops_depth = 0;
+    vector_clear(expr_operands);
+    vector_clear(expr_operators);
+    vector_clear(list_nodes);
+    weak_thread_atexit(parse_free_state);
+
+    while (tok_lookup(tok_pos)) {
+        struct ast_node *decl = parse_global_decl();
+        vector_push_back(*out, decl);
+    }
+}
+
+/* \pre `arena` is current. */
+static struct ast_node *parse_root(ast_array_t *global_stmts, struct arena *arena)
+{
+    struct ast_node *root = ast_compound_init(
+        /*size=*/global_stmts->count,
+        /*stmts=*/global_stmts->data,
+        /*line_no=*/0,
+        /*col_no=*/0
+    );
+
+    /* Root owns the whole tree. */
+    ( (struct ast_compound *) root->ast )->arena = arena;
+
+    return root;
+}
+
+/* Parse global declarations from current position, append
+   them to `global_stmts` and make root of them. `arena` is
+   current only while parsing. On compile error all parsed
+   declarations are released with `arena`, then error goes
+   further to the caller. */
+static struct ast_node *parse_root_guarded(ast_array_t *global_stmts, struct arena *arena)
+{
+    struct arena    *prev = ast_arena_set(arena);
+    struct ast_node *root = NULL;
+    jmp_buf          saved;
+
+    memcpy(saved, weak_fatal_error_buf, sizeof (jmp_buf));
+
+    if (setjmp(weak_fatal_error_buf)) {
+        memcpy(weak_fatal_error_buf, saved, sizeof (jmp_buf));
+        ast_node_cleanup(parse_root(global_stmts, arena));
+        ast_arena_set(prev);
+        longjmp(weak_fatal_error_buf, 1);
+    }
+
+    parse_global_decls(global_stmts);
+
+    memcpy(weak_fatal_error_buf, saved, sizeof (jmp_buf));
+    root = parse_root(global_stmts, arena);
+    ast_arena_set(prev);
+
+    return root;
+}
+
+static struct ast_node *parse_unit()
+{
+    ast_array_t global_stmts = {0};
+
+    return parse_root_guarded(&global_stmts, ast_arena_init());
+}
+
+struct ast_node *parse(const tok_array_t *toks)
+{
+    long     cpus    = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t threads = tok_array_count(toks) / PARSE_PARALLEL_MIN_TOKENS;
+
+    if (cpus > 0 && threads > (uint64_t) cpus)
+        threads = cpus;
+
+    if (threads > 1)
+        return parse_parallel(toks, threads);
+
+    tok_stream_init_array(&tok_stream, toks);
+    tok_pos = 0;
+
+    return parse_unit();
+}
+
+struct ast_node *parse_source(struct source *s)
 {
-    tok_begin = (struct token *) begin;
-    tok_end   = (struct token *) end;
+    tok_stream_init(&tok_stream, s);
+    tok_pos = 0;
 
-    typedef vector_t(struct ast_node *) stmts_t;
+    return parse_unit();
+}
+
+/**********************************************
+ **          Parallel parsing                **
+ **********************************************/
+
+/* Contiguous group of global declarations, parsed by
+   one thread with own parser state and arena. */
+struct parse_job {
+    const tok_array_t *toks;
+    /** Tokens [begin, end) of declarations. */
+    uint64_t           begin;
+    uint64_t           end;
+    ast_array_t        decls;
+    struct arena      *arena;
+    bool               failed;
+    pthread_t          thread;
+};
 
-    stmts_t global_stmts = {0};
-    struct token *curr = NULL;
+typedef vector_t(uint64_t) parse_ends_t;
 
-    while (tok_begin < tok_end) {
-        curr = peek_current();
-        switch (curr->type) {
-        case TOK_STRUCT:
-            vector_push_back(global_stmts, parse_struct_decl());
+/* Find ends of global declarations by brace matching. Both
+   function and structure end with `}` at depth 0, structure
+   also takes following `;`. Tokens are not validated, so
+   garbage gives wrong split, which is handled as a parse
+   error of some job. */
+static void parse_split(const tok_array_t *toks, parse_ends_t *ends)
+{
+    const uint8_t *types = toks->types.data;
+    uint64_t       count = tok_array_count(toks);
+    int64_t        depth = 0;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        switch (types[i]) {
+        case TOK_OPEN_CURLY_BRACKET:
+            ++depth;
             break;
-        case TOK_VOID:
-        case TOK_INT:
-        case TOK_CHAR:
-        case TOK_FLOAT:
-        case TOK_BOOL: /* Fall through. */
-            vector_push_back(global_stmts, parse_function_decl());
+        case TOK_CLOSE_CURLY_BRACKET:
+            if (--depth != 0)
+                break;
+            if (i + 1 < count && types[i + 1] == TOK_SEMICOLON)
+                ++i;
+            vector_push_back(*ends, i + 1);
+            break;
+        case TOK_SEMICOLON:
+            if (depth == 0)
+                vector_push_back(*ends, i + 1);
             break;
         default:
-            weak_compile_error(
-                curr->line_no,
-                curr->col_no,
-                "Unexpected token in global context: %s\n",
-                tok_to_string(curr->type)
-            );
+            break;
         }
     }
 
-    return ast_compound_init(
-        /*size=*/global_stmts.count,
-        /*stmts=*/global_stmts.data,
-        /*line_no=*/0,
-        /*col_no=*/0
-    );
+    if (ends->count == 0 || vector_back(*ends) != count)
+        vector_push_back(*ends, count);
+}
+
+static void *parse_worker(void *arg)
+{
+    struct parse_job *job = arg;
+
+    /* Errors are reported by serial parsing instead, to
+       keep their order. */
+    weak_diag_set_silent(1);
+
+    job->arena = ast_arena_init();
+    ast_arena_set(job->arena);
+
+    tok_stream_init_range(&tok_stream, job->toks, job->begin, job->end);
+    tok_pos = job->begin;
+
+    if (!setjmp(weak_fatal_error_buf))
+        parse_global_decls(&job->decls);
+    else
+        job->failed = 1;
+
+    return NULL;
+}
+
+struct ast_node *parse_parallel(const tok_array_t *toks, uint32_t threads)
+{
+    struct parse_job   jobs[PARSE_PARALLEL_MAX_THREADS];
+    parse_ends_t       ends  = {0};
+    uint64_t           count = tok_array_count(toks);
+    uint32_t           cnt   = 0;
+
+    if (threads > PARSE_PARALLEL_MAX_THREADS)
+        threads = PARSE_PARALLEL_MAX_THREADS;
+
+    parse_split(toks, &ends);
+
+    if (threads > ends.count)
+        threads = ends.count;
+
+    if (threads <= 1) {
+        vector_free(ends);
+        tok_stream_init_array(&tok_stream, toks);
+        tok_pos = 0;
+        return parse_unit();
+    }
+
+    /* Give each job about the same count of tokens. */
+    for (uint64_t i = 0, begin = 0; i < ends.count; ++i) {
+        uint64_t end = ends.data[i];
+
+        if (i + 1 != ends.count && end < count * (cnt + 1) / threads)
+            continue;
+
+        memset(&jobs[cnt], 0, sizeof (*jobs));
+        jobs[cnt].toks  = toks;
+        jobs[cnt].begin = begin;
+        jobs[cnt].end   = end;
+        ++cnt;
+
+        begin = end;
+    }
+
+    vector_free(ends);
+
+    struct arena *arena        = ast_arena_init();
+    ast_array_t   global_stmts = {0};
+
+    /* Calling thread only waits, since its error handler
+       must not be replaced. */
+    for (uint32_t i = 0; i < cnt; ++i) {
+        errno = pthread_create(&jobs[i].thread, NULL, parse_worker, &jobs[i]);
+        if (errno != 0)
+            weak_fatal_errno("pthread_create()");
+    }
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        errno = pthread_join(jobs[i].thread, NULL);
+        if (errno != 0)
+            weak_fatal_errno("pthread_join()");
+    }
+
+    /* Declarations are stitched in source order. On the first
+       failed job input is parsed serially from its start, so
+       the error (or result, if the split was wrong) is the
+       same as of serial parser. Trees of that job and jobs
+       after it are dropped. With root arena current their
+       cleanup is no-op, since they are freed with it. */
+    struct arena *prev   = ast_arena_set(arena);
+    uint32_t      failed = cnt;
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        ast_arena_merge(arena, jobs[i].arena);
+
+        if (failed == cnt && jobs[i].failed)
+            failed = i;
+
+        vector_foreach(jobs[i].decls, j) {
+            struct ast_node *decl = jobs[i].decls.data[j];
+
+            if (i < failed)
+                vector_push_back(global_stmts, decl);
+            else
+                ast_node_cleanup(decl);
+        }
+
+        vector_free(jobs[i].decls);
+    }
+
+    ast_arena_set(prev);
+
+    /* Nothing is left to parse if all jobs succeeded. */
+    uint64_t rest = failed != cnt ? jobs[failed].begin : count;
+
+    tok_stream_init_range(&tok_stream, toks, rest, count);
+    tok_pos = rest;
+
+    return parse_root_guarded(&global_stmts, arena);
 }
 
 struct localized_data_type {
     enum data_type  data_type;
-    char           *type_name;
+    const char     *type_name;
     uint16_t        ptr_depth;
-    uint16_t        line_no;
-    int16_t         col_no;
+    uint32_t        line_no;
+    uint32_t        col_no;
 };
 
 static struct localized_data_type parse_type()
@@ -174,7 +494,7 @@ static struct localized_data_type parse_type()
         struct localized_data_type dt = {
             .data_type = tok_to_data_type(t->type),
             .type_name = (t->type == TOK_SYMBOL)
-                           ? strdup(t->data)
+                           ? t->data
                            : NULL,
             .ptr_depth = ptr_depth,
             .line_no   = t->line_no,
@@ -216,16 +536,16 @@ static struct localized_data_type parse_return_type()
 static struct ast_node *parse_array_decl_without_initializer()
 {
     struct localized_data_type dt = parse_type();
-    struct token *var_name = peek_next();
+    struct token  var_name = *peek_next();
 
-    if (var_name->type != TOK_SYMBOL)
+    if (var_name.type != TOK_SYMBOL)
         weak_compile_error(
-            var_name->line_no,
-            var_name->col_no,
+            var_name.line_no,
+            var_name.col_no,
             "Variable name expected"
         );
 
-    ast_array_t arity_list = {0};
+    uint64_t base = list_base();
 
     if (!tok_is(peek_current(), '['))
         weak_compile_error(
@@ -244,20 +564,15 @@ static struct ast_node *parse_array_decl_without_initializer()
                 "Integer size declarator expected"
             );
 
-        vector_push_back(arity_list, constant);
+        vector_push_back(list_nodes, constant);
         require_char(']');
     }
 
-    struct ast_node *arity = ast_compound_init(
-        arity_list.count,
-        arity_list.data,
-        dt.line_no,
-        dt.col_no
-    );
+    struct ast_node *arity = list_compound(base, dt.line_no, dt.col_no);
 
     return ast_array_decl_init(
         dt.data_type,
-        strdup(var_name->data),
+        var_name.data,
         dt.type_name,
         arity,
         dt.ptr_depth,
@@ -290,20 +605,17 @@ static struct ast_node *parse_array_decl()
 
 static struct ast_node *parse_decl_without_initializer()
 {
+    uint64_t        start    = tok_pos;
     struct token   *ptr      = peek_current();
     struct localized_data_type
                     dt       = parse_type();
-    bool            is_array = tok_is((tok_begin + 1), '[');
-    ptrdiff_t       offset   = tok_begin - ptr;
+    bool            is_array = tok_is(tok_at(tok_pos + 1), '[');
 
-    tok_begin -= offset;
+    tok_pos = start;
 
     /* We just compute the offset of whole type
        declaration, e.g for `char ********` to judge
-       what type of declaration there is. All other
-       allocated strings are not needed. */
-    if (dt.type_name)
-        weak_free(dt.type_name);
+       what type of declaration there is. */
 
     switch (ptr->type) {
     case TOK_SYMBOL:
@@ -331,8 +643,8 @@ static struct ast_node *parse_var_decl_without_initializer()
 
     return ast_var_decl_init(
         dt.data_type,
-        strdup(var_name->data),
-        dt.type_name, /* Already strdup()'ed. */
+        var_name->data,
+        dt.type_name,
         dt.ptr_depth,
         /*body=*/NULL,
         dt.line_no,
@@ -343,12 +655,12 @@ static struct ast_node *parse_var_decl_without_initializer()
 static struct ast_node *parse_var_decl()
 {
     struct localized_data_type dt = parse_type();
-    struct token *var_name = peek_next();
+    struct token  var_name = *peek_next();
 
-    if (var_name->type != TOK_SYMBOL)
+    if (var_name.type != TOK_SYMBOL)
         weak_compile_error(
-            var_name->line_no,
-            var_name->col_no,
+            var_name.line_no,
+            var_name.col_no,
             "Variable name expected"
         );
 
@@ -357,7 +669,7 @@ static struct ast_node *parse_var_decl()
     if (tok_is(operator, '='))
         return ast_var_decl_init(
             dt.data_type,
-            strdup(var_name->data),
+            var_name.data,
             dt.type_name,
             dt.ptr_depth,
             parse_logical_or(),
@@ -367,24 +679,24 @@ static struct ast_node *parse_var_decl()
 
     /* This is placed here because language supports nested functions. */
     if (tok_is(operator, '(')) {
-        --tok_begin; /* Open paren. */
-        --tok_begin; /* Function name. */
-        --tok_begin; /* Data type. */
-        tok_begin -= dt.ptr_depth;
+        --tok_pos; /* Open paren. */
+        --tok_pos; /* Function name. */
+        --tok_pos; /* Data type. */
+        tok_pos -= dt.ptr_depth;
         return parse_function_decl();
     }
 
     if (tok_is(operator, '[')) {
-        --tok_begin; /* Open paren. */
-        --tok_begin; /* Function name. */
-        --tok_begin; /* Data type. */
-        tok_begin -= dt.ptr_depth;
+        --tok_pos; /* Open paren. */
+        --tok_pos; /* Function name. */
+        --tok_pos; /* Data type. */
+        tok_pos -= dt.ptr_depth;
         return parse_array_decl();
     }
 
     weak_compile_error(
-        var_name->line_no,
-        var_name->col_no,
+        var_name.line_no,
+        var_name.col_no,
         "Function, variable or array declaration expected"
     );
 }
@@ -415,38 +727,33 @@ static struct ast_node *parse_decl()
 
 static struct ast_node *parse_struct_decl()
 {
-    ast_array_t decls = {0};
-
-    struct token *start = require_token(TOK_STRUCT);
-    struct token *name  = require_token(TOK_SYMBOL);
+    uint64_t      base  = list_base();
+    struct token  start = *require_token(TOK_STRUCT);
+    struct token  name  = *require_token(TOK_SYMBOL);
 
     require_char('{');
 
     while (!tok_is(peek_current(), '}')) {
-        vector_push_back(decls, parse_decl());
+        struct ast_node *decl = parse_decl();
+        vector_push_back(list_nodes, decl);
         require_char(';');
     }
 
     require_char('}');
 
-    struct ast_node *decls_list = ast_compound_init(
-        decls.count,
-        decls.data,
-        start->line_no,
-        start->col_no
-    );
+    struct ast_node *decls_list = list_compound(base, start.line_no, start.col_no);
 
     return ast_struct_decl_init(
-        strdup(name->data),
+        name.data,
         decls_list,
-        start->line_no,
-        start->col_no
+        start.line_no,
+        start.col_no
     );
 }
 
 static struct ast_node *parse_function_param_list()
 {
-    ast_array_t list = {0};
+    uint64_t base = list_base();
 
     if (tok_is(peek_current(), ')'))
         return ast_compound_init(
@@ -457,23 +764,19 @@ static struct ast_node *parse_function_param_list()
         );
 
     while (!tok_is(peek_current(), ')')) {
-        vector_push_back(list, parse_decl_without_initializer());
+        struct ast_node *decl = parse_decl_without_initializer();
+        vector_push_back(list_nodes, decl);
         if (tok_is(peek_current(), ','))
             require_char(',');
     }
 
-    return ast_compound_init(
-        list.count,
-        list.data,
-        peek_current()->line_no,
-        peek_current()->col_no
-    );
+    return list_compound(base, peek_current()->line_no, peek_current()->col_no);
 }
 
 static struct ast_node *parse_function_decl()
 {
     struct localized_data_type dt = parse_return_type();
-    struct token *name = require_token(TOK_SYMBOL);
+    struct token  name = *require_token(TOK_SYMBOL);
 
     require_char('(');
     struct ast_node *param_list = parse_function_param_list();
@@ -489,7 +792,7 @@ static struct ast_node *parse_function_decl()
     return ast_fn_decl_init(
         dt.data_type,
         dt.ptr_depth,
-        strdup(name->data),
+        name.data,
         param_list,
         block ? block : NULL,
         dt.line_no,
@@ -522,7 +825,7 @@ static struct ast_node *parse_stmt()
            variable declaration only in global context
            (most top level in block), elsewise this is
            a multiplication operator. */
-        return (tok_is(tok_begin + 1, '*') || (tok_begin + 1)->type == TOK_SYMBOL)
+        return (tok_is(tok_at(tok_pos + 1), '*') || tok_at(tok_pos + 1)->type == TOK_SYMBOL)
             ? parse_struct_var_decl()
             : parse_expr();
     }
@@ -553,21 +856,21 @@ static struct ast_node *parse_loop_stmt()
     case TOK_CONTINUE:
         return ast_continue_init(t->line_no, t->col_no);
     default:
-        --tok_begin;
+        --tok_pos;
         return parse_stmt();
     }
 }
 
 static struct ast_node *parse_iteration_block()
 {
-    ast_array_t   stmts = {0};
-    struct token *start = require_char('{');
+    uint64_t      base  = list_base();
+    struct token  start = *require_char('{');
 
     while (!tok_is(peek_current(), '}')) {
-        vector_push_back(stmts, parse_loop_stmt());
-        enum ast_type t = vector_at(stmts, stmts.count - 1)->type;
+        struct ast_node *stmt = parse_loop_stmt();
+        vector_push_back(list_nodes, stmt);
 
-        switch (t) {
+        switch (stmt->type) {
         case AST_BINARY:
         case AST_POSTFIX_UNARY:
         case AST_PREFIX_UNARY:
@@ -590,12 +893,7 @@ static struct ast_node *parse_iteration_block()
 
     require_char('}');
 
-    return ast_compound_init(
-        stmts.count,
-        stmts.data,
-        start->line_no,
-        start->col_no
-    );
+    return list_compound(base, start.line_no, start.col_no);
 }
 
 static struct ast_node *parse_block()
@@ -603,14 +901,14 @@ static struct ast_node *parse_block()
     if (loops_depth > 0)
         return parse_iteration_block();
 
-    ast_array_t   stmts = {0};
-    struct token *start = require_char('{');
+    uint64_t      base  = list_base();
+    struct token  start = *require_char('{');
 
     while (!tok_is(peek_current(), '}')) {
-        vector_push_back(stmts, parse_stmt());
-        enum ast_type t = vector_at(stmts, stmts.count - 1)->type;
+        struct ast_node *stmt = parse_stmt();
+        vector_push_back(list_nodes, stmt);
 
-        switch (t) {
+        switch (stmt->type) {
         case AST_BINARY:
         case AST_POSTFIX_UNARY:
         case AST_PREFIX_UNARY:
@@ -631,12 +929,7 @@ static struct ast_node *parse_block()
 
     require_char('}');
 
-    return ast_compound_init(
-        stmts.count,
-        stmts.data,
-        start->line_no,
-        start->col_no
-    );
+    return list_compound(base, start.line_no, start.col_no);
 }
 
 static struct ast_node *parse_selection_stmt()
@@ -644,7 +937,7 @@ static struct ast_node *parse_selection_stmt()
     struct ast_node *cond      = NULL;
     struct ast_node *then_body = NULL;
     struct ast_node *else_body = NULL;
-    struct token    *start     = require_token(TOK_IF);
+    struct token     start     = *require_token(TOK_IF);
 
     require_char('(');
     cond = parse_logical_or();
@@ -661,8 +954,8 @@ static struct ast_node *parse_selection_stmt()
         cond,
         then_body,
         else_body,
-        start->line_no,
-        start->col_no
+        start.line_no,
+        start.col_no
     );
 }
 
@@ -684,21 +977,21 @@ static struct ast_node *parse_iteration_stmt()
 
 static struct ast_node *parse_jump_stmt()
 {
-    struct token *start = require_token(TOK_RETURN);
+    struct token  start = *require_token(TOK_RETURN);
     struct ast_node  *body  = NULL;
 
     if (!tok_is(peek_current(), ';'))
         body = parse_logical_or();
 
-    return ast_ret_init(body, start->line_no, start->col_no);
+    return ast_ret_init(body, start.line_no, start.col_no);
 }
 
 /* for (decl : expr) {}
        ^
        Starting from here */
 static struct ast_node *parse_for_range(
-    uint16_t start_line_no,
-    uint16_t start_col_no
+    uint32_t start_line_no,
+    uint32_t start_col_no
 ) {
     struct ast_node *iter = parse_decl_without_initializer();
     require_char(':');
@@ -740,7 +1033,7 @@ static struct ast_node *parse_for_range(
    absurd. */
 static struct ast_node *parse_for()
 {
-    struct token *start = require_token(TOK_FOR);
+    struct token  start = *require_token(TOK_FOR);
     require_char('(');
 
     struct ast_node *init      = NULL;
@@ -748,35 +1041,34 @@ static struct ast_node *parse_for()
     struct ast_node *increment = NULL;
 
     if (!tok_is(peek_next(), ';')) {
-        --tok_begin;
+        --tok_pos;
 
-        struct token *curr = peek_current();
-        struct localized_data_type dt = parse_type();
-        weak_free(dt.type_name);
+        uint64_t curr = tok_pos;
+        parse_type();
 
-        if (tok_is(peek_current() + 1, '=')) {
+        if (tok_is(tok_at(tok_pos + 1), '=')) {
             /* Regular for. */
-            tok_begin = curr;
+            tok_pos = curr;
             init = parse_expr();
             require_char(';');
         } else {
             /* Range for. */
-            tok_begin = curr;
+            tok_pos = curr;
             return parse_for_range(
-                start->line_no,
-                start->col_no
+                start.line_no,
+                start.col_no
             );
         }
     }
 
     if (!tok_is(peek_next(), ';')) {
-        --tok_begin;
+        --tok_pos;
         cond = parse_expr();
         require_char(';');
     }
 
     if (!tok_is(peek_next(), ')')) {
-        --tok_begin;
+        --tok_pos;
         increment = parse_expr();
         require_char(')');
     }
@@ -790,14 +1082,14 @@ static struct ast_node *parse_for()
         cond,
         increment,
         body,
-        start->line_no,
-        start->col_no
+        start.line_no,
+        start.col_no
     );
 }
 
 static struct ast_node *parse_do_while()
 {
-    struct token *start = require_token(TOK_DO);
+    struct token  start = *require_token(TOK_DO);
 
     ++loops_depth;
     struct ast_node *body = parse_block();
@@ -812,14 +1104,14 @@ static struct ast_node *parse_do_while()
     return ast_do_while_init(
         body,
         cond,
-        start->line_no,
-        start->col_no
+        start.line_no,
+        start.col_no
     );
 }
 
 static struct ast_node *parse_while()
 {
-    struct token *start = require_token(TOK_WHILE);
+    struct token  start = *require_token(TOK_WHILE);
 
     require_char('(');
     struct ast_node *cond = parse_logical_or();
@@ -832,230 +1124,170 @@ static struct ast_node *parse_while()
     return ast_while_init(
         cond,
         body,
-        start->line_no,
-        start->col_no
+        start.line_no,
+        start.col_no
     );
 }
 
-static struct ast_node *parse_logical_or()
-{
-    struct ast_node *expr = parse_logical_and();
+/**********************************************
+ **           Binary expressions             **
+ **********************************************/
+
+/* Binary operator precedence. 0 means token is not binary
+   operator. All operators are right-associative, since
+   expressions are built that way. */
+enum {
+    PREC_NONE,
+    PREC_ASSIGN,
+    PREC_LOGICAL_OR,
+    PREC_LOGICAL_AND,
+    PREC_INCLUSIVE_OR,
+    PREC_EXCLUSIVE_OR,
+    PREC_AND,
+    PREC_EQUALITY,
+    PREC_RELATIONAL,
+    PREC_SHIFT,
+    PREC_ADDITIVE,
+    PREC_MULTIPLICATIVE
+};
 
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_OR:
-            expr = ast_binary_init(t->type, expr, parse_logical_or(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
-}
+static const uint8_t binary_prec[TOK_CLOSE_PAREN + 1] = {
+    [TOK_ASSIGN]         = PREC_ASSIGN,
+    [TOK_MUL_ASSIGN]     = PREC_ASSIGN,
+    [TOK_DIV_ASSIGN]     = PREC_ASSIGN,
+    [TOK_MOD_ASSIGN]     = PREC_ASSIGN,
+    [TOK_PLUS_ASSIGN]    = PREC_ASSIGN,
+    [TOK_MINUS_ASSIGN]   = PREC_ASSIGN,
+    [TOK_SHL_ASSIGN]     = PREC_ASSIGN,
+    [TOK_SHR_ASSIGN]     = PREC_ASSIGN,
+    [TOK_BIT_AND_ASSIGN] = PREC_ASSIGN,
+    [TOK_BIT_OR_ASSIGN]  = PREC_ASSIGN,
+    [TOK_XOR_ASSIGN]     = PREC_ASSIGN,
+    [TOK_OR]             = PREC_LOGICAL_OR,
+    [TOK_AND]            = PREC_LOGICAL_AND,
+    [TOK_BIT_OR]         = PREC_INCLUSIVE_OR,
+    [TOK_XOR]            = PREC_EXCLUSIVE_OR,
+    [TOK_BIT_AND]        = PREC_AND,
+    [TOK_EQ]             = PREC_EQUALITY,
+    [TOK_NEQ]            = PREC_EQUALITY,
+    [TOK_GT]             = PREC_RELATIONAL,
+    [TOK_LT]             = PREC_RELATIONAL,
+    [TOK_GE]             = PREC_RELATIONAL,
+    [TOK_LE]             = PREC_RELATIONAL,
+    [TOK_SHL]            = PREC_SHIFT,
+    [TOK_SHR]            = PREC_SHIFT,
+    [TOK_PLUS]           = PREC_ADDITIVE,
+    [TOK_MINUS]          = PREC_ADDITIVE,
+    [TOK_STAR]           = PREC_MULTIPLICATIVE,
+    [TOK_SLASH]          = PREC_MULTIPLICATIVE,
+    [TOK_MOD]            = PREC_MULTIPLICATIVE
+};
 
-static struct ast_node *parse_logical_and()
+/* Replace top operator and its operands by subtree. */
+static void parse_binary_reduce()
 {
-    struct ast_node *expr = parse_inclusive_or();
+    struct token     op  = vector_back(expr_operators);
+    struct ast_node *rhs = vector_back(expr_operands);
+    struct ast_node *lhs = NULL;
 
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_AND:
-            expr = ast_binary_init(t->type, expr, parse_logical_and(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
-}
+    --expr_operators.count;
+    --expr_operands.count;
 
-static struct ast_node *parse_inclusive_or()
-{
-    struct ast_node *expr = parse_exclusive_or();
+    lhs = vector_back(expr_operands);
 
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_BIT_OR:
-            expr = ast_binary_init(t->type, expr, parse_inclusive_or(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
+    vector_back(expr_operands) = ast_binary_init(
+        op.type,
+        lhs,
+        rhs,
+        op.line_no,
+        op.col_no
+    );
 }
 
-static struct ast_node *parse_exclusive_or()
+/* Parse expression of binary operators with precedence not
+   less than `min_prec` in one loop. Subtree of operator is
+   built when operator with lower precedence follows it, so
+   trees are the same as from recursive descent, where each
+   precedence level is separate function. */
+static struct ast_node *parse_binary(uint8_t min_prec)
 {
-    struct ast_node *expr = parse_and();
-
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_XOR:
-            expr = ast_binary_init(t->type, expr, parse_exclusive_or(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
-}
+    uint64_t operands_base  = expr_operands.count;
+    uint64_t operators_base = expr_operators.count;
 
-static struct ast_node *parse_and()
-{
-    struct ast_node *expr = parse_equality();
+    struct ast_node *operand = parse_prefix_unary();
+    vector_push_back(expr_operands, operand);
 
     while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_BIT_AND:
-            expr = ast_binary_init(t->type, expr, parse_and(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
-}
+        struct token *t    = peek_current();
+        uint8_t       prec = binary_prec[t->type];
 
-static struct ast_node *parse_equality()
-{
-    struct ast_node *expr = parse_relational();
-
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_EQ:
-        case TOK_NEQ: /* Fall through. */
-            expr = ast_binary_init(t->type, expr, parse_equality(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
+        if (prec == PREC_NONE || prec < min_prec)
             break;
-        }
-        break;
-    }
-    return expr;
-}
 
-static struct ast_node *parse_relational()
-{
-    struct ast_node *expr = parse_shift();
+        /* Right associativity: pop only stronger operators. */
+        while (expr_operators.count > operators_base &&
+               binary_prec[vector_back(expr_operators).type] > prec)
+            parse_binary_reduce();
 
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_GT:
-        case TOK_LT:
-        case TOK_GE:
-        case TOK_LE: /* Fall through. */
-            expr = ast_binary_init(t->type, expr, parse_relational(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
+        vector_push_back(expr_operators, *t);
+        ++tok_pos;
+
+        operand = parse_prefix_unary();
+        vector_push_back(expr_operands, operand);
     }
-    return expr;
-}
 
-static struct ast_node *parse_shift()
-{
-    struct ast_node *expr = parse_additive();
+    while (expr_operators.count > operators_base)
+        parse_binary_reduce();
 
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_SHL:
-        case TOK_SHR: /* Fall through. */
-            expr = ast_binary_init(t->type, expr, parse_shift(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
+    assert(expr_operands.count == operands_base + 1);
+
+    return expr_operands.data[--expr_operands.count];
 }
 
-static struct ast_node *parse_additive()
+static struct ast_node *parse_logical_or()
 {
-    struct ast_node *expr = parse_multiplicative();
-
-    while (1) {
-        struct token *t = peek_next();
-        switch (t->type) {
-        case TOK_PLUS:
-        case TOK_MINUS: /* Fall through. */
-            expr = ast_binary_init(t->type, expr, parse_additive(), t->line_no, t->col_no);
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-    return expr;
+    return parse_binary(PREC_LOGICAL_OR);
 }
 
-static struct ast_node *parse_multiplicative()
+/* Prefix operators are applied in reverse order after
+   operand is parsed, without recursion. */
+static struct ast_node *parse_prefix_unary()
 {
-    struct ast_node *expr = parse_prefix_unary();
+    uint64_t base = expr_operators.count;
 
     while (1) {
-        struct token *t = peek_next();
+        struct token *t = peek_current();
+
         switch (t->type) {
-        case TOK_STAR:
-        case TOK_SLASH:
-        case TOK_MOD: /* Fall through. */
-            expr = ast_binary_init(t->type, expr, parse_multiplicative(), t->line_no, t->col_no);
+        case TOK_BIT_AND: /* Address operator `&`. */
+        case TOK_STAR: /* Dereference operator `*`. */
+        case TOK_INC:
+        case TOK_DEC: /* Fall through. */
+            vector_push_back(expr_operators, *t);
+            ++tok_pos;
             continue;
         default:
-            --tok_begin;
             break;
         }
         break;
     }
-    return expr;
-}
 
-static struct ast_node *parse_prefix_unary()
-{
-    struct token *t = peek_next();
+    struct ast_node *expr = parse_postfix_unary();
 
-    switch (t->type) {
-    case TOK_BIT_AND: /* Address operator `&`. */
-    case TOK_STAR: /* Dereference operator `*`. */
-    case TOK_INC:
-    case TOK_DEC: /* Fall through. */
-        return ast_unary_init(
+    while (expr_operators.count > base) {
+        struct token t = vector_back(expr_operators);
+        --expr_operators.count;
+
+        expr = ast_unary_init(
             AST_PREFIX_UNARY,
-            t->type,
-            parse_prefix_unary(),
-            t->line_no,
-            t->col_no
+            t.type,
+            expr,
+            t.line_no,
+            t.col_no
         );
-    default:
-        /* Rollback current token pointer because there's no unary operator. */
-        --tok_begin;
-        return parse_postfix_unary();
     }
+
+    return expr;
 }
 
 static struct ast_node *parse_postfix_unary()
@@ -1074,32 +1306,32 @@ static struct ast_node *parse_postfix_unary()
             t->col_no
         );
     default:
-      --tok_begin;
+      --tok_pos;
       return expr;
     }
 }
 
 static struct ast_node *parse_symbol()
 {
-    struct token *start    = tok_begin - 1;
-    struct token *curr_tok = tok_begin;
+    struct token *start    = tok_at(tok_pos - 1);
+    struct token *curr_tok = peek_current();
 
     switch (curr_tok->type) {
     /* symbol( */
     case TOK_OPEN_PAREN:
-        --tok_begin;
+        --tok_pos;
         return parse_function_call();
     /* symbol[ */
     case TOK_OPEN_BOX_BRACKET:
-        --tok_begin;
+        --tok_pos;
         return parse_array_access();
     /* symbol. */
     case TOK_DOT:
-        --tok_begin;
+        --tok_pos;
         return parse_struct_field_access();
     /* symbol */
     default:
-        return ast_sym_init(strdup(start->data), start->line_no, start->col_no);
+        return ast_sym_init(start->data, start->line_no, start->col_no);
     }
 }
 
@@ -1125,7 +1357,7 @@ static struct ast_node *parse_primary()
         return expr;
     }
     default:
-        --tok_begin;
+        --tok_pos;
         return parse_constant();
     }
 }
@@ -1134,8 +1366,8 @@ static struct ast_node *parse_struct_var_decl()
 {
     struct localized_data_type
                   dt             = parse_type();
-    struct token *name           = require_token(TOK_SYMBOL);
-    ast_array_t   enclosure_list = {0};
+    struct token  name           = *require_token(TOK_SYMBOL);
+    uint64_t      base           = list_base();
 
     assert(dt.data_type == D_T_STRUCT);
 
@@ -1150,17 +1382,12 @@ static struct ast_node *parse_struct_var_decl()
                 "Integer size declarator expected"
             );
 
-        vector_push_back(enclosure_list, constant);
+        vector_push_back(list_nodes, constant);
         require_char(']');
     }
 
-    if (enclosure_list.count > 0) {
-        struct ast_node *enclosure_list_ast = ast_compound_init(
-            enclosure_list.count,
-            enclosure_list.data,
-            dt.line_no,
-            dt.col_no
-        );
+    if (list_nodes.count > base) {
+        struct ast_node *enclosure_list_ast = list_compound(base, dt.line_no, dt.col_no);
         struct ast_node *ptr_decl_body = NULL;
 
         if (dt.ptr_depth > 0) {
@@ -1170,8 +1397,8 @@ static struct ast_node *parse_struct_var_decl()
 
         return ast_array_decl_init(
             D_T_STRUCT,
-            strdup(name->data),
-            dt.type_name, /* Already strdup()'ed. */
+            name.data,
+            dt.type_name,
             enclosure_list_ast,
             dt.ptr_depth,
             ptr_decl_body,
@@ -1182,8 +1409,8 @@ static struct ast_node *parse_struct_var_decl()
 
     return ast_var_decl_init(
         D_T_STRUCT,
-        strdup(name->data),
-        dt.type_name, /* Already strdup()'ed. */
+        name.data,
+        dt.type_name,
         dt.ptr_depth,
         /*body=*/NULL,
         dt.line_no,
@@ -1193,52 +1420,48 @@ static struct ast_node *parse_struct_var_decl()
 
 static struct ast_node *parse_struct_field_access()
 {
-    struct token *symbol = require_token(TOK_SYMBOL);
+    struct token  symbol = *require_token(TOK_SYMBOL);
     struct token *next   = peek_next();
 
     if (tok_is(next, '.'))
         return ast_member_init(
-            ast_sym_init(strdup(symbol->data), symbol->line_no, symbol->col_no),
+            ast_sym_init(symbol.data, symbol.line_no, symbol.col_no),
             parse_struct_field_access(),
-            symbol->line_no,
-            symbol->col_no
+            symbol.line_no,
+            symbol.col_no
         );
 
-    --tok_begin;
-    return ast_sym_init(strdup(symbol->data), symbol->line_no, symbol->col_no);
+    --tok_pos;
+    return ast_sym_init(symbol.data, symbol.line_no, symbol.col_no);
 }
 
 static struct ast_node *parse_array_access()
 {
-    struct token *symbol = peek_next();
+    struct token  symbol = *peek_next();
 
     if (!tok_is(peek_current(), '['))
         weak_compile_error(
-            symbol->line_no,
-            symbol->col_no,
+            symbol.line_no,
+            symbol.col_no,
             "`[` expected"
         );
 
-    ast_array_t access_list = {0};
+    uint64_t base = list_base();
 
     while (tok_is(peek_current(), '[')) {
         require_char('[');
-        vector_push_back(access_list, parse_expr());
+        struct ast_node *index = parse_expr();
+        vector_push_back(list_nodes, index);
         require_char(']');
     }
 
-    struct ast_node *args = ast_compound_init(
-        access_list.count,
-        access_list.data,
-        symbol->line_no,
-        symbol->col_no
-    );
+    struct ast_node *args = list_compound(base, symbol.line_no, symbol.col_no);
 
     return ast_array_access_init(
-        strdup(symbol->data),
+        symbol.data,
         args,
-        symbol->line_no,
-        symbol->col_no
+        symbol.line_no,
+        symbol.col_no
     );
 }
 
@@ -1259,83 +1482,47 @@ static struct ast_node *parse_expr()
 
 static struct ast_node *parse_assignment()
 {
-    struct ast_node *expr = parse_logical_or();
-
-    while (1) {
-        struct token *t = peek_next();
-
-        switch (t->type) {
-        case TOK_ASSIGN:
-        case TOK_MUL_ASSIGN:
-        case TOK_DIV_ASSIGN:
-        case TOK_MOD_ASSIGN:
-        case TOK_PLUS_ASSIGN:
-        case TOK_MINUS_ASSIGN:
-        case TOK_SHL_ASSIGN:
-        case TOK_SHR_ASSIGN:
-        case TOK_BIT_AND_ASSIGN:
-        case TOK_BIT_OR_ASSIGN:
-        case TOK_XOR_ASSIGN: /* Fall through. */
-            expr = ast_binary_init(
-                t->type,
-                expr,
-                parse_assignment(),
-                t->line_no,
-                t->col_no
-            );
-            continue;
-        default:
-            --tok_begin;
-            break;
-        }
-        break;
-    }
-
-    return expr;
+    return parse_binary(PREC_ASSIGN);
 }
 
 static struct ast_node *parse_function_call()
 {
-    struct token *name = peek_next();
+    struct token  name = *peek_next();
 
-    ast_array_t args_list = {0};
+    uint64_t      base = list_base();
 
     require_char('(');
 
     if (tok_is(peek_next(), ')'))
         return ast_fn_call_init(
-            strdup(name->data),
+            name.data,
             ast_compound_init(
                 0,
                 NULL,
-                name->line_no,
-                name->col_no
+                name.line_no,
+                name.col_no
             ),
-            name->line_no,
-            name->col_no
+            name.line_no,
+            name.col_no
         );
 
-    --tok_begin;
+    --tok_pos;
     while (!tok_is(peek_current(), ')')) {
-        vector_push_back(args_list, parse_logical_or());
+        struct ast_node *arg = parse_logical_or();
+        vector_push_back(list_nodes, arg);
         if (tok_is(peek_current(), ','))
             require_char(',');
     }
 
     require_char(')');
 
-    struct ast_node *args = ast_compound_init(
-        args_list.count,
-        args_list.data,
-        name->line_no,
-        name->col_no
-    );
+    struct ast_node *args = list_compound(base, name.line_no, name.col_no);
 
     return ast_fn_call_init(
-        strdup(name->data),
+        name.data,
         args,
-        name->line_no,
-        name->col_no
+        name.line_no,
+        name.col_no
     );
 }
 
@@ -1349,7 +1536,7 @@ static struct ast_node *parse_constant()
     case TOK_FLOAT_LITERAL:
         return ast_float_init(atof(t->data), t->line_no, t->col_no);
     case TOK_STRING_LITERAL:
-        return ast_string_init(strlen(t->data), strdup(t->data), t->line_no, t->col_no);
+        return ast_string_init(strlen(t->data), t->data, t->line_no, t->col_no);
     case TOK_CHAR_LITERAL:
         return ast_char_init(t->data[0], t->line_no, t->col_no);
     case TOK_TRUE:
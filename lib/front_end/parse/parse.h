@@ -7,12 +7,30 @@
 #ifndef WEAK_COMPILER_FRONTEND_PARSE_PARSE_H
 #define WEAK_COMPILER_FRONTEND_PARSE_PARSE_H
 
-#include "front_end/lex/tok.h"
+#include "front_end/lex/tok_array.h"
 #include "util/compiler.h"
 
 struct ast_node;
+struct source;
 
+/** Parse array of all tokens of input. Source of tokens
+    should be open.
+
+    \note Large inputs are parsed by parse_parallel() with
+          thread per available CPU. */
+wur
+struct ast_node *parse(const tok_array_t *toks);
+
+/** Split tokens into global declarations and parse groups
+    of them on `threads` threads. Resulting tree and reported
+    error are the same as of serial parsing. */
+wur
+struct ast_node *parse_parallel(const tok_array_t *toks, uint32_t threads);
+
+/** Parse tokens pulled by native lexer on demand. Tokens
+    are kept in bounded window (see tok_stream.h), so
+    memory used for them does not depend on input size. */
 wur
-struct ast_node *parse(const struct token *begin, const struct token *end);
+struct ast_node *parse_source(struct source *s);
 
 #endif // WEAK_COMPILER_FRONTEND_PARSE_PARSE_H
\ No newline at end of file
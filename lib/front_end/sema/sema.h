@@ -9,6 +9,9 @@
 
 struct ast_node;
 
+/* Both passes allocate new nodes from arena owning the
+   tree, if it has one (see ast_arena_of()). */
+
 /** Decrease abstraction level of AST.
    
     1. Replace range-based for loop with usual. */
@@ -4,24 +4,21 @@
  * This file is distributed under the MIT license.
  */
 
+#include "front_end/anal/sym_table.h"
 #include "front_end/ast/ast.h"
 #include "front_end/sema/sema.h"
 #include "util/alloc.h"
-#include "util/hashmap.h"
-#include "util/crc32.h"
+#include "util/intern.h"
 #include "util/unreachable.h"
 #include <assert.h>
 #include <string.h>
 
-
-#define DECL_NAME_MAX_LEN 256
-
 /* \note: Functions cannot return array.
           Function takes array as parameter via pointer.
           Array can be declared as variable. */
 struct array_decl_info {
     struct ast_node     *ast;
-    char                 name[DECL_NAME_MAX_LEN];
+    const char          *name;
     enum data_type       dt;
     /* If the array is
       
@@ -35,39 +32,30 @@ struct array_decl_info {
     uint64_t             depth;
 };
 
-static uint64_t  scope_depth;
-static hashmap_t storage;
+static _Thread_local struct sym_table storage;
 
 static void storage_init()
 {
-    scope_depth = 0;
-    hashmap_init(&storage, 100);
+    sym_table_init(&storage);
 }
 
 static void storage_reset()
 {
-    scope_depth = 0;
-    hashmap_foreach(&storage, key, val) {
-        (void) key;
-        struct array_decl_info *decl = (struct array_decl_info *) val;
-        weak_free(decl);
-    }
-    hashmap_destroy(&storage);
+    sym_table_foreach(&storage, b)
+        weak_free(b->data);
+    sym_table_free(&storage);
 }
 
 static void storage_start_scope()
 {
-    ++scope_depth;
+    sym_table_start_scope(&storage);
 }
 
 static void storage_end_scope()
 {
-    hashmap_foreach(&storage, key, val) {
-        struct array_decl_info *decl = (struct array_decl_info *) val;
-        if (decl->depth == scope_depth)
-            hashmap_remove(&storage, key);
-    }
-    --scope_depth;
+    sym_table_scope_foreach(&storage, b)
+        weak_free(b->data);
+    sym_table_end_scope(&storage);
 }
 
 static void storage_put(
@@ -78,27 +66,21 @@ static void storage_put(
 ) {
     struct array_decl_info *decl = weak_calloc(1, sizeof (struct array_decl_info));
 
-    strncpy(decl->name, name, DECL_NAME_MAX_LEN - 1);
+    decl->name = name;
     decl->ast = ast;
     decl->dt = dt;
     decl->top_arity = top_arity;
-    hashmap_put(&storage, crc32_string(name), (uint64_t) decl);
+    decl->depth = sym_table_depth(&storage);
+    sym_table_put(&storage, name, decl);
 }
 
 static struct array_decl_info *storage_lookup(const char *name)
 {
-    uint64_t hash = crc32_string(name);
-    bool     ok   = 0;
-    int64_t  addr = hashmap_get(&storage, hash, &ok);
+    struct array_decl_info *decl = sym_table_get(&storage, name);
 
-    if (!ok || addr == 0)
+    if (!decl)
         weak_unreachable("Could not find variable `%s`.", name);
 
-    struct array_decl_info *decl = (struct array_decl_info *) addr;
-
-    if (decl->depth > scope_depth)
-        weak_unreachable("Impossible case: variable depth > current depth");
-
     return decl;
 }
 
@@ -270,7 +252,7 @@ really_inline static void assertion(
 
 really_inline static struct ast_node **make_index(const char *name)
 {
-    struct ast_node *idx = ast_sym_init(strdup(name), 0, 0);
+    struct ast_node *idx = ast_sym_init(name, 0, 0);
     struct ast_node **idxs = weak_calloc(1, sizeof (struct ast_node *));
     idxs[0] = idx;
 
@@ -279,12 +261,12 @@ really_inline static struct ast_node **make_index(const char *name)
 
 really_inline static struct ast_node *make_iter_index(
     const char *__i,
-    uint16_t    line_no,
-    uint16_t    col_no
+    uint32_t    line_no,
+    uint32_t    col_no
 ) {
     return ast_var_decl_init(
         D_T_INT,
-        strdup(__i),
+        __i,
         /*type_name*/NULL,
         /*ptr_depth=*/0,
         ast_int_init(0, line_no, col_no),
@@ -303,7 +285,7 @@ really_inline static void make_iter_ptr_body(
         AST_PREFIX_UNARY,
         TOK_BIT_AND,
         ast_array_access_init(
-            strdup(decl->name),
+            decl->name,
             ast_compound_init(
                 1,
                 make_index(__i),
@@ -354,9 +336,10 @@ static void visit_for_range(struct ast_node **ast)
 
     assertion(range, decl);
 
-    static int32_t i = 0;
-    char __i[256] = {0};
-    snprintf(__i, sizeof (__i), "__i%d", ++i);
+    static _Thread_local int32_t i = 0;
+    char buf[256] = {0};
+    snprintf(buf, sizeof (buf), "__i%d", ++i);
+    const char *__i = intern(buf);
 
     struct ast_node *iterator = make_iter_index(__i, iter->line_no, iter->col_no);
 
@@ -372,23 +355,23 @@ static void visit_for_range(struct ast_node **ast)
 
     make_iter_ptr_body(decl, iter, __i);
 
-    weak_free(body->stmts);
+    ast_free(body->stmts);
     ast_node_cleanup(target);
-    weak_free((*ast)->ast);
-    weak_free((*ast));
+    ast_free((*ast)->ast);
+    ast_free((*ast));
 
     *ast = ast_for_init(
         iterator,
         ast_binary_init(
             TOK_LT,
-            ast_sym_init(strdup(__i), 0, 0),
+            ast_sym_init(__i, 0, 0),
             ast_int_init(decl->top_arity, 0, 0),
             0, 0
         ),
         ast_unary_init(
             AST_PREFIX_UNARY,
             TOK_INC,
-            ast_sym_init(strdup(__i), 0, 0),
+            ast_sym_init(__i, 0, 0),
             0, 0
         ),
         enlarged_body,
@@ -423,7 +406,12 @@ static void visit(struct ast_node **ast)
 
 void sema_lower(struct ast_node **ast)
 {
+    /* New nodes belong to the tree. */
+    struct arena *prev = ast_arena_set(ast_arena_of(*ast));
+
     storage_init();
     visit(ast);
     storage_reset();
+
+    ast_arena_set(prev);
 }
\ No newline at end of file
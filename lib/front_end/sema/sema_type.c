@@ -12,10 +12,10 @@
 #include <assert.h>
 #include <stdio.h>
 
-static enum data_type fn_ret_type;
-static enum data_type last_type;
+static _Thread_local enum data_type fn_ret_type;
+static _Thread_local enum data_type last_type;
 
-static fn_storage_t fn_storage;
+static _Thread_local fn_storage_t fn_storage;
 
 static void init()
 {
@@ -345,7 +345,12 @@ static void visit(struct ast_node **ast)
  **********************************************/
 void sema_type(struct ast_node **ast)
 {
+    /* Casts belong to the tree. */
+    struct arena *prev = ast_arena_set(ast_arena_of(*ast));
+
     init();
     visit(ast);
     reset();
+
+    ast_arena_set(prev);
 }
\ No newline at end of file
@@ -11,33 +11,34 @@
 
 /* Key:   ir
    Value: sym_idx */
-static hashmap_t stores;
+static _Thread_local hashmap_t stores;
 
 
 
-static void ddg_add_dependency(struct ir_node *ir, struct ir_node *symbol)
+static void ddg_add_dependency(struct ir_fn_decl *decl, struct ir_node *ir, struct ir_node *symbol)
 {
     if (symbol->type != IR_SYM) return;
 
-    struct ir_sym *sym = symbol->ir;
+    struct ir_sym *sym  = symbol->ir;
+    ir_vector_t   *ddgs = ir_ddg(decl, ir);
 
     hashmap_foreach(&stores, k, v) {
         if (v == (uint64_t) sym->idx) {
             struct ir_node *node = (struct ir_node *) k;
-            vector_push_back(ir->ddg_stmts, node);
+            vector_push_back(*ddgs, node);
         }
     }
 }
 
-static void ddg_bin(struct ir_node *ir, struct ir_node *ir_bin)
+static void ddg_bin(struct ir_fn_decl *decl, struct ir_node *ir, struct ir_node *ir_bin)
 {
     struct ir_bin *bin = ir_bin->ir;
 
-    ddg_add_dependency(ir, bin->lhs);
-    ddg_add_dependency(ir, bin->rhs);
+    ddg_add_dependency(decl, ir, bin->lhs);
+    ddg_add_dependency(decl, ir, bin->rhs);
 }
 
-static void ddg_node(struct ir_node *ir)
+static void ddg_node(struct ir_fn_decl *decl, struct ir_node *ir)
 {
     switch (ir->type) {
     case IR_ALLOCA: {
@@ -53,23 +54,23 @@ static void ddg_node(struct ir_node *ir)
         }
 
         if (store->body->type == IR_BIN)
-            ddg_bin(ir, store->body);
+            ddg_bin(decl, ir, store->body);
 
         if (store->body->type == IR_SYM)
-            ddg_add_dependency(ir, store->body);
+            ddg_add_dependency(decl, ir, store->body);
 
         break;
     }
     case IR_COND: {
         struct ir_cond *cond = ir->ir;
         assert(cond->cond->type == IR_BIN);
-        ddg_bin(ir, cond->cond);
+        ddg_bin(decl, ir, cond->cond);
         break;
     }
     case IR_RET: {
         struct ir_ret *ret = ir->ir;
         if (ret->body && ret->body->type == IR_SYM)
-            ddg_add_dependency(ir, ret->body);
+            ddg_add_dependency(decl, ir, ret->body);
         break;
     }
     default:
@@ -77,14 +78,10 @@ static void ddg_node(struct ir_node *ir)
     }
 }
 
-static void ddg_cleanup(struct ir_node *ir)
+static void ddg_cleanup(struct ir_fn_decl *decl)
 {
-    struct ir_node *it = ir;
-
-    while (it) {
-        vector_clear(it->ddg_stmts);
-        it = it->next;
-    }
+    for (uint64_t i = 0; i < decl->ddg_size; ++i)
+        vector_clear(decl->ddg[i]);
 }
 
 static int qsort_cmp(const void *lhs, const void *rhs)
@@ -95,10 +92,12 @@ static int qsort_cmp(const void *lhs, const void *rhs)
     return l->instr_idx - r->instr_idx;
 }
 
-static void ddg_sort(struct ir_node *ir)
+static void ddg_sort(struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    ir_vector_t *ddgs = &ir->ddg_stmts;
-    qsort(ddgs->data, ddgs->count, sizeof (struct ir_node *), qsort_cmp);
+    ir_vector_t *ddgs = ir_ddg(decl, ir);
+
+    if (ddgs->count > 1)
+        qsort(ddgs->data, ddgs->count, sizeof (struct ir_node *), qsort_cmp);
 }
 
 void ir_ddg_build(struct ir_fn_decl *decl)
@@ -107,16 +106,16 @@ void ir_ddg_build(struct ir_fn_decl *decl)
 
     hashmap_reset(&stores, 512);
 
-    ddg_cleanup(it);
+    ddg_cleanup(decl);
 
     while (it) {
-        ddg_node(it);
+        ddg_node(decl, it);
         it = it->next;
     }
 
     it = decl->body;
     while (it) {
-        ddg_sort(it);
+        ddg_sort(decl, it);
         it = it->next;
     }
 
@@ -125,8 +124,9 @@ void ir_ddg_build(struct ir_fn_decl *decl)
 
         while (it) {
             printf("For instr %lu, Required by = (", it->instr_idx);
-            vector_foreach(it->ddg_stmts, i) {
-                struct ir_node *stmt = vector_at(it->ddg_stmts, i);
+            ir_vector_t *ddgs = ir_ddg(decl, it);
+            vector_foreach(*ddgs, i) {
+                struct ir_node *stmt = vector_at(*ddgs, i);
                 printf("%lu ", stmt->instr_idx);
             }
             printf(")\n");
@@ -6,263 +6,292 @@
 
 #include "middle_end/ir/dom.h"
 #include "middle_end/ir/ir.h"
-#include <string.h>
-
-#define MAX_VERTICES 512
-
-#define MIN(a,b) (((a)<(b))?(a):(b))
-
-static vector_t(int) graph        [MAX_VERTICES];
-static vector_t(int) reverse_graph[MAX_VERTICES];
-/* semidoms[u] = {v | sdom[v] = u} */
-static vector_t(int) semidoms     [MAX_VERTICES];
-
-static uint64_t visit_time        [MAX_VERTICES];
-static uint64_t inverse_visit_time[MAX_VERTICES];
-static uint64_t parent_in_dfs_tree[MAX_VERTICES];
-static uint64_t semidom           [MAX_VERTICES];
-static uint64_t idom              [MAX_VERTICES];
-static uint64_t union_find        [MAX_VERTICES];
-static uint64_t path_compression  [MAX_VERTICES];
-
-static uint64_t dfs_index;
+#include "util/alloc.h"
+
+/* State of SEMI-NCA algorithm for one function.
+
+   Reachable blocks are numbered from 1 in DFS preorder, 0 means
+   not visited. All arrays except `preorder` are indexed by this
+   number, so they take memory proportional to number of blocks
+   and are allocated once per function. */
+struct dom_state {
+    /** Number of each block, indexed by ir_block.idx. */
+    uint64_t         *preorder;
+    /** Block of each number. */
+    struct ir_block **vertex;
+    /** Parent in DFS tree. Becomes ancestor in forest made by
+        path compression, see eval(). */
+    uint64_t         *ancestor;
+    uint64_t         *semi;
+    /** Vertex with minimal semidominator on compressed path. */
+    uint64_t         *label;
+    uint64_t         *idom;
+    /** Next successor to visit by DFS. */
+    uint64_t         *succ_iter;
+    /** Explicit stack for DFS and path compression, so depth
+        of CFG does not touch call stack. */
+    uint64_t         *stack;
+    uint64_t          size;
+};
 
-static void dom_tree_reset_state()
+static void dom_state_init(struct dom_state *s, uint64_t blocks)
 {
-    for (uint64_t i = 0; i < MAX_VERTICES; ++i) {
-        vector_free(graph[i]);
-        vector_free(reverse_graph[i]);
-        vector_free(semidoms[i]);
-    }
+    uint64_t  n   = blocks + 1;
+    uint64_t *mem = weak_calloc(n * 7, sizeof (uint64_t));
+
+    s->vertex    = weak_calloc(n, sizeof (struct ir_block *));
+    s->preorder  = mem;
+    s->ancestor  = mem + n;
+    s->semi      = mem + n * 2;
+    s->label     = mem + n * 3;
+    s->idom      = mem + n * 4;
+    s->succ_iter = mem + n * 5;
+    s->stack     = mem + n * 6;
+    s->size      = 0;
+}
 
-    memset(graph,              0, sizeof (graph));
-    memset(reverse_graph,      0, sizeof (reverse_graph));
-    memset(semidoms,           0, sizeof (semidoms));
-    memset(visit_time,         0, sizeof (visit_time));
-    memset(inverse_visit_time, 0, sizeof (inverse_visit_time));
-    memset(parent_in_dfs_tree, 0, sizeof (parent_in_dfs_tree));
-    memset(semidom,            0, sizeof (semidom));
-    memset(idom,               0, sizeof (idom));
-    memset(union_find,         0, sizeof (union_find));
-    memset(path_compression,   0, sizeof (path_compression));
-
-    dfs_index = 0;
+static void dom_state_cleanup(struct dom_state *s)
+{
+    weak_free(s->vertex);
+    weak_free(s->preorder);
 }
 
-struct edge {
-    uint64_t from;
-    uint64_t to;
-};
+static void visit(struct dom_state *s, struct ir_block *b, uint64_t parent)
+{
+    uint64_t v = ++s->size;
+
+    s->preorder[b->idx] = v;
+    s->vertex  [v]      = b;
+    s->ancestor[v]      = parent;
+    s->idom    [v]      = parent;
+    s->semi    [v]      = v;
+    s->label   [v]      = v;
+}
 
-struct edge least_semidom(uint64_t u)
+/* Preorder numbering of blocks reachable from entry. Successors
+   are visited in order, the same as by recursive walk. */
+static void dfs(struct dom_state *s, struct ir_block *entry)
 {
-    if (u == union_find[u]) {
-        struct edge e = {
-            .from = u,
-            .to   = u
-        };
-        return e;
-    }
+    uint64_t sp = 0;
 
-    struct edge got = least_semidom(union_find[u]);
-    uint64_t p      = got.from;
-    union_find[u]   = got.to;
+    visit(s, entry, 0);
+    s->stack[sp++] = 1;
 
-    if (semidom[p] < semidom[path_compression[u]])
-        path_compression[u] = p;
+    while (sp > 0) {
+        uint64_t         v = s->stack[sp - 1];
+        struct ir_block *b = s->vertex[v];
 
-    struct edge e = {
-        .from = path_compression[u],
-        .to   = union_find[u]
-    };
+        if (s->succ_iter[v] == b->succs.count) {
+            --sp;
+            continue;
+        }
 
-    return e;
-}
+        struct ir_block *succ = vector_at(b->succs, s->succ_iter[v]++);
 
-/* Topological sort. */
-void dfs(uint64_t u)
-{
-    visit_time[u] = ++dfs_index;
-    inverse_visit_time[dfs_index] = u;
-
-    vector_foreach(graph[u], i) {
-        uint64_t v = vector_at(graph[u], i);
-        if (!visit_time[v]) {
-            dfs(v);
-            parent_in_dfs_tree[visit_time[v]] = visit_time[u];
-        }
+        if (s->preorder[succ->idx])
+            continue;
+
+        visit(s, succ, v);
+        s->stack[sp++] = s->size;
     }
 }
 
-/* https://www.cs.princeton.edu/courses/archive/fall03/cs528/handouts/a%20fast%20algorithm%20for%20finding.pdf
-   https://baziotis.cs.illinois.edu/compilers/semidominators-proof.html
-   https://www.cs.utexas.edu/users/misra/Lengauer+Tarjan.pdf
+/* Vertex with minimal semidominator on path from `v` to root
+   of its tree in forest. Vertices with numbers from
+   `last_linked` are already processed and linked to their
+   parents. Path is compressed, so each vertex later points
+   right to the root. */
+static uint64_t eval(struct dom_state *s, uint64_t v, uint64_t last_linked)
+{
+    uint64_t sp = 0;
 
-    The union find and path compression techniques are used
-    to speed up algorithm.
+    if (s->ancestor[v] < last_linked)
+        return s->label[v];
 
-    If v < u then v visited before u.
-    If v < u then v is ancestor of u in DFS tree. */
-void dom_tree()
-{
-    /* Step 1 already executed by performing DFS. */
-
-    /* Each node dominates itself. */
-    for (uint64_t i = 1; i <= dfs_index; ++i) {
-        semidom         [i] = i;
-        idom            [i] = i;
-        union_find      [i] = i;
-        path_compression[i] = i;
+    do {
+        s->stack[sp++] = v;
+        v = s->ancestor[v];
+    } while (s->ancestor[v] >= last_linked);
+
+    uint64_t p       = v;
+    uint64_t p_label = s->label[p];
+
+    while (sp > 0) {
+        v = s->stack[--sp];
+        s->ancestor[v] = s->ancestor[p];
+
+        if (s->semi[p_label] < s->semi[s->label[v]])
+            s->label[v] = p_label;
+        else
+            p_label = s->label[v];
+
+        p = v;
     }
 
-    /* Traverse results of topological sort in reverse order. */
-    for (uint64_t u = dfs_index; u >= 1; --u) {
+    return s->label[v];
+}
 
-        /* Step 2: Compute semidominators by applying
+/* SEMI-NCA algorithm.
 
-                   sdom(w) = min({
-                                       v | (v, w) in E && v < w 
-                                 } U {
-                                       sdom(u) | u > w && E edge (v, w)
-                                       such as there is path from u to v
-                                 }) */
-        vector_foreach(reverse_graph[inverse_visit_time[u]], i) {
-            uint64_t v = vector_at(reverse_graph[inverse_visit_time[u]], i);
-            v = visit_time[v];
+   https://www.cs.princeton.edu/courses/archive/fall03/cs528/handouts/a%20fast%20algorithm%20for%20finding.pdf
+   L. Georgiadis et al., Finding Dominators in Practice, JGAA 10(1), 2006.
 
-            /* if (v == 0)
-                continue; */
+   Semidominators are computed as in Lengauer-Tarjan algorithm,
+   but immediate dominator of each vertex is then found as
+   nearest common ancestor of its semidominator and its parent
+   in dominator tree built so far.
 
-            if (v < u)
-                semidom[u] = MIN(semidom[u], semidom[v]);
-            else
-                semidom[u] = MIN(semidom[u], semidom[least_semidom(v).from]);
-        }
-        vector_push_back(semidoms[semidom[u]], u);
+   If v < u then v visited before u. */
+static void dom_tree(struct dom_state *s)
+{
+    /* Semidominator of `w` is minimal vertex, from which
+       `w` is reached by path of vertices greater than `w`. */
+    for (uint64_t w = s->size; w >= 2; --w) {
+        struct ir_block *b = s->vertex[w];
 
-        /* Step 3: Define the immediate dominators. */
-        vector_foreach(semidoms[u], i) {
-            uint64_t v    = vector_at(semidoms[u], i);
-            uint64_t best = least_semidom(v).from;
+        s->semi[w] = s->ancestor[w];
 
-            if (semidom[best] >= u)
-                idom[v] = u;
-            else
-                idom[v] = best;
-        }
+        vector_foreach(b->preds, i) {
+            uint64_t v = s->preorder[vector_at(b->preds, i)->idx];
 
-        vector_foreach(graph[inverse_visit_time[u]], i) {
-            uint64_t v = vector_at(graph[inverse_visit_time[u]], i);
-            v = visit_time[v];
+            /* Edge from block not reachable from entry. */
+            if (v == 0)
+                continue;
 
-            /* if (v == 0)
-                continue; */
+            uint64_t u = eval(s, v, w + 1);
 
-            if (parent_in_dfs_tree[v] == u)
-                union_find[v] = u;
+            if (s->semi[u] < s->semi[w])
+                s->semi[w] = s->semi[u];
         }
     }
 
-    /* Step 4: ??? */
-    for (uint64_t i = 1; i <= dfs_index; ++i)
-        if (idom[i] != semidom[i])
-            idom[i]  = idom[idom[i]];
-}
+    /* Vertices are taken in preorder, so dominator tree is
+       already built above parent of `w`. Walk up from parent
+       to first vertex not greater than semidominator. */
+    for (uint64_t w = 2; w <= s->size; ++w) {
+        uint64_t idom = s->idom[w];
 
-/* Put IR nodes to static array. Used in this specific dominator
-   tree algorithm.
+        while (idom > s->semi[w])
+            idom = s->idom[idom];
 
-   Returns number of added items. */
-static uint64_t dom_tree_fill(struct ir_node *it, struct ir_node **stmts)
-{
-    uint64_t cnt = 0;
+        s->idom[w] = idom;
+    }
 
-    while (it) {
-        stmts[it->instr_idx] = it;
+    /* Entry dominates itself. */
+    s->idom[1] = 1;
+}
 
-        vector_foreach(it->cfg.succs, i) {
-            uint64_t u = it->instr_idx;
-            uint64_t v = vector_at(it->cfg.succs, i)->instr_idx;
+/* Dominators of statements follow from dominators of blocks.
+   Leader is immediately dominated by last statement of
+   dominating block, other statements by previous one.
 
-            vector_push_back(graph[u], v);
-            vector_push_back(reverse_graph[v], u);
-        }
-
-        it = it->next;
-        ++cnt;
+   Statements of blocks not reachable from entry are
+   immediately dominated by first statement. */
+static void dom_tree_stmts(struct ir_fn_decl *decl)
+{
+    for (struct ir_node *prev = NULL, *it = decl->body; it; prev = it, it = it->next) {
+        struct ir_block *b   = ir_block(decl, it);
+        struct ir_node  *dom = NULL;
+
+        if (!b->idom)
+            dom = decl->body;
+        else if (it != b->first)
+            dom = prev;
+        else if (b->idom == b)
+            dom = it;
+        else
+            dom = b->idom->last;
+
+        ir_dom(decl, it)->idom = dom;
     }
-
-    return cnt;
 }
 
 void ir_dominator_tree(struct ir_fn_decl *decl)
 {
-    struct ir_node *it                  = decl->body;
-    struct ir_node *stmts[MAX_VERTICES] = {0};
+    struct dom_state s = {0};
 
-    dom_tree_reset_state();
+    if (decl->blocks.count == 0)
+        return;
 
-    uint64_t stmts_cnt = dom_tree_fill(it, stmts);
+    dom_state_init(&s, decl->blocks.count);
+    dfs(&s, vector_at(decl->blocks, 0));
+    dom_tree(&s);
 
-    dfs(0);
-    dom_tree();
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *b = vector_at(decl->blocks, i);
+        uint64_t         v = s.preorder[i];
 
-    for (uint64_t i = 0; i < stmts_cnt; ++i) {
-        uint64_t        idom_idx = inverse_visit_time[idom[visit_time[i]]];
-        struct ir_node *stmt     = stmts[i];
-        struct ir_node *dom      = stmts[idom_idx];
+        vector_free(b->idom_back);
+        b->idom = v ? s.vertex[s.idom[v]] : NULL;
+    }
+
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *b = vector_at(decl->blocks, i);
 
-        stmt->idom = dom;
-        vector_push_back(dom->idom_back, stmt);
+        if (b->idom && b->idom != b)
+            vector_push_back(b->idom->idom_back, b);
     }
+
+    dom_state_cleanup(&s);
+    dom_tree_stmts(decl);
 }
 
 /* Cooper algorithm
    https://www.cs.tufts.edu/comp/150FP/archive/keith-cooper/dom14.pdf */
 void ir_dominance_frontier(struct ir_fn_decl *decl)
 {
-    struct ir_node *b = decl->body;
+    vector_foreach(decl->blocks, i)
+        vector_free(vector_at(decl->blocks, i)->df);
 
-    while (b) {
-        if (b->cfg.preds.count >= 2) {
-            vector_foreach(b->cfg.preds, pred_i) {
-                struct ir_node *p = vector_at(b->cfg.preds, pred_i);
-                struct ir_node *runner = p;
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *b = vector_at(decl->blocks, i);
 
-                while (runner != b->idom) {
-                    vector_push_back(runner->df, b);
+        if (b->preds.count < 2 || !b->idom)
+            continue;
 
-                    /* Upper statement is reached. */
-                    if (runner == runner->idom)
-                        break;
+        vector_foreach(b->preds, pred_i) {
+            struct ir_block *runner = vector_at(b->preds, pred_i);
 
-                    runner = runner->idom;
-                }
+            if (!runner->idom)
+                continue;
+
+            while (runner != b->idom) {
+                vector_push_back(runner->df, b);
+
+                /* Entry block is reached. */
+                if (runner == runner->idom)
+                    break;
+
+                runner = runner->idom;
             }
         }
-
-        b = b->next;
     }
 }
 
-bool ir_dominated_by(struct ir_node *node, struct ir_node *dom)
+bool ir_dominated_by(struct ir_fn_decl *decl, struct ir_node *node, struct ir_node *dom)
 {
-    if (node == dom) return 1;
-
-    while (node && node != node->idom) {
-        node = node->idom;
-        if (node == dom) return 1;
-    }
-    return 0;
+    return ir_dominates(decl, dom, node);
 }
 
-bool ir_dominates(struct ir_node *dom, struct ir_node *node)
+bool ir_dominates(struct ir_fn_decl *decl, struct ir_node *dom, struct ir_node *node)
 {
     if (dom == node) return 1;
 
-    while (node && node != node->idom) {
-        node = node->idom;
-        if (node && node == dom) return 1;
+    struct ir_block *a = ir_block(decl, dom);
+    struct ir_block *b = ir_block(decl, node);
+
+    if (!a || !b) return 0;
+
+    /* Inside block statement dominates all following. */
+    if (a == b) {
+        for (struct ir_node *it = dom; it != b->last; it = it->next)
+            if (it->next == node) return 1;
+        return 0;
+    }
+
+    while (b->idom && b != b->idom) {
+        b = b->idom;
+        if (b == a) return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
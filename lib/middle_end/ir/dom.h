@@ -13,14 +13,24 @@
 struct ir_node;
 struct ir_fn_decl;
 
+/** Compute immediate dominators of \p decl basic blocks
+    and statements. Result is stored in blocks and in
+    dominator table of \p decl, see ir_dom().
+
+    Uses SEMI-NCA algorithm. Memory is allocated per call
+    and is linear in number of blocks.
+
+    \note Requires blocks made by ir_cfg_build(). */
 void ir_dominator_tree(struct ir_fn_decl *decl);
 
+/** Compute dominance frontier of each basic block of
+    \p decl. Requires dominator tree. */
 void ir_dominance_frontier(struct ir_fn_decl *decl);
 
 /** Judge of \p node is dominated by \p dom. */
-bool ir_dominated_by(struct ir_node *node, struct ir_node *dom);
+bool ir_dominated_by(struct ir_fn_decl *decl, struct ir_node *node, struct ir_node *dom);
 
 /** Judge if \p dom is dominator of \p node. */
-bool ir_dominates(struct ir_node *dom, struct ir_node *node);
+bool ir_dominates(struct ir_fn_decl *decl, struct ir_node *dom, struct ir_node *node);
 
 #endif // WEAK_COMPILER_MIDDLE_END_DOM_H
\ No newline at end of file
@@ -5,46 +5,54 @@
  */
 
 #include "middle_end/ir/gen.h"
-#include "front_end/ast/ast.h"
+#include "front_end/ast/ast_flat.h"
 #include "middle_end/ir/ir.h"
 #include "middle_end/ir/storage.h"
-#include "util/crc32.h"
+#include "util/alloc.h"
+#include "util/intern.h"
 #include "util/hashmap.h"
+#include "util/thread.h"
 #include "util/unreachable.h"
 #include "util/vector.h"
 #include <assert.h>
 #include <string.h>
 
 /* Total list of functions. */
-static ir_vector_t        ir_fn_decls;
-static struct ir_node    *ir_first;
-static struct ir_node    *ir_last;
-static struct ir_node    *ir_prev;
+static _Thread_local ir_vector_t        ir_fn_decls;
+static _Thread_local struct ir_node    *ir_first;
+static _Thread_local struct ir_node    *ir_last;
+static _Thread_local struct ir_node    *ir_prev;
 /* Our IR is designed to store a lot of implicit information
    and our language is not simply stack-based, when we can
    pop last two generated instructions and always know their
    type.
    So there is a type of last created instruction (if any),
-   and mapping between symbol index and type. */
-static enum data_type     ir_last_type;
-static struct type        ir_type_map[65536];
+   and mapping between symbol index and type.
+
+   Map is allocated for each ir_gen() call, since it is
+   too large for thread-local storage, and grows with
+   number of symbols in function. */
+#define IR_TYPE_MAP_SIZE 65536
+static _Thread_local enum data_type     ir_last_type;
+static _Thread_local struct type       *ir_type_map;
+static _Thread_local uint64_t           ir_type_map_size;
 /* Used to count alloca instructions.
    Conditions:
    - reset_state at the start of each function declaration,
    - increments with every created alloca instruction. */
-static uint64_t           ir_var_idx;
-static bool               ir_save_first;
-static bool               ir_meta_is_loop;
+static _Thread_local uint64_t           ir_var_idx;
+static _Thread_local bool               ir_save_first;
+static _Thread_local bool               ir_meta_is_loop;
 /* Depth of source-level blocks ({ ... }). */
-static uint64_t           ir_block_depth;
+static _Thread_local uint64_t           ir_block_depth;
 /* Loop index in function boundaries. If loop is nested,
    index is incremented sequentially. */
-static uint64_t           ir_loop_idx;
-static uint64_t           ir_meta_loop_idx;
+static _Thread_local uint64_t           ir_loop_idx;
+static _Thread_local uint64_t           ir_meta_loop_idx;
 /* This used to judge if we should put function call to IR list
    or use it as instruction operand. */
-static bool               ir_is_global_scope;
-static hashmap_t          ir_fn_return_types;
+static _Thread_local bool               ir_is_global_scope;
+static _Thread_local hashmap_t          ir_fn_return_types;
 /* This is stacks for `break` and `continue` instructions.
    On the top of stack sits most recent loop (loop with maximum
    current depth). This complication used to store correct states
@@ -54,23 +62,45 @@ static hashmap_t          ir_fn_return_types;
      - break   , jumps to the first statement after current loop.
      - continue, jumps to the loop header (for, while, do-while conditions).
   
-   Note, that there is no stack for continue statements. Indices for them
-   computed immediately from `ir_loop_header_stack`. */
-static ir_vector_t        ir_break_stack;
-static vector_t(uint64_t) ir_loop_header_stack;
+   Each loop has one label for all its `break` and one for all
+   its `continue` statements. Label of loop header is shared
+   with the jump to the next iteration. */
+static _Thread_local ir_label_vector_t  ir_break_stack;
+static _Thread_local ir_label_vector_t  ir_loop_header_stack;
+/* Labels of statement which is not emitted yet. Jumps
+   forward get target when next statement is inserted. */
+static _Thread_local ir_label_vector_t  ir_pending_labels;
+/* Labels bound in current function. Given to its
+   declaration. */
+static _Thread_local ir_label_vector_t  ir_fn_labels;
+/* Tree being translated and walk over it. */
+static _Thread_local const struct ast_flat *ir_ast;
+static _Thread_local struct ast_flat_walk   ir_walk;
+
+static uint64_t next_var_idx()
+{
+    if (ir_var_idx == ir_type_map_size) {
+        uint64_t size = ir_type_map_size * 2;
+
+        ir_type_map = weak_realloc(ir_type_map, size * sizeof (*ir_type_map));
+        memset(ir_type_map + ir_type_map_size, 0, ir_type_map_size * sizeof (*ir_type_map));
+        ir_type_map_size = size;
+    }
+
+    return ir_var_idx++;
+}
 
-static void store_return_type(const char *name, enum data_type dt)
+static void store_return_type(uint32_t name_id, enum data_type dt)
 {
-    hashmap_put(&ir_fn_return_types, crc32_string(name), (uint64_t) dt);
+    hashmap_put(&ir_fn_return_types, name_id, (uint64_t) dt);
 }
 
-static enum data_type load_return_type(const char *name)
+static enum data_type load_return_type(uint32_t name_id)
 {
     bool ok = 0;
-    uint64_t name_hash = crc32_string(name);
-    uint64_t got = hashmap_get(&ir_fn_return_types, name_hash, &ok);
+    uint64_t got = hashmap_get(&ir_fn_return_types, name_id, &ok);
     if (!ok)
-        weak_unreachable("Cannot get return type for function `%s`", name);
+        weak_unreachable("Cannot get return type for function `%s`", intern_str(name_id));
 
     return (enum data_type) got;
 }
@@ -87,9 +117,15 @@ static void try_add_meta(struct ir_node *ir)
     }
 }
 
-/* Note: This function does not set previous pointers
-         in IR list. Back edges always represents control flow
-         and set up in `link()`. */
+/* Bind label to the next inserted statement. */
+static void label_next(struct ir_label *label)
+{
+    vector_push_back(ir_pending_labels, label);
+}
+
+/* Note: This function does not link CFG edges. They
+         are set up in ir_cfg_build() once function
+         is generated. */
 static void insert(struct ir_node *new_node)
 {
     __weak_debug({
@@ -106,6 +142,12 @@ static void insert(struct ir_node *new_node)
     }
     ir_last = new_node;
 
+    vector_foreach(ir_pending_labels, i) {
+        vector_at(ir_pending_labels, i)->target = new_node;
+        vector_push_back(ir_fn_labels, vector_at(ir_pending_labels, i));
+    }
+    ir_pending_labels.count = 0;
+
     if (ir_prev == NULL) {
         ir_prev = new_node;
         return;
@@ -125,7 +167,8 @@ static void reset_fn_state()
 {
     ir_storage_init();
 
-    memset(ir_type_map, 0, sizeof (ir_type_map));
+    /* Only symbols of previous function are set. */
+    memset(ir_type_map, 0, ir_var_idx * sizeof (*ir_type_map));
     ir_last_type = D_T_UNKNOWN;
     ir_var_idx = 0;
     ir_loop_idx = 0;
@@ -136,6 +179,8 @@ static void reset_fn_state()
     ir_save_first = 1;
     vector_free(ir_break_stack);
     vector_free(ir_loop_header_stack);
+    vector_free(ir_pending_labels);
+    vector_free(ir_fn_labels);
 }
 
 static void reset_state()
@@ -143,50 +188,104 @@ static void reset_state()
     reset_fn_state();
 
     vector_free(ir_fn_decls);
-    if (ir_fn_return_types.buckets)
-        hashmap_destroy(&ir_fn_return_types);
+    hashmap_reset(&ir_fn_return_types, 32);
+}
+
+static void free_state()
+{
+    vector_free(ir_fn_decls);
+    vector_free(ir_break_stack);
+    vector_free(ir_loop_header_stack);
+    vector_free(ir_pending_labels);
+    vector_free(ir_fn_labels);
+    hashmap_destroy(&ir_fn_return_types);
+    ast_flat_walk_free(&ir_walk);
+    weak_free(ir_type_map);
+    ir_type_map = NULL;
+}
+
+/* Each visit_* function is called with node on top of walk
+   once at start and once after each child it pushed, with
+   f->step incremented. Result of visited child is in
+   ir_last. Values needed after child are kept in f->data.
+
+   Optional children are pushed as AST_FLAT_NONE, which only
+   moves to the next step. */
+static void visit(ast_idx_t idx)
+{
+    ast_flat_walk_push(&ir_walk, idx);
+}
 
-    hashmap_init(&ir_fn_return_types, 32);
+static void leave()
+{
+    ast_flat_walk_pop(&ir_walk);
 }
 
-static void visit(struct ast_node *ast);
+static enum ast_type type_of(ast_idx_t idx)
+{
+    return ir_ast->nodes.data[idx].type;
+}
 
 /* Primitives. They are not pushed to ir_stmts, because
-   they are immediate values. */
-#define __visit_primitive(lo, hi) \
-static void visit_##lo(struct ast_##lo *ast) \
+   they are immediate values. Value of most of them is
+   stored in node itself. */
+#define __visit_primitive(lo, hi, value) \
+static void visit_##lo(ast_idx_t idx) \
 { \
-    ir_last = ir_imm_##lo##_init(ast->value); \
+    ir_last = ir_imm_##lo##_init(value); \
     ir_last_type = D_T_##hi; \
+    leave(); \
 }
-__visit_primitive(bool,  BOOL )
-__visit_primitive(char,  CHAR )
-__visit_primitive(float, FLOAT)
-__visit_primitive(int,   INT  )
+__visit_primitive(bool,  BOOL,  ir_ast->nodes.data[idx].payload)
+__visit_primitive(char,  CHAR,  (char) ir_ast->nodes.data[idx].payload)
+__visit_primitive(float, FLOAT, ir_ast->floats.data[ir_ast->nodes.data[idx].payload])
+__visit_primitive(int,   INT,   (int32_t) ir_ast->nodes.data[idx].payload)
 #undef __visit_primitive
 
-static void visit_string(struct ast_string *ast)
+static void visit_string(ast_idx_t idx)
 {
-    /* ast->value is allocated in AST also. We duplicate to do not
-       be dependent on AST cleanup. */
-    ir_last = ir_string_init(ast->len, strdup(ast->value));
+    const struct ast_flat_string *ast = ast_flat_get(ir_ast, strings, idx);
+
+    /* String is copied to the IR arena, so we do not
+       depend on AST cleanup. */
+    ir_last = ir_string_init(ast->len, intern_str(ast->value));
     ir_last_type = D_T_STRING;
+    leave();
 }
 
-static void visit_cast(struct ast_implicit_cast *ast)
+static void visit_cast(struct ast_flat_walk_frame *f)
 {
-    visit(ast->body);
+    const struct ast_flat_implicit_cast *ast = ast_flat_get(ir_ast, casts, f->idx);
+
+    if (f->step++ == 0)
+        visit(ast->body);
+    else
+        leave();
 }
 
-static void emit_assign(struct ast_binary *ast)
+static void emit_assign(struct ast_flat_walk_frame *f)
 {
-    visit(ast->lhs);
-    struct ir_node *lhs = ir_last;
-    visit(ast->rhs);
-    struct ir_node *rhs = ir_last;
+    const struct ast_flat_binary *ast = ast_flat_get(ir_ast, binaries, f->idx);
 
-    ir_last = ir_store_init(lhs, rhs);
-    insert_last();
+    switch (f->step++) {
+    case 0:
+        visit(ast->lhs);
+        break;
+    case 1:
+        /* lhs. */
+        f->data[0] = (uint64_t) ir_last;
+        visit(ast->rhs);
+        break;
+    default: {
+        struct ir_node *lhs = (struct ir_node *) f->data[0];
+        struct ir_node *rhs = ir_last;
+
+        ir_last = ir_store_init(lhs, rhs);
+        insert_last();
+        leave();
+        break;
+    }
+    }
 }
 
 static bool logical(enum token_type t)
@@ -204,61 +303,82 @@ static bool logical(enum token_type t)
     }
 }
 
-static void emit_bin(struct ast_binary *ast)
+static void emit_bin(struct ast_flat_walk_frame *f)
 {
-    ir_last = ir_alloca_init(D_T_UNKNOWN, /*ptr_depth=*/0, ir_var_idx++);
-    struct ir_alloca *alloca = ir_last->ir;
-    uint64_t alloca_idx = alloca->idx;
+    const struct ast_flat_binary *ast = ast_flat_get(ir_ast, binaries, f->idx);
 
-    insert_last();
-
-    visit(ast->lhs);
-    struct ir_node *lhs = ir_last;
-    visit(ast->rhs);
-    struct ir_node *rhs = ir_last;
+    switch (f->step++) {
+    case 0: {
+        ir_last = ir_alloca_init(D_T_UNKNOWN, /*ptr_depth=*/0, next_var_idx());
 
-    if (logical(ast->op)) {
-        alloca->dt = D_T_INT; /* Or bool. */
-        ir_last_type = D_T_INT;
-    } else
-        alloca->dt = ir_last_type;
+        insert_last();
 
-    ir_last = ir_store_sym_init(
-        alloca_idx,
-        ir_bin_init(ast->op, lhs, rhs)
-    );
-    insert_last();
-    ir_last = ir_sym_init(alloca_idx);
+        /* alloca. */
+        f->data[0] = (uint64_t) ir_last->ir;
+        visit(ast->lhs);
+        break;
+    }
+    case 1:
+        /* lhs. */
+        f->data[1] = (uint64_t) ir_last;
+        visit(ast->rhs);
+        break;
+    default: {
+        struct ir_alloca *alloca     = (struct ir_alloca *) f->data[0];
+        uint64_t          alloca_idx = alloca->idx;
+        struct ir_node   *lhs        = (struct ir_node *) f->data[1];
+        struct ir_node   *rhs        = ir_last;
+
+        if (logical(ast->op)) {
+            alloca->dt = D_T_INT; /* Or bool. */
+            ir_last_type = D_T_INT;
+        } else
+            alloca->dt = ir_last_type;
+
+        ir_last = ir_store_sym_init(
+            alloca_idx,
+            ir_bin_init(ast->op, lhs, rhs)
+        );
+        insert_last();
+        ir_last = ir_sym_init(alloca_idx);
+        leave();
+        break;
+    }
+    }
 }
 
-static void visit_binary(struct ast_binary *ast)
+static void visit_binary(struct ast_flat_walk_frame *f)
 {
+    const struct ast_flat_binary *ast = ast_flat_get(ir_ast, binaries, f->idx);
+
     /* Symbol. */
     if (ast->op == TOK_ASSIGN)
-        emit_assign(ast);
+        emit_assign(f);
     else
-        emit_bin(ast);
+        emit_bin(f);
 }
 
-static void visit_break(unused struct ast_break *ast)
+static void visit_break()
 {
-    struct ir_node *ir = ir_jump_init(0);
-    vector_push_back(ir_break_stack, ir);
+    struct ir_node *ir = ir_jump_init(vector_back(ir_break_stack));
     insert(ir);
+    leave();
 }
 
-static void visit_continue(unused struct ast_continue *ast)
+static void visit_continue()
 {
     struct ir_node *ir = ir_jump_init(vector_back(ir_loop_header_stack));
     insert(ir);
+    leave();
 }
 
-/* To emit correct `break`, we just attach it to the next
-   statement after the loop.
-  
+/* Loop labels are pushed before loop body. To emit correct
+   `break`, we just attach its label to the next statement after
+   the loop.
+
    To emit correct `continue` we taking last (deepest right now)
-   loop header index from stack and then remove it from stack.
-  
+   loop header label from stack and then remove it from stack.
+
    while () {
      continue;         | Level 0
      while () {
@@ -267,19 +387,24 @@ static void visit_continue(unused struct ast_continue *ast)
    } */
 static void emit_loop_flow_instrs()
 {
-    if (ir_break_stack.count > 0) {
-        struct ir_node *back = vector_back(ir_break_stack);
-        struct ir_jump *jmp = back->ir;
-        jmp->idx = ir_last->instr_idx + 1;
-        /* Target will be added during linkage based on index. */
-        jmp->target = NULL;
-
-        vector_pop_back(ir_break_stack);
-    }
+    label_next(vector_back(ir_break_stack));
 
+    vector_pop_back(ir_break_stack);
     vector_pop_back(ir_loop_header_stack);
 }
 
+/* Header label is bound to the first statement of loop. */
+static struct ir_label *enter_loop()
+{
+    struct ir_label *header = ir_label_init(NULL);
+
+    label_next(header);
+    vector_push_back(ir_loop_header_stack, header);
+    vector_push_back(ir_break_stack, ir_label_init(NULL));
+
+    return header;
+}
+
 static struct ir_node *zero_cond_immediate()
 {
     switch (ir_last_type) {
@@ -292,10 +417,10 @@ static struct ir_node *zero_cond_immediate()
     }
 }
 
-static void visit_for(struct ast_for *ast)
+static void visit_for(struct ast_flat_walk_frame *f)
 {
     /* Schema:
-      
+
        L0:  init variable
        L1:  if condition is true jump to L3
        L2:  jump to L7 (exit label)
@@ -304,73 +429,76 @@ static void visit_for(struct ast_for *ast)
        L5:  increment
        L6:  jump to L1 (condition)
        L7:  after for instr
-       
+
        Initial part is optional. */
 
-    ir_meta_is_loop = 1;
-    if (ast->init) visit(ast->init);
-    ir_meta_is_loop = 0;
+    const struct ast_flat_for *ast = ast_flat_get(ir_ast, fors, f->idx);
 
-    /* Body starts with condition that is checked on each
-      iteration. */
-    uint64_t         next_iter_jump_idx = 0;
-    uint64_t         header_idx         = ir_last->instr_idx + 1;
-    struct ir_node *cond                = NULL;
-    struct ir_node *exit_jmp            = NULL;
-    struct ir_jump *exit_jmp_ptr        = NULL;
-    struct ir_node *body_start          = NULL;
+    switch (f->step++) {
+    case 0:
+        ir_meta_is_loop = 1;
+        visit(ast->init);
+        break;
+    case 1: {
+        ir_meta_is_loop = 0;
 
-    vector_push_back(ir_loop_header_stack, header_idx);
+        /* Body starts with condition that is checked on each
+          iteration. Condition is optional. */
+        struct ir_label *header = enter_loop();
 
-    if (ir_block_depth == 0)
-        ++ir_loop_idx;
+        if (ir_block_depth == 0)
+            ++ir_loop_idx;
 
-    ++ir_block_depth;
-    /* Condition is optional. */
-    if (ast->condition) {
-        next_iter_jump_idx       = ir_last->instr_idx + 1;
+        ++ir_block_depth;
+        /* next_iter_label. */
+        f->data[0] = (uint64_t) header;
         visit(ast->condition);
-        struct ir_node *cond_bin = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
-        cond                     = ir_cond_init(cond_bin, /* Not used for now. */-1);
-        exit_jmp                 = ir_jump_init(/* Not used for now. */-1);
-        exit_jmp_ptr             = exit_jmp->ir;
-        struct ir_cond *cond_ptr = cond->ir;
-
-        insert(cond);
-        insert(exit_jmp);
-
-        cond_ptr->goto_label = ir_last->instr_idx + 1;
-    } else {
-        next_iter_jump_idx = ir_last->instr_idx + 1;
+        break;
     }
+    case 2:
+        if (ast->condition != AST_FLAT_NONE) {
+            struct ir_label *body     = ir_label_init(NULL);
+            struct ir_label *exit     = ir_label_init(NULL);
+            struct ir_node  *cond_bin = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
+            struct ir_node  *cond     = ir_cond_init(cond_bin, body);
+            struct ir_node  *exit_jmp = ir_jump_init(exit);
+
+            insert(cond);
+            insert(exit_jmp);
+
+            label_next(body);
+            /* exit_label. */
+            f->data[1] = (uint64_t) exit;
+        }
+        visit(ast->body);
+        break;
+    case 3:
+        /* Increment is optional. */
+        ir_meta_is_loop = 1;
+        visit(ast->increment);
+        break;
+    default: {
+        ir_meta_is_loop = 0;
 
-    body_start = ir_last;
-    visit(ast->body);
-    if (body_start != ir_last)
-        body_start = body_start->next;
-    else
-        body_start = NULL;
-
-    /* Increment is optional. */
-    ir_meta_is_loop = 1;
-    if (ast->increment) visit(ast->increment);
-    ir_meta_is_loop = 0;
-
-    ir_last = ir_jump_init(next_iter_jump_idx);
+        ir_last = ir_jump_init(/*next_iter_label=*/(struct ir_label *) f->data[0]);
+        insert_last();
 
-    if (ast->condition)
-        exit_jmp_ptr->idx = ir_last->instr_idx + 1;
+        if (ast->condition != AST_FLAT_NONE)
+            label_next(/*exit_label=*/(struct ir_label *) f->data[1]);
 
-    insert_last();
-    --ir_block_depth;
+        --ir_block_depth;
 
-    emit_loop_flow_instrs();
+        emit_loop_flow_instrs();
+        leave();
+        break;
+    }
+    }
 }
 
-static void visit_while(struct ast_while *ast)
+static void visit_while(struct ast_flat_walk_frame *f)
 {
     /* Schema:
-      
+
        L0: if condition is true jump to L2
        L1: jump to L5 (exit label)
        L2: body instr 1
@@ -378,99 +506,116 @@ static void visit_while(struct ast_while *ast)
        L4: jump to L0 (condition)
        L5: after while instr */
 
-    uint64_t next_iter_idx = ir_last ? ir_last->instr_idx + 1 : 0;
-    uint64_t header_idx    = ir_last ? ir_last->instr_idx + 1 : 0;
+    const struct ast_flat_while *ast = ast_flat_get(ir_ast, whiles, f->idx);
 
-    vector_push_back(ir_loop_header_stack, header_idx);
+    switch (f->step++) {
+    case 0: {
+        struct ir_label *header = enter_loop();
 
-    if (ir_block_depth == 0)
-        ++ir_loop_idx;
+        if (ir_block_depth == 0)
+            ++ir_loop_idx;
 
-    ++ir_block_depth;
-    ir_meta_is_loop = 1;
-    visit(ast->cond);
-    ir_meta_is_loop = 0;
-
-    struct ir_node *cond_bin      = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
-    struct ir_node *cond          = ir_cond_init(cond_bin, /*Not used for now.*/-1);
-    struct ir_cond *cond_ptr      = cond->ir;
-    struct ir_node *exit_jmp      = ir_jump_init(/*Not used for now.*/-1);
-    struct ir_jump *exit_jmp_ptr  = exit_jmp->ir;
+        ++ir_block_depth;
+        /* next_iter_label. */
+        f->data[0] = (uint64_t) header;
+        ir_meta_is_loop = 1;
+        visit(ast->cond);
+        break;
+    }
+    case 1: {
+        ir_meta_is_loop = 0;
 
-    insert(cond);
-    insert(exit_jmp);
+        struct ir_label *body          = ir_label_init(NULL);
+        struct ir_label *exit          = ir_label_init(NULL);
+        struct ir_node  *cond_bin      = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
+        struct ir_node  *cond          = ir_cond_init(cond_bin, body);
+        struct ir_node  *exit_jmp      = ir_jump_init(exit);
 
-    cond_ptr->goto_label = exit_jmp->instr_idx + 1;
+        insert(cond);
+        insert(exit_jmp);
 
-    visit(ast->body);
+        label_next(body);
+        /* exit_label. */
+        f->data[1] = (uint64_t) exit;
 
-    struct ir_node *next_iter_jmp = ir_jump_init(next_iter_idx);
-    insert(next_iter_jmp);
-    --ir_block_depth;
+        visit(ast->body);
+        break;
+    }
+    default: {
+        struct ir_label *exit          = (struct ir_label *) f->data[1];
+        struct ir_node  *next_iter_jmp = ir_jump_init(/*next_iter_label=*/(struct ir_label *) f->data[0]);
+        insert(next_iter_jmp);
+        --ir_block_depth;
 
-    exit_jmp_ptr->idx = next_iter_jmp->instr_idx + 1;
+        label_next(exit);
 
-    emit_loop_flow_instrs();
+        emit_loop_flow_instrs();
+        leave();
+        break;
+    }
+    }
 }
 
-static void visit_do_while(struct ast_do_while *ast)
+static void visit_do_while(struct ast_flat_walk_frame *f)
 {
     /* Schema:
-      
+
        L0: body instr 1
        L1: body instr 2
        L2: allocate temporary for condition
        L3: store condition in temporary
        L4: if condition is true jump to L0 */
 
-    uint64_t stmt_begin;
-    uint64_t header_idx
-        = ir_last
-        ? ir_last->instr_idx + 1
-        : 0;
-
-    vector_push_back(ir_loop_header_stack, header_idx);
-
-    if (ir_last == NULL)
-        stmt_begin = 0;
-    else
-        stmt_begin = ir_last->instr_idx + 1;
+    const struct ast_flat_do_while *ast = ast_flat_get(ir_ast, do_whiles, f->idx);
 
-    if (ir_block_depth == 0)
-        ++ir_loop_idx;
+    switch (f->step++) {
+    case 0: {
+        /* stmt_begin. */
+        f->data[0] = (uint64_t) enter_loop();
 
-    ++ir_block_depth;
-    visit(ast->body);
+        if (ir_block_depth == 0)
+            ++ir_loop_idx;
 
-    ir_meta_is_loop = 1;
-    visit(ast->condition);
-    ir_meta_is_loop = 0;
+        ++ir_block_depth;
+        visit(ast->body);
+        break;
+    }
+    case 1:
+        ir_meta_is_loop = 1;
+        visit(ast->condition);
+        break;
+    default: {
+        ir_meta_is_loop = 0;
 
-    struct ir_node *cond = ir_cond_init(
-        ir_bin_init(
-            TOK_NEQ,
-            ir_last,
-            zero_cond_immediate()
-        ),
-        stmt_begin
-    );
+        struct ir_node *cond = ir_cond_init(
+            ir_bin_init(
+                TOK_NEQ,
+                ir_last,
+                zero_cond_immediate()
+            ),
+            /*stmt_begin=*/(struct ir_label *) f->data[0]
+        );
 
-    insert(cond);
-    --ir_block_depth;
+        insert(cond);
+        --ir_block_depth;
 
-    emit_loop_flow_instrs();
+        emit_loop_flow_instrs();
+        leave();
+        break;
+    }
+    }
 }
 
-static void visit_if(struct ast_if *ast)
+static void visit_if(struct ast_flat_walk_frame *f)
 {
     /* Schema:
-      
+
             if condition is true jump to L1
        L0:  jump to L3 (exit label)
        L1:  body instr 1 (first if stmt)
        L2:  body instr 2
        L3:  after if
-      
+
        or
             if condition is true jump to L1
        L0:  jump to L4 (else label)
@@ -481,82 +626,106 @@ static void visit_if(struct ast_if *ast)
        L5:  else body instr 2
        L6:  after if */
 
-    ++ir_block_depth;
-    visit(ast->condition);
-    assert((
-        ir_last->type == IR_IMM ||
-        ir_last->type == IR_SYM
-    ) && ("Immediate value or symbol required."));
-
-    /* Condition always looks like comparison with 0.
-      
-       Possible cases:
-                          v Binary operation result.
-       - if (1 + 1) -> if sym neq $0 goto ...
-       - if (1    ) -> if imm neq $0 goto ...
-       - if (var  ) -> if sym neq $0 goto ... */
-
-    ir_last = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
+    const struct ast_flat_if *ast = ast_flat_get(ir_ast, ifs, f->idx);
 
-    struct ir_node *cond         = ir_cond_init(ir_last, /*Not used for now.*/-1);
-    struct ir_cond *cond_ptr     = cond->ir;
-    struct ir_node *exit_jmp     = ir_jump_init(/*Not used for now.*/-1);
-    struct ir_jump *exit_jmp_ptr = exit_jmp->ir;
-
-    /* Body starts after exit jump. */
-    cond_ptr->goto_label = exit_jmp->instr_idx + 1;
-    insert(cond);
-    insert(exit_jmp);
-
-    struct ir_node *initial_stmt = ir_last;
+    switch (f->step++) {
+    case 0:
+        ++ir_block_depth;
+        visit(ast->condition);
+        break;
+    case 1: {
+        assert((
+            ir_last->type == IR_IMM ||
+            ir_last->type == IR_SYM
+        ) && ("Immediate value or symbol required."));
 
-    visit(ast->body);
-    --ir_block_depth;
+        /* Condition always looks like comparison with 0.
 
-    initial_stmt = initial_stmt->next;
+           Possible cases:
+                              v Binary operation result.
+           - if (1 + 1) -> if sym neq $0 goto ...
+           - if (1    ) -> if imm neq $0 goto ...
+           - if (var  ) -> if sym neq $0 goto ... */
 
-    /* Even with code like
-       void f() { if (x) { f(); } }
-       this will make us to jump to the `ret`
-       instruction, which terminates each (regardless
-       on the return type) function. */
-    exit_jmp_ptr->idx = ir_last->instr_idx + 1;
+        ir_last = ir_bin_init(TOK_NEQ, ir_last, zero_cond_immediate());
 
-    if (!ast->else_body) return;
-    ++ir_block_depth;
-    struct ir_node *else_jmp = ir_jump_init(/*Not used for now.*/-1);
-    struct ir_jump *else_jmp_ptr = else_jmp->ir;
-    /* Index of this jump will be changed through pointer. */
-    insert(else_jmp);
+        struct ir_label *body         = ir_label_init(NULL);
+        struct ir_label *exit         = ir_label_init(NULL);
+        struct ir_node  *cond         = ir_cond_init(ir_last, body);
+        struct ir_node  *exit_jmp     = ir_jump_init(exit);
 
-    initial_stmt = ir_last;
+        insert(cond);
+        insert(exit_jmp);
 
-    /* Jump over the `then` statement to `else`. */
-    exit_jmp_ptr->idx = ir_last->instr_idx + 1; /* +1 jump statement. */
-    visit(ast->else_body);
-    /* `then` part ends with jump over `else` part. */
-    else_jmp_ptr->idx = ir_last->instr_idx + 1;
+        /* Body starts after exit jump. */
+        label_next(body);
 
-    initial_stmt = initial_stmt->next;
+        /* exit_label. */
+        f->data[0] = (uint64_t) exit;
+        visit(ast->body);
+        break;
+    }
+    case 2: {
+        struct ir_label *exit = (struct ir_label *) f->data[0];
+
+        --ir_block_depth;
+
+        if (ast->else_body == AST_FLAT_NONE) {
+            /* Even with code like
+               void f() { if (x) { f(); } }
+               this will make us to jump to the `ret`
+               instruction, which terminates each (regardless
+               on the return type) function. */
+            label_next(exit);
+            leave();
+            return;
+        }
+        ++ir_block_depth;
+        struct ir_label *end      = ir_label_init(NULL);
+        struct ir_node  *else_jmp = ir_jump_init(end);
+        insert(else_jmp);
+
+        /* Jump over the `then` statement to `else`. */
+        label_next(exit);
+        /* end_label. */
+        f->data[1] = (uint64_t) end;
+        visit(ast->else_body);
+        break;
+    }
+    default: {
+        /* `then` part ends with jump over `else` part. */
+        label_next(/*end_label=*/(struct ir_label *) f->data[1]);
 
-    --ir_block_depth;
+        --ir_block_depth;
+        leave();
+        break;
+    }
+    }
 }
 
-static void visit_ret(struct ast_ret *ast)
+static void visit_ret(struct ast_flat_walk_frame *f)
 {
-    memset(&ir_last, 0, sizeof (ir_last));
-    if (ast->op) {
-        visit(ast->op);
+    /* Operand index is stored in node itself. */
+    ast_idx_t op = ir_ast->nodes.data[f->idx].payload;
+
+    if (f->step++ == 0) {
+        memset(&ir_last, 0, sizeof (ir_last));
+        visit(op);
+        return;
     }
+
     ir_last = ir_ret_init(ir_last);
     insert_last();
+    leave();
 }
 
-static void visit_sym(struct ast_sym *ast)
+static void visit_sym(ast_idx_t node)
 {
-    uint64_t idx = ir_storage_get(ast->value)->sym_idx;
+    /* Name id is stored in node itself. */
+    uint64_t idx = ir_storage_get(ir_ast->nodes.data[node].payload)->sym_idx;
     ir_last = ir_sym_init(idx);
     ir_last_type = ir_type_map[idx].dt;
+    leave();
 }
 
 really_inline static void visit_unary_arith(enum token_type op)
@@ -586,7 +755,7 @@ really_inline static void visit_unary_pointer(enum token_type op, bool immediate
     if (immediate) {
         ir_last = ir_sym_init(sym->idx);
     } else {
-        uint64_t next_idx = ir_var_idx++;
+        uint64_t next_idx = next_var_idx();
         ir_last = ir_alloca_init(
             ir_type_map[sym->idx].dt,
             ir_type_map[sym->idx].ptr_depth > 0,
@@ -604,9 +773,17 @@ really_inline static void visit_unary_pointer(enum token_type op, bool immediate
     new_s->addr_of = op == TOK_BIT_AND;
 }
 
-static void visit_unary(struct ast_unary *ast)
+static void visit_unary(struct ast_flat_walk_frame *f)
 {
-    visit(ast->operand);
+    const struct ast_flat_unary *ast = ast_flat_get(ir_ast, unaries, f->idx);
+
+    if (f->step++ == 0) {
+        visit(ast->operand);
+        return;
+    }
+
+    leave();
+
     assert((
         ir_last->type == IR_SYM
     ) && (
@@ -624,60 +801,80 @@ static void visit_unary(struct ast_unary *ast)
     /* Pointer operations. */
     case TOK_STAR:    /* * */
     case TOK_BIT_AND: /* & */
-        visit_unary_pointer(op, ast->operand->type == AST_SYMBOL);
+        visit_unary_pointer(op, type_of(ast->operand) == AST_SYMBOL);
         break;
     default:
         weak_unreachable("Unknown operator `%s`", tok_to_string(op));
     }
 }
 
-static void visit_struct_decl(unused struct ast_struct_decl *ast)
-{}
+static void visit_struct_decl()
+{
+    leave();
+}
 
-static void emit_var(struct ast_var_decl *ast)
+static void emit_var(struct ast_flat_walk_frame *f)
 {
-    uint64_t next_idx = ir_var_idx++;
-    ir_last = ir_alloca_init(ast->dt, ast->ptr_depth, next_idx);
-    ir_type_map[next_idx].dt = ast->dt;
-    ir_type_map[next_idx].ptr_depth = ast->ptr_depth;
+    const struct ast_flat_var_decl *ast = ast_flat_get(ir_ast, var_decls, f->idx);
 
-    /* Used as function argument or as function body statement. */
-    insert_last();
-    ir_storage_push(ast->name, next_idx, ast->dt, ast->ptr_depth, ir_last);
+    if (f->step++ == 0) {
+        uint64_t next_idx = next_var_idx();
+        ir_last = ir_alloca_init(ast->dt, ast->ptr_depth, next_idx);
+        ir_type_map[next_idx].dt = ast->dt;
+        ir_type_map[next_idx].ptr_depth = ast->ptr_depth;
+
+        /* Used as function argument or as function body statement. */
+        insert_last();
+        ir_storage_push(ast->name, next_idx, ast->dt, ast->ptr_depth, ir_last);
 
-    if (ast->body) {
+        f->data[0] = next_idx;
         visit(ast->body);
-        ir_last = ir_store_sym_init(next_idx, ir_last);
+        return;
+    }
+
+    if (ast->body != AST_FLAT_NONE) {
+        ir_last = ir_store_sym_init(/*next_idx=*/f->data[0], ir_last);
         insert_last();
     }
+    leave();
 }
 
-static void emit_var_string(struct ast_var_decl *ast)
+static void emit_var_string(struct ast_flat_walk_frame *f)
 {
-    struct ast_string *string   = ast->body->ast;
-    uint64_t           next_idx = ir_var_idx++;
-    uint64_t           mem_siz  = string->len + 1; /* We add '\0'. */
+    const struct ast_flat_var_decl *ast = ast_flat_get(ir_ast, var_decls, f->idx);
 
-    ir_last = ir_alloca_array_init(D_T_CHAR, &mem_siz, 1, next_idx);
-    insert_last();
-    ir_storage_push(ast->name, next_idx, ast->dt, ast->ptr_depth, ir_last);
+    if (f->step++ == 0) {
+        const struct ast_flat_string *string   = ast_flat_get(ir_ast, strings, ast->body);
+        uint64_t                      next_idx = next_var_idx();
+        uint64_t                      mem_siz  = string->len + 1; /* We add '\0'. */
+
+        ir_last = ir_alloca_array_init(D_T_CHAR, &mem_siz, 1, next_idx);
+        insert_last();
+        ir_storage_push(ast->name, next_idx, ast->dt, ast->ptr_depth, ir_last);
+
+        f->data[0] = next_idx;
+        visit(ast->body);
+        return;
+    }
 
-    visit(ast->body);
-    ir_last = ir_store_init(ir_sym_init(next_idx), ir_last);
+    ir_last = ir_store_init(ir_sym_init(/*next_idx=*/f->data[0]), ir_last);
     insert_last();
+    leave();
 }
 
-static void visit_var_decl(struct ast_var_decl *ast)
+static void visit_var_decl(struct ast_flat_walk_frame *f)
 {
+    const struct ast_flat_var_decl *ast = ast_flat_get(ir_ast, var_decls, f->idx);
+
     bool string = 1;
     string &= ast->ptr_depth == 1;
     string &= ast->dt == D_T_CHAR;
-    string &= ast->body && ast->body->type == AST_STRING;
+    string &= ast->body != AST_FLAT_NONE && type_of(ast->body) == AST_STRING;
 
     if (string)
-        emit_var_string(ast);
+        emit_var_string(f);
     else
-        emit_var(ast);
+        emit_var(f);
 }
 
 /* Example. Decide, how to store indices list.
@@ -702,12 +899,14 @@ static void visit_var_decl(struct ast_var_decl *ast)
        ///              Store there
    store %2 9
 */
-static void visit_array_decl(struct ast_array_decl *ast)
+static void visit_array_decl(ast_idx_t idx)
 {
-    assert(ast->arity->type == AST_COMPOUND_STMT && "Array declarator expects compound ast enclosure list.");
+    const struct ast_flat_array_decl *ast = ast_flat_get(ir_ast, array_decls, idx);
 
-    uint64_t             next_idx  = ir_var_idx++;
-    struct ast_compound *enclosure = ast->arity->ast;
+    assert(type_of(ast->arity) == AST_COMPOUND_STMT && "Array declarator expects compound ast enclosure list.");
+
+    uint64_t                        next_idx  = next_var_idx();
+    const struct ast_flat_compound *enclosure = ast_flat_get(ir_ast, compounds, ast->arity);
 
     assert(enclosure->size <= 16 && "Maximum array depth limited to 16.");
 
@@ -716,110 +915,144 @@ static void visit_array_decl(struct ast_array_decl *ast)
         weak_unreachable("Something funny happened.");
 
     for (uint64_t i = 0; i < enclosure->size; ++i) {
-        struct ast_int *num = enclosure->stmts[i]->ast;
-        lvls[i] = num->value;
+        ast_idx_t num = ast_flat_stmt(ir_ast, ast->arity, i);
+        lvls[i] = (int32_t) ir_ast->nodes.data[num].payload;
     }
 
     ir_last = ir_alloca_array_init(ast->dt, lvls, enclosure->size, next_idx);
     insert_last();
 
     ir_storage_push(ast->name, next_idx, ast->dt, ast->ptr_depth, ir_last);
+    leave();
 }
 
-static void visit_array_access(struct ast_array_access *ast)
+static void visit_array_access(struct ast_flat_walk_frame *f)
 {
     /* First just assume one-dimensional array.
        Next extend to multi-dimensional. */
 
-    struct ir_storage_record *record  = ir_storage_get(ast->name);
-    struct ast_compound      *indices = ast->indices->ast;
-
-    if (indices->size == 1) {
-        visit(indices->stmts[0]);
-        struct ir_node *idx = ir_last;
+    const struct ast_flat_array_access *ast     = ast_flat_get(ir_ast, array_accesses, f->idx);
+    struct ir_storage_record           *record  = ir_storage_get(ast->name);
+    const struct ast_flat_compound     *indices = ast_flat_get(ir_ast, compounds, ast->indices);
 
-        uint64_t next_idx = ir_var_idx++;
+    if (indices->size != 1) {
+        leave();
+        return;
+    }
 
-        ir_last = ir_alloca_init(record->dt, /*ptr=*/1, next_idx);
-        ir_type_map[next_idx].dt = record->dt;
-        ir_type_map[next_idx].ptr_depth = record->ptr_depth;
-        insert_last();
-        ir_last = ir_store_init(
-            ir_sym_init(next_idx),
-            ir_bin_init(
-                TOK_PLUS,
-                ir_sym_init(record->sym_idx),
-                idx
-            )
-        );
-        insert_last();
-        ir_last = ir_sym_ptr_init(next_idx);
+    if (f->step++ == 0) {
+        visit(ast_flat_stmt(ir_ast, ast->indices, 0));
+        return;
     }
+
+    struct ir_node *idx = ir_last;
+
+    uint64_t next_idx = next_var_idx();
+
+    ir_last = ir_alloca_init(record->dt, /*ptr=*/1, next_idx);
+    ir_type_map[next_idx].dt = record->dt;
+    ir_type_map[next_idx].ptr_depth = record->ptr_depth;
+    insert_last();
+    ir_last = ir_store_init(
+        ir_sym_init(next_idx),
+        ir_bin_init(
+            TOK_PLUS,
+            ir_sym_init(record->sym_idx),
+            idx
+        )
+    );
+    insert_last();
+    ir_last = ir_sym_ptr_init(next_idx);
+    leave();
 }
 
-static void visit_member(unused struct ast_member *ast)
-{}
+static void visit_member()
+{
+    leave();
+}
 
-static void visit_compound(struct ast_compound *ast)
+static void visit_compound(struct ast_flat_walk_frame *f)
 {
-    for (uint64_t i = 0; i < ast->size; ++i) {
-        struct ast_node *s = ast->stmts[i];
-        if (s->type == AST_FUNCTION_CALL) {
-            ir_is_global_scope = 1;
-            visit(s);
-            ir_is_global_scope = 0;
-        } else {
-            visit(s);
-        }
+    const struct ast_flat_compound *ast = ast_flat_get(ir_ast, compounds, f->idx);
+    uint32_t                        i   = f->step++;
+
+    /* Call, which is statement itself, is done. */
+    if (i > 0 && type_of(ast_flat_stmt(ir_ast, f->idx, i - 1)) == AST_FUNCTION_CALL)
+        ir_is_global_scope = 0;
+
+    if (i == ast->size) {
+        leave();
+        return;
     }
+
+    ast_idx_t s = ast_flat_stmt(ir_ast, f->idx, i);
+    if (type_of(s) == AST_FUNCTION_CALL)
+        ir_is_global_scope = 1;
+    visit(s);
 }
 
-static void visit_fn_decl(struct ast_fn_decl *decl)
+static void visit_fn_decl(struct ast_flat_walk_frame *f)
 {
-    reset_fn_state();
+    const struct ast_flat_fn_decl *decl = ast_flat_get(ir_ast, fn_decls, f->idx);
 
-    visit(decl->args);
-    struct ir_node *args = ir_first;
+    switch (f->step++) {
+    case 0:
+        reset_fn_state();
 
-    ir_first = NULL;
-    ir_last = NULL;
-    ir_prev = NULL;
-    ir_save_first = 1;
+        visit(decl->args);
+        break;
+    case 1:
+        /* args. */
+        f->data[0] = (uint64_t) ir_first;
 
-    ir_reset_state();
+        ir_first = NULL;
+        ir_last = NULL;
+        ir_prev = NULL;
+        ir_save_first = 1;
 
-    store_return_type(decl->name, decl->data_type);
+        ir_reset_state();
 
-    visit(decl->body);
-    if (decl->data_type == D_T_VOID)
-        insert(ir_ret_init(NULL));
+        store_return_type(decl->name, decl->data_type);
 
-    struct ir_node *body = ir_first;
+        visit(decl->body);
+        break;
+    default: {
+        if (decl->data_type == D_T_VOID)
+            insert(ir_ret_init(NULL));
 
-    vector_push_back(
-        ir_fn_decls,
-        ir_fn_decl_init(
+        struct ir_node *args = (struct ir_node *) f->data[0];
+        struct ir_node *body = ir_first;
+        struct ir_node *fn   = ir_fn_decl_init(
             decl->data_type,
             decl->ptr_depth,
-            /* Duplicate to not be depended on AST string values (after free). */
-            strdup(decl->name),
+            /* Interned, so not depends on AST lifetime. */
+            intern_str(decl->name),
             args,
             body
-        )
-    );
+        );
 
-    ir_storage_reset();
-}
+        ( (struct ir_fn_decl *) fn->ir )->labels = ir_fn_labels;
+        memset(&ir_fn_labels, 0, sizeof (ir_fn_labels));
 
-static void visit_fn_call(struct ast_fn_call *ast)
-{
-    struct ast_compound *args_ast   = ast->args->ast;
-    struct ir_node      *args       = NULL;
-    struct ir_node      *args_start = NULL;
+        vector_push_back(ir_fn_decls, fn);
 
-    for (uint64_t i = 0; i < args_ast->size; ++i) {
-        visit(args_ast->stmts[i]);
+        ir_storage_reset();
+        leave();
+        break;
+    }
+    }
+}
 
+static void visit_fn_call(struct ast_flat_walk_frame *f)
+{
+    const struct ast_flat_fn_call  *ast        = ast_flat_get(ir_ast, fn_calls, f->idx);
+    const struct ast_flat_compound *args_ast   = ast_flat_get(ir_ast, compounds, ast->args);
+    uint32_t                        i          = f->step++;
+    /* Arguments are linked in list as they are visited. */
+    struct ir_node                 *args       = (struct ir_node *) f->data[0];
+    struct ir_node                 *args_start = (struct ir_node *) f->data[1];
+
+    if (i > 0) {
         if (args == NULL) {
             args = ir_last;
             args_start = args;
@@ -827,17 +1060,24 @@ static void visit_fn_call(struct ast_fn_call *ast)
             args->next = ir_last;
             args = args->next;
         }
+        f->data[0] = (uint64_t) args;
+        f->data[1] = (uint64_t) args_start;
+    }
+
+    if (i < args_ast->size) {
+        visit(ast_flat_stmt(ir_ast, ast->args, i));
+        return;
     }
 
     enum data_type ret_dt = load_return_type(ast->name);
-    /* Duplicate to not be depended on AST string values (after free). */
-    char *fcall_name = strdup(ast->name);
+    /* Interned, so not depends on AST lifetime. */
+    const char *fcall_name = intern_str(ast->name);
 
     if (ir_is_global_scope) {
         ir_last = ir_fn_call_init(fcall_name, args_start);
         insert(ir_last);
     } else {
-        uint64_t next_idx = ir_var_idx++;
+        uint64_t next_idx = next_var_idx();
         ir_last = ir_alloca_init(ret_dt, /*ptr=*/0, next_idx);
         ir_type_map[next_idx].dt = ret_dt;
         insert_last();
@@ -849,78 +1089,55 @@ static void visit_fn_call(struct ast_fn_call *ast)
     }
 
     ir_last_type = ret_dt;
+    leave();
 }
 
-static void visit(struct ast_node *ast)
+static void visit_step(struct ast_flat_walk_frame *f)
 {
-    assert(ast);
-
-    void *ptr = ast->ast;
-    switch (ast->type) {
-    case AST_CHAR:            visit_char(ptr); break;
-    case AST_INT:             visit_int(ptr); break;
-    case AST_FLOAT:           visit_float(ptr); break;
-    case AST_STRING:          visit_string(ptr); break;
-    case AST_BOOL:            visit_bool(ptr); break;
-    case AST_SYMBOL:          visit_sym(ptr); break;
-    case AST_VAR_DECL:        visit_var_decl(ptr); break;
-    case AST_ARRAY_DECL:      visit_array_decl(ptr); break;
-    case AST_STRUCT_DECL:     visit_struct_decl(ptr); break;
-    case AST_BREAK_STMT:      visit_break(ptr); break;
-    case AST_CONTINUE_STMT:   visit_continue(ptr); break;
-    case AST_BINARY:          visit_binary(ptr); break;
-    case AST_PREFIX_UNARY:    visit_unary(ptr); break;
-    case AST_POSTFIX_UNARY:   visit_unary(ptr); break;
-    case AST_ARRAY_ACCESS:    visit_array_access(ptr); break;
-    case AST_MEMBER:          visit_member(ptr); break;
-    case AST_IF_STMT:         visit_if(ptr); break;
-    case AST_FOR_STMT:        visit_for(ptr); break;
-    case AST_WHILE_STMT:      visit_while(ptr); break;
-    case AST_DO_WHILE_STMT:   visit_do_while(ptr); break;
-    case AST_RETURN_STMT:     visit_ret(ptr); break;
-    case AST_COMPOUND_STMT:   visit_compound(ptr); break;
-    case AST_FUNCTION_DECL:   visit_fn_decl(ptr); break;
-    case AST_FUNCTION_CALL:   visit_fn_call(ptr); break;
-    case AST_IMPLICIT_CAST:   visit_cast(ptr); break;
+    ast_idx_t idx = f->idx;
+    switch (type_of(idx)) {
+    case AST_CHAR:            visit_char(idx); break;
+    case AST_INT:             visit_int(idx); break;
+    case AST_FLOAT:           visit_float(idx); break;
+    case AST_STRING:          visit_string(idx); break;
+    case AST_BOOL:            visit_bool(idx); break;
+    case AST_SYMBOL:          visit_sym(idx); break;
+    case AST_VAR_DECL:        visit_var_decl(f); break;
+    case AST_ARRAY_DECL:      visit_array_decl(idx); break;
+    case AST_STRUCT_DECL:     visit_struct_decl(); break;
+    case AST_BREAK_STMT:      visit_break(); break;
+    case AST_CONTINUE_STMT:   visit_continue(); break;
+    case AST_BINARY:          visit_binary(f); break;
+    case AST_PREFIX_UNARY:    visit_unary(f); break;
+    case AST_POSTFIX_UNARY:   visit_unary(f); break;
+    case AST_ARRAY_ACCESS:    visit_array_access(f); break;
+    case AST_MEMBER:          visit_member(); break;
+    case AST_IF_STMT:         visit_if(f); break;
+    case AST_FOR_STMT:        visit_for(f); break;
+    case AST_WHILE_STMT:      visit_while(f); break;
+    case AST_DO_WHILE_STMT:   visit_do_while(f); break;
+    case AST_RETURN_STMT:     visit_ret(f); break;
+    case AST_COMPOUND_STMT:   visit_compound(f); break;
+    case AST_FUNCTION_DECL:   visit_fn_decl(f); break;
+    case AST_FUNCTION_CALL:   visit_fn_call(f); break;
+    case AST_IMPLICIT_CAST:   visit_cast(f); break;
     default:
-        weak_unreachable("Wrong AST type (numeric: %d).", ast->type);
-    }
-}
-
-
-
-/* To ease IR access by instruction index, we maintain hashmap. */
-really_inline static void link_stmt_map(hashmap_t *stmt_map, struct ir_node *ir)
-{
-    hashmap_init(stmt_map, 128);
-
-    while (ir) {
-        hashmap_put(stmt_map, ir->instr_idx, (uint64_t) ir);
-        /* Clear all CFG information. */
-        vector_free(ir->cfg.preds);
-        vector_free(ir->cfg.succs);
-        ir = ir->next;
+        weak_unreachable("Wrong AST type (numeric: %d).", type_of(idx));
     }
 }
 
-really_inline static struct ir_node *link_target(hashmap_t *stmt_map, uint64_t jmp)
+really_inline static void link_branch(struct ir_node *stmt, struct ir_label *label)
 {
-    bool     ok   = 0;
-    uint64_t addr = hashmap_get(stmt_map, jmp, &ok);
-
-    assert(ok);
+    assert(label->target && "Label is not bound");
 
-    return (struct ir_node *) addr;
+    vector_push_back(stmt->cfg.succs, label->target);
+    vector_push_back(label->target->cfg.preds, stmt);
 }
 
-really_inline static void link_jmp(hashmap_t *stmt_map, struct ir_node *stmt)
+really_inline static void link_jmp(struct ir_node *stmt)
 {
     struct ir_jump *jump = stmt->ir;
-    jump->target = link_target(stmt_map, jump->idx);
-
-    ir_vector_t *prevs = &jump->target->cfg.preds;
-    vector_push_back(stmt->cfg.succs, jump->target);
-    vector_push_back(*prevs, stmt);
+    link_branch(stmt, jump->label);
 }
 
 /* Return statement cannot have control flow successors.
@@ -943,18 +1160,12 @@ really_inline static void link_ret(struct ir_node *stmt)
     }
 }
 
-really_inline static void link_cond(hashmap_t *stmt_map, struct ir_node *stmt)
+really_inline static void link_cond(struct ir_node *stmt)
 {
     struct ir_cond *cond = stmt->ir;
 
-    uint64_t to = cond->goto_label;
-    cond->target = link_target(stmt_map, to);
-
-    vector_push_back(stmt->cfg.succs, cond->target);
+    link_branch(stmt, cond->label);
     vector_push_back(stmt->cfg.succs, stmt->next);
-
-    ir_vector_t *prevs = &cond->target->cfg.preds;
-    vector_push_back(*prevs, stmt);
 }
 
 really_inline static void link_stmt(struct ir_node *stmt)
@@ -963,54 +1174,123 @@ really_inline static void link_stmt(struct ir_node *stmt)
         vector_push_back(stmt->cfg.succs, stmt->next);
 }
 
+/* Jump targets are known by labels, so statements are
+   linked in one walk over list. */
 static void link(struct ir_fn_decl *decl)
 {
-    struct ir_node *it       = decl->body;
-    hashmap_t       stmt_map = {0};
-
-    link_stmt_map(&stmt_map, it);
+    struct ir_node *it   = decl->body;
+    struct ir_node *prev = NULL;
 
-    hashmap_foreach(&stmt_map, k, v) {
-        (void) k;
-        struct ir_node *stmt = (struct ir_node *) v;
+    /* Clear all CFG information. */
+    for (; it; it = it->next) {
+        vector_free(it->cfg.preds);
+        vector_free(it->cfg.succs);
+    }
 
+    for (it = decl->body; it; prev = it, it = it->next) {
         /* Link previous. If we have return statement,
            some predecessors will be dropped. */
-        if (stmt->instr_idx > 0) {
-            struct ir_node *prev = link_target(&stmt_map, stmt->instr_idx - 1);
+        if (prev && prev->type != IR_JUMP)
+            vector_push_back(it->cfg.preds, prev);
 
-            if (prev->type != IR_JUMP)
-                vector_push_back(stmt->cfg.preds, prev);
-        }
+        /* List is walked forward, so previous pointer is
+           set here too. */
+        it->prev = prev;
 
-        switch (stmt->type) {
+        switch (it->type) {
         case IR_JUMP:
-            link_jmp(&stmt_map, stmt);
+            link_jmp(it);
             break;
 
         case IR_COND:
-            link_cond(&stmt_map, stmt);
+            link_cond(it);
             break;
 
         case IR_RET:
-            link_ret(stmt);
+            link_ret(it);
             break;
 
         default:
-            link_stmt(stmt);
+            link_stmt(it);
             break;
         }
     }
+}
+
+/* Statement starts basic block if it is first, follows
+   jump, condition or return, or is jump target. Target
+   reached also from previous statement has two
+   predecessors. */
+static bool block_leader(struct ir_node *prev, struct ir_node *stmt)
+{
+    if (!prev)
+        return 1;
 
-    hashmap_destroy(&stmt_map);
+    switch (prev->type) {
+    case IR_JUMP:
+    case IR_COND:
+    case IR_RET:
+        return 1;
+    default:
+        return stmt->cfg.preds.count != 1;
+    }
 }
 
-void ir_cfg_build(struct ir_fn_decl *decl)
+/* Split body into basic blocks and link them by edges
+   of last statements. */
+static void blocks_build(struct ir_fn_decl *decl)
+{
+    struct ir_node  *it      = decl->body;
+    struct ir_block *block   = NULL;
+    uint64_t         max_idx = 0;
+
+    if (!it)
+        return;
+
+    for (; it; it = it->next)
+        if (it->instr_idx > max_idx)
+            max_idx = it->instr_idx;
+
+    decl->block_of      = weak_calloc(max_idx + 1, sizeof (struct ir_block *));
+    decl->block_of_size = max_idx + 1;
+
+    for (it = decl->body; it; it = it->next) {
+        if (block_leader(it->prev, it)) {
+            block        = weak_calloc(1, sizeof (struct ir_block));
+            block->idx   = decl->blocks.count;
+            block->first = it;
+            vector_push_back(decl->blocks, block);
+        }
+
+        block->last = it;
+        decl->block_of[it->instr_idx] = block;
+    }
+
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *b    = vector_at(decl->blocks, i);
+        ir_vector_t     *outs = &b->last->cfg.succs;
+
+        vector_foreach(*outs, j) {
+            struct ir_block *succ = decl->block_of[vector_at(*outs, j)->instr_idx];
+
+            vector_push_back(b->succs, succ);
+            vector_push_back(succ->preds, b);
+        }
+    }
+}
+
+/* Legacy numbering of blocks, kept in IR dumps. */
+static void block_numbers(struct ir_fn_decl *decl)
 {
     struct ir_node *it     = decl->body;
     uint64_t        cfg_no = 0;
 
-    link(decl);
+    if (!it)
+        return;
+
+    /* Sized as blocks_build() sized block_of. */
+    decl->block_no      = weak_calloc(decl->block_of_size, sizeof (uint64_t));
+    decl->block_no_size = decl->block_of_size;
 
     while (it) {
         bool new = 0;
@@ -1019,7 +1299,7 @@ void ir_cfg_build(struct ir_fn_decl *decl)
         new |= it->type == IR_JUMP;
         new |= it->type == IR_COND;
 
-        it->cfg_block_no = cfg_no;
+        decl->block_no[it->instr_idx] = cfg_no;
 
         if (new)
             ++cfg_no;
@@ -1028,11 +1308,45 @@ void ir_cfg_build(struct ir_fn_decl *decl)
     }
 }
 
+void ir_cfg_build(struct ir_fn_decl *decl)
+{
+    ir_fn_decl_blocks_cleanup(decl);
+    link(decl);
+    blocks_build(decl);
+    block_numbers(decl);
+}
+
 struct ir_unit ir_gen(struct ast_node *ast)
 {
+    struct ast_flat flat = {0};
+
+    ast_flat_build(&flat, ast);
+    struct ir_unit unit = ir_gen_flat(&flat);
+    ast_flat_free(&flat);
+
+    return unit;
+}
+
+struct ir_unit ir_gen_flat(const struct ast_flat *ast)
+{
+    struct ir_arena            *arena = ir_arena_init();
+    struct ast_flat_walk_frame *f     = NULL;
+
+    ir_type_map      = weak_calloc(IR_TYPE_MAP_SIZE, sizeof (*ir_type_map));
+    ir_type_map_size = IR_TYPE_MAP_SIZE;
+    ir_var_idx       = 0;
     reset_state();
+    weak_thread_atexit(free_state);
+
+    ir_ast = ast;
+    ast_flat_walk_init(&ir_walk, /*root=*/0);
+    while ((f = ast_flat_walk_top(&ir_walk)))
+        visit_step(f);
+    ast_flat_walk_free(&ir_walk);
+    ir_ast = NULL;
 
-    visit(ast);
+    weak_free(ir_type_map);
+    ir_type_map = NULL;
 
     vector_foreach(ir_fn_decls, i) {
         if (i >= ir_fn_decls.count - 1)
@@ -1045,12 +1359,16 @@ struct ir_unit ir_gen(struct ast_node *ast)
         vector_push_back(decl_next->cfg.preds, decl);
     }
 
-    /* NOTE: Linking and CFG construction is done
-             by driver code. */
+    /* After that CFG is only edited, see ir_ops.h. */
+    vector_foreach(ir_fn_decls, i)
+        ir_cfg_build(vector_at(ir_fn_decls, i)->ir);
 
     struct ir_node *decls = vector_at(ir_fn_decls, 0);
 
-    return (struct ir_unit) { .fn_decls = decls };
+    return (struct ir_unit) {
+        .fn_decls = decls,
+        .arena    = arena
+    };
 }
 
 /*
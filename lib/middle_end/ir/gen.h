@@ -11,11 +11,13 @@
 #include "util/compiler.h"
 
 struct ast_node;
+struct ast_flat;
 struct ir_node;
 struct ir_unit;
 struct ir_fn_decl;
 
-/** Create IR from AST. Implemented as recursive visitor.
+/** Create IR from AST. Tree is converted to flat form
+    and passed to ir_gen_flat().
    
     Preconditions:
     - Applied all front-end analysis
@@ -24,6 +26,18 @@ struct ir_fn_decl;
       - type_analysis  */
 wur struct ir_unit ir_gen(struct ast_node *ast);
 
+/** Create IR from flat AST. Tree is walked without recursion,
+    in order of nodes in memory.
+
+    \note Preconditions are the same as of ir_gen(). */
+wur struct ir_unit ir_gen_flat(const struct ast_flat *ast);
+
+/** Link CFG edges of statements by jump labels and split
+    \p decl body into basic blocks, see ir_block().
+
+    \note Done by ir_gen_flat() for each function. Passes
+          keep CFG by edits from ir_ops.h instead of
+          building it again. */
 void ir_cfg_build(struct ir_fn_decl *decl);
 
 #endif // WEAK_COMPILER_MIDDLE_END_IR_GEN_H
@@ -14,29 +14,61 @@
    index incrementing. This should be done before
    instruction allocation. So it needed to have
    indexing from 0. */
-static uint64_t ir_instr_idx = -1;
+static _Thread_local uint64_t ir_instr_idx = -1;
+
+/* Arena of the unit being built. */
+static _Thread_local struct ir_arena *ir_arena = NULL;
 
 void ir_reset_state()
 {
     ir_instr_idx = -1;
 }
 
+struct ir_arena *ir_arena_init()
+{
+    struct ir_arena *arena = weak_calloc(1, sizeof (struct ir_arena));
+    arena_init(&arena->mem);
+    ir_arena = arena;
+    return arena;
+}
+
+void ir_arena_set(struct ir_arena *arena)
+{
+    ir_arena = arena;
+}
+
+void *ir_alloc(uint64_t size)
+{
+    if (!ir_arena)
+        weak_fatal_error("IR allocation without arena; call ir_arena_init() first");
+
+    return arena_alloc(&ir_arena->mem, size);
+}
+
+void ir_unit_dump_stats(FILE *stream, struct ir_unit *ir)
+{
+    struct ir_arena *arena = ir->arena;
+
+    fprintf(stream, "IR nodes: %lu\n", arena->nodes);
+    arena_dump_stats(stream, &arena->mem);
+}
+
 struct ir_node *ir_node_init(enum ir_type type, void *ir)
 {
-    struct ir_node *node = weak_calloc(1, sizeof (struct ir_node));
+    struct ir_node *node = ir_new(struct ir_node);
+    ++ir_arena->nodes;
     node->type = type;
     node->instr_idx = ir_instr_idx;
     node->ir = ir;
     node->meta.block_depth = META_VALUE_UNKNOWN;
     node->meta.global_loop_idx = META_VALUE_UNKNOWN;
-    node->cfg_block_no = 0;
     node->claimed_reg = IR_NO_CLAIMED_REG;
     return node;
 }
 
 struct ir_node *ir_alloca_init(enum data_type dt, uint16_t ptr_depth, uint64_t idx)
 {
-    struct ir_alloca *ir = weak_calloc(1, sizeof (struct ir_alloca));
+    struct ir_alloca *ir = ir_new(struct ir_alloca);
     ir->dt = dt;
     ir->ptr_depth = ptr_depth;
     ir->idx = idx;
@@ -50,7 +82,7 @@ struct ir_node *ir_alloca_array_init(
     uint64_t        enclosure_lvls_size,
     uint64_t         idx
 ) {
-    struct ir_alloca_array *ir = weak_calloc(1, sizeof (struct ir_alloca_array));
+    struct ir_alloca_array *ir = ir_new(struct ir_alloca_array);
     ir->dt = dt;
     ir->arity_size = enclosure_lvls_size;
     ir->idx = idx;
@@ -61,7 +93,7 @@ struct ir_node *ir_alloca_array_init(
 
 struct ir_node *ir_imm_bool_init(bool imm)
 {
-    struct ir_imm *ir = weak_calloc(1, sizeof (struct ir_imm));
+    struct ir_imm *ir = ir_new(struct ir_imm);
     ir->imm.__bool = imm;
     ir->type = IMM_BOOL;
     return ir_node_init(IR_IMM, ir);
@@ -69,7 +101,7 @@ struct ir_node *ir_imm_bool_init(bool imm)
 
 struct ir_node *ir_imm_char_init(char imm)
 {
-    struct ir_imm *ir = weak_calloc(1, sizeof (struct ir_imm));
+    struct ir_imm *ir = ir_new(struct ir_imm);
     ir->imm.__char = imm;
     ir->type = IMM_CHAR;
     return ir_node_init(IR_IMM, ir);
@@ -77,7 +109,7 @@ struct ir_node *ir_imm_char_init(char imm)
 
 struct ir_node *ir_imm_float_init(float imm)
 {
-    struct ir_imm *ir = weak_calloc(1, sizeof (struct ir_imm));
+    struct ir_imm *ir = ir_new(struct ir_imm);
     ir->imm.__float = imm;
     ir->type = IMM_FLOAT;
     return ir_node_init(IR_IMM, ir);
@@ -85,24 +117,25 @@ struct ir_node *ir_imm_float_init(float imm)
 
 struct ir_node *ir_imm_int_init(uint64_t imm)
 {
-    struct ir_imm *ir = weak_calloc(1, sizeof (struct ir_imm));
+    struct ir_imm *ir = ir_new(struct ir_imm);
     ir->imm.__int = imm;
     ir->type = IMM_INT;
     return ir_node_init(IR_IMM, ir);
 }
 
-struct ir_node *ir_string_init(uint64_t len, char *imm)
+struct ir_node *ir_string_init(uint64_t len, const char *imm)
 {
     assert(imm);
-    struct ir_string *ir = weak_calloc(1, sizeof (struct ir_string));
+    struct ir_string *ir = ir_new(struct ir_string);
     ir->len = len;
-    ir->imm = imm;
+    ir->imm = ir_alloc(len + 1);
+    memcpy(ir->imm, imm, len);
     return ir_node_init(IR_STRING, ir);
 }
 
 struct ir_node *ir_sym_init(uint64_t idx)
 {
-    struct ir_sym *ir = weak_calloc(1, sizeof (struct ir_sym));
+    struct ir_sym *ir = ir_new(struct ir_sym);
     ir->deref = 0;
     ir->addr_of = 0;
     ir->idx = idx;
@@ -112,7 +145,7 @@ struct ir_node *ir_sym_init(uint64_t idx)
 
 struct ir_node *ir_sym_ptr_init(uint64_t idx)
 {
-    struct ir_sym *ir = weak_calloc(1, sizeof (struct ir_sym));
+    struct ir_sym *ir = ir_new(struct ir_sym);
     ir->deref = 1;
     ir->idx = idx;
     ir->ssa_idx = UINT64_MAX;
@@ -126,7 +159,7 @@ struct ir_node *ir_store_init(struct ir_node *idx, struct ir_node *body)
     ) && (
         "Store instruction expects symbol or array access operator as target"
     ));
-    struct ir_store *ir = weak_calloc(1, sizeof (struct ir_store));
+    struct ir_store *ir = ir_new(struct ir_store);
     ir->idx = idx;
     ir->body = body;
 
@@ -150,14 +183,14 @@ struct ir_node *ir_store_sym_init(uint64_t idx, struct ir_node *body)
 
 struct ir_node *ir_push_init(int reg)
 {
-    struct ir_push *push = weak_calloc(1, sizeof (struct ir_push));
+    struct ir_push *push = ir_new(struct ir_push);
     push->reg = reg;
     return ir_node_init(IR_PUSH, push);
 }
 
 struct ir_node *ir_pop_init(int reg)
 {
-    struct ir_pop *pop = weak_calloc(1, sizeof (struct ir_pop));
+    struct ir_pop *pop = ir_new(struct ir_pop);
     pop->reg = reg;
     return ir_node_init(IR_POP, pop);
 }
@@ -173,27 +206,34 @@ struct ir_node *ir_bin_init(enum token_type op, struct ir_node *lhs, struct ir_n
     )) && (
         "Binary operation expects variable, immediate value or array access operator"
     ));
-    struct ir_bin *ir = weak_calloc(1, sizeof (struct ir_bin));
+    struct ir_bin *ir = ir_new(struct ir_bin);
     ir->op = op;
     ir->lhs = lhs;
     ir->rhs = rhs;
     return ir_node_init(IR_BIN, ir);
 }
 
-struct ir_node *ir_jump_init(uint64_t idx)
+struct ir_label *ir_label_init(struct ir_node *target)
 {
-    struct ir_jump *ir = weak_calloc(1, sizeof (struct ir_jump));
-    ir->idx = idx;
+    struct ir_label *label = ir_new(struct ir_label);
+    label->target = target;
+    return label;
+}
+
+struct ir_node *ir_jump_init(struct ir_label *label)
+{
+    struct ir_jump *ir = ir_new(struct ir_jump);
+    ir->label = label;
     ++ir_instr_idx;
     return ir_node_init(IR_JUMP, ir);
 }
 
-struct ir_node *ir_cond_init(struct ir_node *cond, uint64_t goto_label)
+struct ir_node *ir_cond_init(struct ir_node *cond, struct ir_label *label)
 {
     assert(cond->type == IR_BIN && "Only binary instruction supported as condition body");
-    struct ir_cond *ir = weak_calloc(1, sizeof (struct ir_cond));
+    struct ir_cond *ir = ir_new(struct ir_cond);
     ir->cond = cond;
-    ir->goto_label = goto_label;
+    ir->label = label;
     ++ir_instr_idx;
     return ir_node_init(IR_COND, ir);
 }
@@ -207,7 +247,7 @@ struct ir_node *ir_ret_init(struct ir_node *body)
         ) && (
             "Ret expects immediate value or variable"
         ));
-    struct ir_ret *ir = weak_calloc(1, sizeof (struct ir_ret));
+    struct ir_ret *ir = ir_new(struct ir_ret);
     ir->body = body;
     ir->is_void = ir->body == NULL;
     /* Return operand is inline instruction. */
@@ -217,7 +257,7 @@ struct ir_node *ir_ret_init(struct ir_node *body)
 
 struct ir_node *ir_member_init(uint64_t idx, uint64_t field_idx)
 {
-    struct ir_member *ir = weak_calloc(1, sizeof (struct ir_member));
+    struct ir_member *ir = ir_new(struct ir_member);
     ir->idx = idx;
     ir->field_idx = field_idx;
     return ir_node_init(IR_MEMBER, ir);
@@ -238,7 +278,7 @@ struct ir_node *ir_type_decl_init(const char *name, struct ir_node *decls)
             it = it->next;
         }
     })
-    struct ir_type_decl *ir = weak_calloc(1, sizeof (struct ir_type_decl));
+    struct ir_type_decl *ir = ir_new(struct ir_type_decl);
     ir->name = name;
     ir->decls = decls;
     return ir_node_init(IR_TYPE_DECL, ir);
@@ -247,7 +287,7 @@ struct ir_node *ir_type_decl_init(const char *name, struct ir_node *decls)
 struct ir_node *ir_fn_decl_init(
     enum data_type  ret_type,
     uint64_t        ptr_depth,
-    char           *name,
+    const char     *name,
     struct ir_node *args,
     struct ir_node *body
 ) {
@@ -261,7 +301,7 @@ struct ir_node *ir_fn_decl_init(
             it = it->next;
         }
     })
-    struct ir_fn_decl *ir = weak_calloc(1, sizeof (struct ir_fn_decl));
+    struct ir_fn_decl *ir = ir_new(struct ir_fn_decl);
     ir->ret_type = ret_type;
     ir->ptr_depth = ptr_depth;
     ir->name = name;
@@ -270,7 +310,7 @@ struct ir_node *ir_fn_decl_init(
     return ir_node_init(IR_FN_DECL, ir);
 }
 
-struct ir_node *ir_fn_call_init(char *name, struct ir_node *args)
+struct ir_node *ir_fn_call_init(const char *name, struct ir_node *args)
 {
     __weak_debug({
         struct ir_node *it = args;
@@ -285,7 +325,7 @@ struct ir_node *ir_fn_call_init(char *name, struct ir_node *args)
             it = it->next;
         }
     })
-    struct ir_fn_call *ir = weak_calloc(1, sizeof (struct ir_fn_call));
+    struct ir_fn_call *ir = ir_new(struct ir_fn_call);
     ir->name = name;
     ir->args = args;
     ++ir_instr_idx;
@@ -297,7 +337,7 @@ wur struct ir_node *ir_phi_init(
     uint64_t op_1_idx,
     uint64_t op_2_idx
 ) {
-    struct ir_phi *ir = weak_calloc(1, sizeof (struct ir_phi));
+    struct ir_phi *ir = ir_new(struct ir_phi);
     ir->sym_idx = sym_idx;
     ir->op_1_idx = op_1_idx;
     ir->op_2_idx = op_2_idx;
@@ -305,113 +345,145 @@ wur struct ir_node *ir_phi_init(
     return ir_node_init(IR_PHI, ir);
 }
 
-static void ir_string_cleanup(struct ir_string *ir)
+/* Grow table of `elem_size` elements to hold `idx`.
+   New elements are zeroed. */
+static void side_table_grow(void **table, uint64_t *size, uint64_t idx, uint64_t elem_size)
 {
-    weak_free(ir->imm);
+    uint64_t new_size = *size ? *size * 2 : 64;
+
+    while (new_size <= idx)
+        new_size *= 2;
+
+    *table = weak_realloc(*table, new_size * elem_size);
+    memset((char *) *table + *size * elem_size, 0, (new_size - *size) * elem_size);
+    *size = new_size;
 }
 
-static void ir_store_cleanup(struct ir_store *ir)
+struct ir_dom *ir_dom(struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    ir_node_cleanup(ir->idx);
-    ir_node_cleanup(ir->body);
+    if (unlikely(ir->instr_idx >= decl->dom_size))
+        side_table_grow((void **) &decl->dom, &decl->dom_size, ir->instr_idx, sizeof (struct ir_dom));
+
+    return &decl->dom[ir->instr_idx];
 }
 
-static void ir_bin_cleanup(struct ir_bin *ir)
+struct ir_block *ir_block(struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    ir_node_cleanup(ir->lhs);
-    ir_node_cleanup(ir->rhs);
+    if (ir->instr_idx >= decl->block_of_size)
+        return NULL;
+
+    return decl->block_of[ir->instr_idx];
 }
 
-static void ir_cond_cleanup(struct ir_cond *ir)
+void ir_block_set(struct ir_fn_decl *decl, struct ir_node *ir, struct ir_block *block)
 {
-    ir_node_cleanup(ir->cond);
+    if (unlikely(ir->instr_idx >= decl->block_of_size))
+        side_table_grow((void **) &decl->block_of, &decl->block_of_size, ir->instr_idx, sizeof (struct ir_block *));
+
+    decl->block_of[ir->instr_idx] = block;
 }
 
-static void ir_ret_cleanup(struct ir_ret *ir)
+uint64_t ir_block_no(struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    if (ir->body)
-        ir_node_cleanup(ir->body);
+    if (ir->instr_idx >= decl->block_no_size)
+        return 0;
+
+    return decl->block_no[ir->instr_idx];
 }
 
-static void ir_type_decl_cleanup(struct ir_type_decl *ir)
+void ir_block_no_set(struct ir_fn_decl *decl, struct ir_node *ir, uint64_t no)
 {
-    struct ir_node *it = ir->decls;
-    while (it) {
-        ir_node_cleanup(it);
-        it = it->next;
-    }
+    if (unlikely(ir->instr_idx >= decl->block_no_size))
+        side_table_grow((void **) &decl->block_no, &decl->block_no_size, ir->instr_idx, sizeof (uint64_t));
+
+    decl->block_no[ir->instr_idx] = no;
 }
 
-static void ir_fn_decl_cleanup(struct ir_fn_decl *ir)
+ir_vector_t *ir_ddg(struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    struct ir_node *it = ir->args;
-    while (it) {
-        ir_node_cleanup(it);
-        it = it->next;
-    }
+    if (unlikely(ir->instr_idx >= decl->ddg_size))
+        side_table_grow((void **) &decl->ddg, &decl->ddg_size, ir->instr_idx, sizeof (ir_vector_t));
 
-    it = ir->body;
-    while (it) {
-        ir_node_cleanup(it);
-        it = it->next;
+    return &decl->ddg[ir->instr_idx];
+}
+
+void ir_fn_decl_blocks_cleanup(struct ir_fn_decl *decl)
+{
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *block = vector_at(decl->blocks, i);
+
+        vector_free(block->preds);
+        vector_free(block->succs);
+        vector_free(block->idom_back);
+        vector_free(block->df);
+        weak_free(block);
     }
 
-    weak_free(ir->name);
+    vector_free(decl->blocks);
+    weak_free(decl->block_of);
+    weak_free(decl->block_no);
+    decl->block_of = NULL;
+    decl->block_of_size = 0;
+    decl->block_no = NULL;
+    decl->block_no_size = 0;
 }
-static void ir_fn_call_cleanup(struct ir_fn_call *ir)
+
+void ir_fn_decl_tables_cleanup(struct ir_fn_decl *decl)
 {
-    struct ir_node *it = ir->args;
-    while (it) {
-        ir_node_cleanup(it);
-        it = it->next;
-    }
+    for (uint64_t i = 0; i < decl->dom_size; ++i)
+        vector_free(decl->dom[i].idom_back);
+
+    ir_fn_decl_blocks_cleanup(decl);
 
-    weak_free(ir->name);
+    for (uint64_t i = 0; i < decl->ddg_size; ++i)
+        vector_free(decl->ddg[i]);
+
+    weak_free(decl->dom);
+    weak_free(decl->ddg);
+    decl->dom = NULL;
+    decl->ddg = NULL;
+    decl->dom_size = 0;
+    decl->ddg_size = 0;
 }
 
 void ir_node_cleanup(struct ir_node *ir)
 {
-    switch (ir->type) {
-    case IR_ALLOCA:
-    case IR_ALLOCA_ARRAY:
-    case IR_IMM:
-    case IR_SYM:
-    case IR_JUMP:
-    case IR_PUSH:
-    case IR_POP:
-    case IR_MEMBER:
-    case IR_PHI: /* Fall through. */
-        /* Nothing to clean except ir->ir itself. */
-        break;
-    case IR_STRING:       ir_string_cleanup(ir->ir); break;
-    case IR_STORE:        ir_store_cleanup(ir->ir); break;
-    case IR_BIN:          ir_bin_cleanup(ir->ir); break;
-    case IR_COND:         ir_cond_cleanup(ir->ir); break;
-    case IR_RET:          ir_ret_cleanup(ir->ir); break;
-    case IR_TYPE_DECL:    ir_type_decl_cleanup(ir->ir); break;
-    case IR_FN_DECL:
-        ir_fn_decl_cleanup(ir->ir); break;
-    case IR_FN_CALL:
-        ir_fn_call_cleanup(ir->ir); break;
-    default:
-        weak_unreachable("Unknown IR type (numeric: %d).", ir->type);
-    }
-
-    vector_clear(ir->idom_back);
-    vector_clear(ir->ddg_stmts);
-    vector_clear(ir->df);
-    weak_free(ir->ir);
-    weak_free(ir);
+    /* Node and its payload are owned by the arena. */
+    vector_free(ir->cfg.succs);
+    vector_free(ir->cfg.preds);
 }
 
 void ir_unit_cleanup(struct ir_unit *ir)
 {
-    struct ir_node *it = ir->fn_decls;
+    struct ir_arena *arena = ir->arena;
+    struct ir_node  *it    = ir->fn_decls;
 
+    /* Only function declarations and top-level statements
+       carry CFG edges. Operands do not. Analysis tables
+       are owned by function declarations. */
     while (it) {
+        struct ir_fn_decl *decl = it->ir;
+        struct ir_node    *stmt = decl->body;
+
+        while (stmt) {
+            ir_node_cleanup(stmt);
+            stmt = stmt->next;
+        }
+
+        ir_fn_decl_tables_cleanup(decl);
+        vector_free(decl->labels);
         ir_node_cleanup(it);
         it = it->next;
     }
+
+    if (ir_arena == arena)
+        ir_arena = NULL;
+
+    arena_release(&arena->mem);
+    weak_free(arena);
+
+    ir->fn_decls = NULL;
+    ir->arena = NULL;
 }
 
 /*
@@ -12,10 +12,12 @@
 #include "middle_end/ir/ir_ops.h"
 #include "middle_end/ir/meta.h"
 #include "middle_end/ir/type.h"
+#include "util/arena.h"
 #include "util/compiler.h"
 #include "util/vector.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 enum ir_type {
     IR_ALLOCA,
@@ -84,27 +86,15 @@ enum {
     2) Control flow links (jump targets, other CFG edges)
        are represented in
        - `next_else` in case of false branch of condition;
-       - `*instr*->target` in case of specific instruction
+       - `*instr*->label` in case of specific instruction
          jump (ir_jump, ir_cond).
        - `prev` array. */
 struct ir_node {
     enum ir_type        type;
+    /** Used by register allocator. */
+    int                 claimed_reg;
     uint64_t            instr_idx;
     void               *ir;
-    /** Immediate dominator. Used to compute dominator tree. */
-    struct ir_node     *idom;
-    /** Backward edges of dominator tree. Maximum 2 (binary tree property). */
-    ir_vector_t         idom_back;
-    /** Dominance frontier. */
-    ir_vector_t         df;
-    /** Number of basic block in CFG to which current node is associated. */
-    uint64_t            cfg_block_no;
-
-    /** Data dependence graph.
-       
-        This array shows, on which data operations
-        this statement depends. */
-    ir_vector_t         ddg_stmts;
 
     struct ir_node     *prev;
     struct ir_node     *next;
@@ -117,8 +107,47 @@ struct ir_node {
         If type is IR_META_UNKNOWN, there is no metadata for given
         node. */
     struct meta         meta;
-    /** Used by register allocator. */
-    int                 claimed_reg;
+};
+
+/** Dominator tree data of statement. */
+struct ir_dom {
+    /** Immediate dominator. */
+    struct ir_node     *idom;
+    /** Backward edges of dominator tree. Made only by
+        SSA construction, other passes use dominator tree
+        of basic blocks. */
+    ir_vector_t         idom_back;
+};
+
+struct ir_block;
+
+typedef vector_t(struct ir_block *) ir_block_vector_t;
+
+/** Basic block. Range of statements from `first` to `last`
+    in IR list, entered only at first statement and left
+    only after last one.
+
+    Blocks are made by ir_cfg_build() after generation, kept
+    by edits from ir_ops.h and owned by function declaration.
+    Control flow and dominator algorithms work on blocks
+    instead of single statements. */
+struct ir_block {
+    /** Index in ir_fn_decl.blocks. */
+    uint64_t            idx;
+    /** Leader statement. Can be jump target. */
+    struct ir_node     *first;
+    /** Jump, condition, return or statement followed by
+        leader of other block. */
+    struct ir_node     *last;
+    ir_block_vector_t   preds;
+    ir_block_vector_t   succs;
+    /** Immediate dominator. Entry block is immediate dominator
+        of itself. NULL if block is not reachable from entry. */
+    struct ir_block    *idom;
+    /** Children in dominator tree. */
+    ir_block_vector_t   idom_back;
+    /** Dominance frontier. */
+    ir_block_vector_t   df;
 };
 
 /** All information contained about processed file.
@@ -126,7 +155,19 @@ struct ir_node {
     attributes and other configuration. */
 struct ir_unit {
     /** Linked list of function declarations. */
-    struct ir_node *fn_decls;
+    struct ir_node  *fn_decls;
+    /** Memory of all nodes, payloads and names of this unit. */
+    struct ir_arena *arena;
+};
+
+/** Region owning every IR node of single unit.
+
+    Nodes are never freed one by one. Whole arena is released
+    by ir_unit_cleanup(). */
+struct ir_arena {
+    struct arena     mem;
+    /** Number of allocated IR nodes. */
+    uint64_t         nodes;
 };
 
 struct ir_alloca {
@@ -221,13 +262,20 @@ struct ir_pop {
     int reg;
 };
 
-struct ir_jump {
-    /** Instruction index where to jump. */
-    uint64_t         idx;
-    /** Pointer to node at given \c idx. */
+/** Jump target. Label is shared by all jumps to the same
+    place, so it is bound to statement once and moved
+    together with all its jumps. */
+struct ir_label {
+    /** Statement where to jump. */
     struct ir_node  *target;
 };
 
+typedef vector_t(struct ir_label *) ir_label_vector_t;
+
+struct ir_jump {
+    struct ir_label *label;
+};
+
 struct ir_cond {
     /** Condition. Requires binary operator as
         operand. In case of expressions like
@@ -236,10 +284,8 @@ struct ir_cond {
           if cmpneq x, 0.
         Requires only binary IR instruction. */
     struct ir_node  *cond;
-    /** Instruction index where to jump. */
-    uint64_t         goto_label;
-    /** Pointer to node at given \c goto_label. */
-    struct ir_node  *target;
+    /** Where to jump if condition is true. */
+    struct ir_label *label;
 };
 
 struct ir_ret {
@@ -276,17 +322,44 @@ struct ir_fn_decl {
     enum data_type   ret_type;
     uint64_t         ptr_depth;
     /** Name instead of index required though
-        (to be able to view something at all in assembly file). */
-    char            *name;
+        (to be able to view something at all in assembly file).
+
+        \note Interned. */
+    const char      *name;
     /** Accepted values:
         - struct ir_alloca (primitive type),
         - struct ir_type_decl_t (compound type, nested). */
     struct ir_node  *args;
     struct ir_node  *body;
+    /** All labels bound to statements of body, also ones
+        no jump leads to, so erase of statement can move
+        each of them. */
+    ir_label_vector_t labels;
+
+    /** Analysis data of body statements, indexed by
+        `instr_idx`. Each table is filled by one pass and
+        not needed by others, so it is kept out of
+        struct ir_node. Tables are allocated on first
+        access, see ir_dom() and ir_ddg(). */
+    struct ir_dom   *dom;
+    uint64_t         dom_size;
+    /** Basic blocks. Entry block is first. Blocks emptied
+        by edits stay here without statements and edges. */
+    ir_block_vector_t blocks;
+    /** Block of each statement, see ir_block(). */
+    struct ir_block **block_of;
+    uint64_t         block_of_size;
+    /** Number of block in dumps, see ir_block_no(). */
+    uint64_t        *block_no;
+    uint64_t         block_no_size;
+    /** Data dependence graph. Shows, on which data
+        operations statement depends. */
+    ir_vector_t     *ddg;
+    uint64_t         ddg_size;
 };
 
 struct ir_fn_call {
-    char            *name;
+    const char      *name; /** \note Interned. */
     /** Accepted values:
         - struct ir_sym,
         - struct ir_imm.
@@ -304,6 +377,23 @@ struct ir_phi {
 
 void ir_reset_state();
 
+/** Create new arena and make it current. Every ir_*_init() call
+    allocates from the current arena.
+
+    \note Passes that create nodes after generation (optimizers,
+          SSA, register allocation, unflattening) get the unit
+          and select its arena by ir_arena_set() on entry. */
+wur struct ir_arena *ir_arena_init();
+void ir_arena_set(struct ir_arena *arena);
+
+/** Allocate zeroed memory from the current arena. */
+wur void *ir_alloc(uint64_t size);
+
+#define ir_new(type) ir_alloc(sizeof (type))
+
+/** Print amount of nodes and bytes allocated for unit. */
+void ir_unit_dump_stats(FILE *stream, struct ir_unit *ir);
+
 wur struct ir_node *ir_node_init(enum ir_type type, void *ir);
 wur struct ir_node *ir_alloca_init(enum data_type dt, uint16_t ptr_depth, uint64_t idx);
 wur struct ir_node *ir_alloca_array_init(
@@ -317,7 +407,7 @@ wur struct ir_node *ir_imm_bool_init(bool imm);
 wur struct ir_node *ir_imm_char_init(char imm);
 wur struct ir_node *ir_imm_float_init(float imm);
 wur struct ir_node *ir_imm_int_init(uint64_t imm);
-wur struct ir_node *ir_string_init(uint64_t len, char *imm);
+wur struct ir_node *ir_string_init(uint64_t len, const char *imm);
 
 wur struct ir_node *ir_sym_init(uint64_t idx);
 wur struct ir_node *ir_sym_ptr_init(uint64_t idx);
@@ -329,19 +419,23 @@ wur struct ir_node *ir_push_init(int reg);
 wur struct ir_node *ir_pop_init(int reg);
 
 wur struct ir_node *ir_bin_init(enum token_type op, struct ir_node *lhs, struct ir_node *rhs);
-wur struct ir_node *ir_jump_init(uint64_t idx);
-wur struct ir_node *ir_cond_init(struct ir_node *cond, uint64_t goto_label);
+/** \note Label can be bound to its target later. */
+wur struct ir_label *ir_label_init(struct ir_node *target);
+wur struct ir_node *ir_jump_init(struct ir_label *label);
+wur struct ir_node *ir_cond_init(struct ir_node *cond, struct ir_label *label);
 wur struct ir_node *ir_ret_init(struct ir_node *body);
 wur struct ir_node *ir_member_init(uint64_t idx, uint64_t field_idx);
 wur struct ir_node *ir_type_decl_init(const char *name, struct ir_node *decls);
+/** \note Function name must be interned. */
 wur struct ir_node *ir_fn_decl_init(
     enum data_type  ret_type,
     uint64_t        ptr_depth,
-    char           *name,
+    const char     *name,
     struct ir_node *args,
     struct ir_node *body
 );
-wur struct ir_node *ir_fn_call_init(char *name, struct ir_node *args);
+/** \note Function name must be interned. */
+wur struct ir_node *ir_fn_call_init(const char *name, struct ir_node *args);
 
 wur struct ir_node *ir_phi_init(
     uint64_t sym_idx,
@@ -349,7 +443,55 @@ wur struct ir_node *ir_phi_init(
     uint64_t op_2_idx
 );
 
+/** Dominator tree data of statement `ir` of function `decl`.
+    Table is grown if needed.
+
+    \note Pointer is valid until next call for statement
+          with greater `instr_idx`. */
+struct ir_dom *ir_dom(struct ir_fn_decl *decl, struct ir_node *ir);
+
+/** Basic block of statement `ir` of function `decl`.
+
+    \note Returns NULL for statements not linked by
+          ir_cfg_build() or ir_ops.h edits. */
+struct ir_block *ir_block(struct ir_fn_decl *decl, struct ir_node *ir);
+
+/** Attach statement `ir` to `block`. Table is grown
+    if needed. */
+void ir_block_set(struct ir_fn_decl *decl, struct ir_node *ir, struct ir_block *block);
+
+/** Legacy number of block of statement `ir`, shown in
+    dumps and used by passes to detect change of block. It
+    does not match ir_block() exactly. Numbers are given by
+    ir_cfg_build(), inserted statement takes number of its
+    neighbour.
+
+    \note Returns 0 for statements without number. */
+uint64_t ir_block_no(struct ir_fn_decl *decl, struct ir_node *ir);
+
+/** Set number of block of statement `ir`. Table is grown
+    if needed. */
+void ir_block_no_set(struct ir_fn_decl *decl, struct ir_node *ir, uint64_t no);
+
+/** Data dependencies of statement `ir` of function `decl`.
+    Table is grown if needed.
+
+    \note Pointer is valid until next call for statement
+          with greater `instr_idx`. */
+ir_vector_t *ir_ddg(struct ir_fn_decl *decl, struct ir_node *ir);
+
+/** Free basic blocks of `decl`, see ir_block() and
+    ir_block_no(). */
+void ir_fn_decl_blocks_cleanup(struct ir_fn_decl *decl);
+
+/** Free analysis tables of `decl`, see ir_dom(),
+    ir_block() and ir_ddg(). */
+void ir_fn_decl_tables_cleanup(struct ir_fn_decl *decl);
+
+/** Free CFG edges attached to node. Node itself stays
+    in the arena. */
 void ir_node_cleanup(struct ir_node *ir);
+/** Release whole unit arena. */
 void ir_unit_cleanup(struct ir_unit *ir);
 
 #endif // WEAK_COMPILER_MIDDLE_END_IR_H
\ No newline at end of file
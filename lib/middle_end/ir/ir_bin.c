@@ -8,6 +8,9 @@
 #include "middle_end/ir/ir.h"
 #include "middle_end/ir/ir_dump.h"
 #include "middle_end/ir/ir_bin.h"
+#include "util/alloc.h"
+#include "util/intern.h"
+#include "util/unreachable.h"
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
@@ -60,6 +63,30 @@
 static void write_node(FILE *mem, struct ir_node *ir);
 static struct ir_node *read_node(FILE *mem);
 
+/* Jump targets are stored as instruction indices and
+   bound to labels when whole function body is read. */
+struct label_ref {
+    struct ir_label *label;
+    uint64_t         idx;
+};
+
+static _Thread_local vector_t(struct label_ref) read_labels;
+
+/* Names are stored as length and bytes. */
+static const char *read_name(FILE *mem)
+{
+    uint64_t len = 0;
+    ir_fread(len);
+
+    char *buf = weak_malloc(len);
+    ir_fread_bytes(buf, len);
+
+    const char *name = intern_n(buf, len);
+    weak_free(buf);
+
+    return name;
+}
+
 /**********************************************
  **                 Alloca                   **
  **********************************************/
@@ -71,7 +98,7 @@ static void write_alloca(FILE *mem, struct ir_node *ir)
 
 static void read_alloca(unused FILE *mem, struct ir_node *ir)
 {
-    struct ir_alloca *alloca = weak_new(struct ir_alloca);
+    struct ir_alloca *alloca = ir_new(struct ir_alloca);
     ir->ir = alloca;
     ir_fread_ptr(alloca);
 }
@@ -87,7 +114,7 @@ static void write_alloca_array(FILE *mem, struct ir_node *ir)
 
 static void read_alloca_array(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_alloca_array *alloca = weak_new(struct ir_alloca_array);
+    struct ir_alloca_array *alloca = ir_new(struct ir_alloca_array);
     ir->ir = alloca;
     ir_fread_ptr(alloca);
 }
@@ -103,7 +130,7 @@ static void write_imm(FILE *mem, struct ir_node *ir)
 
 static void read_imm(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_imm *imm = weak_new(struct ir_imm);
+    struct ir_imm *imm = ir_new(struct ir_imm);
     ir->ir = imm;
 
     ir_fread_ptr(imm);
@@ -121,11 +148,11 @@ static void write_string(unused FILE *mem, unused struct ir_node *ir)
 
 static void read_string(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_string *s = weak_new(struct ir_string);
+    struct ir_string *s = ir_new(struct ir_string);
     ir->ir = s;
 
     ir_fread(s->len);
-    s->imm = weak_calloc(1, s->len);
+    s->imm = ir_alloc(s->len + 1);
     ir_fread_bytes(s->imm, s->len);
 }
 
@@ -140,7 +167,7 @@ static void write_sym(FILE *mem, struct ir_node *ir)
 
 static void read_sym(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_sym *sym = weak_new(struct ir_sym);
+    struct ir_sym *sym = ir_new(struct ir_sym);
     ir->ir = sym;
 
     ir_fread_ptr(sym);
@@ -158,7 +185,7 @@ static void write_store(FILE *mem, struct ir_node *ir)
 
 static void read_store(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_store *store = weak_new(struct ir_store);
+    struct ir_store *store = ir_new(struct ir_store);
     ir->ir = store;
 
     store->idx  = read_node(mem);
@@ -178,7 +205,7 @@ static void write_bin(FILE *mem, struct ir_node *ir)
 
 static void read_bin(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_bin *bin = weak_new(struct ir_bin);
+    struct ir_bin *bin = ir_new(struct ir_bin);
     ir->ir = bin;
 
     ir_fread(bin->op);
@@ -189,18 +216,34 @@ static void read_bin(unused FILE *mem, unused struct ir_node *ir)
 /**********************************************
  **                 Jump                     **
  **********************************************/
+static void write_label(FILE *mem, struct ir_label *label)
+{
+    uint64_t idx = label->target->instr_idx;
+    ir_fwrite(idx);
+}
+
+static struct ir_label *read_label(FILE *mem)
+{
+    struct label_ref ref = {.label = ir_label_init(NULL)};
+
+    ir_fread(ref.idx);
+    vector_push_back(read_labels, ref);
+
+    return ref.label;
+}
+
 static void write_jump(FILE *mem, struct ir_node *ir)
 {
     struct ir_jump *jump = ir->ir;
-    ir_fwrite(jump->idx);
+    write_label(mem, jump->label);
 }
 
 static void read_jump(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_jump *jump = weak_new(struct ir_jump);
+    struct ir_jump *jump = ir_new(struct ir_jump);
     ir->ir = jump;
 
-    ir_fread(jump->idx);
+    jump->label = read_label(mem);
 }
 
 /**********************************************
@@ -210,16 +253,16 @@ static void write_cond(FILE *mem, struct ir_node *ir)
 {
     struct ir_cond *cond = ir->ir;
     write_node(mem, cond->cond);
-    ir_fwrite(cond->goto_label);
+    write_label(mem, cond->label);
 }
 
 static void read_cond(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_cond *cond = weak_new(struct ir_cond);
+    struct ir_cond *cond = ir_new(struct ir_cond);
     ir->ir = cond;
 
     cond->cond = read_node(mem);
-    ir_fread(cond->goto_label);
+    cond->label = read_label(mem);
 }
 
 /**********************************************
@@ -236,7 +279,7 @@ static void write_ret(FILE *mem, struct ir_node *ir)
 
 static void read_ret(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_ret *ret = weak_new(struct ir_ret);
+    struct ir_ret *ret = ir_new(struct ir_ret);
     ir->ir = ret;
 
     ir_fread(ret->is_void);
@@ -290,13 +333,10 @@ static void write_fn_call(unused FILE *mem, unused struct ir_node *ir)
 
 static void read_fn_call(unused FILE *mem, unused struct ir_node *ir)
 {
-    struct ir_fn_call *call = weak_new(struct ir_fn_call);
+    struct ir_fn_call *call = ir_new(struct ir_fn_call);
     ir->ir = call;
 
-    uint64_t len = 0;
-    ir_fread(len);
-    call->name = weak_calloc(1, len);
-    ir_fread_bytes(call->name, len);
+    call->name = read_name(mem);
 
     uint64_t args_num = 0;
     ir_fread(args_num);
@@ -343,10 +383,7 @@ static void write_fn_decl_header(FILE *mem, struct ir_fn_decl *decl)
 
 static void read_fn_decl_header(FILE *mem, struct ir_fn_decl *decl)
 {
-    uint64_t len = 0;
-    ir_fread(len);
-    decl->name = weak_calloc(1, len);
-    ir_fread_bytes(decl->name, len);
+    decl->name = read_name(mem);
     ir_fread(decl->ret_type);
     ir_fread(decl->ptr_depth);
 }
@@ -379,7 +416,7 @@ static void read_fn_decl_args(FILE *mem, struct ir_fn_decl *decl)
 
     ir_vector_t args = {0};
     for (uint64_t i = 0; i < num; ++i) {
-        struct ir_node *ir = weak_new(struct ir_node);
+        struct ir_node *ir = ir_node_init(IR_ALLOCA, NULL);
         read_alloca(mem, ir);
         vector_push_back(args, ir);
     }
@@ -417,6 +454,34 @@ static void write_fn_decl_body(FILE *mem, struct ir_fn_decl *decl)
     }
 }
 
+static void bind_labels(struct ir_fn_decl *decl, ir_vector_t *stmts)
+{
+    uint64_t         max_idx = 0;
+    struct ir_node **targets = NULL;
+
+    vector_foreach(*stmts, i)
+        if (vector_at(*stmts, i)->instr_idx + 1 > max_idx)
+            max_idx = vector_at(*stmts, i)->instr_idx + 1;
+
+    targets = weak_calloc(max_idx, sizeof (*targets));
+
+    vector_foreach(*stmts, i)
+        targets[vector_at(*stmts, i)->instr_idx] = vector_at(*stmts, i);
+
+    vector_foreach(read_labels, i) {
+        struct label_ref *ref = &vector_at(read_labels, i);
+
+        if (ref->idx >= max_idx || !targets[ref->idx])
+            weak_fatal_error("Jump to unknown instruction %lu", ref->idx);
+
+        ref->label->target = targets[ref->idx];
+        vector_push_back(decl->labels, ref->label);
+    }
+
+    vector_free(read_labels);
+    weak_free(targets);
+}
+
 static void read_fn_decl_body(FILE *mem, struct ir_fn_decl *decl)
 {
     uint64_t num = 0;
@@ -433,8 +498,11 @@ static void read_fn_decl_body(FILE *mem, struct ir_fn_decl *decl)
         vector_at(stmts, i + 1);
     }
 
+    bind_labels(decl, &stmts);
+
     decl->body = vector_at(stmts, 0);
     ir_cfg_build(decl);
+    vector_free(stmts);
 }
 
 /**********************************************
@@ -450,7 +518,7 @@ static void write_fn_decl(FILE *mem, struct ir_node *ir)
 
 static void read_fn_decl(FILE *mem, unused struct ir_node *ir)
 {
-    ir->ir = weak_new(struct ir_fn_decl);
+    ir->ir = ir_new(struct ir_fn_decl);
     read_fn_decl_header(mem, ir->ir);
     read_fn_decl_args(mem, ir->ir);
     read_fn_decl_body(mem, ir->ir);
@@ -463,7 +531,6 @@ static void write_node_meta(FILE *mem, struct ir_node *ir)
 {
     ir_fwrite(ir->type);
     ir_fwrite(ir->instr_idx);
-    ir_fwrite(ir->cfg_block_no);
     ir_fwrite(ir->meta);
     ir_fwrite(ir->claimed_reg);
 }
@@ -472,7 +539,6 @@ static void read_node_meta(FILE *mem, struct ir_node *ir)
 {
     ir_fread(ir->type);
     ir_fread(ir->instr_idx);
-    ir_fread(ir->cfg_block_no);
     ir_fread(ir->meta);
     ir_fread(ir->claimed_reg);
 }
@@ -505,7 +571,8 @@ static void write_node(FILE *mem, struct ir_node *ir)
 
 static struct ir_node *read_node(FILE *mem)
 {
-    struct ir_node *ir = weak_new(struct ir_node);
+    /* Type and the rest of meta is overwritten below. */
+    struct ir_node *ir = ir_node_init(IR_ALLOCA, NULL);
 
     read_node_meta(mem, ir);
     /* printf("IR read type: %s\n", ir_type_to_string(ir->type)); */
@@ -557,8 +624,10 @@ static void write_unit(FILE *mem, struct ir_unit *ir)
 static struct ir_unit read_unit(FILE *mem)
 {
     uint64_t num_fns = 0;
+    struct ir_arena *arena = ir_arena_init();
     struct ir_unit unit = {
-        .fn_decls = weak_new(struct ir_node)
+        .fn_decls = ir_node_init(IR_FN_DECL, NULL),
+        .arena    = arena
     };
 
     ir_fread(num_fns);
@@ -50,20 +50,25 @@ static void fprintf_n(FILE *stream, uint32_t count, char c)
  **                Visitors                  **
  **********************************************/
 
-static void ir_dump_alloca(FILE *mem, struct ir_node *ir)
+static void dump_alloca(FILE *mem, enum data_type dt, uint64_t ptr_depth, uint64_t idx, int claimed_reg)
 {
-    struct ir_alloca *alloca = ir->ir;
-
     fprintf(
         mem, "%s %s",
-        data_type_to_string(alloca->dt),
-        alloca->ptr_depth ? "* " : ""
+        data_type_to_string(dt),
+        ptr_depth ? "* " : ""
     );
 
-    if (ir->claimed_reg != IR_NO_CLAIMED_REG)
-        fprintf(mem, "#reg%d", ir->claimed_reg);
+    if (claimed_reg != IR_NO_CLAIMED_REG)
+        fprintf(mem, "#reg%d", claimed_reg);
     else
-        fprintf(mem, "t%lu", alloca->idx);
+        fprintf(mem, "t%lu", idx);
+}
+
+static void ir_dump_alloca(FILE *mem, struct ir_node *ir)
+{
+    struct ir_alloca *alloca = ir->ir;
+
+    dump_alloca(mem, alloca->dt, alloca->ptr_depth, alloca->idx, ir->claimed_reg);
 }
 
 static void ir_dump_alloca_array(FILE *mem, struct ir_alloca_array *ir)
@@ -98,23 +103,28 @@ static void ir_dump_string(FILE *mem, struct ir_string *ir)
     fprintf(mem, "\"%s\"", ir->imm);
 }
 
-static void ir_dump_sym(FILE *mem, struct ir_node *ir)
+static void dump_sym(FILE *mem, bool deref, bool addr_of, uint64_t idx, uint64_t ssa_idx, int claimed_reg)
 {
-    struct ir_sym *sym = ir->ir;
-
-    if (sym->deref)
+    if (deref)
         fprintf(mem, "*");
 
-    if (sym->addr_of)
+    if (addr_of)
         fprintf(mem, "&");
 
-    if (ir->claimed_reg != IR_NO_CLAIMED_REG)
-        fprintf(mem, "#reg%d", ir->claimed_reg);
+    if (claimed_reg != IR_NO_CLAIMED_REG)
+        fprintf(mem, "#reg%d", claimed_reg);
     else
-        fprintf(mem, "t%lu", sym->idx);
+        fprintf(mem, "t%lu", idx);
+
+    if (ssa_idx != UINT64_MAX)
+        fprintf(mem, ".%lu", ssa_idx);
+}
+
+static void ir_dump_sym(FILE *mem, struct ir_node *ir)
+{
+    struct ir_sym *sym = ir->ir;
 
-    if (sym->ssa_idx != UINT64_MAX)
-        fprintf(mem, ".%lu", sym->ssa_idx);
+    dump_sym(mem, sym->deref, sym->addr_of, sym->idx, sym->ssa_idx, ir->claimed_reg);
 }
 
 static void ir_dump_store(FILE *mem, struct ir_store *ir)
@@ -145,14 +155,14 @@ static void ir_dump_bin(FILE *mem, struct ir_bin *ir)
 
 static void ir_dump_jump(FILE *mem, struct ir_jump *ir)
 {
-    fprintf(mem, "jmp L%lu", ir->idx);
+    fprintf(mem, "jmp L%lu", ir->label->target->instr_idx);
 }
 
 static void ir_dump_cond(FILE *mem, struct ir_cond *ir)
 {
     fprintf(mem, "if ");
     ir_dump_node(mem, ir->cond);
-    fprintf(mem, " goto L%lu", ir->goto_label);
+    fprintf(mem, " goto L%lu", ir->label->target->instr_idx);
 }
 
 static void ir_dump_ret(FILE *mem, struct ir_ret *ir)
@@ -290,33 +300,164 @@ void ir_dump_unit(FILE *mem, struct ir_unit *unit)
     }
 }
 
+/**********************************************
+ **               Flat form                  **
+ **********************************************/
+
+static void flat_dump_instr(FILE *mem, const struct ir_flat_fn *fn, const struct ir_flat_instr *instr, const struct ir_flat_info *info);
+
+static void flat_dump_op(FILE *mem, const struct ir_flat_fn *fn, const struct ir_flat_op *op)
+{
+    switch (op->kind) {
+    case IR_FLAT_OP_NONE:
+        break;
+    case IR_FLAT_OP_IMM: {
+        struct ir_imm imm = {
+            .type = op->imm_type,
+            .imm  = op->imm
+        };
+        ir_dump_imm(mem, &imm);
+        break;
+    }
+    case IR_FLAT_OP_REF:
+        flat_dump_instr(mem, fn, &vector_at(fn->values, op->ref), &vector_at(fn->values_info, op->ref));
+        break;
+    default:
+        weak_unreachable("Unknown operand kind (numeric: %d).", op->kind);
+    }
+}
+
+static void flat_dump_fn_call(FILE *mem, const struct ir_flat_fn *fn, const struct ir_flat_instr *instr)
+{
+    fprintf(mem, "call %s(", instr->call.name);
+    for (uint32_t i = 0; i < instr->call.args_size; ++i) {
+        flat_dump_op(mem, fn, &vector_at(fn->args, instr->call.args + i));
+        if (i < instr->call.args_size - 1)
+            fprintf(mem, ", ");
+    }
+    fprintf(mem, ")");
+}
+
+static void flat_dump_instr(FILE *mem, const struct ir_flat_fn *fn, const struct ir_flat_instr *instr, const struct ir_flat_info *info)
+{
+    switch (instr->type) {
+    case IR_ALLOCA:
+        dump_alloca(mem, instr->aux, instr->alloca.ptr_depth, instr->alloca.idx, info->claimed_reg);
+        break;
+    case IR_SYM:
+        dump_sym(
+            mem,
+            instr->flags & IR_FLAT_DEREF,
+            instr->flags & IR_FLAT_ADDR_OF,
+            instr->sym.idx,
+            instr->sym.ssa_idx == IR_FLAT_NONE ? UINT64_MAX : instr->sym.ssa_idx,
+            info->claimed_reg
+        );
+        break;
+    case IR_STORE:
+        flat_dump_op(mem, fn, &instr->store.idx);
+        fprintf(mem, " = ");
+        flat_dump_op(mem, fn, &instr->store.body);
+        break;
+    case IR_BIN:
+        flat_dump_op(mem, fn, &instr->bin.lhs);
+        fprintf(mem, " %s ", tok_to_string(instr->aux));
+        flat_dump_op(mem, fn, &instr->bin.rhs);
+        break;
+    case IR_JUMP:
+        fprintf(mem, "jmp L%u", instr->jump.label);
+        break;
+    case IR_COND:
+        fprintf(mem, "if ");
+        flat_dump_op(mem, fn, &instr->cond.cond);
+        fprintf(mem, " goto L%u", instr->cond.label);
+        break;
+    case IR_RET:
+        fprintf(mem, "ret");
+        if (instr->ret.body.kind != IR_FLAT_OP_NONE) {
+            fprintf(mem, " ");
+            flat_dump_op(mem, fn, &instr->ret.body);
+        }
+        break;
+    case IR_FN_CALL:
+        flat_dump_fn_call(mem, fn, instr);
+        break;
+    case IR_PUSH:
+        fprintf(mem, "push #reg%d", instr->push_pop.reg);
+        break;
+    case IR_POP:
+        fprintf(mem, "pop #reg%d", instr->push_pop.reg);
+        break;
+    case IR_ALLOCA_ARRAY: ir_dump_alloca_array(mem, instr->payload); break;
+    case IR_STRING:       ir_dump_string(mem, instr->payload); break;
+    case IR_MEMBER:       ir_dump_member(mem, instr->payload); break;
+    case IR_TYPE_DECL:    ir_dump_type_decl(mem, instr->payload); break;
+    case IR_PHI:          ir_dump_phi(mem, instr->payload); break;
+    default:
+        weak_unreachable("Unknown IR type (numeric: %d).", instr->type);
+    }
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+void ir_dump_flat(FILE *mem, const struct ir_flat_fn *fn)
+{
+    struct ir_fn_decl *decl = fn->decl;
+
+    fprintf(mem, "fun %s(", decl->name);
+    struct ir_node *it = decl->args;
+    while (it) {
+        ir_dump_alloca(mem, it);
+        if (it->next != NULL)
+            fprintf(mem, ", ");
+        it = it->next;
+    }
+    fprintf(mem, "):");
+
+    vector_foreach(fn->stmts, i) {
+        const struct ir_flat_instr *instr = &vector_at(fn->stmts, i);
+        const struct ir_flat_info  *info  = &vector_at(fn->stmts_info, i);
+
+        if (instr->type == IR_PHI)
+            fprintf(mem, "\n            ");
+        else
+            fprintf(mem, "\n% 8lu:   ", instr->instr_idx == IR_FLAT_NONE ? UINT64_MAX : instr->instr_idx);
+        fprintf_n(mem, info->meta.block_depth * 2, ' ');
+        flat_dump_instr(mem, fn, instr, info);
+    }
+    fprintf(mem, "\n");
+}
+#pragma GCC diagnostic pop /* -Wformat */
+
 /**********************************************
  **               Graphviz                   **
  **********************************************/
 
-static void graphviz_single_node(FILE *mem, struct ir_node *ir)
+static void graphviz_single_node(FILE *mem, struct ir_fn_decl *decl, struct ir_node *ir)
 {
     if (ir->type != IR_PHI)
         fprintf(mem, "%lu:   ", ir->instr_idx);
     ir_dump_node(mem, ir);
     fprintf(mem, "\n");
-    ir_dump_dominance_frontier(mem, ir);
+    ir_dump_dominance_frontier(mem, decl, ir);
 }
 
-static void graphviz_node(FILE *mem, struct ir_node *curr, struct ir_node *next)
+static void graphviz_node(FILE *mem, struct ir_fn_decl *decl, struct ir_node *curr, struct ir_node *next)
 {
     fprintf(mem, "    \"");
-    graphviz_single_node(mem, curr);
+    graphviz_single_node(mem, decl, curr);
     fprintf(mem, "\" -> \"");
-    graphviz_single_node(mem, next);
+    graphviz_single_node(mem, decl, next);
     fprintf(mem, "\"\n");
 }
 
-static void graphviz_ddg(FILE *mem, struct ir_node *ir)
+static void graphviz_ddg(FILE *mem, struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    vector_foreach(ir->ddg_stmts, i) {
-        struct ir_node *dependence = vector_at(ir->ddg_stmts, i);
-        graphviz_node(mem, ir, dependence);
+    ir_vector_t *ddgs = ir_ddg(decl, ir);
+
+    vector_foreach(*ddgs, i) {
+        struct ir_node *dependence = vector_at(*ddgs, i);
+        graphviz_node(mem, decl, ir, dependence);
         fprintf(mem, " [style = dotted]\n");
     }
 }
@@ -351,7 +492,7 @@ static void mark_visited(bool *visited, struct ir_node *ir)
  **          Graphviz (IR graph)             **
  **********************************************/
 
-static void graphviz_traverse_ir(FILE *mem, bool *visited, struct ir_node *ir)
+static void graphviz_traverse_ir(FILE *mem, struct ir_fn_decl *decl, bool *visited, struct ir_node *ir)
 {
     if (visited[ir->instr_idx]) return;
 
@@ -369,31 +510,31 @@ static void graphviz_traverse_ir(FILE *mem, bool *visited, struct ir_node *ir)
     case IR_JUMP: {
         mark_visited(visited, ir);
 
-        graphviz_node(mem, ir, ir->next);
-        graphviz_traverse_ir(mem, visited, ir->next);
+        graphviz_node(mem, decl, ir, ir->next);
+        graphviz_traverse_ir(mem, decl, visited, ir->next);
         break;
     }
     case IR_COND: {
         mark_visited(visited, ir);
 
-        graphviz_node(mem, ir, ir->next);
-        graphviz_node(mem, ir, vector_at(ir->cfg.succs, 0));
+        graphviz_node(mem, decl, ir, ir->next);
+        graphviz_node(mem, decl, ir, vector_at(ir->cfg.succs, 0));
         fprintf(mem, " [ label = \"  true\"]\n");
 
-        graphviz_node(mem, ir, vector_at(ir->cfg.succs, 1));
+        graphviz_node(mem, decl, ir, vector_at(ir->cfg.succs, 1));
         fprintf(mem, " [ label = \"  false\"]\n");
 
-        graphviz_traverse_ir(mem, visited, ir->next);
-        graphviz_traverse_ir(mem, visited, vector_at(ir->cfg.succs, 0));
-        graphviz_traverse_ir(mem, visited, vector_at(ir->cfg.succs, 1));
+        graphviz_traverse_ir(mem, decl, visited, ir->next);
+        graphviz_traverse_ir(mem, decl, visited, vector_at(ir->cfg.succs, 0));
+        graphviz_traverse_ir(mem, decl, visited, vector_at(ir->cfg.succs, 1));
         break;
     }
     case IR_RET: {
         mark_visited(visited, ir);
 
         if (ir->next) {
-            graphviz_node(mem, ir, ir->next);
-            graphviz_traverse_ir(mem, visited, ir->next);
+            graphviz_node(mem, decl, ir, ir->next);
+            graphviz_traverse_ir(mem, decl, visited, ir->next);
         }
         break;
     }
@@ -407,7 +548,7 @@ void ir_dump_graph_dot(FILE *mem, struct ir_fn_decl *decl)
     bool visited[8192] = {0};
 
     graphviz_header(mem);
-    graphviz_traverse_ir(mem, visited, decl->body);
+    graphviz_traverse_ir(mem, decl, visited, decl->body);
 
     fprintf(mem, "}\n");
 }
@@ -416,34 +557,34 @@ void ir_dump_graph_dot(FILE *mem, struct ir_fn_decl *decl)
  **             Graphviz (CFG)               **
  **********************************************/
 
-static void graphviz_traverse_cfg(FILE *mem, struct ir_node *ir)
+static void graphviz_traverse_cfg(FILE *mem, struct ir_fn_decl *decl, struct ir_node *ir)
 {
     struct ir_node *it = ir;
     uint64_t cfg_no = 0;
     uint64_t cluster_no = 0;
 
     fprintf(mem, "start -> \"");
-    graphviz_single_node(mem, it);
+    graphviz_single_node(mem, decl, it);
     fprintf(mem, "\"");
 
     while (it) {
         bool should_split = 0;
         bool first = it == ir;
         should_split |= first;
-        should_split |= cfg_no != it->cfg_block_no;
+        should_split |= cfg_no != ir_block_no(decl, it);
         should_split |= it->next && it->next->cfg.preds.count >= 2;
 
         if (should_split) {
             if (!first)
                 fprintf(mem, "} ");
 
-            graphviz_subgraph_header(mem, it->cfg_block_no, &cluster_no);
+            graphviz_subgraph_header(mem, ir_block_no(decl, it), &cluster_no);
         }
 
         switch (it->type) {
         case IR_JUMP: {
             struct ir_jump *jump = it->ir;
-            graphviz_node(mem, it, jump->target);
+            graphviz_node(mem, decl, it, jump->label->target);
             break;
         }
         case IR_COND: {
@@ -451,13 +592,13 @@ static void graphviz_traverse_cfg(FILE *mem, struct ir_node *ir)
                 "Conditional statement requires two \
                 successors");
 
-            graphviz_node(mem, it, vector_at(it->cfg.succs, 1));
+            graphviz_node(mem, decl, it, vector_at(it->cfg.succs, 1));
             fprintf(mem, " [ label = \"  false\"]\n");
 
             fprintf(mem, "} ");
-            graphviz_subgraph_header(mem, it->cfg_block_no, &cluster_no);
+            graphviz_subgraph_header(mem, ir_block_no(decl, it), &cluster_no);
 
-            graphviz_node(mem, it, vector_at(it->cfg.succs, 0));
+            graphviz_node(mem, decl, it, vector_at(it->cfg.succs, 0));
             fprintf(mem, " [ label = \"  true\"]\n");
 
             /* This is reorder trick for dot language.
@@ -473,20 +614,20 @@ static void graphviz_traverse_cfg(FILE *mem, struct ir_node *ir)
         }
         case IR_RET: {
             fprintf(mem, "    \"");
-            graphviz_single_node(mem, it);
+            graphviz_single_node(mem, decl, it);
             fprintf(mem, "\" -> exit\n");
             break;
         }
         default: {
             if (it->next)
-                graphviz_node(mem, it, it->next);
+                graphviz_node(mem, decl, it, it->next);
             break;
         }
         } /* switch */
 
-        graphviz_ddg(mem, it);
+        graphviz_ddg(mem, decl, it);
 
-        cfg_no = it->cfg_block_no;
+        cfg_no = ir_block_no(decl, it);
         it = it->next;
     }
 
@@ -502,7 +643,7 @@ static void graphviz_traverse_cfg(FILE *mem, struct ir_node *ir)
 void ir_dump_cfg(FILE *mem, struct ir_fn_decl *decl)
 {
     graphviz_header(mem);
-    graphviz_traverse_cfg(mem, decl->body);
+    graphviz_traverse_cfg(mem, decl, decl->body);
 
     /* Wierd specific of algorithm above forces
        us to paste extra `}`, but this makes code much
@@ -514,16 +655,20 @@ void ir_dump_cfg(FILE *mem, struct ir_fn_decl *decl)
  **           Dominance frontier             **
  **********************************************/
 
-void ir_dump_dominance_frontier(FILE *mem, struct ir_node *ir)
+void ir_dump_dominance_frontier(FILE *mem, struct ir_fn_decl *decl, struct ir_node *ir)
 {
-    if (ir->df.count == 0)
+    struct ir_block *block = ir_block(decl, ir);
+
+    if (!block || block->df.count == 0)
         return;
 
+    ir_block_vector_t *dfs = &block->df;
+
     fprintf(mem, "DF = {");
-    vector_foreach(ir->df, i) {
-        struct ir_node *df = vector_at(ir->df, i);
+    vector_foreach(*dfs, i) {
+        struct ir_node *df = vector_at(*dfs, i)->first;
         fprintf(mem, "%lu", df->instr_idx);
-        if (i < ir->df.count - 1)
+        if (i < dfs->count - 1)
             fprintf(mem, ", ");
     }
     fprintf(mem, "}\n");
@@ -545,20 +690,21 @@ void ir_dump_dom_tree(FILE *mem, struct ir_fn_decl *decl)
         bool should_split = 0;
         bool first = it == decl->body;
         should_split |= first;
-        should_split |= cfg_no != it->cfg_block_no;
+        should_split |= cfg_no != ir_block_no(decl, it);
         should_split |= it->next && it->next->cfg.preds.count >= 2;
 
         if (should_split) {
             if (!first)
                 fprintf(mem, "} ");
 
-            graphviz_subgraph_header(mem, it->cfg_block_no, &cluster_no);
+            graphviz_subgraph_header(mem, ir_block_no(decl, it), &cluster_no);
         }
 
-        if (it->idom)
-            graphviz_node(mem, it->idom, it);
+        struct ir_node *idom = ir_dom(decl, it)->idom;
+        if (idom)
+            graphviz_node(mem, decl, idom, it);
 
-        cfg_no = it->cfg_block_no;
+        cfg_no = ir_block_no(decl, it);
         it = it->next;
     }
 
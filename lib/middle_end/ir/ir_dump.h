@@ -8,6 +8,7 @@
 #define WEAK_COMPILER_MIDDLE_END_IR_DUMP_H
 
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_flat.h"
 #include <stdio.h>
 
 const char *ir_type_to_string(enum ir_type t);
@@ -22,6 +23,10 @@ void ir_dump(FILE *mem, struct ir_fn_decl *decl);
     \param ir      Pointer to the unit. */
 void ir_dump_unit(FILE *mem, struct ir_unit *unit);
 
+/** Print flat form of function. Output is the same
+    as of ir_dump() for function it was built from. */
+void ir_dump_flat(FILE *mem, const struct ir_flat_fn *fn);
+
 /** Print IR dominator tree.
    
     \param ir      Pointer to the function IR. */
@@ -39,8 +44,8 @@ void ir_dump_dom_tree(FILE *mem, struct ir_fn_decl *decl);
                    mapping to physical register. */
 void ir_dump_node(FILE *mem, struct ir_node *ir);
 
-/** Print dominance frontier for given node. */
-void ir_dump_dominance_frontier(FILE *mem, struct ir_node *ir);
+/** Print dominance frontier of basic block of given node. */
+void ir_dump_dominance_frontier(FILE *mem, struct ir_fn_decl *decl, struct ir_node *ir);
 
 /** Print IR as dot graph. May be used to generate images.
    
@@ -0,0 +1,469 @@
+/* ir_flat.c - Linear, index-based IR of function body.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ir_flat.h"
+#include "middle_end/ir/gen.h"
+#include "middle_end/ir/type.h"
+#include "util/alloc.h"
+#include "util/unreachable.h"
+#include <assert.h>
+#include <string.h>
+
+/**********************************************
+ **                 Build                    **
+ **********************************************/
+
+static uint32_t narrow(uint64_t v)
+{
+    assert(v < IR_FLAT_NONE && "Value does not fit in 32 bits");
+    return v;
+}
+
+/* Optional index, UINT64_MAX if absent. */
+static uint32_t narrow_opt(uint64_t v)
+{
+    return v == UINT64_MAX ? IR_FLAT_NONE : narrow(v);
+}
+
+static uint64_t widen_opt(uint32_t v)
+{
+    return v == IR_FLAT_NONE ? UINT64_MAX : v;
+}
+
+static ir_ref_t flat_value(struct ir_flat_fn *fn, struct ir_node *ir);
+
+static struct ir_flat_op flat_op(struct ir_flat_fn *fn, struct ir_node *ir)
+{
+    struct ir_flat_op op = {0};
+
+    if (!ir)
+        return op;
+
+    if (ir->type == IR_IMM) {
+        struct ir_imm *imm = ir->ir;
+        op.kind = IR_FLAT_OP_IMM;
+        op.imm_type = imm->type;
+        op.typed = imm->type_info.bytes != 0;
+        op.imm = imm->imm;
+        return op;
+    }
+
+    op.kind = IR_FLAT_OP_REF;
+    op.ref = flat_value(fn, ir);
+    return op;
+}
+
+static void flat_call(struct ir_flat_fn *fn, struct ir_fn_call *call, struct ir_flat_instr *out)
+{
+    /* Arguments may contain calls with their own arguments,
+       so range is appended only after all of them are built. */
+    vector_t(struct ir_flat_op) args = {0};
+
+    for (struct ir_node *it = call->args; it; it = it->next) {
+        struct ir_flat_op op = flat_op(fn, it);
+        vector_push_back(args, op);
+    }
+
+    out->aux = call->type_info.dt;
+    out->call.name = call->name;
+    out->call.args = narrow(fn->args.count);
+    out->call.args_size = narrow(args.count);
+    out->call.bytes = narrow(call->type_info.bytes);
+    out->call.ptr_depth = narrow(call->type_info.ptr_depth);
+
+    vector_foreach(args, i) {
+        vector_push_back(fn->args, vector_at(args, i));
+    }
+
+    vector_free(args);
+}
+
+static struct ir_flat_instr flat_instr(struct ir_flat_fn *fn, struct ir_node *ir)
+{
+    struct ir_flat_instr instr = {
+        .type      = ir->type,
+        .instr_idx = narrow_opt(ir->instr_idx)
+    };
+
+    switch (ir->type) {
+    case IR_ALLOCA: {
+        struct ir_alloca *alloca = ir->ir;
+        instr.aux = alloca->dt;
+        instr.alloca.idx = narrow(alloca->idx);
+        instr.alloca.ptr_depth = alloca->ptr_depth;
+        break;
+    }
+    case IR_SYM: {
+        struct ir_sym *sym = ir->ir;
+        instr.flags |= sym->deref ? IR_FLAT_DEREF : 0;
+        instr.flags |= sym->addr_of ? IR_FLAT_ADDR_OF : 0;
+        instr.aux = sym->type_info.dt;
+        instr.sym.idx = narrow(sym->idx);
+        instr.sym.ssa_idx = narrow_opt(sym->ssa_idx);
+        instr.sym.bytes = narrow(sym->type_info.bytes);
+        instr.sym.ptr_depth = narrow(sym->type_info.ptr_depth);
+        break;
+    }
+    case IR_BIN: {
+        struct ir_bin *bin = ir->ir;
+        instr.aux = bin->op;
+        instr.bin.lhs = flat_op(fn, bin->lhs);
+        instr.bin.rhs = flat_op(fn, bin->rhs);
+        break;
+    }
+    case IR_STORE: {
+        struct ir_store *store = ir->ir;
+        instr.store.idx = flat_op(fn, store->idx);
+        instr.store.body = flat_op(fn, store->body);
+        break;
+    }
+    case IR_JUMP: {
+        struct ir_jump *jump = ir->ir;
+        instr.jump.target = IR_FLAT_NONE;
+        instr.jump.label = narrow(jump->label->target->instr_idx);
+        break;
+    }
+    case IR_COND: {
+        struct ir_cond *cond = ir->ir;
+        instr.cond.cond = flat_op(fn, cond->cond);
+        instr.cond.target = IR_FLAT_NONE;
+        instr.cond.label = narrow(cond->label->target->instr_idx);
+        break;
+    }
+    case IR_RET: {
+        struct ir_ret *ret = ir->ir;
+        instr.flags |= ret->is_void ? IR_FLAT_VOID : 0;
+        instr.ret.body = flat_op(fn, ret->body);
+        break;
+    }
+    case IR_FN_CALL:
+        flat_call(fn, ir->ir, &instr);
+        break;
+    case IR_PUSH:
+        instr.push_pop.reg = ((struct ir_push *) ir->ir)->reg;
+        break;
+    case IR_POP:
+        instr.push_pop.reg = ((struct ir_pop *) ir->ir)->reg;
+        break;
+    case IR_ALLOCA_ARRAY:
+    case IR_MEMBER:
+    case IR_STRING:
+    case IR_TYPE_DECL:
+    case IR_PHI:
+        instr.payload = ir->ir;
+        break;
+    default:
+        weak_unreachable("Unknown IR type (numeric: %d).", ir->type);
+    }
+
+    return instr;
+}
+
+static struct ir_flat_info flat_info(struct ir_node *ir)
+{
+    return (struct ir_flat_info) {
+        .meta         = ir->meta,
+        .claimed_reg  = ir->claimed_reg
+    };
+}
+
+static ir_ref_t flat_value(struct ir_flat_fn *fn, struct ir_node *ir)
+{
+    /* Operands are placed before value using them. */
+    struct ir_flat_instr instr = flat_instr(fn, ir);
+    struct ir_flat_info  info  = flat_info(ir);
+
+    vector_push_back(fn->values, instr);
+    vector_push_back(fn->values_info, info);
+
+    return narrow(fn->values.count - 1);
+}
+
+static uint32_t flat_target(uint32_t *stmt_map, uint64_t stmt_map_size, uint32_t label)
+{
+    assert(label < stmt_map_size && stmt_map[label] != IR_FLAT_NONE && "Jump to unknown statement");
+
+    return stmt_map[label];
+}
+
+/* Arrays are filled with known number of elements. */
+#define flat_reserve(vec, n) \
+do { \
+    (vec).data = weak_malloc((n) * sizeof (*(vec).data)); \
+    (vec).size = (n); \
+} while (0)
+
+void ir_flat_build(struct ir_flat_fn *fn, struct ir_fn_decl *decl)
+{
+    uint64_t  stmts    = 0;
+    uint64_t  max_idx  = 0;
+    uint32_t *stmt_map = NULL;
+
+    memset(fn, 0, sizeof (*fn));
+    fn->decl = decl;
+
+    if (!decl->body)
+        return;
+
+    for (struct ir_node *it = decl->body; it; it = it->next) {
+        uint64_t idx = narrow(it->instr_idx);
+
+        ++stmts;
+        if (idx + 1 > max_idx)
+            max_idx = idx + 1;
+    }
+
+    /* Instruction indices are dense within function, so
+       position of jump target is found by plain table. */
+    stmt_map = weak_malloc(max_idx * sizeof (*stmt_map));
+    memset(stmt_map, 0xFF, max_idx * sizeof (*stmt_map));
+
+    flat_reserve(fn->stmts, stmts);
+    flat_reserve(fn->stmts_info, stmts);
+
+    stmts = 0;
+    for (struct ir_node *it = decl->body; it; it = it->next)
+        stmt_map[it->instr_idx] = narrow(stmts++);
+
+    for (struct ir_node *it = decl->body; it; it = it->next) {
+        struct ir_flat_instr instr = flat_instr(fn, it);
+        struct ir_flat_info  info  = flat_info(it);
+
+        vector_push_back(fn->stmts, instr);
+        vector_push_back(fn->stmts_info, info);
+    }
+
+    vector_foreach(fn->stmts, i) {
+        struct ir_flat_instr *instr = &vector_at(fn->stmts, i);
+
+        if (instr->type == IR_JUMP)
+            instr->jump.target = flat_target(stmt_map, max_idx, instr->jump.label);
+
+        if (instr->type == IR_COND)
+            instr->cond.target = flat_target(stmt_map, max_idx, instr->cond.label);
+    }
+
+    weak_free(stmt_map);
+}
+
+void ir_flat_free(struct ir_flat_fn *fn)
+{
+    vector_free(fn->stmts);
+    vector_free(fn->values);
+    vector_free(fn->args);
+    vector_free(fn->stmts_info);
+    vector_free(fn->values_info);
+    fn->decl = NULL;
+}
+
+/**********************************************
+ **                Unflatten                 **
+ **********************************************/
+
+static enum data_type imm_type_to_dt(enum ir_imm_type t)
+{
+    switch (t) {
+    case IMM_BOOL:  return D_T_BOOL;
+    case IMM_CHAR:  return D_T_CHAR;
+    case IMM_INT:   return D_T_INT;
+    case IMM_FLOAT: return D_T_FLOAT;
+    default:
+        weak_unreachable("Unknown data type (numeric: %d)", t);
+    }
+}
+
+static struct ir_node *unflatten_value(struct ir_flat_fn *fn, ir_ref_t ref);
+
+static struct ir_node *unflatten_op(struct ir_flat_fn *fn, const struct ir_flat_op *op)
+{
+    switch (op->kind) {
+    case IR_FLAT_OP_NONE:
+        return NULL;
+    case IR_FLAT_OP_REF:
+        return unflatten_value(fn, op->ref);
+    case IR_FLAT_OP_IMM: {
+        struct ir_imm *imm = ir_new(struct ir_imm);
+        imm->type = op->imm_type;
+        imm->imm = op->imm;
+
+        if (op->typed) {
+            imm->type_info.dt = imm_type_to_dt(imm->type);
+            imm->type_info.bytes = ir_type_size(imm->type_info.dt);
+        }
+
+        return ir_node_init(IR_IMM, imm);
+    }
+    default:
+        weak_unreachable("Unknown operand kind (numeric: %d).", op->kind);
+    }
+}
+
+static void *unflatten_payload(struct ir_flat_fn *fn, const struct ir_flat_instr *instr)
+{
+    switch (instr->type) {
+    case IR_ALLOCA: {
+        struct ir_alloca *alloca = ir_new(struct ir_alloca);
+        alloca->dt = instr->aux;
+        alloca->ptr_depth = instr->alloca.ptr_depth;
+        alloca->idx = instr->alloca.idx;
+        return alloca;
+    }
+    case IR_SYM: {
+        struct ir_sym *sym = ir_new(struct ir_sym);
+        sym->deref = instr->flags & IR_FLAT_DEREF;
+        sym->addr_of = instr->flags & IR_FLAT_ADDR_OF;
+        sym->idx = instr->sym.idx;
+        sym->ssa_idx = widen_opt(instr->sym.ssa_idx);
+        sym->type_info.dt = instr->aux;
+        sym->type_info.ptr_depth = instr->sym.ptr_depth;
+        sym->type_info.bytes = instr->sym.bytes;
+        return sym;
+    }
+    case IR_BIN: {
+        struct ir_bin *bin = ir_new(struct ir_bin);
+        bin->op = instr->aux;
+        bin->lhs = unflatten_op(fn, &instr->bin.lhs);
+        bin->rhs = unflatten_op(fn, &instr->bin.rhs);
+        return bin;
+    }
+    case IR_STORE: {
+        struct ir_store *store = ir_new(struct ir_store);
+        store->idx = unflatten_op(fn, &instr->store.idx);
+        store->body = unflatten_op(fn, &instr->store.body);
+        return store;
+    }
+    case IR_JUMP: {
+        /* Label is bound when all statements are made. */
+        struct ir_jump *jump = ir_new(struct ir_jump);
+        jump->label = ir_label_init(NULL);
+        return jump;
+    }
+    case IR_COND: {
+        struct ir_cond *cond = ir_new(struct ir_cond);
+        cond->cond = unflatten_op(fn, &instr->cond.cond);
+        cond->label = ir_label_init(NULL);
+        return cond;
+    }
+    case IR_RET: {
+        struct ir_ret *ret = ir_new(struct ir_ret);
+        ret->is_void = instr->flags & IR_FLAT_VOID;
+        ret->body = unflatten_op(fn, &instr->ret.body);
+        return ret;
+    }
+    case IR_FN_CALL: {
+        struct ir_fn_call *call = ir_new(struct ir_fn_call);
+        struct ir_node    *last = NULL;
+
+        call->name = instr->call.name;
+        call->type_info.dt = instr->aux;
+        call->type_info.ptr_depth = instr->call.ptr_depth;
+        call->type_info.bytes = instr->call.bytes;
+
+        for (uint32_t i = 0; i < instr->call.args_size; ++i) {
+            struct ir_node *arg = unflatten_op(fn, &vector_at(fn->args, instr->call.args + i));
+
+            if (last)
+                last->next = arg;
+            else
+                call->args = arg;
+            last = arg;
+        }
+        return call;
+    }
+    case IR_PUSH: {
+        struct ir_push *push = ir_new(struct ir_push);
+        push->reg = instr->push_pop.reg;
+        return push;
+    }
+    case IR_POP: {
+        struct ir_pop *pop = ir_new(struct ir_pop);
+        pop->reg = instr->push_pop.reg;
+        return pop;
+    }
+    case IR_ALLOCA_ARRAY:
+    case IR_MEMBER:
+    case IR_STRING:
+    case IR_TYPE_DECL:
+    case IR_PHI:
+        return instr->payload;
+    default:
+        weak_unreachable("Unknown IR type (numeric: %d).", instr->type);
+    }
+}
+
+static struct ir_node *unflatten_instr(
+    struct ir_flat_fn          *fn,
+    const struct ir_flat_instr *instr,
+    const struct ir_flat_info  *info
+) {
+    struct ir_node *node = ir_node_init(instr->type, unflatten_payload(fn, instr));
+
+    node->instr_idx = widen_opt(instr->instr_idx);
+    node->meta = info->meta;
+    node->claimed_reg = info->claimed_reg;
+
+    if (node->type == IR_STORE) {
+        struct ir_store *store = node->ir;
+        if (store->body->type == IR_BIN)
+            ((struct ir_bin *) store->body->ir)->parent = node;
+    }
+
+    return node;
+}
+
+static struct ir_node *unflatten_value(struct ir_flat_fn *fn, ir_ref_t ref)
+{
+    return unflatten_instr(fn, &vector_at(fn->values, ref), &vector_at(fn->values_info, ref));
+}
+
+void ir_flat_unflatten(struct ir_unit *unit, struct ir_flat_fn *fn)
+{
+    struct ir_fn_decl *decl  = fn->decl;
+    struct ir_node    *prev  = NULL;
+    struct ir_node   **nodes = weak_calloc(fn->stmts.count, sizeof (*nodes));
+
+    ir_arena_set(unit->arena);
+
+    for (struct ir_node *it = decl->body; it; it = it->next)
+        ir_node_cleanup(it);
+
+    ir_fn_decl_tables_cleanup(decl);
+    vector_clear(decl->labels);
+    decl->body = NULL;
+
+    vector_foreach(fn->stmts, i) {
+        struct ir_node *node = unflatten_instr(fn, &vector_at(fn->stmts, i), &vector_at(fn->stmts_info, i));
+
+        nodes[i] = node;
+        node->prev = prev;
+        if (prev)
+            prev->next = node;
+        else
+            decl->body = node;
+        prev = node;
+    }
+
+    vector_foreach(fn->stmts, i) {
+        struct ir_flat_instr *instr = &vector_at(fn->stmts, i);
+        struct ir_label      *label = NULL;
+
+        if (instr->type == IR_JUMP) {
+            label = ((struct ir_jump *) nodes[i]->ir)->label;
+            label->target = nodes[instr->jump.target];
+        }
+
+        if (instr->type == IR_COND) {
+            label = ((struct ir_cond *) nodes[i]->ir)->label;
+            label->target = nodes[instr->cond.target];
+        }
+
+        if (label)
+            vector_push_back(decl->labels, label);
+    }
+
+    weak_free(nodes);
+    ir_cfg_build(decl);
+}
@@ -0,0 +1,176 @@
+/* ir_flat.h - Linear, index-based IR of function body.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_MIDDLE_END_IR_FLAT_H
+#define WEAK_COMPILER_MIDDLE_END_IR_FLAT_H
+
+#include "middle_end/ir/ir.h"
+#include "util/compiler.h"
+#include "util/vector.h"
+#include <stdint.h>
+
+/** Function body stored in contiguous arrays of fixed-size
+    instructions.
+
+    Statements are placed in list order, so execution goes
+    forward through memory and only jumps change position.
+    Jump targets are statement indices.
+
+    Operands are placed in separate array of values and
+    referred by 32-bit index. Immediates have no value,
+    they are stored in operand itself.
+
+    Data not needed to walk or execute instructions (meta,
+    CFG block number, claimed register) is kept in parallel
+    arrays, so hot arrays stay small.
+
+    Rare instructions (arrays, structures, strings, phi)
+    keep pointer to their payload in IR arena.
+
+    \note Flat form is built from list and can be turned
+          back into it, see ir_flat_unflatten(). It is not
+          updated by passes working on list. */
+
+/** Index in ir_flat_fn.values or ir_flat_fn.args. */
+typedef uint32_t ir_ref_t;
+
+#define IR_FLAT_NONE UINT32_MAX
+
+enum ir_flat_op_kind {
+    IR_FLAT_OP_NONE,
+    IR_FLAT_OP_IMM,
+    IR_FLAT_OP_REF
+};
+
+/** Operand of instruction. */
+struct ir_flat_op {
+    /** enum ir_flat_op_kind. */
+    uint8_t               kind;
+    /** enum ir_imm_type. */
+    uint8_t               imm_type;
+    /** Immediate has type set by ir_type_pass(). */
+    uint8_t               typed;
+    union {
+        ir_ref_t          ref;
+        union ir_imm_val  imm;
+    };
+};
+
+enum {
+    IR_FLAT_DEREF   = 1 << 0,
+    IR_FLAT_ADDR_OF = 1 << 1,
+    IR_FLAT_VOID    = 1 << 2
+};
+
+struct ir_flat_instr {
+    /** enum ir_type. */
+    uint8_t   type;
+    /** IR_FLAT_DEREF, IR_FLAT_ADDR_OF, IR_FLAT_VOID. */
+    uint8_t   flags;
+    /** Data type of symbol, alloca and call, operator of
+        binary. */
+    uint16_t  aux;
+    /** IR_FLAT_NONE if not set. */
+    uint32_t  instr_idx;
+
+    union {
+        struct {
+            uint32_t idx;
+            uint32_t ptr_depth;
+        } alloca;
+
+        struct {
+            uint32_t idx;
+            /** IR_FLAT_NONE if not in SSA form. */
+            uint32_t ssa_idx;
+            uint32_t bytes;
+            uint32_t ptr_depth;
+        } sym;
+
+        struct {
+            struct ir_flat_op lhs;
+            struct ir_flat_op rhs;
+        } bin;
+
+        struct {
+            struct ir_flat_op idx;
+            struct ir_flat_op body;
+        } store;
+
+        struct {
+            /** Statement index. */
+            uint32_t target;
+            uint32_t label;
+        } jump;
+
+        struct {
+            struct ir_flat_op cond;
+            /** Statement index. */
+            uint32_t          target;
+            uint32_t          label;
+        } cond;
+
+        struct {
+            struct ir_flat_op body;
+        } ret;
+
+        struct {
+            /** Interned. */
+            const char *name;
+            /** Range in ir_flat_fn.args. */
+            uint32_t    args;
+            uint32_t    args_size;
+            uint32_t    bytes;
+            uint32_t    ptr_depth;
+        } call;
+
+        struct {
+            int32_t reg;
+        } push_pop;
+
+        /** IR_ALLOCA_ARRAY, IR_MEMBER, IR_STRING,
+            IR_TYPE_DECL, IR_PHI. */
+        void *payload;
+    };
+};
+
+/** Cold data of instruction. */
+struct ir_flat_info {
+    struct meta meta;
+    int         claimed_reg;
+};
+
+struct ir_flat_fn {
+    /** Name, return type and arguments are read from
+        there. */
+    struct ir_fn_decl *decl;
+
+    vector_t(struct ir_flat_instr) stmts;
+    vector_t(struct ir_flat_instr) values;
+    vector_t(struct ir_flat_op)    args;
+
+    /** Parallel to `stmts` and `values`. */
+    vector_t(struct ir_flat_info)  stmts_info;
+    vector_t(struct ir_flat_info)  values_info;
+};
+
+/** Build flat form of `decl` body. */
+void ir_flat_build(struct ir_flat_fn *fn, struct ir_fn_decl *decl);
+
+/** Replace body of `fn->decl` with list made of `fn`.
+    Jump labels are bound and CFG is built again. CFG
+    edges and analysis tables of old body are freed.
+
+    \note Nodes are allocated from arena of `unit`, which
+          must own `fn->decl`.
+    \note Operand immediates get no meta and no claimed
+          register. Of type information only data type,
+          pointer depth and size are kept. */
+void ir_flat_unflatten(struct ir_unit *unit, struct ir_flat_fn *fn);
+
+void ir_flat_free(struct ir_flat_fn *fn);
+
+#endif // WEAK_COMPILER_MIDDLE_END_IR_FLAT_H
@@ -6,17 +6,354 @@
 
 #include "middle_end/ir/ir_ops.h"
 #include "middle_end/ir/ir.h"
+#include "util/alloc.h"
+#include <assert.h>
 
-void ir_remove(struct ir_node **ir, struct ir_node **list_head)
+/* Replace first `from` in edge vector with `to`. If `to`
+   is NULL, edge is removed. */
+#define edge_replace(vec, from, to) \
+do { \
+    vector_foreach(vec, __i) { \
+        if (vector_at(vec, __i) != (from)) \
+            continue; \
+        if (to) \
+            vector_at(vec, __i) = (to); \
+        else \
+            vector_erase(vec, __i); \
+        break; \
+    } \
+} while (0)
+
+static struct ir_label **label_of(struct ir_node *stmt)
+{
+    switch (stmt->type) {
+    case IR_JUMP: return &((struct ir_jump *) stmt->ir)->label;
+    case IR_COND: return &((struct ir_cond *) stmt->ir)->label;
+    default:      return NULL;
+    }
+}
+
+/* Statement passes control to the next one in list. */
+static bool falls_through(struct ir_node *stmt)
+{
+    return stmt->type != IR_JUMP && stmt->type != IR_RET;
+}
+
+/* Block is left only after its last statement. */
+static bool terminates(struct ir_node *stmt)
+{
+    return !falls_through(stmt) || stmt->type == IR_COND;
+}
+
+/* Previous statement is predecessor the same way as made
+   by ir_cfg_build(): one return does not precede other. */
+static bool precedes(struct ir_node *prev, struct ir_node *stmt)
+{
+    if (prev->type == IR_JUMP)
+        return 0;
+
+    return prev->type != IR_RET || stmt->type != IR_RET;
+}
+
+/* Condition has jump target first and next statement
+   second in successors. */
+static uint64_t fallthrough_edge(struct ir_node *stmt)
+{
+    return stmt->type == IR_COND;
+}
+
+static struct ir_block *block_new(struct ir_fn_decl *decl, struct ir_node *first)
+{
+    struct ir_block *block = weak_calloc(1, sizeof (struct ir_block));
+
+    block->idx   = decl->blocks.count;
+    block->first = first;
+    block->last  = first;
+    vector_push_back(decl->blocks, block);
+    ir_block_set(decl, first, block);
+
+    return block;
+}
+
+/* Entry block must be first. */
+static void block_make_entry(struct ir_fn_decl *decl, struct ir_block *block)
+{
+    struct ir_block *entry = vector_at(decl->blocks, 0);
+
+    vector_at(decl->blocks, 0)          = block;
+    vector_at(decl->blocks, block->idx) = entry;
+    entry->idx                          = block->idx;
+    block->idx                          = 0;
+}
+
+/* Move statements from `at` to the end of `block` to new
+   block, which takes all successors. */
+static struct ir_block *block_split(struct ir_fn_decl *decl, struct ir_block *block, struct ir_node *at)
+{
+    struct ir_block *tail = block_new(decl, at);
+
+    tail->last  = block->last;
+    tail->succs = block->succs;
+    block->last = at->prev;
+    vector_init(block->succs);
+
+    for (struct ir_node *it = at; it != tail->last; it = it->next)
+        ir_block_set(decl, it->next, tail);
+
+    vector_foreach(tail->succs, i)
+        edge_replace(vector_at(tail->succs, i)->preds, block, tail);
+
+    vector_push_back(block->succs, tail);
+    vector_push_back(tail->preds, block);
+
+    return tail;
+}
+
+/* Statement edges of `stmt` put between `prev` and `next`. */
+static void link_edges(struct ir_node *prev, struct ir_node *next, struct ir_node *stmt)
+{
+    if (prev) {
+        if (falls_through(prev)) {
+            if (next)
+                vector_at(prev->cfg.succs, fallthrough_edge(prev)) = stmt;
+            else
+                vector_push_back(prev->cfg.succs, stmt);
+        }
+
+        if (precedes(prev, stmt))
+            vector_push_back(stmt->cfg.preds, prev);
+    }
+
+    if (next) {
+        vector_push_back(stmt->cfg.succs, next);
+
+        if (prev && precedes(prev, next))
+            edge_replace(next->cfg.preds, prev, stmt);
+        else
+            vector_push_back(next->cfg.preds, stmt);
+    }
+}
+
+/* Block of `stmt` put between `prev` and `next`. Statement
+   is added to block of previous one, if it is reached from
+   it. Otherwise `stmt` is only way to enter `next` from
+   previous statement, so new block is made. */
+static void link_block(struct ir_fn_decl *decl, struct ir_node *prev, struct ir_node *next, struct ir_node *stmt)
+{
+    struct ir_block *prev_block = prev ? ir_block(decl, prev) : NULL;
+    struct ir_block *next_block = next ? ir_block(decl, next) : NULL;
+
+    if (prev && !terminates(prev)) {
+        ir_block_set(decl, stmt, prev_block);
+        if (prev_block->last == prev)
+            prev_block->last = stmt;
+        return;
+    }
+
+    /* Beginning of function, which is not jump target. */
+    if (!prev && next && next_block->preds.count == 0) {
+        ir_block_set(decl, stmt, next_block);
+        next_block->first = stmt;
+        return;
+    }
+
+    struct ir_block *block = block_new(decl, stmt);
+
+    if (next) {
+        vector_push_back(block->succs, next_block);
+
+        if (prev && prev->type == IR_COND) {
+            vector_at(prev_block->succs, fallthrough_edge(prev)) = block;
+            vector_push_back(block->preds, prev_block);
+            edge_replace(next_block->preds, prev_block, block);
+        } else
+            vector_push_back(next_block->preds, block);
+    }
+
+    if (!prev)
+        block_make_entry(decl, block);
+}
+
+static void link_between(struct ir_fn_decl *decl, struct ir_node *prev, struct ir_node *next, struct ir_node *stmt)
+{
+    assert(!terminates(stmt) && "Only straight-line statement can be inserted");
+
+    stmt->prev = prev;
+    stmt->next = next;
+    ir_block_no_set(decl, stmt, prev ? ir_block_no(decl, prev) : next ? ir_block_no(decl, next) : 0);
+
+    link_edges(prev, next, stmt);
+    link_block(decl, prev, next, stmt);
+
+    if (prev)
+        prev->next = stmt;
+    else
+        decl->body = stmt;
+
+    if (next)
+        next->prev = stmt;
+}
+
+void ir_insert_before(struct ir_fn_decl *decl, struct ir_node *pos, struct ir_node *stmt)
+{
+    link_between(decl, pos->prev, pos, stmt);
+}
+
+void ir_insert_after(struct ir_fn_decl *decl, struct ir_node *pos, struct ir_node *stmt)
+{
+    link_between(decl, pos, pos->next, stmt);
+}
+
+static void erase_edges(struct ir_fn_decl *decl, struct ir_node *stmt)
+{
+    struct ir_node *prev = stmt->prev;
+    struct ir_node *next = stmt->next;
+
+    vector_foreach(stmt->cfg.succs, i)
+        edge_replace(vector_at(stmt->cfg.succs, i)->cfg.preds, stmt, NULL);
+
+    /* Return is predecessor of next statement without
+       being its successor. */
+    if (stmt->type == IR_RET && next)
+        edge_replace(next->cfg.preds, stmt, NULL);
+
+    /* Jumps to `stmt`. Jump target is first successor. */
+    vector_foreach(stmt->cfg.preds, i) {
+        struct ir_node *pred = vector_at(stmt->cfg.preds, i);
+
+        if (!label_of(pred) || vector_at(pred->cfg.succs, 0) != stmt)
+            continue;
+
+        assert(next && "Jump target cannot be removed from the end");
+        assert(pred != stmt && "Jump to itself cannot be removed");
+
+        vector_at(pred->cfg.succs, 0) = next;
+        vector_push_back(next->cfg.preds, pred);
+    }
+
+    /* Labels, no jump leads to, are moved as well, since
+       they can be used by jumps made later. */
+    vector_foreach(decl->labels, i)
+        if (vector_at(decl->labels, i)->target == stmt)
+            vector_at(decl->labels, i)->target = next;
+
+    if (prev && falls_through(prev)) {
+        if (next)
+            vector_at(prev->cfg.succs, fallthrough_edge(prev)) = next;
+        else
+            vector_erase(prev->cfg.succs, fallthrough_edge(prev));
+    }
+
+    if (prev && next && precedes(prev, next))
+        vector_push_back(next->cfg.preds, prev);
+
+    vector_free(stmt->cfg.preds);
+    vector_free(stmt->cfg.succs);
+}
+
+static void erase_block(struct ir_fn_decl *decl, struct ir_node *stmt)
 {
-    if ((*ir)->next) {
-        if ((*ir)->prev)
-            (*ir)->prev->next = (*ir)->next;
-        (*ir)->next->prev = (*ir)->prev;
+    struct ir_block *block      = ir_block(decl, stmt);
+    struct ir_block *next_block = stmt->next ? ir_block(decl, stmt->next) : NULL;
+
+    ir_block_set(decl, stmt, NULL);
+
+    if (block->first == stmt && block->last == stmt) {
+        /* All ways to block lead now to the next one. */
+        vector_foreach(block->succs, i)
+            edge_replace(vector_at(block->succs, i)->preds, block, NULL);
+
+        vector_foreach(block->preds, i) {
+            struct ir_block *pred = vector_at(block->preds, i);
+
+            edge_replace(pred->succs, block, next_block);
+            if (next_block)
+                vector_push_back(next_block->preds, pred);
+        }
+
+        vector_free(block->preds);
+        vector_free(block->succs);
+        block->first = NULL;
+        block->last  = NULL;
+
+        if (block->idx == 0 && next_block)
+            block_make_entry(decl, next_block);
+        return;
     }
 
-    if (!(*ir)->prev) {
-        (*ir) = (*ir)->next;
-        (*list_head) = (*ir);
+    if (block->first == stmt) {
+        block->first = stmt->next;
+        return;
+    }
+
+    if (block->last != stmt)
+        return;
+
+    block->last = stmt->prev;
+
+    /* Now block falls through to the next one. */
+    if (terminates(stmt)) {
+        vector_foreach(block->succs, i)
+            edge_replace(vector_at(block->succs, i)->preds, block, NULL);
+        vector_free(block->succs);
+
+        if (next_block) {
+            vector_push_back(block->succs, next_block);
+            vector_push_back(next_block->preds, block);
+        }
     }
-}
\ No newline at end of file
+}
+
+void ir_erase(struct ir_fn_decl *decl, struct ir_node *stmt)
+{
+    struct ir_node *prev = stmt->prev;
+    struct ir_node *next = stmt->next;
+
+    erase_block(decl, stmt);
+    erase_edges(decl, stmt);
+
+    if (prev)
+        prev->next = next;
+    else
+        decl->body = next;
+
+    if (next)
+        next->prev = prev;
+
+    stmt->prev = NULL;
+    stmt->next = NULL;
+}
+
+void ir_redirect(struct ir_fn_decl *decl, struct ir_node *branch, struct ir_label *label)
+{
+    struct ir_label **old    = label_of(branch);
+    struct ir_node   *to     = label->target;
+    struct ir_block  *target = ir_block(decl, to);
+
+    assert(old && to && "Branch and bound label expected");
+
+    struct ir_node   *from   = (*old)->target;
+    bool              known  = 0;
+
+    vector_foreach(decl->labels, i)
+        known |= vector_at(decl->labels, i) == label;
+
+    if (!known)
+        vector_push_back(decl->labels, label);
+
+    *old = label;
+    vector_at(branch->cfg.succs, 0) = to;
+    edge_replace(from->cfg.preds, branch, NULL);
+    vector_push_back(to->cfg.preds, branch);
+
+    if (target->first != to)
+        target = block_split(decl, target, to);
+
+    /* Block of branch is known after split. */
+    struct ir_block *block = ir_block(decl, branch);
+    struct ir_block *prev  = vector_at(block->succs, 0);
+
+    vector_at(block->succs, 0) = target;
+    edge_replace(prev->preds, block, NULL);
+    vector_push_back(target->preds, block);
+}
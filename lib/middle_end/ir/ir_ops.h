@@ -11,10 +11,39 @@
 #include <stdbool.h>
 
 struct ir_node;
+struct ir_label;
+struct ir_fn_decl;
 typedef vector_t(struct ir_node *) ir_vector_t;
 
-/** Remove `ir` from IR. If `ir` is a first statement
-    in list, update `list_head`. */
-void ir_remove(struct ir_node **ir, struct ir_node **list_head);
+/* Edits of function body. Each keeps IR list, CFG edges
+   of statements, labels and basic blocks of `decl` valid,
+   so CFG made by ir_cfg_build() after generation is never
+   built again.
 
-#endif // WEAK_COMPILER_MIDDLE_END_IR_OPS_H
\ No newline at end of file
+   Dominator tree and other analysis data is not updated. */
+
+/** Insert `stmt` before `pos`. Jumps to `pos` still lead
+    to `pos`, so `stmt` is reached only from previous
+    statement.
+
+    \note `stmt` cannot be jump, condition or return. */
+void ir_insert_before(struct ir_fn_decl *decl, struct ir_node *pos, struct ir_node *stmt);
+
+/** Insert `stmt` after `pos`.
+
+    \note `stmt` cannot be jump, condition or return. */
+void ir_insert_after(struct ir_fn_decl *decl, struct ir_node *pos, struct ir_node *stmt);
+
+/** Remove `stmt` from body of `decl`. All labels bound to
+    `stmt` (see ir_fn_decl.labels) are moved to the next
+    statement. Block left without statements stays empty
+    and without edges. */
+void ir_erase(struct ir_fn_decl *decl, struct ir_node *stmt);
+
+/** Make jump or condition `branch` lead to `label`. If
+    label target is not first statement of its block,
+    block is split. `label` is added to labels of `decl`
+    if it is new. */
+void ir_redirect(struct ir_fn_decl *decl, struct ir_node *branch, struct ir_label *label);
+
+#endif // WEAK_COMPILER_MIDDLE_END_IR_OPS_H
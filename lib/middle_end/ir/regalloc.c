@@ -6,6 +6,7 @@
 
 #include "middle_end/ir/regalloc.h"
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_ops.h"
 #include <assert.h>
 #include <stdint.h>
 #include <string.h>
@@ -19,7 +20,7 @@
 #define REG_ALLOC_VARS_LIMIT 512
 #define REG_ALLOC_REGS_LIMIT  32
 
-static uint64_t reg_alloc_max_regs =  -1;
+static _Thread_local uint64_t reg_alloc_max_regs =  -1;
 
 struct interference_graph {
     int graph[REG_ALLOC_VARS_LIMIT][REG_ALLOC_VARS_LIMIT];
@@ -37,6 +38,8 @@ struct live_range_info {
 };
 
 struct reg_allocator {
+    /** Function where spill code is put. */
+    struct ir_fn_decl *decl;
     int  color[REG_ALLOC_VARS_LIMIT];
     bool spill[REG_ALLOC_VARS_LIMIT];
     int  reg_free[REG_ALLOC_REGS_LIMIT];
@@ -189,18 +192,6 @@ static void reg_alloc_live_ranges(struct live_range_info *info, struct ir_node *
  **       Register -> IR assignment          **
  **********************************************/
 
-static void ir_insert_before(struct ir_node *curr, struct ir_node *new)
-{
-    struct ir_node *prev = curr->prev;
-
-    prev->next = new;
-    new->prev = prev;
-    new->next = curr;
-    curr->prev = new;
-
-    memcpy(&new->meta, &curr->meta, sizeof (struct meta));
-}
-
 static int select_spill_reg(struct reg_allocator *allocator)
 {
     for (int i = 0; i < reg_alloc_max_regs; i++) {
@@ -220,14 +211,20 @@ static int select_spill_reg(struct reg_allocator *allocator)
 /**       store index */
 static void put_spill(struct ir_node *ir, struct reg_allocator *allocator, int reg)
 {
-    ir_insert_before(ir, ir_push_init(reg));
+    struct ir_node *push = ir_push_init(reg);
+
+    ir_insert_before(allocator->decl, ir, push);
+    memcpy(&push->meta, &ir->meta, sizeof (struct meta));
     /* TODO: Correct mark spill. */
     allocator->reg_free[reg] = 1;
 }
 
 static void put_reload(struct ir_node *ir, struct reg_allocator *allocator, int reg)
 {
-    ir_insert_before(ir, ir_pop_init(reg));
+    struct ir_node *pop = ir_pop_init(reg);
+
+    ir_insert_after(allocator->decl, ir, pop);
+    memcpy(&pop->meta, &ir->meta, sizeof (struct meta));
     /* TODO: Correct mark spill. */
     allocator->reg_free[reg] = 0;
 }
@@ -259,7 +256,7 @@ static void handle_spill(
         allocator->spill[sym->idx] = reg_to_spill;
         allocator->color[sym->idx] = reg_to_spill;
 
-        put_reload(parent->next, allocator, reg_to_spill);
+        put_reload(parent, allocator, reg_to_spill);
 
         parent->claimed_reg = reg_to_spill;
     }
@@ -354,7 +351,7 @@ static void reg_alloc_fn(struct ir_fn_decl *ir)
     /* TODO: function args. */
     struct interference_graph graph           = {0};
     struct live_range_info    live_range_info = {0};
-    struct reg_allocator      allocator       = {0};
+    struct reg_allocator      allocator       = {.decl = ir};
 
     reg_alloc_live_ranges(&live_range_info, ir->body);
     reg_alloc_build_graph(&graph, &live_range_info);
@@ -368,6 +365,10 @@ void ir_reg_alloc(struct ir_unit *unit, uint64_t hardware_regs)
     reg_alloc_max_regs = hardware_regs;
 
     struct ir_node *it = unit->fn_decls;
+
+    /* New nodes must belong to this unit. */
+    ir_arena_set(unit->arena);
+
     while (it) {
         struct ir_fn_decl *decl = it->ir;
         reg_alloc_fn(decl);
@@ -7,7 +7,6 @@
 #include "middle_end/ir/ssa.h"
 #include "middle_end/ir/ir.h"
 #include "middle_end/ir/dom.h"
-#include "middle_end/ir/gen.h"
 #include "middle_end/ir/ir_ops.h"
 #include "util/compiler.h"
 #include "util/hashmap.h"
@@ -55,32 +54,31 @@ static void assigns_destroy(hashmap_t *assigns)
     hashmap_destroy(assigns);
 }
 
-/*  TODO: update all links correctly (IR list and CFG).
-
-    (prev    ) -- next --> (curr    )
-    (prev    ) <- prev --- (curr    )
-
-    (prev    ) -- next --> (new     ) -- next --> (curr    )
-    (prev    ) <- prev --- (new     ) <- prev --- (curr    ) */
-static void ir_insert_before(struct ir_node *curr, struct ir_node *new)
+/* Phi nodes are put before `y` one after another, so
+   predecessor of `y` is taken as it was before them. */
+static struct ir_node *phi_pred(struct ir_node *y)
 {
-    struct ir_node *prev = curr->prev;
+    struct ir_node *pred = vector_at(y->cfg.preds, 0);
 
-    prev->next = new;
-    new->prev = prev;
-    new->next = curr;
-    curr->prev = new;
+    while (pred->type == IR_PHI)
+        pred = vector_at(pred->cfg.preds, 0);
 
-    vector_push_back(prev->cfg.succs, new);
-    vector_push_back(curr->cfg.preds, new);
+    return pred;
+}
 
-    /* TODO: Now first SSA renaming algorithm visits
-             statement after phi, then before. Fix it
-             by introducing correct predecessors.
-             Phi node must be the only predecessor of next statement. */
+/* Renaming walks dominator tree of statements. Children
+   are linked in order of IR list. */
+static void dom_tree_children(struct ir_fn_decl *decl)
+{
+    struct ir_node *it = decl->body;
+
+    for (; it; it = it->next)
+        vector_free(ir_dom(decl, it)->idom_back);
 
-    /* To traverse dominator tree next. */
-    vector_push_back(curr->idom_back, new);
+    for (it = decl->body; it; it = it->next) {
+        struct ir_node *idom = ir_dom(decl, it)->idom;
+        vector_push_back(ir_dom(decl, idom)->idom_back, it);
+    }
 }
 
 /* This function implements algorithm given in
@@ -131,8 +129,12 @@ static void phi_insert(
             struct ir_node *x = vector_back(w);
             vector_pop_back(w);
 
-            vector_foreach(x->df, i) {
-                struct ir_node *y = vector_at(x->df, i);
+            /* Phi nodes are inserted before leaders, so
+               frontier of block is placement of them. */
+            ir_block_vector_t *df = &ir_block(decl, x)->df;
+
+            vector_foreach(*df, i) {
+                struct ir_node *y = vector_at(*df, i)->first;
                 uint64_t y_addr = (uint64_t) y;
 
                 bool ok = 0;
@@ -141,10 +143,12 @@ static void phi_insert(
                     struct ir_node *phi = ir_phi_init(
                         sym_idx,
                         y->instr_idx,
-                        vector_at(y->cfg.preds, 0)->instr_idx
+                        phi_pred(y)->instr_idx
                     );
 
-                    ir_insert_before(y, phi);
+                    ir_insert_before(decl, y, phi);
+                    /* To traverse dominator tree next. */
+                    vector_push_back(ir_dom(decl, y)->idom_back, phi);
                     /* printf("Insert phi before %ld\n", y->instr_idx); */
                     memcpy(&phi->meta, &y->meta, sizeof (struct meta));
                     hashmap_put(&dom_fron_plus, y_addr, 1);
@@ -167,7 +171,7 @@ static void phi_insert(
 
 typedef vector_t(uint64_t) ssa_stack_t;
 
-static uint64_t ssa_idx;
+static _Thread_local uint64_t ssa_idx;
 
 really_inline static void ssa_rename_sym(struct ir_node *sym_ir, uint64_t sym_idx, ssa_stack_t *stack)
 {
@@ -185,8 +189,13 @@ static void ssa_rename_bin(struct ir_bin *bin, uint64_t sym_idx, ssa_stack_t *st
     ssa_rename_sym(bin->rhs, sym_idx, stack);
 }
 
-static void ssa_rename(struct ir_node *ir, uint64_t sym_idx, ssa_stack_t *stack, bool *visited)
-{
+static void ssa_rename(
+    struct ir_fn_decl *decl,
+    struct ir_node    *ir,
+    uint64_t           sym_idx,
+    ssa_stack_t       *stack,
+    bool              *visited
+) {
     if (visited[ir->instr_idx])
         return;
 
@@ -260,9 +269,10 @@ static void ssa_rename(struct ir_node *ir, uint64_t sym_idx, ssa_stack_t *stack,
     }
 
     /* 2. call recursive for dominator tree children. */
-    vector_foreach(ir->idom_back, i) {
-        struct ir_node *submissive = vector_at(ir->idom_back, i);
-        ssa_rename(submissive, sym_idx, stack, visited);
+    /* Dominator table can grow inside recursive call. */
+    for (uint64_t i = 0; i < ir_dom(decl, ir)->idom_back.count; ++i) {
+        struct ir_node *submissive = vector_at(ir_dom(decl, ir)->idom_back, i);
+        ssa_rename(decl, submissive, sym_idx, stack, visited);
     }
 
     /* 3. Pop from stack for current assignment. */
@@ -276,9 +286,13 @@ static void ssa_rename(struct ir_node *ir, uint64_t sym_idx, ssa_stack_t *stack,
     }
 }
 
-void ir_compute_ssa(struct ir_node *decls)
+void ir_compute_ssa(struct ir_unit *unit)
 {
-    struct ir_node *it = decls;
+    struct ir_node *it = unit->fn_decls;
+
+    /* New nodes must belong to this unit. */
+    ir_arena_set(unit->arena);
+
     while (it) {
         struct ir_fn_decl *decl = it->ir;
         /* Key:   sym_idx
@@ -291,8 +305,8 @@ void ir_compute_ssa(struct ir_node *decls)
 
         ir_dominator_tree(decl);
         ir_dominance_frontier(decl);
+        dom_tree_children(decl);
         phi_insert(decl, &assigns);
-        ir_cfg_build(decl);
 
         hashmap_foreach(&assigns, sym_idx, __) {
             bool visited[512] = {0};
@@ -300,7 +314,7 @@ void ir_compute_ssa(struct ir_node *decls)
             (void) __;
             vector_free(ssa_stack);
             ssa_idx = 0;
-            ssa_rename(decl->body, sym_idx, &ssa_stack, visited);
+            ssa_rename(decl, decl->body, sym_idx, &ssa_stack, visited);
         }
 
         it = it->next;
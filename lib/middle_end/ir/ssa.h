@@ -10,8 +10,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-struct ir_node;
+struct ir_unit;
 
-void ir_compute_ssa(struct ir_node *functions);
+void ir_compute_ssa(struct ir_unit *unit);
 
 #endif // WEAK_COMPILER_MIDDLE_END_SSA_H
\ No newline at end of file
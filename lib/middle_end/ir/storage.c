@@ -6,23 +6,28 @@
 
 #include "middle_end/ir/storage.h"
 #include "util/alloc.h"
-#include "util/crc32.h"
 #include "util/hashmap.h"
+#include "util/thread.h"
 
-static hashmap_t storage;
+static _Thread_local hashmap_t storage;
 
 void ir_storage_init()
 {
+    ir_storage_reset();
     hashmap_init(&storage, 512);
+    weak_thread_atexit(ir_storage_reset);
 }
 
 void ir_storage_reset()
 {
+    hashmap_foreach(&storage, k, v)
+        weak_free((struct ir_storage_record *) v);
+
     hashmap_destroy(&storage);
 }
 
 void ir_storage_push(
-    const char     *name,
+    uint32_t        name_id,
     int32_t         sym_idx,
     enum data_type  dt,
     uint64_t        ptr_depth,
@@ -36,14 +41,14 @@ void ir_storage_push(
     record->ir = ir;
     record->ptr_depth = ptr_depth;
 
-    hashmap_put(&storage, crc32_string(name), (uint64_t) record);
+    hashmap_put(&storage, name_id, (uint64_t) record);
 }
 
-struct ir_storage_record *ir_storage_get(const char *name)
+struct ir_storage_record *ir_storage_get(uint32_t name_id)
 {
     bool ok = 0;
     struct ir_storage_record *got =
-        (struct ir_storage_record *) hashmap_get(&storage, crc32_string(name), &ok);
+        (struct ir_storage_record *) hashmap_get(&storage, name_id, &ok);
 
     return ok ? got : NULL;
 }
\ No newline at end of file
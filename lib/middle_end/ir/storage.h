@@ -16,14 +16,17 @@
     Preconditions
       1: Types are checked during analysis.
     Operations
-      1: Push variable index (number) assicoated with its textual name (string).
-      2: Get variable index (number) by string.
+      1: Push variable index (number) assicoated with its name
+         (id of interned string).
+      2: Get variable index (number) by name id.
    
     \note
       1: There is no scope separation as in front-end
          AST storage, so it does not makes sence to do that
          since each variable in IR is unique (incremental). */
 void ir_storage_init();
+
+/** Free all records. Called also on thread exit. */
 void ir_storage_reset();
 
 struct ir_storage_record {
@@ -35,7 +38,7 @@ struct ir_storage_record {
 };
 
 void ir_storage_push(
-    const char     *name,
+    uint32_t        name_id,
     int32_t         sym_idx,
     enum data_type  dt,
     uint64_t        ptr_depth,
@@ -43,6 +46,6 @@ void ir_storage_push(
 );
 
 wur struct ir_storage_record *
-ir_storage_get (const char *name);
+ir_storage_get (uint32_t name_id);
 
 #endif // WEAK_COMPILER_MIDDLE_END_IR_STORAGE_H
\ No newline at end of file
@@ -7,14 +7,16 @@
 #include "middle_end/ir/type.h"
 #include "middle_end/ir/ir.h"
 #include "middle_end/ir/meta.h"
-#include "util/crc32.h"
+#include "util/alloc.h"
+#include "util/intern.h"
 #include "util/hashmap.h"
 #include <string.h>
 
 #define MAX_IR_STMTS 10000
 
-static struct type type_map[MAX_IR_STMTS];
-static hashmap_t   fn_map;
+/* Allocated for each ir_type_pass() call. */
+static _Thread_local struct type *type_map;
+static _Thread_local hashmap_t   fn_map;
 
 
 
@@ -52,13 +54,13 @@ static void fn_type_save(struct ir_fn_decl *decl)
     t->ptr_depth = decl->ptr_depth;
     t->bytes = t->ptr_depth > 0 ? 8 : ir_type_size(t->dt);
 
-    hashmap_put(&fn_map, crc32_string(decl->name), (uint64_t) t);
+    hashmap_put(&fn_map, intern_id(decl->name), (uint64_t) t);
 }
 
 struct type *fn_type_lookup(const char *name)
 {
     bool     ok   = 0;
-    uint64_t hash = crc32_string(name);
+    uint64_t hash = intern_id(name);
     uint64_t addr = hashmap_get(&fn_map, hash, &ok);
 
     if (!ok)
@@ -69,7 +71,7 @@ struct type *fn_type_lookup(const char *name)
 
 static void init_fn_state()
 {
-    memset(type_map, 0, sizeof (type_map));
+    memset(type_map, 0, MAX_IR_STMTS * sizeof (*type_map));
 }
 
 static void init_fn_map()
@@ -256,6 +258,7 @@ static void type_pass_fn(struct ir_fn_decl *decl)
 
 void ir_type_pass(struct ir_unit *unit)
 {
+    type_map = weak_calloc(MAX_IR_STMTS, sizeof (*type_map));
     init_fn_map();
 
     struct ir_node *it = unit->fn_decls;
@@ -271,4 +274,6 @@ void ir_type_pass(struct ir_unit *unit)
     }
 
     reset_fn_map();
+    weak_free(type_map);
+    type_map = NULL;
 }
\ No newline at end of file
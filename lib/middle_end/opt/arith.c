@@ -13,10 +13,9 @@ static struct ir_node *opt_arith_node(struct ir_node *ir);
 
 wur static struct ir_node *no_result()
 {
-    static struct ir_node ir = {0};
+    static _Thread_local struct ir_node ir = {0};
     ir.instr_idx = -1;
     ir.ir = NULL;
-    ir.idom = NULL;
     return &ir;
 }
 
@@ -236,6 +235,10 @@ static void ir_opt_arith_fn_decl(struct ir_fn_decl *decl)
 void ir_opt_arith(struct ir_unit *ir)
 {
     struct ir_node *it = ir->fn_decls;
+
+    /* New nodes must belong to this unit. */
+    ir_arena_set(ir->arena);
+
     while (it) {
         ir_opt_arith_fn_decl(it->ir);
         it = it->next;
@@ -6,6 +6,7 @@
 
 #include "middle_end/opt/opt.h"
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_ops.h"
 
 static void mark_visited(bool *visited, struct ir_node *ir)
 {
@@ -13,9 +14,9 @@ static void mark_visited(bool *visited, struct ir_node *ir)
 }
 
 /* dd -- Data dependency. */
-static void traverse_dd_chain(bool *visited, struct ir_node *it)
+static void traverse_dd_chain(struct ir_fn_decl *decl, bool *visited, struct ir_node *it)
 {
-    ir_vector_t *ddgs = &it->ddg_stmts;
+    ir_vector_t *ddgs = ir_ddg(decl, it);
     vector_foreach(*ddgs, i) {
         struct ir_node *ddg = vector_at(*ddgs, i);
         if (!visited[ddg->instr_idx])
@@ -25,7 +26,7 @@ static void traverse_dd_chain(bool *visited, struct ir_node *it)
 
 /* Walk over loop and mark statements above and below
    in bounds of loop (up to most outer) as needed. */
-static void extend_loop(bool *visited, struct ir_node *ir)
+static void extend_loop(struct ir_fn_decl *decl, bool *visited, struct ir_node *ir)
 {
     struct ir_node *it = ir;
     uint64_t loop_idx = ir->meta.global_loop_idx;
@@ -37,7 +38,7 @@ static void extend_loop(bool *visited, struct ir_node *ir)
            it->meta.block_depth > 0
     ) {
         mark_visited(visited, it);
-        traverse_dd_chain(visited, it);
+        traverse_dd_chain(decl, visited, it);
         it = it->prev;
     }
 
@@ -50,32 +51,31 @@ static void extend_loop(bool *visited, struct ir_node *ir)
            it->meta.block_depth > 0
     ) {
         mark_visited(visited, it);
-        traverse_dd_chain(visited, it);
+        traverse_dd_chain(decl, visited, it);
         it = it->next;
     }
 }
 
-static void traverse_ddg(bool *visited, struct ir_node *ir)
+static void traverse_ddg(struct ir_fn_decl *decl, bool *visited, struct ir_node *ir)
 {
-    ir_vector_t *ddgs = &ir->ddg_stmts;
-
-    vector_foreach(*ddgs, i) {
-        struct ir_node *ddg = vector_at(*ddgs, i);
+    /* DDG table can grow inside recursive call. */
+    for (uint64_t i = 0; i < ir_ddg(decl, ir)->count; ++i) {
+        struct ir_node *ddg = vector_at(*ir_ddg(decl, ir), i);
         if (!visited[ddg->instr_idx]) {
             mark_visited(visited, ddg);
-            extend_loop(visited, ddg);
-            traverse_ddg(visited, ddg);
+            extend_loop(decl, visited, ddg);
+            traverse_ddg(decl, visited, ddg);
         }
     }
 }
 
-static void traverse_from_ret(bool *visited, struct ir_node *ir)
+static void traverse_from_ret(struct ir_fn_decl *decl, bool *visited, struct ir_node *ir)
 {
     mark_visited(visited, ir);
-    traverse_ddg(visited, ir);
+    traverse_ddg(decl, visited, ir);
 }
 
-static void traverse(bool *visited, struct ir_node *ir)
+static void traverse(struct ir_fn_decl *decl, bool *visited, struct ir_node *ir)
 {
     struct ir_node *it = ir;
 
@@ -83,7 +83,7 @@ static void traverse(bool *visited, struct ir_node *ir)
         switch (it->type) {
         case IR_RET:
             /* Return is start point for whole optimization. */
-            traverse_from_ret(visited, it);
+            traverse_from_ret(decl, visited, it);
             break;
         case IR_FN_CALL:
             /* Raw function calls are not this optimizer case.
@@ -98,23 +98,25 @@ static void traverse(bool *visited, struct ir_node *ir)
     }
 }
 
-static void cut(bool *visited, struct ir_node *ir)
+static void cut(bool *visited, struct ir_fn_decl *decl)
 {
-    struct ir_node *it = ir;
+    struct ir_node *it = decl->body;
 
     while (it) {
+        struct ir_node *next = it->next;
+
         if (!visited[it->instr_idx])
-            ir_remove(&it, &ir);
-        if (it)
-            it = it->next;
+            ir_erase(decl, it);
+
+        it = next;
     }
 }
 
 static void ir_opt_data_flow_fn_decl(struct ir_fn_decl *ir)
 {
     bool visited[8192] = {0};
-    traverse(visited, ir->body);
-    cut(visited, ir->body);
+    traverse(ir, visited, ir->body);
+    cut(visited, ir);
 }
 
 void ir_opt_data_flow(struct ir_unit *ir)
@@ -23,18 +23,15 @@ struct dce_entry {
     uint64_t sym_idx;
 };
 
-static vector_t(struct dce_entry) dead_stores;
-static vector_t(int32_t)          live_instrs;
-static hashmap_t                  alloca_stmts;
+static _Thread_local vector_t(struct dce_entry) dead_stores;
+static _Thread_local vector_t(int32_t)          live_instrs;
+static _Thread_local hashmap_t                  alloca_stmts;
 
 
 
 static void reset_hashmap(hashmap_t *map)
 {
-    if (map->buckets) {
-        hashmap_destroy(map);
-    }
-    hashmap_init(map, 512);
+    hashmap_reset(map, 512);
 }
 
 static void alloca_put(struct ir_node *ir)
@@ -208,7 +205,7 @@ static void dce_jmp(struct ir_node *ir)
     /// Not our optimization case.
     vector_push_back(live_instrs, ir->instr_idx);
     /// I am not sure.
-    vector_push_back(live_instrs, jmp->target->instr_idx);
+    vector_push_back(live_instrs, jmp->label->target->instr_idx);
 }
 
 
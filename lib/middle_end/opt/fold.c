@@ -13,8 +13,8 @@
 #include <string.h>
 
 /* Hashmap to refer by variable index. */
-static hashmap_t consts_mapping;
-static hashmap_t loop_dependent_stmts;
+static _Thread_local hashmap_t consts_mapping;
+static _Thread_local hashmap_t loop_dependent_stmts;
 
 
 
@@ -154,10 +154,9 @@ static struct ir_node *fold_node(struct ir_node *ir);
 
 wur static struct ir_node *no_result()
 {
-    static struct ir_node ir = {0};
+    static _Thread_local struct ir_node ir = {0};
     ir.instr_idx = -1;
     ir.ir = NULL;
-    ir.idom = NULL;
     return &ir;
 }
 
@@ -437,13 +436,13 @@ static void ir_opt_fold_fn_decl(struct ir_fn_decl *decl)
     while (it) {
         bool should_reset = 0;
         should_reset |= it == decl->body;
-        should_reset |= cfg_no != it->cfg_block_no;
+        should_reset |= cfg_no != ir_block_no(decl, it);
 
         fold_node(it);
         if (should_reset)
             fold_opt_reset();
 
-        cfg_no = it->cfg_block_no;
+        cfg_no = ir_block_no(decl, it);
         it = it->next;
     }
 }
@@ -451,6 +450,10 @@ static void ir_opt_fold_fn_decl(struct ir_fn_decl *decl)
 void ir_opt_fold(struct ir_unit *ir)
 {
     struct ir_node *it = ir->fn_decls;
+
+    /* New nodes must belong to this unit. */
+    ir_arena_set(ir->arena);
+
     while (it) {
         ir_opt_fold_fn_decl(it->ir);
         it = it->next;
@@ -75,6 +75,10 @@ void ir_opt_arith(struct ir_unit *ir);
 void ir_opt_dead_code_elimination(struct ir_unit *ir);
 #endif
 
+/** Remove basic blocks not reachable from entry block.
+
+    \note Removed blocks are left empty in block table
+          of function. */
 void ir_opt_unreachable_code(struct ir_unit *ir);
 
 /** Instruction reordering.
@@ -82,7 +86,10 @@ void ir_opt_unreachable_code(struct ir_unit *ir);
     This collects all alloca instructions in function
     in one place. Makes no really difference in case
     of interpreter, but in a real backend (ARM, x86_64)
-    we can subtract stack pointer once in a function. */
+    we can subtract stack pointer once in a function.
+
+    Jumps to moved allocas lead to the statements
+    following them. */
 void ir_opt_reorder(struct ir_unit *ir);
 
 /** Data flow analysis.
@@ -5,80 +5,51 @@
  */
 
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_ops.h"
 #include "middle_end/opt/opt.h"
-#include "util/vector.h"
-#include <stddef.h>
+#include "util/compiler.h"
 
-/* This function follows alloca instructions chain and sets jump
-   targets to instructions, that placed after alloca's. */
-really_inline static void reindex(ir_vector_t *stmts)
+/* Jumps to allocas left in place lead to statements,
+   that placed after alloca's. */
+static void retarget(struct ir_fn_decl *decl)
 {
-    vector_foreach(*stmts, i) {
-        struct ir_node *curr = vector_at(*stmts, i);
-
-        /* We move allocas to most outer block, hence
-            out of any loop. */
-        if (curr->type == IR_ALLOCA)
-            curr->meta.block_depth = 0;
-
-        if (curr->type == IR_COND) {
-            struct ir_cond *cond = curr->ir;
-            uint64_t jump_idx = cond->goto_label;
-
-            while (vector_at(*stmts, cond->goto_label)->type == IR_ALLOCA) {
-                ++cond->goto_label;
-                ++jump_idx;
-                cond->target = vector_at(*stmts, jump_idx);
-            }
+    for (struct ir_node *it = decl->body; it; it = it->next) {
+        struct ir_label *label = NULL;
+
+        switch (it->type) {
+        case IR_ALLOCA:
+            /* We move allocas to most outer block, hence
+               out of any loop. */
+            it->meta.block_depth = 0;
+            break;
+        case IR_JUMP:
+            label = ((struct ir_jump *) it->ir)->label;
+            break;
+        case IR_COND:
+            label = ((struct ir_cond *) it->ir)->label;
+            break;
+        default:
+            break;
         }
 
-        if (curr->type == IR_JUMP) {
-            struct ir_jump *jump = curr->ir;
-            uint64_t jump_idx = jump->idx;
+        if (!label || label->target->type != IR_ALLOCA)
+            continue;
 
-            while (vector_at(*stmts, jump->idx)->type == IR_ALLOCA) {
-                ++jump->idx;
-                ++jump_idx;
-                jump->target = vector_at(*stmts, jump_idx);
-            }
-        }
-    }
-}
+        struct ir_node *target = label->target;
 
-/* +-------+ -- next --> +-------+ -- next --> +-------+ -- next --> +-------+
-   |   1   |             |   2   |             |  ir   |             |   3   |
-   +-------+ <-- prev -- +-------+ <-- prev -- +-------+ <-- prev -- +-------+
-  
-   +-------+ -- next --> +-------+ -- next --> +-------+ -- next --> +-------+
-   |   1   |             |  ir   |             |   2   |             |   3   |
-   +-------+ <-- prev -- +-------+ <-- prev -- +-------+ <-- prev -- +-------+ */
-really_inline static void swap(struct ir_node *ir)
-{
-    if (!ir->prev)
-        return;
+        while (target->type == IR_ALLOCA)
+            target = target->next;
 
-    if (!ir->prev->prev) {
-        ir->prev->next = ir;
-        ir->prev = NULL;
-        return;
+        ir_redirect(decl, it, ir_label_init(target));
     }
+}
 
-    if (ir->type == IR_RET)
-        return;
-
-    if (ir->type != IR_ALLOCA)
-        return;
-
-    struct ir_node *_1 = ir->prev->prev;
-    struct ir_node *_2 = ir->prev;
-    struct ir_node *_3 = ir->next;
-
-    _1->next = ir;
-    ir->prev = _1;
-    ir->next = _2;
-    _2->prev = ir;
-    _2->next = _3;
-    _3->prev = _2;
+/* Jumps to `ir` are moved to the next statement
+   by erase. */
+really_inline static void move_before(struct ir_fn_decl *decl, struct ir_node *pos, struct ir_node *ir)
+{
+    ir_erase(decl, ir);
+    ir_insert_before(decl, pos, ir);
 }
 
 /* This generally needed to force reordering algorithm to begin.
@@ -94,45 +65,46 @@ really_inline static bool initial_move(struct ir_node **ir)
 }
 
 /* This function traversing the list and group all
-   alloca instructions together. This purpose of this
-   optimization is easily determine, how many stack
-   storage we must allocate for given function. */
+   alloca instructions together after first statement.
+   This purpose of this optimization is easily determine,
+   how many stack storage we must allocate for given
+   function. */
 static void ir_opt_reorder_fn_decl(struct ir_fn_decl *decl)
 {
     struct ir_node *it = decl->body;
 
-    ir_vector_t stmts = {0};
-
-    while (it) {
-        vector_push_back(stmts, it);
-        it = it->next;
-    }
-    reindex(&stmts);
-
-    it = decl->body;
-
     if (!initial_move(&it))
         return;
 
-    struct ir_node *_ = it;
-    swap(it);
+    /* Allocas are put before `pos` in order they
+       appear. */
+    struct ir_node *pos = decl->body->next;
+    struct ir_node *_   = it;
 
-    while (it) {
-        it = _;
-        it = it->next;
-        while (it && it->type != IR_ALLOCA)
-            it = it->next;
+    if (_->type == IR_ALLOCA) {
+        move_before(decl, pos, _);
+        pos = _;
+    }
+
+    for (it = _->next; it; ) {
+        struct ir_node *next = it->next;
 
-        while (it && it->prev != IR_ALLOCA)
-            swap(it);
+        if (it->type == IR_ALLOCA)
+            move_before(decl, pos, it);
+
+        it = next;
     }
 
-    vector_free(stmts);
+    retarget(decl);
 }
 
 void ir_opt_reorder(struct ir_unit *ir)
 {
     struct ir_node *it = ir->fn_decls;
+
+    /* New nodes must belong to this unit. */
+    ir_arena_set(ir->arena);
+
     while (it) {
         ir_opt_reorder_fn_decl(it->ir);
         it = it->next;
@@ -6,97 +6,38 @@
 
 #include "middle_end/opt/opt.h"
 #include "middle_end/ir/ir.h"
+#include "middle_end/ir/ir_ops.h"
+#include "util/alloc.h"
 
-really_inline static void mark_visited(bool *visited, struct ir_node *ir)
+static void traverse(bool *visited, struct ir_block *b)
 {
-    visited[ir->instr_idx] = 1;
-}
+    if (visited[b->idx]) return;
 
-really_inline static bool in_same_cfg_block(struct ir_node *l, struct ir_node *r)
-{
-    return l->cfg_block_no == r->cfg_block_no;
+    visited[b->idx] = 1;
+
+    vector_foreach(b->succs, i)
+        traverse(visited, vector_at(b->succs, i));
 }
 
-static void traverse(bool *visited, uint64_t *max_id, struct ir_node *ir)
+/* Traverse CFG and remove all unvisited blocks. Edges
+   and labels are kept by each erase, so statements of
+   removed blocks are erased one by one. */
+void ir_opt_unreachable_code_fn_decl(struct ir_fn_decl *decl)
 {
-    if (visited[ir->instr_idx]) return;
+    if (decl->blocks.count == 0)
+        return;
 
-    if (*max_id < ir->instr_idx)
-        *max_id = ir->instr_idx;
+    bool *visited = weak_calloc(decl->blocks.count, sizeof (bool));
 
-    switch (ir->type) {
-    case IR_IMM:
-    case IR_SYM:
-    case IR_BIN:
-    case IR_MEMBER:
-    case IR_STORE:
-    case IR_ALLOCA:
-    case IR_ALLOCA_ARRAY:
-    case IR_FN_CALL: {
-        mark_visited(visited, ir);
-        traverse(visited, max_id, ir->next);
-        break;
-    }
-    case IR_JUMP: {
-        struct ir_jump *jmp = ir->ir;
-        mark_visited(visited, ir);
-        traverse(visited, max_id, jmp->target);
-        break;
-    }
-    case IR_COND: {
-        struct ir_cond *cond = ir->ir;
-        mark_visited(visited, ir);
-        traverse(visited, max_id, cond->target);
-        traverse(visited, max_id, vector_at(ir->cfg.succs, 0));
-        // traverse(visited, max_id, ir->next_else);
-        break;
-    }
-    case IR_RET: {
-        mark_visited(visited, ir);
-        bool should_jump = ir->next;
-        if (ir->next) {
-            /* We continue walking over graph if
-               1) Return statement has successor in other CFG block.
-               2) Return statement has no jump successors. Even if jumps
-                  are located after return, they were/will visit
-                  as condition or other jump targets, so they are not
-                  removed.
+    traverse(visited, vector_at(decl->blocks, 0));
 
-               Otherwise, all after return statement can be safely
-               removed since it guaranteed to never be reached. */
-            should_jump &= !in_same_cfg_block(ir, ir->next);
-            should_jump &= ir->next->type != IR_JUMP;
-        }
-        if (should_jump)
-            traverse(visited, max_id, ir->next);
-        break;
-    }
-    default:
-        break;
+    for (struct ir_node *it = decl->body, *next; it; it = next) {
+        next = it->next;
+        if (!visited[ir_block(decl, it)->idx])
+            ir_erase(decl, it);
     }
-}
-
-static void cut(bool *visited, uint64_t siz, struct ir_node *ir)
-{
-    struct ir_node *it = ir;
-
-    while (it) {
-        if (ir->instr_idx <= siz && !visited[it->instr_idx]) {
-            ir_remove(&it, &ir);
-        }
-        it = it->next;
-    }
-}
-
-/* Traverse CFG and remove all unvisited nodes. */
-void ir_opt_unreachable_code_fn_decl(struct ir_fn_decl *decl)
-{
-    bool visited[8192] = {0};
-    /* How many nodes potentially were visited. */
-    uint64_t max_id = 0;
 
-    traverse(visited, &max_id, decl->body);
-    cut(visited, max_id, decl->body);
+    weak_free(visited);
 }
 
 void ir_opt_unreachable_code(struct ir_unit *ir)
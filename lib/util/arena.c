@@ -0,0 +1,119 @@
+/* arena.c - Region-based memory allocator.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/arena.h"
+#include "util/alloc.h"
+#include <string.h>
+
+#define ARENA_ALIGN 16
+
+void arena_init(struct arena *a)
+{
+    memset(a, 0, sizeof (*a));
+}
+
+void arena_release(struct arena *a)
+{
+    struct arena_chunk *it = a->chunks;
+
+    while (it) {
+        struct arena_chunk *next = it->next;
+        weak_free(it);
+        it = next;
+    }
+
+    arena_init(a);
+}
+
+static struct arena_chunk *arena_chunk_new(struct arena *a, uint64_t size)
+{
+    struct arena_chunk *chunk = weak_calloc(1, sizeof (struct arena_chunk) + size);
+    chunk->size = size;
+    chunk->used = 0;
+
+    a->reserved += size;
+    ++a->chunks_cnt;
+
+    return chunk;
+}
+
+void *arena_alloc(struct arena *a, uint64_t size)
+{
+    struct arena_chunk *chunk = a->chunks;
+
+    size = (size + ARENA_ALIGN - 1) & ~(uint64_t) (ARENA_ALIGN - 1);
+
+    if (unlikely(!chunk || chunk->used + size > chunk->size)) {
+        if (size > ARENA_CHUNK_SIZE / 4) {
+            /* Big block gets own chunk, placed behind the current
+               one to not waste rest of the current chunk. */
+            struct arena_chunk *big = arena_chunk_new(a, size);
+            if (chunk) {
+                big->next = chunk->next;
+                chunk->next = big;
+            } else {
+                a->chunks = big;
+            }
+            chunk = big;
+        } else {
+            chunk = arena_chunk_new(a, ARENA_CHUNK_SIZE);
+            chunk->next = a->chunks;
+            a->chunks = chunk;
+        }
+    }
+
+    void *addr = chunk->data + chunk->used;
+    chunk->used += size;
+
+    a->bytes += size;
+    ++a->allocs;
+
+    return addr;
+}
+
+char *arena_strdup(struct arena *a, const char *s)
+{
+    uint64_t len = strlen(s);
+    char *copy = arena_alloc(a, len + 1);
+    memcpy(copy, s, len);
+    return copy;
+}
+
+void arena_merge(struct arena *a, struct arena *from)
+{
+    struct arena_chunk *tail = from->chunks;
+
+    if (!tail)
+        return;
+
+    while (tail->next)
+        tail = tail->next;
+
+    /* Current chunk of `a` stays first, so allocation
+       continues from it. */
+    if (a->chunks) {
+        tail->next = a->chunks->next;
+        a->chunks->next = from->chunks;
+    } else {
+        a->chunks = from->chunks;
+    }
+
+    a->chunks_cnt += from->chunks_cnt;
+    a->bytes      += from->bytes;
+    a->reserved   += from->reserved;
+    a->allocs     += from->allocs;
+
+    arena_init(from);
+}
+
+void arena_dump_stats(FILE *stream, struct arena *a)
+{
+    fprintf(
+        stream,
+        "arena: %lu allocations, %lu bytes used, %lu bytes reserved in %lu chunks\n",
+        a->allocs, a->bytes, a->reserved, a->chunks_cnt
+    );
+}
@@ -0,0 +1,66 @@
+/* arena.h - Region-based memory allocator.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_UTIL_ARENA_H
+#define WEAK_COMPILER_UTIL_ARENA_H
+
+#include "util/compiler.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/** Default size of single arena chunk. Requests larger
+    than this get their own dedicated chunk. */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    uint64_t            size;
+    uint64_t            used;
+    _Alignas(16) char   data[];
+};
+
+/** Bump allocator with chunked growth.
+
+    Memory is handed out sequentially from the current chunk.
+    When it is exhausted, new chunk is allocated and linked
+    into the list. Individual allocations are never freed;
+    whole region is released at once by arena_release().
+
+    \note All returned memory is zero-initialized. */
+struct arena {
+    struct arena_chunk *chunks;
+    uint64_t            chunks_cnt;
+    /** Total bytes handed out to users. */
+    uint64_t            bytes;
+    /** Total bytes requested from the system. */
+    uint64_t            reserved;
+    /** Number of arena_alloc() calls. */
+    uint64_t            allocs;
+};
+
+void arena_init(struct arena *a);
+
+/** Release all chunks in O(chunks). Arena is reusable afterwards. */
+void arena_release(struct arena *a);
+
+/** Allocate zeroed block of given size, aligned to 16 bytes. */
+wur void *arena_alloc(struct arena *a, uint64_t size);
+
+/** Copy NUL-terminated string to the arena. */
+wur char *arena_strdup(struct arena *a, const char *s);
+
+/** Move all chunks of `from` to `a`. Memory allocated from
+    `from` stays valid and is released together with `a`.
+
+    \note `from` is empty afterwards. */
+void arena_merge(struct arena *a, struct arena *from);
+
+/** Print allocation counters. */
+void arena_dump_stats(FILE *stream, struct arena *a);
+
+#define arena_new(a, type) arena_alloc((a), sizeof (type))
+
+#endif // WEAK_COMPILER_UTIL_ARENA_H
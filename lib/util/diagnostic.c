@@ -7,36 +7,44 @@
 #include "util/diagnostic.h"
 #include "util/lexical.h"
 #include "util/compiler.h"
+#include "util/source.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
-jmp_buf weak_fatal_error_buf;
+_Thread_local jmp_buf weak_fatal_error_buf;
 
 extern void *diag_error_memstream;
 extern void *diag_warn_memstream;
 
-static const char *active_filename;
-static FILE       *active_stream;
+static _Thread_local const char *active_filename;
+static _Thread_local const struct source *active_source;
 
 static struct diag_config config = {
     .ignore_warns  = 1,
     .show_location = 0
 };
 
+static _Thread_local bool silent;
+
 void weak_diag_set_config(struct diag_config *new_config)
 {
     memcpy(&config, new_config, sizeof (config));
 }
 
+void weak_diag_set_silent(bool new_silent)
+{
+    silent = new_silent;
+}
+
 void weak_set_source_filename(const char *filename)
 {
     active_filename = filename;
 }
 
-void weak_set_source_stream(FILE *stream)
+void weak_set_source(const struct source *source)
 {
-    active_stream = stream;
+    active_source = source;
 }
 
 static noreturn void weak_terminate_compilation()
@@ -47,21 +55,15 @@ static noreturn void weak_terminate_compilation()
 
 
 
-really_inline static void replace_newline(char *buf)
-{
-    while (*buf) {
-        if (*buf == '\n')
-            *buf = ' ';
-        ++buf;
-    }
-}
-
 static void flush(char *buf, bool is_error)
 {
     FILE *out_stream = is_error
         ? diag_error_memstream
         : diag_warn_memstream;
 
+    if (!out_stream)
+        out_stream = stderr;
+
     fputs(buf, out_stream);
     fflush(out_stream);
 }
@@ -77,72 +79,64 @@ static void flush(char *buf, bool is_error)
    */
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat"
-unused static void print_file_range(
-    FILE     *stream,
+static uint64_t print_line(char *report, uint64_t line_no, const char *msg_color)
+{
+    uint64_t    len  = 0;
+    const char *line = source_line(active_source, line_no, &len);
+
+    /* Fit into report buffer. */
+    if (len > 1024)
+        len = 1024;
+
+    return sprintf(report, "%s|%s %s% 6lu:%s %.*s\n", msg_color, color_end, color_purple, line_no, color_end, (int) len, line);
+}
+
+/* Lines are taken from line index, so file is not
+   re-read on each report. */
+static void print_file_range(
     uint64_t  line_no,
     uint64_t  col_no,
     char     *err_buf,
     uint64_t  range,
     bool      is_error
 ) {
-    fseek(stream, 0, SEEK_SET);
-
-    uint64_t curr_line_no =  1;
-    char     buf[4096]    = {0};
-
-    for (uint64_t i = 1; i < line_no - range && fgets(buf, sizeof (buf), active_stream) != NULL; ++i)
-        ++curr_line_no;
-
-    fputs("", stream);
+    if (!active_source || line_no > source_lines_count(active_source))
+        return;
 
     char     report[16384] = {0};
     uint64_t w             =  0;
-    uint64_t line_max      =  0;
+    uint64_t first         = line_no > range ? line_no - range : 1;
+    uint64_t last          = line_no + range;
+    char    *msg_color     = is_error ? color_red : color_yellow;
 
-    char *msg_color = is_error ? color_red : color_yellow;
-    char *line_color = color_purple;
-
-#define DO() \
-        { replace_newline(buf); \
-          uint64_t written = sprintf(report + w, "%s|%s %s% 6lu:%s %s\n", msg_color, color_end, line_color, curr_line_no++, color_end, buf); \
-          \
-          if (line_max < strlen(buf) + 7) \
-              line_max = strlen(buf) + 7; \
-          \
-          w += written; }
-
-#define GET() fgets(buf, sizeof (buf), stream)
+    if (last > source_lines_count(active_source))
+        last = source_lines_count(active_source);
 
     /* Before. */
-    for (uint64_t i = range > line_no
-                    ? 0
-                    : line_no - range;  i < line_no && GET() != NULL; ++i)
-        DO()
+    for (uint64_t i = first; i < line_no; ++i)
+        w += print_line(report + w, i, msg_color);
 
     /* Error/warning line. */
-    for (uint64_t i = line_no; i <= line_no && GET() != NULL; ++i) {
-        DO()
-
-        w += sprintf(report + w, "%s|%s        %-*s%s^%s\n", msg_color, color_end, (int) col_no, " ", msg_color, color_end);
-        w += sprintf(report + w, "%s|        %s%s\n", msg_color, err_buf, color_end);
-        w += sprintf(report + w, "%s|%s\n", msg_color, color_end);
-    }
+    w += print_line(report + w, line_no, msg_color);
+    w += sprintf(report + w, "%s|%s        %-*s%s^%s\n", msg_color, color_end, (int) col_no, " ", msg_color, color_end);
+    w += sprintf(report + w, "%s|        %s%s\n", msg_color, err_buf, color_end);
+    w += sprintf(report + w, "%s|%s\n", msg_color, color_end);
 
     /* After. */
-    for (uint64_t i = line_no + 1; i <= line_no + range && GET() != NULL; ++i)
-        DO()
+    for (uint64_t i = line_no + 1; i <= last; ++i)
+        w += print_line(report + w, i, msg_color);
 
     flush(report, is_error);
-
-#undef GET
-#undef DO
 }
 #pragma GCC diagnostic pop /* -Wformat */
 
 
 
-void weak_compile_error(uint16_t line_no, uint16_t col_no, const char *fmt, ...)
+void weak_compile_error(uint32_t line_no, uint32_t col_no, const char *fmt, ...)
 {
+    if (silent)
+        weak_terminate_compilation();
+
     FILE *stream = diag_error_memstream != NULL
         ? diag_error_memstream
         : stderr;
@@ -164,7 +158,7 @@ void weak_compile_error(uint16_t line_no, uint16_t col_no, const char *fmt, ...)
     va_end(args);
 
     if (config.show_location)
-        print_file_range(active_stream, line_no, col_no, buf, 3, /*is_error=*/1);
+        print_file_range(line_no, col_no, buf, 3, /*is_error=*/1);
 
     fputc('\n', stream);
     fflush(stream);
@@ -172,9 +166,9 @@ void weak_compile_error(uint16_t line_no, uint16_t col_no, const char *fmt, ...)
     weak_terminate_compilation();
 }
 
-void weak_compile_warn(uint16_t line_no, uint16_t col_no, const char *fmt, ...)
+void weak_compile_warn(uint32_t line_no, uint32_t col_no, const char *fmt, ...)
 {
-    if (config.ignore_warns)
+    if (config.ignore_warns || silent)
         return;
 
     FILE *stream = diag_warn_memstream != NULL
@@ -198,7 +192,7 @@ void weak_compile_warn(uint16_t line_no, uint16_t col_no, const char *fmt, ...)
     va_end(args);
 
     if (config.show_location)
-        print_file_range(active_stream, line_no, col_no, buf, 3, /*is_error=*/0);
+        print_file_range(line_no, col_no, buf, 3, /*is_error=*/0);
 
     fputc('\n', stream);
     fflush(stream);
@@ -13,6 +13,8 @@
 #include <stdnoreturn.h>
 #include <stdio.h>
 
+struct source;
+
 struct diag_config {
     bool ignore_warns;
     bool show_location;
@@ -30,8 +32,10 @@ struct diag_config {
     } else {
         // Fallback on error inside normal code.
     }
-    \endcode */
-extern jmp_buf weak_fatal_error_buf;
+    \endcode
+
+    \note Each thread has own buffer. */
+extern _Thread_local jmp_buf weak_fatal_error_buf;
 
 /** \defgroup weak_diagnostic_streams
    
@@ -56,16 +60,26 @@ extern void *diag_warn_memstream;
  */
 void weak_diag_set_config(struct diag_config *new_config);
 
+/** \brief Do not print errors and warnings emitted by the
+           current thread. Errors still terminate compilation.
+
+    Used by threads doing speculative work, whose errors are
+    reported again by the main thread in proper order. */
+void weak_diag_set_silent(bool silent);
+
 /** \brief Set source code location being analyzed. Used to display
            warns and errors. */
 void weak_set_source_filename(const char *filename);
-void weak_set_source_stream(FILE *stream);
+/** \brief Set source used to print code around reported location.
+
+    \note Source should stay mapped until the end of analysis. */
+void weak_set_source(const struct source *source);
 
 /** \brief Emit compile error according to \ref weak_diagnostic_streams rule
            and go out from executor function of any depth. */
 noreturn
-void weak_compile_error(uint16_t line_no, uint16_t col_no, const char *fmt, ...);
+void weak_compile_error(uint32_t line_no, uint32_t col_no, const char *fmt, ...);
 /** \brief Emit compile warning according to \ref weak_diagnostic_streams rule. */
-void weak_compile_warn (uint16_t line_no, uint16_t col_no, const char *fmt, ...);
+void weak_compile_warn (uint32_t line_no, uint32_t col_no, const char *fmt, ...);
 
 #endif // WEAK_COMPILER_UTIL_DIAGNOSTICS_H
\ No newline at end of file
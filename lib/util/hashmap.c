@@ -6,122 +6,339 @@
 
 #include "util/hashmap.h"
 #include "util/alloc.h"
+#include "util/compiler.h"
 #include <stdbool.h>
 #include <string.h>
 
-#define LOAD_FACTOR 0.75
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
-static inline uint64_t hash(uint64_t key, uint64_t capacity)
+#define HASHMAP_MIN_CAPACITY HASHMAP_GROUP_SIZE
+
+/* Keys are often small sequential numbers (instruction indices,
+   interned ids), so mix all bits before using them. */
+static inline uint64_t hash(uint64_t key)
 {
-    return key % capacity;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
 }
 
-void hashmap_init(hashmap_t *map, uint64_t size)
+/* Group index bits. */
+static inline uint64_t hash_h1(uint64_t h) { return h >> 7; }
+/* Stored in control byte. */
+static inline int8_t   hash_h2(uint64_t h) { return (int8_t) (h & 0x7F); }
+
+/**********************************************
+ **           Group operations               **
+ **********************************************/
+
+/* Each function returns bitmask, where bit i is set if
+   slot i of the group matches. */
+#ifdef __SSE2__
+static inline uint32_t group_match(const int8_t *g, int8_t h2)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) g);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static inline uint32_t group_match_empty(const int8_t *g)
+{
+    return group_match(g, HASHMAP_CTRL_EMPTY);
+}
+
+static inline uint32_t group_match_empty_or_deleted(const int8_t *g)
+{
+    /* Both have sign bit set, full slots have not. */
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) g);
+    return _mm_movemask_epi8(ctrl);
+}
+#else
+static inline uint32_t group_match(const int8_t *g, int8_t h2)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < HASHMAP_GROUP_SIZE; ++i)
+        mask |= (uint32_t) (g[i] == h2) << i;
+    return mask;
+}
+
+static inline uint32_t group_match_empty(const int8_t *g)
+{
+    return group_match(g, HASHMAP_CTRL_EMPTY);
+}
+
+static inline uint32_t group_match_empty_or_deleted(const int8_t *g)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < HASHMAP_GROUP_SIZE; ++i)
+        mask |= (uint32_t) (g[i] < 0) << i;
+    return mask;
+}
+#endif /* __SSE2__ */
+
+/* Groups are probed in triangular sequence g, g+1, g+3, g+6, ...
+   With power of two groups count it visits every group once. */
+#define probe_foreach(map, h, group)                                     \
+    for (uint64_t _gmask = (map)->capacity / HASHMAP_GROUP_SIZE - 1,     \
+                  _step  = 0,                                            \
+                   group = hash_h1(h) & _gmask;                          \
+         _step <= _gmask;                                                \
+         group = (group + ++_step) & _gmask)
+
+#define bitmask_foreach(mask, bit)                                       \
+    for (uint32_t _m = (mask), bit; _m && (bit = __builtin_ctz(_m), 1);  \
+         _m &= _m - 1)
+
+/**********************************************
+ **              Allocation                  **
+ **********************************************/
+/* Keep load factor of index table below 7/8. */
+static inline uint64_t max_entries(uint64_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+static uint64_t capacity_for(uint64_t size)
+{
+    uint64_t cap = HASHMAP_MIN_CAPACITY;
+    while (max_entries(cap) <= size)
+        cap *= 2;
+    return cap;
+}
+
+/* Words of deleted entries bitmap. */
+static inline uint64_t deleted_words(uint64_t capacity)
+{
+    return (max_entries(capacity) + 63) / 64;
+}
+
+static void hashmap_alloc(hashmap_t *map, uint64_t capacity)
 {
-    map->buckets = (hashmap_bucket_t *) weak_calloc(size, sizeof (hashmap_bucket_t));
-    map->capacity = size;
+    map->ctrl = weak_malloc(capacity);
+    map->slots = weak_malloc(capacity * sizeof (uint32_t));
+    map->entries = weak_malloc(max_entries(capacity) * sizeof (hashmap_entry_t));
+    map->deleted = weak_calloc(deleted_words(capacity), sizeof (uint64_t));
+    map->entries_cnt = 0;
+    map->capacity = capacity;
     map->size = 0;
+    map->tombstones = 0;
+    memset(map->ctrl, HASHMAP_CTRL_EMPTY, capacity);
+}
+
+void hashmap_init(hashmap_t *map, uint64_t size)
+{
+    hashmap_alloc(map, capacity_for(size));
 }
 
+/* Map is reset for each function by many passes, and
+   usually gets back to the same size. So buffers are kept
+   if they are not much larger than needed, and only
+   control bytes are cleared. */
 void hashmap_reset(hashmap_t *map, uint64_t size)
 {
-    if (map->buckets)
-        hashmap_destroy(map);
-    hashmap_init(map, size);
+    uint64_t capacity = capacity_for(size);
+
+    if (map->ctrl && map->capacity >= capacity && map->capacity <= capacity * 8) {
+        map->entries_cnt = 0;
+        map->size = 0;
+        map->tombstones = 0;
+        memset(map->ctrl, HASHMAP_CTRL_EMPTY, map->capacity);
+        memset(map->deleted, 0, deleted_words(map->capacity) * sizeof (uint64_t));
+        return;
+    }
+
+    hashmap_destroy(map);
+    hashmap_alloc(map, capacity);
 }
 
 void hashmap_destroy(hashmap_t *map)
 {
-    weak_free(map->buckets);
-    map->size = 0;
-    map->capacity = 0;
+    weak_free(map->ctrl);
+    weak_free(map->slots);
+    weak_free(map->entries);
+    weak_free(map->deleted);
     memset(map, 0, sizeof (*map));
 }
 
-static void hashmap_resize(hashmap_t *map)
+/**********************************************
+ **              Lookup                      **
+ **********************************************/
+/* \return Index table slot of key or -1. */
+static int64_t hashmap_find(hashmap_t *map, uint64_t key, uint64_t h)
 {
-    uint64_t old_capacity = map->capacity;
-    hashmap_bucket_t *old_buckets = map->buckets;
+    if (unlikely(map->capacity == 0))
+        return -1;
 
-    map->capacity *= 2;
-    map->buckets = (hashmap_bucket_t *) weak_calloc(map->capacity, sizeof (hashmap_bucket_t));
+    int8_t h2 = hash_h2(h);
 
-    for (uint64_t i = 0; i < map->capacity; i++) {
-        map->buckets[i].key = 0;
-        map->buckets[i].is_occupied = false;
-        map->buckets[i].is_deleted = false;
-    }
-
-    map->size = 0;
+    probe_foreach(map, h, group) {
+        uint64_t      base = group * HASHMAP_GROUP_SIZE;
+        const int8_t *g    = &map->ctrl[base];
 
-    for (uint64_t i = 0; i < old_capacity; i++) {
-        if (old_buckets[i].is_occupied && !old_buckets[i].is_deleted) {
-            hashmap_bucket_t *entry = &old_buckets[i];
-            hashmap_put(map, entry->key, entry->val);
+        bitmask_foreach(group_match(g, h2), bit) {
+            uint64_t idx = base + bit;
+            if (likely(map->entries[map->slots[idx]].key == key))
+                return idx;
         }
+
+        /* Key would be placed in this group, if it had empty
+           slot at insertion time. */
+        if (likely(group_match_empty(g)))
+            return -1;
     }
 
-    weak_free(old_buckets);
+    return -1;
 }
 
-void hashmap_put(hashmap_t *map, uint64_t key, uint64_t val)
+/* \pre Key is not present. */
+static uint64_t hashmap_find_free(hashmap_t *map, uint64_t h)
 {
-    if (map->size >= map->capacity * LOAD_FACTOR) {
-        hashmap_resize(map);
+    probe_foreach(map, h, group) {
+        uint64_t base = group * HASHMAP_GROUP_SIZE;
+        uint32_t mask = group_match_empty_or_deleted(&map->ctrl[base]);
+
+        if (likely(mask))
+            return base + __builtin_ctz(mask);
     }
 
-    unsigned long index = hash(key, map->capacity);
+    __builtin_unreachable();
+}
 
-    while (map->buckets[index].is_occupied) {
-        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
-            map->buckets[index].val = val;
-            map->size++;
-            return;
-        }
+/**********************************************
+ **              Rehash                      **
+ **********************************************/
+/* Rebuild index table and drop deleted entries,
+   preserving order of live ones. */
+static void hashmap_rehash(hashmap_t *map, uint64_t capacity)
+{
+    hashmap_t old = *map;
+
+    hashmap_alloc(map, capacity);
 
-        index = (index + 1) % map->capacity;
+    for (uint64_t i = 0; i < old.entries_cnt; ++i) {
+        if (hashmap_entry_deleted(&old, i))
+            continue;
+
+        hashmap_entry_t *e = &old.entries[i];
+
+        uint64_t h   = hash(e->key);
+        uint64_t idx = hashmap_find_free(map, h);
+
+        map->ctrl[idx] = hash_h2(h);
+        map->slots[idx] = map->entries_cnt;
+        map->entries[map->entries_cnt++] = *e;
     }
 
-    map->buckets[index].key = key;
-    map->buckets[index].val = val;
-    map->buckets[index].is_occupied = true;
-    map->buckets[index].is_deleted = false;
-    map->size++;
+    map->size = old.size;
+
+    weak_free(old.ctrl);
+    weak_free(old.slots);
+    weak_free(old.entries);
+    weak_free(old.deleted);
 }
 
-uint64_t hashmap_get(hashmap_t *map, uint64_t key, bool *success)
+/* Called before appending new entry. */
+static void hashmap_reserve_one(hashmap_t *map)
 {
-    uint64_t index = hash(key, map->capacity);
+    if (unlikely(map->capacity == 0)) {
+        hashmap_alloc(map, HASHMAP_MIN_CAPACITY);
+        return;
+    }
 
-    while (map->buckets[index].is_occupied) {
-        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
-            *success = 1;
-            return map->buckets[index].val;
-        }
+    uint64_t dead = map->entries_cnt - map->size;
+    bool     full = map->entries_cnt >= max_entries(map->capacity) ||
+                    map->size + map->tombstones >= max_entries(map->capacity);
+
+    /* Compact if deleted entries dominate, so iteration
+       stays proportional to live entries. */
+    if (likely(!full && (dead <= map->size || dead < HASHMAP_GROUP_SIZE)))
+        return;
 
-        index = (index + 1) % map->capacity;
+    /* Leave at least half of the table free after rehash. */
+    uint64_t capacity = map->capacity;
+    while ((map->size + 1) * 2 > max_entries(capacity))
+        capacity *= 2;
+
+    hashmap_rehash(map, capacity);
+}
+
+/**********************************************
+ **              Modification                **
+ **********************************************/
+void hashmap_put(hashmap_t *map, uint64_t key, uint64_t val)
+{
+    uint64_t h   = hash(key);
+    int64_t  idx = hashmap_find(map, key, h);
+
+    if (idx >= 0) {
+        /* Overwrite. Size and position are unchanged. */
+        map->entries[map->slots[idx]].val = val;
+        return;
     }
 
-    *success = 0;
+    hashmap_reserve_one(map);
+
+    uint64_t         slot = hashmap_find_free(map, h);
+    hashmap_entry_t *e    = &map->entries[map->entries_cnt];
 
-    return (uint64_t) -1;
+    e->key = key;
+    e->val = val;
+    /* Bit could be left by entry reclaimed in hashmap_remove(). */
+    map->deleted[map->entries_cnt / 64] &= ~(1ULL << (map->entries_cnt % 64));
+
+    if (map->ctrl[slot] == HASHMAP_CTRL_DELETED)
+        --map->tombstones;
+
+    map->ctrl[slot] = hash_h2(h);
+    map->slots[slot] = map->entries_cnt++;
+    ++map->size;
+}
+
+uint64_t hashmap_get(hashmap_t *map, uint64_t key, bool *success)
+{
+    int64_t idx = hashmap_find(map, key, hash(key));
+
+    if (idx < 0) {
+        *success = 0;
+        return (uint64_t) -1;
+    }
+
+    *success = 1;
+    return map->entries[map->slots[idx]].val;
 }
 
 bool hashmap_remove(hashmap_t *map, uint64_t key)
 {
-    uint64_t index = hash(key, map->capacity);
+    int64_t idx = hashmap_find(map, key, hash(key));
 
-    while (map->buckets[index].is_occupied) {
-        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
-            map->buckets[index].is_deleted = true;
-            map->size--;
-            return 1;
-        }
+    if (idx < 0)
+        return 0; /* Key not found */
 
-        index = (index + 1) % map->capacity;
+    uint64_t pos = map->slots[idx];
+    map->deleted[pos / 64] |= 1ULL << (pos % 64);
+
+    /* If group still has empty slot, no lookup ever probed past
+       it, so slot can become empty instead of tombstone. */
+    const int8_t *g = &map->ctrl[idx & ~(uint64_t) (HASHMAP_GROUP_SIZE - 1)];
+
+    if (group_match_empty(g)) {
+        map->ctrl[idx] = HASHMAP_CTRL_EMPTY;
+    } else {
+        map->ctrl[idx] = HASHMAP_CTRL_DELETED;
+        ++map->tombstones;
     }
 
-    return 0; /* Key not found */
+    /* Entries removed in LIFO order (like scopes) are
+       reclaimed immediately. */
+    while (map->entries_cnt > 0 && hashmap_entry_deleted(map, map->entries_cnt - 1))
+        --map->entries_cnt;
+
+    --map->size;
+    return 1;
 }
 
 bool hashmap_has(hashmap_t *map, uint64_t key)
@@ -129,4 +346,4 @@ bool hashmap_has(hashmap_t *map, uint64_t key)
     bool ok = 0;
     hashmap_get(map, key, &ok);
     return ok;
-}
\ No newline at end of file
+}
@@ -11,19 +11,51 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/** Slots are probed in groups of this size. */
+#define HASHMAP_GROUP_SIZE 16
+
+/** Control byte values. Full slot stores 7 low bits of
+    key hash, so it is always non-negative. */
+#define HASHMAP_CTRL_EMPTY   ((int8_t) -128)
+#define HASHMAP_CTRL_DELETED ((int8_t) -2)
+
 typedef struct {
     uint64_t key;
     uint64_t val;
-    bool     is_occupied;
-    bool     is_deleted;
-} hashmap_bucket_t;
+} hashmap_entry_t;
+
+/** Open addressing hashmap with separate control bytes
+    (SwissTable layout) over dense entry array.
+
+    Entries are stored contiguously in insertion order. Index
+    table of `capacity` slots maps hash to entry position. Each
+    slot has one control byte: empty, deleted or 7 bits of hash
+    of key. Lookup compares whole group of 16 control bytes at
+    once (with SSE2 if available) and touches entries only on
+    match. Capacity is always power of two, so probing uses
+    masks instead of division.
 
+    Removed entries are marked as deleted in separate bitmap,
+    so entry stays 16 bytes, and dropped from the entry array
+    by compaction, which happens in hashmap_put() when deleted
+    entries outnumber live ones or table is full.
+    So iteration costs O(live entries) amortized, not O(capacity). */
 typedef struct {
-    hashmap_bucket_t* buckets;
-    uint64_t          capacity;
-    uint64_t          size;
+    int8_t          *ctrl;
+    uint32_t        *slots;
+    hashmap_entry_t *entries;
+    /** Bit per entry, set if entry is removed. */
+    uint64_t        *deleted;
+    /** Count of entries including deleted ones. */
+    uint64_t         entries_cnt;
+    uint64_t         capacity;
+    /** Count of live entries. */
+    uint64_t         size;
+    /** Count of deleted control bytes. */
+    uint64_t         tombstones;
 } hashmap_t;
 
+/** Allocate map for at least `size` entries without rehash. */
 void     hashmap_init   (hashmap_t *map, uint64_t size);
 void     hashmap_reset  (hashmap_t *map, uint64_t size);
 void     hashmap_destroy(hashmap_t *map);
@@ -32,15 +64,19 @@ uint64_t hashmap_get    (hashmap_t *map, uint64_t key, bool *success);
 bool     hashmap_remove (hashmap_t *map, uint64_t key);
 bool     hashmap_has    (hashmap_t *map, uint64_t key);
 
+#define hashmap_entry_deleted(map, i) \
+    ((map)->deleted[(i) / 64] >> ((i) % 64) & 1)
+
+/** Iterate over all entries in insertion order. Overwrite by
+    hashmap_put() keeps original position.
+
+    \note hashmap_remove() is allowed inside the loop.
+          hashmap_put() of new key is not, since it may
+          compact entries. */
 #define hashmap_foreach(map, k, v) \
-    for (uint64_t _i = 0, (k), (v); (k) = (map)->buckets[_i].key, \
-                                    (v) = (map)->buckets[_i].val, \
-                                     _i < (map)->capacity; ++_i)  \
-                                /*
-                                            ^^^^^^^^
-                                     Must be comparison with count of
-                                     occupied entries, not with capacity.
-                                 */                          \
-        if ((map)->buckets[_i].is_occupied && !(map)->buckets[_i].is_deleted)
-
-#endif // WEAK_COMPILER_UTIL_HASHMAP_H
\ No newline at end of file
+    for (uint64_t _i = 0, k = 0, v = 0; _i < (map)->entries_cnt; ++_i) \
+        if (!hashmap_entry_deleted(map, _i) &&                         \
+            ((k) = (map)->entries[_i].key,                             \
+             (v) = (map)->entries[_i].val, 1))
+
+#endif // WEAK_COMPILER_UTIL_HASHMAP_H
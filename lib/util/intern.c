@@ -0,0 +1,237 @@
+/* intern.c - Global string interner.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/intern.h"
+#include "util/alloc.h"
+#include "util/arena.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+
+struct intern_entry {
+    uint64_t hash;
+    uint32_t len;
+    uint32_t id;
+    char     str[];
+};
+
+/* Entries are indexed by id. Id of string can be passed to
+   other thread, which looks it up without lock, so entries
+   are never moved. With B = 2^INTERN_SEGMENT_BITS, segment
+   k > 0 holds ids [B * 2^(k-1), B * 2^k), and segment 0
+   holds ids [0, B). Slot 0 is reserved for INTERN_NO_ID. */
+#define INTERN_SEGMENT_BITS 10
+#define INTERN_SEGMENTS     (32 - INTERN_SEGMENT_BITS + 1)
+
+/* Strings storage. Never released. */
+static struct arena          intern_mem;
+static struct intern_entry **intern_segments[INTERN_SEGMENTS];
+static uint32_t              intern_entries_cnt;
+/* Open addressing table of ids, power of two size. */
+static uint32_t             *intern_slots;
+static uint64_t              intern_slots_cap;
+/* Taken for each change, since any thread can intern. */
+static pthread_mutex_t       intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Strings recently interned by the thread, indexed by hash.
+   Entries are never freed, so hit needs no lock. */
+#define INTERN_CACHE_SIZE 256
+
+static _Thread_local const struct intern_entry *intern_cache[INTERN_CACHE_SIZE];
+
+static inline uint32_t intern_segment(uint32_t id)
+{
+    uint32_t high = id >> INTERN_SEGMENT_BITS;
+    return high ? 32 - __builtin_clz(high) : 0;
+}
+
+static inline struct intern_entry **intern_entry_at(uint32_t id)
+{
+    uint32_t seg = intern_segment(id);
+    uint32_t off = seg ? id - (1U << (INTERN_SEGMENT_BITS + seg - 1)) : id;
+
+    return &intern_segments[seg][off];
+}
+
+/* 64-bit hash in style of wyhash: reads 8 bytes at once
+   and mixes with 64x64->128 multiplication. */
+static const uint64_t intern_secret[2] = {
+    0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL
+};
+
+static inline uint64_t intern_mum(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+static inline uint64_t intern_r8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof (v));
+    return v;
+}
+
+static inline uint64_t intern_r4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof (v));
+    return v;
+}
+
+uint64_t intern_hash(const char *s, uint64_t len)
+{
+    const uint8_t *p    = (const uint8_t *) s;
+    uint64_t       seed = intern_secret[0];
+    uint64_t       a    = 0;
+    uint64_t       b    = 0;
+
+    if (likely(len <= 16)) {
+        if (len >= 4) {
+            /* Two possibly overlapping reads from each end. */
+            uint64_t off = (len >> 3) << 2;
+            a = (intern_r4(p) << 32) | intern_r4(p + off);
+            b = (intern_r4(p + len - 4) << 32) | intern_r4(p + len - 4 - off);
+        } else if (len > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+        }
+    } else {
+        uint64_t i = len;
+        while (i > 16) {
+            seed = intern_mum(intern_r8(p) ^ intern_secret[1], intern_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = intern_r8(p + i - 16);
+        b = intern_r8(p + i - 8);
+    }
+
+    return intern_mum(
+        intern_mum(a ^ intern_secret[1], b ^ seed) ^ len,
+        intern_secret[0]
+    );
+}
+
+static void intern_grow()
+{
+    uint64_t  cap   = intern_slots_cap ? intern_slots_cap * 2 : 1024;
+    uint32_t *slots = weak_calloc(cap, sizeof (uint32_t));
+
+    for (uint32_t i = 1; i < intern_entries_cnt; ++i) {
+        uint64_t idx = (*intern_entry_at(i))->hash & (cap - 1);
+        while (slots[idx] != INTERN_NO_ID)
+            idx = (idx + 1) & (cap - 1);
+        slots[idx] = i;
+    }
+
+    weak_free(intern_slots);
+    intern_slots = slots;
+    intern_slots_cap = cap;
+}
+
+static void intern_push(struct intern_entry *e)
+{
+    uint32_t seg = intern_segment(intern_entries_cnt);
+
+    if (unlikely(!intern_segments[seg])) {
+        uint64_t size = 1ULL << (INTERN_SEGMENT_BITS + (seg ? seg - 1 : 0));
+        intern_segments[seg] = weak_calloc(size, sizeof (struct intern_entry *));
+    }
+
+    *intern_entry_at(intern_entries_cnt++) = e;
+}
+
+static const struct intern_entry *intern_n_locked(const char *s, uint64_t len, uint64_t hash)
+{
+    /* Keep load factor below 1/2. */
+    if (unlikely(intern_entries_cnt * 2 >= intern_slots_cap)) {
+        if (intern_entries_cnt == 0)
+            intern_push(NULL);
+        intern_grow();
+    }
+
+    uint64_t mask = intern_slots_cap - 1;
+    uint64_t idx  = hash & mask;
+
+    while (intern_slots[idx] != INTERN_NO_ID) {
+        struct intern_entry *e = *intern_entry_at(intern_slots[idx]);
+        if (e->hash == hash && e->len == len && !memcmp(e->str, s, len))
+            return e;
+        idx = (idx + 1) & mask;
+    }
+
+    struct intern_entry *e = arena_alloc(&intern_mem, sizeof (struct intern_entry) + len + 1);
+    e->hash = hash;
+    e->len = len;
+    e->id = intern_entries_cnt;
+    memcpy(e->str, s, len);
+
+    intern_push(e);
+    intern_slots[idx] = e->id;
+
+    return e;
+}
+
+const char *intern_n(const char *s, uint64_t len)
+{
+    uint64_t                    hash  = intern_hash(s, len);
+    const struct intern_entry **cache = &intern_cache[hash & (INTERN_CACHE_SIZE - 1)];
+    const struct intern_entry  *e     = *cache;
+
+    if (likely(e && e->hash == hash && e->len == len && !memcmp(e->str, s, len)))
+        return e->str;
+
+    pthread_mutex_lock(&intern_lock);
+    e = intern_n_locked(s, len, hash);
+    pthread_mutex_unlock(&intern_lock);
+
+    *cache = e;
+    return e->str;
+}
+
+const char *intern(const char *s)
+{
+    return intern_n(s, strlen(s));
+}
+
+#ifndef NDEBUG
+static bool intern_is_entry(const struct intern_entry *e)
+{
+    pthread_mutex_lock(&intern_lock);
+    bool ok = e->id != INTERN_NO_ID && e->id < intern_entries_cnt && *intern_entry_at(e->id) == e;
+    pthread_mutex_unlock(&intern_lock);
+
+    return ok;
+}
+#endif /* NDEBUG */
+
+uint32_t intern_id(const char *s)
+{
+    const struct intern_entry *e = (const struct intern_entry *)
+        (s - offsetof(struct intern_entry, str));
+
+    assert(intern_is_entry(e) && "String is not interned");
+
+    return e->id;
+}
+
+/* Id is got from interned string, so its entry is already
+   stored and never moves. */
+const char *intern_str(uint32_t id)
+{
+    assert(id != INTERN_NO_ID);
+    return (*intern_entry_at(id))->str;
+}
+
+uint32_t intern_count()
+{
+    pthread_mutex_lock(&intern_lock);
+    uint32_t cnt = intern_entries_cnt ? intern_entries_cnt - 1 : 0;
+    pthread_mutex_unlock(&intern_lock);
+
+    return cnt;
+}
@@ -0,0 +1,54 @@
+/* intern.h - Global string interner.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_UTIL_INTERN_H
+#define WEAK_COMPILER_UTIL_INTERN_H
+
+#include "util/compiler.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Each distinct string is stored once and gets dense 32-bit
+    id, starting from 1. Interned strings live until the end
+    of the program, so pointers to them are never freed.
+
+    Interned string pointer is itself a valid key: two such
+    pointers are equal if and only if strings are equal. Id is
+    stored right before characters, so intern_id() is O(1) and
+    computes no hash. Symbol tables must use this id as a key
+    rather than a hash of the name, which may collide.
+
+    64-bit string hash is computed only once, when lexer (or
+    anyone else) interns the string, and cached with it.
+
+    All functions can be called from several threads at once.
+    Interning takes lock, while intern_id() and intern_str()
+    do not. */
+#define INTERN_NO_ID 0
+
+/** Intern string of given length (not necessarily NUL-terminated).
+
+    \return Interned copy. */
+wur const char *intern_n(const char *s, uint64_t len);
+
+/** Intern NUL-terminated string. */
+wur const char *intern(const char *s);
+
+/** \pre `s` is returned by intern() or intern_n(). */
+wur uint32_t    intern_id(const char *s);
+
+/** \return Interned string by id. */
+wur const char *intern_str(uint32_t id);
+
+/** \return Count of distinct interned strings. */
+wur uint32_t    intern_count();
+
+/** 64-bit hash of `len` bytes, the same as used for
+    interning. Not cryptographic, but good enough to
+    tell contents apart. */
+wur uint64_t    intern_hash(const char *s, uint64_t len);
+
+#endif // WEAK_COMPILER_UTIL_INTERN_H
@@ -0,0 +1,128 @@
+/* source.c - Memory-mapped source file.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/source.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void source_index_lines(struct source *s)
+{
+    const char *p   = s->data;
+    const char *end = s->data + s->size;
+
+    vector_push_back(s->lines, 0);
+
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        ++p;
+        if (p < end)
+            vector_push_back(s->lines, (uint32_t) (p - s->data));
+    }
+}
+
+bool source_open(struct source *s, const char *filename)
+{
+    struct stat st = {0};
+    int         fd = open(filename, O_RDONLY);
+
+    memset(s, 0, sizeof (*s));
+
+    if (fd < 0)
+        return 0;
+
+    if (fstat(fd, &st) < 0)
+        goto fail;
+
+    if ((uint64_t) st.st_size > UINT32_MAX) {
+        errno = EFBIG;
+        goto fail;
+    }
+
+    uint64_t page = sysconf(_SC_PAGESIZE);
+
+    s->filename = filename;
+    s->size = st.st_size;
+    /* Reserve zeroed tail, since bytes after end of file
+       are zero-filled only up to the page end. */
+    s->mapped_size = (s->size + 2 + page - 1) & ~(page - 1);
+    s->data = mmap(NULL, s->mapped_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (s->data == MAP_FAILED)
+        goto fail;
+
+    if (s->size > 0 &&
+        mmap(s->data, s->size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(s->data, s->mapped_size);
+        goto fail;
+    }
+
+    close(fd);
+    source_index_lines(s);
+    return 1;
+
+fail:
+    close(fd);
+    memset(s, 0, sizeof (*s));
+    return 0;
+}
+
+void source_close(struct source *s)
+{
+    if (s->data)
+        munmap(s->data, s->mapped_size);
+    vector_free(s->lines);
+    memset(s, 0, sizeof (*s));
+}
+
+uint64_t source_lines_count(const struct source *s)
+{
+    return s->lines.count;
+}
+
+const char *source_line(const struct source *s, uint64_t line_no, uint64_t *len)
+{
+    if (line_no == 0 || line_no > s->lines.count)
+        return NULL;
+
+    uint64_t begin = s->lines.data[line_no - 1];
+    uint64_t end   = line_no < s->lines.count
+        ? s->lines.data[line_no] - 1 /* Skip '\n'. */
+        : s->size;
+
+    /* Last line may end with newline. */
+    if (end > begin && s->data[end - 1] == '\n')
+        --end;
+
+    *len = end - begin;
+    return s->data + begin;
+}
+
+void source_locate(
+    const struct source *s,
+    uint32_t             offset,
+    uint32_t            *line_no,
+    uint32_t            *col_no
+) {
+    /* Last line, which begins not after offset. */
+    uint64_t lo = 0;
+    uint64_t hi = s->lines.count;
+
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if (s->lines.data[mid] <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    *line_no = lo + 1;
+    *col_no  = offset - s->lines.data[lo] + 1;
+}
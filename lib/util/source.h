@@ -0,0 +1,63 @@
+/* source.h - Memory-mapped source file.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_UTIL_SOURCE_H
+#define WEAK_COMPILER_UTIL_SOURCE_H
+
+#include "util/compiler.h"
+#include "util/vector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Source file, mapped to memory once and shared by lexer
+    and diagnostics.
+
+    \note Buffer is writable private mapping, followed by two
+          zero bytes, so it can be scanned by flex in place
+          (see yy_scan_buffer()). Writes are never visible
+          in the file. */
+struct source {
+    const char         *filename;
+    char               *data;
+    /** File size without trailing zeros. */
+    uint64_t            size;
+    uint64_t            mapped_size;
+    /** Offsets of line beginnings. Line N starts at lines[N - 1]. */
+    vector_t(uint32_t)  lines;
+};
+
+/** Map file and build line index.
+
+    \return 1 on success, 0 on error with errno set.
+    \note   Files larger than 4GB are rejected with EFBIG,
+            since tokens and lines use 32-bit offsets. */
+wur bool source_open(struct source *s, const char *filename);
+
+/** Unmap file. Tokens and diagnostics cannot refer to it after. */
+void source_close(struct source *s);
+
+/** \return Count of lines. Last line may be not terminated
+            by newline. */
+wur uint64_t source_lines_count(const struct source *s);
+
+/** Get line by number in O(1).
+
+    \param line_no 1-based line number.
+    \param len     Line length without newline.
+    \return        Pointer to line start, NULL if out of range.
+                   Line is not NUL-terminated. */
+wur const char *source_line(const struct source *s, uint64_t line_no, uint64_t *len);
+
+/** Get 1-based line and column of byte offset by binary
+    search in line index. */
+void source_locate(
+    const struct source *s,
+    uint32_t             offset,
+    uint32_t            *line_no,
+    uint32_t            *col_no
+);
+
+#endif // WEAK_COMPILER_UTIL_SOURCE_H
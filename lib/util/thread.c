@@ -0,0 +1,64 @@
+/* thread.c - Per-thread state teardown.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/thread.h"
+#include "util/compiler.h"
+#include "util/unreachable.h"
+#include <pthread.h>
+#include <stdint.h>
+
+/* Count of modules with thread-local state is small
+   and known at compile time. */
+#define THREAD_ATEXIT_MAX 16
+
+static pthread_key_t  thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+static _Thread_local void   (*thread_fns[THREAD_ATEXIT_MAX])();
+static _Thread_local uint32_t thread_fns_cnt;
+
+static void thread_key_destroy(unused void *arg)
+{
+    weak_thread_cleanup();
+}
+
+static void thread_key_create()
+{
+    errno = pthread_key_create(&thread_key, thread_key_destroy);
+    if (errno != 0)
+        weak_fatal_errno("pthread_key_create()");
+}
+
+void weak_thread_atexit(void (*fn)())
+{
+    for (uint32_t i = 0; i < thread_fns_cnt; ++i)
+        if (thread_fns[i] == fn)
+            return;
+
+    if (thread_fns_cnt == THREAD_ATEXIT_MAX)
+        weak_fatal_error("Too many thread exit functions");
+
+    if (thread_fns_cnt == 0) {
+        pthread_once(&thread_key_once, thread_key_create);
+        /* Destructor is called only for non-NULL value. */
+        pthread_setspecific(thread_key, thread_fns);
+    }
+
+    thread_fns[thread_fns_cnt++] = fn;
+}
+
+void weak_thread_cleanup()
+{
+    if (thread_fns_cnt == 0)
+        return;
+
+    /* Function may register another one (or itself) again,
+       so list is consumed from the end. */
+    while (thread_fns_cnt > 0)
+        thread_fns[--thread_fns_cnt]();
+
+    pthread_setspecific(thread_key, NULL);
+}
@@ -0,0 +1,30 @@
+/* thread.h - Per-thread state teardown.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#ifndef WEAK_COMPILER_UTIL_THREAD_H
+#define WEAK_COMPILER_UTIL_THREAD_H
+
+/** Each compiler stage keeps its state in thread-local
+    variables, so one thread compiles one unit at time.
+    Stage, which allocates such state, registers function
+    freeing it. Registered functions are called in reverse
+    order when thread exits or by weak_thread_cleanup().
+
+    Registration of the same function twice is no-op, so it
+    is done on each state initialization.
+
+    \note Main thread does not call destructors on exit.
+          It should call weak_thread_cleanup() itself, if
+          needed. */
+void weak_thread_atexit(void (*fn)());
+
+/** Call and unregister all functions, registered by
+    calling thread. After that, stages can be used from
+    scratch, for example after weak_fatal_error_buf jump
+    interrupted some of them. */
+void weak_thread_cleanup();
+
+#endif // WEAK_COMPILER_UTIL_THREAD_H
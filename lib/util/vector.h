@@ -92,9 +92,10 @@ do { \
 
 #define vector_erase(vec, pos) \
 do { \
-    if (pos < (vec).count) { \
+    size_t _vec_pos = (pos); \
+    if (_vec_pos < (vec).count) { \
         (vec).count--; \
-        for (size_t _vec_i=pos; _vec_i<(vec).count; ++_vec_i) (vec).data[_vec_i] = (vec).data[_vec_i+1]; \
+        for (size_t _vec_i=_vec_pos; _vec_i<(vec).count; ++_vec_i) (vec).data[_vec_i] = (vec).data[_vec_i+1]; \
     } \
 } while(0)
 
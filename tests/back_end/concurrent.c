@@ -0,0 +1,154 @@
+/* concurrent.c - Test for compilation of several files at once.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ir_dump.h"
+#include "middle_end/ir/type.h"
+#include "middle_end/opt/opt.h"
+#include "utils/test_utils.h"
+#include <pthread.h>
+
+#ifdef CONFIG_USE_BACKEND_EVAL
+#include "back_end/eval.h"
+#endif /* CONFIG_USE_BACKEND_EVAL */
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define MAX_FILES 64
+
+struct unit_job {
+    char      *path;
+    /** Output of serial compilation. */
+    char      *expected;
+    /** Output of compilation in own thread. */
+    char      *generated;
+    pthread_t  thread;
+};
+
+static struct unit_job jobs[MAX_FILES];
+static uint32_t        jobs_cnt;
+
+#ifndef CONFIG_USE_NATIVE_LEXER
+/* flex scanner is not reentrant (see lex_source()). */
+static pthread_mutex_t lex_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* CONFIG_USE_NATIVE_LEXER */
+
+/* Same pipeline as in compiler driver up to the back end.
+   Each stage keeps its state per thread, so only source is
+   passed. IR is compared, and also result of evaluation if
+   eval back end is built. */
+static char *compile(const char *path)
+{
+    char          *out    = NULL;
+    size_t         size   = 0;
+    FILE          *stream = open_memstream(&out, &size);
+    struct source  src    = {0};
+
+    if (!source_open(&src, path))
+        weak_unreachable("Cannot open file `%s`", path);
+
+    weak_set_source_filename(path);
+    weak_set_source(&src);
+
+#ifndef CONFIG_USE_NATIVE_LEXER
+    pthread_mutex_lock(&lex_lock);
+#endif /* CONFIG_USE_NATIVE_LEXER */
+    lex_init_state();
+    lex_source(&src);
+    tok_array_t toks = *lex_consumed_tokens();
+#ifndef CONFIG_USE_NATIVE_LEXER
+    yylex_destroy();
+    pthread_mutex_unlock(&lex_lock);
+#endif /* CONFIG_USE_NATIVE_LEXER */
+
+    struct ast_node *ast = parse(&toks);
+    tok_array_free(&toks);
+
+    ana_run(ast);
+
+    struct ir_unit unit = ir_gen(ast);
+    ast_node_cleanup(ast);
+
+    ir_type_pass(&unit);
+    ir_opt_reorder(&unit);
+    ir_opt_arith(&unit);
+
+    ir_dump_unit(stream, &unit);
+#ifdef CONFIG_USE_BACKEND_EVAL
+    fprintf(stream, "%d\n", eval(&unit));
+#endif /* CONFIG_USE_BACKEND_EVAL */
+
+    ir_unit_cleanup(&unit);
+    source_close(&src);
+    fclose(stream);
+
+    return out;
+}
+
+static void *compile_worker(void *arg)
+{
+    struct unit_job *job = arg;
+
+    job->generated = compile(job->path);
+    return NULL;
+}
+
+int serial_test(const char *path, unused const char *filename)
+{
+    if (jobs_cnt == MAX_FILES)
+        weak_unreachable("Too many test inputs");
+
+    struct unit_job *job = &jobs[jobs_cnt++];
+
+    job->path     = strdup(path);
+    job->expected = compile(path);
+    return 0;
+}
+
+int concurrent_test()
+{
+    int rc = 0;
+
+    for (uint32_t i = 0; i < jobs_cnt; ++i) {
+        errno = pthread_create(&jobs[i].thread, NULL, compile_worker, &jobs[i]);
+        if (errno != 0)
+            weak_fatal_errno("pthread_create()");
+    }
+
+    for (uint32_t i = 0; i < jobs_cnt; ++i) {
+        errno = pthread_join(jobs[i].thread, NULL);
+        if (errno != 0)
+            weak_fatal_errno("pthread_join()");
+    }
+
+    for (uint32_t i = 0; i < jobs_cnt; ++i) {
+        struct unit_job *job = &jobs[i];
+
+        if (strcmp(job->expected, job->generated) != 0) {
+            printf(
+                "%sMismatch on %s:%s\n`%s`\ngot,\n`%s`\nexpected\n",
+                color_red, job->path, color_end,
+                job->generated, job->expected
+            );
+            rc = -1;
+        }
+
+        free(job->path);
+        free(job->expected);
+        free(job->generated);
+    }
+
+    printf("%u files compiled concurrently\n", jobs_cnt);
+    return rc;
+}
+
+int main()
+{
+    if (do_on_each_file("eval", serial_test) < 0)
+        return -1;
+
+    return concurrent_test();
+}
@@ -14,21 +14,14 @@ void *diag_warn_memstream = NULL;
 
 void __eval_test(const char *path, unused const char *filename, FILE *out_stream)
 {
-    struct ir_unit  ir = gen_ir(path);
-    struct ir_node *it = ir.fn_decls;
+    struct ir_unit ir = gen_ir(path);
+
     ir_type_pass(&ir);
+    ir_opt_reorder(&ir);
+    ir_opt_arith(&ir);
 
-    while (it) {
-        struct ir_fn_decl *decl = it->ir;
-        /* Reordering before building CFG links. */
-        ir_opt_reorder(decl);
-        ir_opt_arith(decl);
-        ir_cfg_build(decl);
-
-        /* Wrong
-            ir_opt_unreachable_code(decl); */
-        it = it->next;
-    }
+    /* Wrong
+        ir_opt_unreachable_code(&ir); */
 
     ir_dump_unit(stdout, &ir);
 
@@ -0,0 +1,121 @@
+/* ast_cache.c - Cold and warm build with AST cache.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast.h"
+#include "front_end/ast/ast_cache.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FILES     200
+#define FUNCTIONS 200
+
+static const char *dir = "/tmp/__ast_cache_bench";
+
+static void gen(uint64_t n)
+{
+    char  path[256] = {0};
+    FILE *f         = NULL;
+
+    snprintf(path, sizeof (path), "%s/%lu.wl", dir, n);
+
+    f = fopen(path, "w");
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t i = 0; i < FUNCTIONS; ++i)
+        fprintf(f,
+            "int f%lu_%lu(int a, int b) {\n"
+            "    int s = 0;\n"
+            "    for (int i = 0; i < b; ++i) {\n"
+            "        if (a > i) { s = s + a * i; } else { s = s - i; }\n"
+            "        while (s > 100) { s = s / 2; }\n"
+            "    }\n"
+            "    return s;\n"
+            "}\n",
+            n, i
+        );
+
+    fclose(f);
+}
+
+/* Same as driver does with --ast-cache. */
+static void build(uint64_t n, bool *hit)
+{
+    char             path [256]      = {0};
+    char             cache[PATH_MAX] = {0};
+    struct source    s               = {0};
+    struct ast_node *ast             = NULL;
+
+    snprintf(path, sizeof (path), "%s/%lu.wl", dir, n);
+
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    weak_set_source(&s);
+    if (!ast_cache_path(cache, sizeof (cache), dir, &s))
+        weak_fatal_errno("ast_cache_path()");
+
+    ast = ast_cache_load(cache, &s);
+    *hit = ast != NULL;
+
+    if (!ast) {
+        lex_init_state();
+        lex_source(&s);
+        ast = parse(lex_consumed_tokens());
+        lex_reset_state();
+
+        if (!ast_cache_store(cache, ast, &s))
+            weak_fatal_errno("ast_cache_store()");
+    }
+
+    ast_node_cleanup(ast);
+    source_close(&s);
+}
+
+static void bench(const char *name)
+{
+    uint64_t hits = 0;
+    double   t    = bench_now();
+
+    for (uint64_t i = 0; i < FILES; ++i) {
+        bool hit = 0;
+        build(i, &hit);
+        hits += hit;
+    }
+
+    t = bench_now() - t;
+    printf("%-6s %8.2f ms, %lu/%d from cache\n", name, t * 1e3, hits, FILES);
+}
+
+int main()
+{
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+        weak_fatal_errno("mkdir()");
+
+    for (uint64_t i = 0; i < FILES; ++i)
+        gen(i);
+
+    bench("cold");
+    bench("warm");
+
+    char cmd[256] = {0};
+    snprintf(cmd, sizeof (cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+        weak_fatal_error("Cannot remove %s", dir);
+}
@@ -0,0 +1,195 @@
+/* dom.c - Dominator tree of large functions and CFGs.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/data_type.h"
+#include "front_end/lex/tok_type.h"
+#include "middle_end/ir/dom.h"
+#include "util/alloc.h"
+#include "utils/bench_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FUNCTIONS 4
+#define BRANCHES  100
+#define STMTS     50
+#define RUNS      5
+
+/* Random CFGs of 1k, 10k and 100k blocks. */
+#define CFG_SIZES 3
+
+/* About 50k statements in a few hundred blocks
+   per function. Long straight-line code inside
+   branches, as after inlining or unrolling. */
+static void gen(FILE *f)
+{
+    for (uint64_t i = 0; i < FUNCTIONS; ++i) {
+        fprintf(f, "int f%lu(int a, int b) {\n    int s = 0;\n", i);
+
+        for (uint64_t j = 0; j < BRANCHES; ++j) {
+            fprintf(f, "    if (a > %lu) {\n", j);
+            for (uint64_t k = 0; k < STMTS; ++k)
+                fprintf(f, "        s = s + a * %lu;\n", k);
+            fprintf(f, "    } else {\n");
+            for (uint64_t k = 0; k < STMTS; ++k)
+                fprintf(f, "        s = s - b * %lu;\n", k);
+            fprintf(f, "    }\n");
+        }
+
+        fprintf(f, "    return s;\n}\n");
+    }
+
+    fputs("int main() { return 0; }\n", f);
+}
+
+static void bench_source(const char *path)
+{
+    static const struct {
+        const char  *name;
+        void       (*pass)(struct ir_fn_decl *);
+    } passes[] = {
+        { "walk",     bench_walk            },
+        { "cfg",      ir_cfg_build          },
+        { "dom tree", ir_dominator_tree     },
+        { "frontier", ir_dominance_frontier }
+    };
+    double best[sizeof (passes) / sizeof (*passes)] = {0};
+
+    for (int r = 0; r < RUNS; ++r) {
+        struct ir_unit unit = bench_gen_ir(path);
+
+        for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i) {
+            double t = bench_run_pass(&unit, passes[i].pass);
+            if (best[i] == 0 || t < best[i])
+                best[i] = t;
+        }
+
+        if (r == 0) {
+            struct ir_fn_decl *decl  = unit.fn_decls->ir;
+            uint64_t           stmts = 0;
+
+            for (struct ir_node *it = decl->body; it; it = it->next)
+                ++stmts;
+
+            printf(
+                "%d functions, %lu statements, %lu blocks each\n",
+                FUNCTIONS, stmts, decl->blocks.count
+            );
+        }
+
+        ir_unit_cleanup(&unit);
+    }
+
+    for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i)
+        printf("%-10s %8.2f ms\n", passes[i].name, best[i] * 1e3);
+}
+
+static uint64_t rand_state = 0x9e3779b97f4a7c15;
+
+static uint64_t rand_next()
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+static void append(struct ir_node **body, struct ir_node **last, struct ir_node *stmt)
+{
+    if (*last)
+        (*last)->next = stmt;
+    else
+        *body = stmt;
+
+    *last = stmt;
+}
+
+/* CFG of `size` pairs of blocks. First block of each pair
+   is condition, which jumps to random block anywhere in
+   function. Second one is jump to one of few next pairs.
+   Unlike generated code, such CFG has irreducible loops,
+   and some blocks are not reachable. */
+static struct ir_unit random_cfg(uint64_t size)
+{
+    struct ir_unit    unit   = { .arena = ir_arena_init() };
+    struct ir_label **labels = weak_calloc(size, sizeof (struct ir_label *));
+    struct ir_node   *body   = NULL;
+    struct ir_node   *last   = NULL;
+
+    ir_reset_state();
+
+    for (uint64_t i = 0; i < size; ++i)
+        labels[i] = ir_label_init(NULL);
+
+    append(&body, &last, ir_alloca_init(D_T_INT, 0, 0));
+
+    for (uint64_t i = 0; i < size; ++i) {
+        struct ir_node *cond = ir_cond_init(
+            ir_bin_init(TOK_NEQ, ir_sym_init(0), ir_imm_int_init(0)),
+            labels[rand_next() % size]
+        );
+        uint64_t next = i + 1 + rand_next() % 4;
+
+        labels[i]->target = cond;
+        append(&body, &last, cond);
+        append(&body, &last, next < size
+            ? ir_jump_init(labels[next])
+            : ir_ret_init(NULL)
+        );
+    }
+
+    unit.fn_decls = ir_fn_decl_init(D_T_VOID, 0, "random", NULL, body);
+    ir_cfg_build(unit.fn_decls->ir);
+
+    weak_free(labels);
+    return unit;
+}
+
+static void bench_random()
+{
+    static const struct {
+        const char  *name;
+        void       (*pass)(struct ir_fn_decl *);
+    } passes[] = {
+        { "dom tree", ir_dominator_tree     },
+        { "frontier", ir_dominance_frontier }
+    };
+
+    for (uint64_t size = 500, n = 0; n < CFG_SIZES; size *= 10, ++n) {
+        double best[sizeof (passes) / sizeof (*passes)] = {0};
+
+        for (int r = 0; r < RUNS; ++r) {
+            struct ir_unit unit = random_cfg(size);
+
+            for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i) {
+                double t = bench_run_pass(&unit, passes[i].pass);
+                if (best[i] == 0 || t < best[i])
+                    best[i] = t;
+            }
+
+            if (r == 0) {
+                struct ir_fn_decl *decl = unit.fn_decls->ir;
+                printf("random CFG, %lu blocks\n", decl->blocks.count);
+            }
+
+            ir_unit_cleanup(&unit);
+        }
+
+        for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i)
+            printf("%-10s %8.2f ms\n", passes[i].name, best[i] * 1e3);
+    }
+}
+
+int main()
+{
+    const char *path = "/tmp/__dom_bench.wl";
+
+    bench_gen_file(path, gen);
+    bench_source(path);
+    remove(path);
+
+    bench_random();
+}
@@ -0,0 +1,240 @@
+/* hashmap.c - Hashmap microbenchmark.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/hashmap.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+/**********************************************
+ **     Previous implementation (reference)  **
+ **********************************************/
+/* Linear probing with `key % capacity` and tombstones that
+   are never reclaimed. Kept here only to compare against. */
+typedef struct {
+    uint64_t key;
+    uint64_t val;
+    bool     is_occupied;
+    bool     is_deleted;
+} legacy_bucket_t;
+
+typedef struct {
+    legacy_bucket_t *buckets;
+    uint64_t         capacity;
+    uint64_t         size;
+} legacy_map_t;
+
+static void legacy_put(legacy_map_t *map, uint64_t key, uint64_t val);
+
+static void legacy_init(legacy_map_t *map, uint64_t size)
+{
+    map->buckets = calloc(size, sizeof (legacy_bucket_t));
+    map->capacity = size;
+    map->size = 0;
+}
+
+static void legacy_destroy(legacy_map_t *map)
+{
+    free(map->buckets);
+    memset(map, 0, sizeof (*map));
+}
+
+static void legacy_resize(legacy_map_t *map)
+{
+    uint64_t         old_capacity = map->capacity;
+    legacy_bucket_t *old_buckets  = map->buckets;
+
+    map->capacity *= 2;
+    map->buckets = calloc(map->capacity, sizeof (legacy_bucket_t));
+    map->size = 0;
+
+    for (uint64_t i = 0; i < old_capacity; i++)
+        if (old_buckets[i].is_occupied && !old_buckets[i].is_deleted)
+            legacy_put(map, old_buckets[i].key, old_buckets[i].val);
+
+    free(old_buckets);
+}
+
+static void legacy_put(legacy_map_t *map, uint64_t key, uint64_t val)
+{
+    if (map->size >= map->capacity * 0.75)
+        legacy_resize(map);
+
+    uint64_t index = key % map->capacity;
+
+    while (map->buckets[index].is_occupied) {
+        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
+            map->buckets[index].val = val;
+            return;
+        }
+        index = (index + 1) % map->capacity;
+    }
+
+    map->buckets[index].key = key;
+    map->buckets[index].val = val;
+    map->buckets[index].is_occupied = true;
+    map->buckets[index].is_deleted = false;
+    map->size++;
+}
+
+static uint64_t legacy_get(legacy_map_t *map, uint64_t key, bool *success)
+{
+    uint64_t index = key % map->capacity;
+
+    while (map->buckets[index].is_occupied) {
+        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
+            *success = 1;
+            return map->buckets[index].val;
+        }
+        index = (index + 1) % map->capacity;
+    }
+
+    *success = 0;
+    return (uint64_t) -1;
+}
+
+static bool legacy_remove(legacy_map_t *map, uint64_t key)
+{
+    uint64_t index = key % map->capacity;
+
+    while (map->buckets[index].is_occupied) {
+        if (!map->buckets[index].is_deleted && map->buckets[index].key == key) {
+            map->buckets[index].is_deleted = true;
+            map->size--;
+            return 1;
+        }
+        index = (index + 1) % map->capacity;
+    }
+
+    return 0;
+}
+
+/**********************************************
+ **              Workloads                   **
+ **********************************************/
+#define N      (1 << 20)
+#define CHURN  (1 << 22)
+#define WINDOW 256
+
+static uint64_t keys[N];
+
+/* CRC-like scattered keys, as symbol tables used to have. */
+static void gen_keys()
+{
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (uint64_t i = 0; i < N; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        keys[i] = x & 0xFFFFFFFF;
+    }
+}
+
+#define BENCH(name, init, put, get, remove, destroy, map_t, churn_size)  \
+static void bench_##name()                                               \
+{                                                                        \
+    map_t    map  = {0};                                                 \
+    bool     ok   = 0;                                                   \
+    uint64_t sink = 0;                                                   \
+    double   t    = 0;                                                   \
+                                                                         \
+    init(&map, 32);                                                      \
+    t = bench_now();                                                           \
+    for (uint64_t i = 0; i < N; ++i)                                     \
+        put(&map, keys[i], i);                                           \
+    printf("%-8s insert:      %8.2f ns/op\n", #name,                     \
+           (bench_now() - t) * 1e9 / N);                                       \
+                                                                         \
+    t = bench_now();                                                           \
+    for (uint64_t i = 0; i < N; ++i)                                     \
+        sink += get(&map, keys[i], &ok);                                 \
+    printf("%-8s lookup hit:  %8.2f ns/op\n", #name,                     \
+           (bench_now() - t) * 1e9 / N);                                       \
+                                                                         \
+    t = bench_now();                                                           \
+    for (uint64_t i = 0; i < N; ++i)                                     \
+        sink += get(&map, keys[i] | (1ULL << 40), &ok);                  \
+    printf("%-8s lookup miss: %8.2f ns/op\n", #name,                     \
+           (bench_now() - t) * 1e9 / N);                                       \
+    destroy(&map);                                                       \
+                                                                         \
+    /* Scope-like workload: small live set, many put/remove. */          \
+    init(&map, churn_size);                                              \
+    t = bench_now();                                                           \
+    for (uint64_t i = 0; i < CHURN; ++i) {                               \
+        put(&map, i, i);                                                 \
+        sink += get(&map, i - i % WINDOW, &ok);                          \
+        if (i >= WINDOW)                                                 \
+            remove(&map, i - WINDOW);                                    \
+    }                                                                    \
+    printf("%-8s churn:       %8.2f ns/op\n", #name,                     \
+           (bench_now() - t) * 1e9 / CHURN);                                   \
+    destroy(&map);                                                       \
+                                                                         \
+    if (sink == 42)                                                      \
+        puts("");                                                        \
+}
+
+/* Legacy map never reuses tombstones and put() loops forever once
+   every bucket is occupied or deleted, so churn is measured on table
+   large enough to never fill. New map starts small and compacts. */
+BENCH(legacy, legacy_init, legacy_put, legacy_get, legacy_remove, legacy_destroy, legacy_map_t, CHURN * 2)
+BENCH(hashmap, hashmap_init, hashmap_put, hashmap_get, hashmap_remove, hashmap_destroy, hashmap_t, 512)
+
+/* Walk over few live entries in large table, as AST storage
+   does at every closing brace. */
+#define ITER_TABLE 131072
+#define ITER_LIVE  64
+#define ITER_LOOPS 10000
+
+static void bench_iterate()
+{
+    legacy_map_t legacy = {0};
+    hashmap_t    map    = {0};
+    uint64_t     sink   = 0;
+    double       t      = 0;
+
+    legacy_init(&legacy, ITER_TABLE);
+    hashmap_init(&map, ITER_TABLE);
+
+    for (uint64_t i = 0; i < ITER_LIVE; ++i) {
+        legacy_put(&legacy, keys[i], i);
+        hashmap_put(&map, keys[i], i);
+    }
+
+    t = bench_now();
+    for (uint64_t n = 0; n < ITER_LOOPS; ++n)
+        for (uint64_t i = 0; i < legacy.capacity; ++i)
+            if (legacy.buckets[i].is_occupied && !legacy.buckets[i].is_deleted)
+                sink += legacy.buckets[i].val;
+    printf("%-8s iterate:     %8.2f ns/loop\n", "legacy",
+           (bench_now() - t) * 1e9 / ITER_LOOPS);
+
+    t = bench_now();
+    for (uint64_t n = 0; n < ITER_LOOPS; ++n)
+        hashmap_foreach(&map, k, v) {
+            (void) k;
+            sink += v;
+        }
+    printf("%-8s iterate:     %8.2f ns/loop\n", "hashmap",
+           (bench_now() - t) * 1e9 / ITER_LOOPS);
+
+    legacy_destroy(&legacy);
+    hashmap_destroy(&map);
+
+    if (sink == 42)
+        puts("");
+}
+
+int main() {
+    gen_keys();
+    bench_legacy();
+    bench_hashmap();
+    bench_iterate();
+}
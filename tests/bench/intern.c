@@ -0,0 +1,91 @@
+/* intern.c - Symbol lookup microbenchmark.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/crc32.h"
+#include "util/hashmap.h"
+#include "util/intern.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define NAMES   4096
+#define LOOKUPS (1 << 24)
+
+static char        names[NAMES][32];
+static const char *interned[NAMES];
+
+/* Symbol table keyed by CRC-32 of name, as it was before
+   interning. Hash is computed on every lookup. */
+static void bench_crc32()
+{
+    hashmap_t map  = {0};
+    bool      ok   = 0;
+    uint64_t  sink = 0;
+
+    for (uint64_t i = 0; i < NAMES; ++i)
+        hashmap_put(&map, crc32_string(names[i]), i);
+
+    double t = bench_now();
+    for (uint64_t i = 0; i < LOOKUPS; ++i)
+        sink += hashmap_get(&map, crc32_string(names[i % NAMES]), &ok);
+    printf("%-8s lookup: %8.2f ns/op\n", "crc32", (bench_now() - t) * 1e9 / LOOKUPS);
+
+    hashmap_destroy(&map);
+    if (sink == 42)
+        puts("");
+}
+
+/* Symbol table keyed by interned id. */
+static void bench_intern_id()
+{
+    hashmap_t map  = {0};
+    bool      ok   = 0;
+    uint64_t  sink = 0;
+
+    for (uint64_t i = 0; i < NAMES; ++i)
+        hashmap_put(&map, intern_id(interned[i]), i);
+
+    double t = bench_now();
+    for (uint64_t i = 0; i < LOOKUPS; ++i)
+        sink += hashmap_get(&map, intern_id(interned[i % NAMES]), &ok);
+    printf("%-8s lookup: %8.2f ns/op\n", "intern", (bench_now() - t) * 1e9 / LOOKUPS);
+
+    hashmap_destroy(&map);
+    if (sink == 42)
+        puts("");
+}
+
+/* Cost paid once per token by the lexer. */
+static void bench_intern_n()
+{
+    uint64_t sink = 0;
+    uint64_t lens[NAMES];
+
+    for (uint64_t i = 0; i < NAMES; ++i)
+        lens[i] = strlen(names[i]);
+
+    double t = bench_now();
+    for (uint64_t i = 0; i < LOOKUPS; ++i)
+        sink += (uint64_t) intern_n(names[i % NAMES], lens[i % NAMES]);
+    printf("%-8s token:  %8.2f ns/op\n", "intern_n", (bench_now() - t) * 1e9 / LOOKUPS);
+
+    if (sink == 42)
+        puts("");
+}
+
+int main() {
+    for (uint64_t i = 0; i < NAMES; ++i) {
+        snprintf(names[i], sizeof (names[i]), "identifier_%lu", i * 7919);
+        interned[i] = intern(names[i]);
+    }
+
+    bench_crc32();
+    bench_intern_id();
+    bench_intern_n();
+}
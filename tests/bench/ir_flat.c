@@ -0,0 +1,192 @@
+/* ir_flat.c - Walk of list and flat IR forms.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ir_dump.h"
+#include "middle_end/ir/ir_flat.h"
+#include "util/alloc.h"
+#include "utils/bench_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FUNCTIONS 5000
+#define RUNS      5
+
+static void gen(FILE *f)
+{
+    bench_gen_loop_fns(f, FUNCTIONS);
+}
+
+/* Visit every statement and operand, as interpreter
+   or code generator does. */
+static uint64_t walk_sum;
+
+static void walk_node(struct ir_node *ir)
+{
+    if (!ir)
+        return;
+
+    walk_sum += ir->type;
+
+    switch (ir->type) {
+    case IR_STORE: {
+        struct ir_store *store = ir->ir;
+        walk_node(store->idx);
+        walk_node(store->body);
+        break;
+    }
+    case IR_BIN: {
+        struct ir_bin *bin = ir->ir;
+        walk_node(bin->lhs);
+        walk_node(bin->rhs);
+        break;
+    }
+    case IR_COND:
+        walk_node(((struct ir_cond *) ir->ir)->cond);
+        break;
+    case IR_RET:
+        walk_node(((struct ir_ret *) ir->ir)->body);
+        break;
+    case IR_FN_CALL:
+        for (struct ir_node *it = ((struct ir_fn_call *) ir->ir)->args; it; it = it->next)
+            walk_node(it);
+        break;
+    case IR_IMM:
+        walk_sum += ((struct ir_imm *) ir->ir)->imm.__int;
+        break;
+    case IR_SYM:
+        walk_sum += ((struct ir_sym *) ir->ir)->idx;
+        break;
+    default:
+        break;
+    }
+}
+
+static void walk_list(struct ir_fn_decl *decl)
+{
+    for (struct ir_node *it = decl->body; it; it = it->next)
+        walk_node(it);
+}
+
+static void walk_op(const struct ir_flat_op *op)
+{
+    if (op->kind == IR_FLAT_OP_IMM)
+        walk_sum += op->imm.__int;
+}
+
+static void walk_instr(const struct ir_flat_instr *instr)
+{
+    walk_sum += instr->type;
+
+    switch (instr->type) {
+    case IR_STORE:
+        walk_op(&instr->store.idx);
+        walk_op(&instr->store.body);
+        break;
+    case IR_BIN:
+        walk_op(&instr->bin.lhs);
+        walk_op(&instr->bin.rhs);
+        break;
+    case IR_COND:
+        walk_op(&instr->cond.cond);
+        break;
+    case IR_RET:
+        walk_op(&instr->ret.body);
+        break;
+    case IR_SYM:
+        walk_sum += instr->sym.idx;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Operands are in contiguous array, no need to
+   follow references. */
+static void walk_flat(const struct ir_flat_fn *fn)
+{
+    vector_foreach(fn->stmts, i) {
+        walk_instr(&vector_at(fn->stmts, i));
+    }
+
+    vector_foreach(fn->values, i) {
+        walk_instr(&vector_at(fn->values, i));
+    }
+}
+
+static void bench(const char *path)
+{
+    enum { BUILD, WALK_LIST, WALK_FLAT, DUMP_LIST, DUMP_FLAT, TOTAL };
+
+    static const char *names[TOTAL] = {
+        "build",
+        "walk list",
+        "walk flat",
+        "dump list",
+        "dump flat"
+    };
+    double best[TOTAL] = {0};
+    double t[TOTAL]    = {0};
+    FILE  *null        = fopen("/dev/null", "w");
+
+    if (!null)
+        weak_fatal_errno("fopen()");
+
+    for (int r = 0; r < RUNS; ++r) {
+        struct ir_unit     unit = bench_gen_ir(path);
+        struct ir_flat_fn *fns  = weak_calloc(FUNCTIONS + 1, sizeof (*fns));
+        uint64_t           n    = 0;
+        double             s    = bench_now();
+
+        for (struct ir_node *it = unit.fn_decls; it; it = it->next)
+            ir_flat_build(&fns[n++], it->ir);
+        t[BUILD] = bench_now() - s;
+
+        s = bench_now();
+        for (struct ir_node *it = unit.fn_decls; it; it = it->next)
+            walk_list(it->ir);
+        t[WALK_LIST] = bench_now() - s;
+
+        s = bench_now();
+        for (uint64_t i = 0; i < n; ++i)
+            walk_flat(&fns[i]);
+        t[WALK_FLAT] = bench_now() - s;
+
+        s = bench_now();
+        ir_dump_unit(null, &unit);
+        t[DUMP_LIST] = bench_now() - s;
+
+        s = bench_now();
+        for (uint64_t i = 0; i < n; ++i)
+            ir_dump_flat(null, &fns[i]);
+        t[DUMP_FLAT] = bench_now() - s;
+
+        for (int i = 0; i < TOTAL; ++i)
+            if (best[i] == 0 || t[i] < best[i])
+                best[i] = t[i];
+
+        for (uint64_t i = 0; i < n; ++i)
+            ir_flat_free(&fns[i]);
+        weak_free(fns);
+        ir_unit_cleanup(&unit);
+    }
+
+    fclose(null);
+
+    printf("sizeof (struct ir_flat_instr) = %lu bytes\n", sizeof (struct ir_flat_instr));
+
+    for (int i = 0; i < TOTAL; ++i)
+        printf("%-10s %8.2f ms\n", names[i], best[i] * 1e3);
+}
+
+int main()
+{
+    const char *path = "/tmp/__ir_flat_bench.wl";
+
+    bench_gen_file(path, gen);
+    bench(path);
+    remove(path);
+}
@@ -0,0 +1,170 @@
+/* ir_gen.c - IR generator benchmark on large inputs.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/anal.h"
+#include "front_end/ast/ast.h"
+#include "front_end/ast/ast_flat.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "middle_end/ir/gen.h"
+#include "middle_end/ir/ir.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FUNCTIONS 5000
+#define RUNS      5
+
+/* Hardware cache misses counter of this process.
+   \return -1 if not available (e.g. in container). */
+static int cache_misses_open()
+{
+    struct perf_event_attr attr = {0};
+
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof (attr);
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cache_misses_read(int fd)
+{
+    uint64_t count = 0;
+
+    if (fd < 0 || read(fd, &count, sizeof (count)) != sizeof (count))
+        return 0;
+
+    return count;
+}
+
+/* Functions with loops, conditions and calls of each other. */
+static void gen(FILE *f)
+{
+    fputs("int f0(int a, int b) { return a + b; }\n", f);
+
+    for (uint64_t i = 1; i < FUNCTIONS; ++i)
+        fprintf(f,
+            "int f%lu(int a, int b) {\n"
+            "    int s = 0;\n"
+            "    for (int i = 0; i < b; ++i) {\n"
+            "        if (a > i) { s = s + a * i; } else { s = s - i; }\n"
+            "        while (s > 100) { s = s / 2; }\n"
+            "    }\n"
+            "    do { s = s + 1; } while (s < 10);\n"
+            "    return s + f%lu(a, b);\n"
+            "}\n",
+            i, i - 1
+        );
+
+    fputs("int main() { return 0; }\n", f);
+}
+
+struct bench_stat {
+    double   time;
+    uint64_t misses;
+};
+
+static void stat_update(struct bench_stat *best, double t, uint64_t misses)
+{
+    if (best->time == 0 || t < best->time) {
+        best->time = t;
+        best->misses = misses;
+    }
+}
+
+static void stat_print(const char *name, struct bench_stat *s, int fd)
+{
+    printf("%-12s %8.2f ms", name, s->time * 1e3);
+    if (fd >= 0)
+        printf(", %10lu cache misses", s->misses);
+    printf("\n");
+}
+
+static void bench(struct ast_node *ast)
+{
+    struct bench_stat build = {0};
+    struct bench_stat gen   = {0};
+    struct bench_stat total = {0};
+    struct ast_flat   flat  = {0};
+    int               fd    = cache_misses_open();
+
+/* Measure `expr` into `stat`. */
+#define measure(stat, expr) do {                    \
+    if (fd >= 0) {                                  \
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);         \
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);        \
+    }                                               \
+    double t = bench_now();                               \
+    expr;                                           \
+    t = bench_now() - t;                                  \
+    if (fd >= 0)                                    \
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);       \
+    stat_update(&stat, t, cache_misses_read(fd));   \
+} while (0)
+
+    for (int i = 0; i < RUNS; ++i) {
+        struct ir_unit unit;
+
+        measure(build, ast_flat_build(&flat, ast));
+        measure(gen, unit = ir_gen_flat(&flat));
+        ir_unit_cleanup(&unit);
+
+        measure(total, unit = ir_gen(ast));
+        ir_unit_cleanup(&unit);
+    }
+#undef measure
+
+    stat_print("flatten", &build, fd);
+    stat_print("ir_gen_flat", &gen, fd);
+    stat_print("ir_gen", &total, fd);
+
+    if (fd < 0)
+        printf("Cache misses counter is not available\n");
+    else
+        close(fd);
+
+    ast_flat_free(&flat);
+}
+
+int main()
+{
+    const char    *path = "/tmp/__ir_gen_bench.wl";
+    struct source  s;
+
+    bench_gen_file(path, gen);
+
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    weak_set_source(&s);
+    lex_init_state();
+    lex_source(&s);
+
+    struct ast_node *ast = parse(lex_consumed_tokens());
+    lex_reset_state();
+
+    ana_run(ast);
+    bench(ast);
+
+    ast_node_cleanup(ast);
+    source_close(&s);
+    remove(path);
+}
@@ -0,0 +1,64 @@
+/* ir_passes.c - IR node size and analysis passes time.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ddg.h"
+#include "middle_end/ir/dom.h"
+#include "utils/bench_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FUNCTIONS 5000
+#define RUNS      5
+
+static void gen(FILE *f)
+{
+    bench_gen_loop_fns(f, FUNCTIONS);
+}
+
+static void bench(const char *path)
+{
+    static const struct {
+        const char  *name;
+        void       (*pass)(struct ir_fn_decl *);
+    } passes[] = {
+        { "walk",     bench_walk            },
+        { "cfg",      ir_cfg_build          },
+        { "dom tree", ir_dominator_tree     },
+        { "frontier", ir_dominance_frontier },
+        { "ddg",      ir_ddg_build          }
+    };
+    double best[sizeof (passes) / sizeof (*passes)] = {0};
+
+    for (int r = 0; r < RUNS; ++r) {
+        struct ir_unit unit = bench_gen_ir(path);
+
+        if (r == 0)
+            ir_unit_dump_stats(stdout, &unit);
+
+        for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i) {
+            double t = bench_run_pass(&unit, passes[i].pass);
+            if (best[i] == 0 || t < best[i])
+                best[i] = t;
+        }
+
+        ir_unit_cleanup(&unit);
+    }
+
+    printf("sizeof (struct ir_node) = %lu bytes\n", sizeof (struct ir_node));
+
+    for (uint64_t i = 0; i < sizeof (passes) / sizeof (*passes); ++i)
+        printf("%-10s %8.2f ms\n", passes[i].name, best[i] * 1e3);
+}
+
+int main()
+{
+    const char *path = "/tmp/__ir_passes_bench.wl";
+
+    bench_gen_file(path, gen);
+    bench(path);
+    remove(path);
+}
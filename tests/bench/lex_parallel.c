@@ -0,0 +1,88 @@
+/* lex_parallel.c - Scaling of multithreaded lexer.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/lex.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define INPUT_SIZE (64 << 20)
+#define RUNS       5
+
+static const char *chunk =
+    "// Compute something.\n"
+    "int compute_something(int argument, float *values_array, char c) {\n"
+    "    int accumulator = 0;\n"
+    "    /* Block comment. */\n"
+    "    for (int i = 0; i < 1000; ++i) {\n"
+    "        if (argument >= -15 && values_array[i] != 3.1415) {\n"
+    "            accumulator += i << 2;\n"
+    "        } else {\n"
+    "            accumulator -= c == 'x';\n"
+    "        }\n"
+    "    }\n"
+    "    print(\"result is computed\");\n"
+    "    return accumulator;\n"
+    "}\n\n";
+
+static double bench(struct source *s, uint32_t threads)
+{
+    double   best = 1e9;
+    uint64_t toks = 0;
+
+    for (int i = 0; i < RUNS; ++i) {
+        lex_init_state();
+
+        double t = bench_now();
+        lex_parallel_source(s, threads);
+        t = bench_now() - t;
+
+        toks = tok_array_count(lex_consumed_tokens());
+        lex_reset_state();
+
+        if (t < best)
+            best = t;
+    }
+
+    printf(
+        "%2u threads %10lu tokens: %8.2f Mtok/s, %8.2f MB/s",
+        threads, toks, toks / best / 1e6, s->size / best / 1e6
+    );
+
+    return best;
+}
+
+int main()
+{
+    const char *path = "/tmp/__lex_parallel_bench.wl";
+    FILE       *f    = fopen(path, "w");
+    uint64_t    len  = strlen(chunk);
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t w = 0; w < INPUT_SIZE; w += len)
+        fputs(chunk, f);
+    fclose(f);
+
+    struct source s;
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    double serial = bench(&s, 1);
+    printf("\n");
+
+    for (uint32_t threads = 2; threads <= 8; threads *= 2)
+        printf(", speedup %.2fx\n", serial / bench(&s, threads));
+
+    source_close(&s);
+    remove(path);
+}
@@ -0,0 +1,111 @@
+/* parse_expr.c - Parser benchmark on expression-heavy inputs.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define STMTS      200000
+#define LONG_TERMS 200000
+#define RUNS       5
+
+/* Many statements with expressions, using all precedence levels. */
+static void gen_mixed(FILE *f)
+{
+    fputs("int f(int a, int b, int c) {\n", f);
+    for (uint64_t i = 0; i < STMTS; ++i)
+        fputs(
+            "    a = b * c + a / (b - 1) % 3 << 2 >> 1 < c && "
+            "a == b || c != a & b | c ^ -1 >= *&a + ++b - c--;\n",
+            f
+        );
+    fputs("    return a;\n}\n", f);
+}
+
+/* Single expression with many terms. */
+static void gen_long(FILE *f)
+{
+    fputs("int f(int a) {\n    return a", f);
+    for (uint64_t i = 0; i < LONG_TERMS; ++i)
+        fputs(i % 2 ? " + a" : " * a", f);
+    fputs(";\n}\n", f);
+}
+
+static void parse_file(const char *path)
+{
+    struct source s;
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    weak_set_source(&s);
+    lex_init_state();
+    lex_source(&s);
+
+    double best = 1e9;
+
+    for (int i = 0; i < RUNS; ++i) {
+        double t = bench_now();
+        struct ast_node *ast = parse(lex_consumed_tokens());
+        t = bench_now() - t;
+
+        ast_node_cleanup(ast);
+
+        if (t < best)
+            best = t;
+    }
+
+    printf("%8.2f ms\n", best * 1e3);
+    lex_reset_state();
+    source_close(&s);
+}
+
+/* Run in separate process, since too deep recursion
+   can crash it. */
+static void bench(const char *name, void (*gen)(FILE *))
+{
+    const char *path = "/tmp/__parse_expr_bench.wl";
+
+    bench_gen_file(path, gen);
+
+    printf("%-8s ", name);
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        weak_fatal_errno("fork()");
+
+    if (pid == 0) {
+        parse_file(path);
+        exit(0);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0)
+        weak_fatal_errno("waitpid()");
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        printf("crashed\n");
+
+    remove(path);
+}
+
+int main()
+{
+    bench("mixed", gen_mixed);
+    bench("long", gen_long);
+}
@@ -0,0 +1,90 @@
+/* parse_parallel.c - Scaling of multithreaded parser.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define INPUT_SIZE (32 << 20)
+#define RUNS       5
+
+static const char *chunk =
+    "int compute_something(int argument, float *values_array, char c) {\n"
+    "    int accumulator = 0;\n"
+    "    for (int i = 0; i < 1000; ++i) {\n"
+    "        if (argument >= -15 && values_array[i] != 3.1415) {\n"
+    "            accumulator += i << 2;\n"
+    "        } else {\n"
+    "            accumulator -= c == 'x';\n"
+    "        }\n"
+    "    }\n"
+    "    return accumulator;\n"
+    "}\n\n";
+
+static double bench(const tok_array_t *toks, uint32_t threads)
+{
+    double best = 1e9;
+
+    for (int i = 0; i < RUNS; ++i) {
+        double t = bench_now();
+        struct ast_node *ast = parse_parallel(toks, threads);
+        t = bench_now() - t;
+
+        ast_node_cleanup(ast);
+
+        if (t < best)
+            best = t;
+    }
+
+    printf(
+        "%2u threads %10lu tokens: %8.2f ms, %8.2f Mtok/s",
+        threads, tok_array_count(toks), best * 1e3, tok_array_count(toks) / best / 1e6
+    );
+
+    return best;
+}
+
+int main()
+{
+    const char *path = "/tmp/__parse_parallel_bench.wl";
+    FILE       *f    = fopen(path, "w");
+    uint64_t    len  = strlen(chunk);
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t w = 0; w < INPUT_SIZE; w += len)
+        fputs(chunk, f);
+    fclose(f);
+
+    struct source s;
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    weak_set_source(&s);
+    lex_init_state();
+    lex_source(&s);
+
+    tok_array_t *toks   = lex_consumed_tokens();
+    double       serial = bench(toks, 1);
+    printf("\n");
+
+    for (uint32_t threads = 2; threads <= 8; threads *= 2)
+        printf(", speedup %.2fx\n", serial / bench(toks, threads));
+
+    lex_reset_state();
+    source_close(&s);
+    remove(path);
+}
@@ -0,0 +1,112 @@
+/* parse_stream.c - Peak memory of parser with token array and stream.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/ast/ast.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define INPUT_LINES 1000000
+
+static const char *chunk[] = {
+    "int compute_something(int argument, float *values_array, char c) {\n",
+    "    int accumulator = 0;\n",
+    "    for (int i = 0; i < 1000; ++i) {\n",
+    "        if (argument >= -15 && values_array[i] != 3.1415) {\n",
+    "            accumulator += i << 2;\n",
+    "        } else {\n",
+    "            accumulator -= c == 'x';\n",
+    "        }\n",
+    "    }\n",
+    "    return accumulator;\n",
+    "}\n"
+};
+
+static void parse_array(struct source *s)
+{
+    lex_init_state();
+    lex_source(s);
+    tok_array_t *toks = lex_consumed_tokens();
+    struct ast_node *ast = parse(toks);
+    (void) ast;
+}
+
+static void parse_stream(struct source *s)
+{
+    struct ast_node *ast = parse_source(s);
+    (void) ast;
+}
+
+/* Run in separate process to get independent peak RSS. */
+static void bench(const char *name, const char *path, void (*parse_fn)(struct source *))
+{
+    fflush(stdout);
+
+    double t   = bench_now();
+    pid_t  pid = fork();
+
+    if (pid < 0)
+        weak_fatal_errno("fork()");
+
+    if (pid == 0) {
+        struct source s;
+        if (!source_open(&s, path))
+            weak_fatal_errno("source_open()");
+
+        weak_set_source(&s);
+        parse_fn(&s);
+        exit(0);
+    }
+
+    int           status = 0;
+    struct rusage usage  = {0};
+
+    if (wait4(pid, &status, 0, &usage) < 0)
+        weak_fatal_errno("wait4()");
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        weak_unreachable("%s: child failed", name);
+
+    printf(
+        "%-8s %d lines: peak RSS %8.2f MB, %6.2f s\n",
+        name, INPUT_LINES, usage.ru_maxrss / 1024.0, bench_now() - t
+    );
+}
+
+int main()
+{
+    const char *path = "/tmp/__parse_stream_bench.wl";
+    FILE       *f    = fopen(path, "w");
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t i = 0; i < INPUT_LINES; ++i)
+        fputs(chunk[i % __weak_array_size(chunk)], f);
+
+    /* Close last function if lines count is not multiple of chunk. */
+    if (INPUT_LINES % __weak_array_size(chunk) != 0)
+        for (uint64_t i = INPUT_LINES % __weak_array_size(chunk); i < __weak_array_size(chunk); ++i)
+            fputs(chunk[i], f);
+    fclose(f);
+
+    bench("array", path, parse_array);
+    bench("stream", path, parse_stream);
+
+    remove(path);
+}
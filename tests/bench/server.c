@@ -0,0 +1,139 @@
+/* server.c - Compile server requests against fresh compiler processes.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/unreachable.h"
+#include "utils/bench_utils.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+#define FUNCTIONS 50
+#define REQUESTS  200
+
+static const char *input       = "/tmp/__server_bench.wl";
+static const char *socket_path = "/tmp/__server_bench.sock";
+
+static void gen()
+{
+    FILE *f = fopen(input, "w");
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t i = 0; i < FUNCTIONS; ++i)
+        fprintf(f,
+            "int f%lu(int a, int b) {\n"
+            "    int s = 0;\n"
+            "    for (int i = 0; i < b; ++i) {\n"
+            "        if (a > i) { s = s + a * i; } else { s = s - i; }\n"
+            "        while (s > 100) { s = s / 2; }\n"
+            "    }\n"
+            "    return s;\n"
+            "}\n",
+            i
+        );
+
+    fputs("int main() { return 0; }\n", f);
+    fclose(f);
+}
+
+/* Start compiler with output to /dev/null.
+   \return Pid. */
+static pid_t spawn(char *argv[])
+{
+    pid_t pid = fork();
+    if (pid < 0)
+        weak_fatal_errno("fork()");
+
+    if (pid == 0) {
+        int fd = open("/dev/null", O_WRONLY);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+static void run(char *argv[])
+{
+    int status = 0;
+
+    if (waitpid(spawn(argv), &status, 0) < 0)
+        weak_fatal_errno("waitpid()");
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        weak_fatal_error("%s exited with status %d", argv[0], status);
+}
+
+static void wait_server()
+{
+    struct sockaddr_un addr = {0};
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    for (int i = 0; i < 1000; ++i) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            weak_fatal_errno("socket()");
+
+        /* Server closes connection without request. */
+        int ok = connect(fd, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+        close(fd);
+        if (ok)
+            return;
+
+        usleep(1000);
+    }
+
+    weak_fatal_error("Server is not started");
+}
+
+static void bench(const char *name, char *argv[])
+{
+    double t = bench_now();
+
+    for (int i = 0; i < REQUESTS; ++i)
+        run(argv);
+
+    t = bench_now() - t;
+    printf("%-8s %8.2f ms, %6.3f ms/request\n", name, t * 1e3, t * 1e3 / REQUESTS);
+}
+
+/* Benchmark is run from build directory, see Makefile.
+   Other driver binary can be given as first argument. */
+int main(int argc, char *argv[])
+{
+    char *compiler = argc > 1 ? argv[1] : "./bin/weak_compiler";
+
+    char *spawn_argv [] = { compiler, "--dump-ir", (char *) input, NULL };
+    char *client_argv[] = { compiler, "--client", (char *) socket_path, "--dump-ir", (char *) input, NULL };
+    char *server_argv[] = { compiler, "--server", (char *) socket_path, NULL };
+
+    gen();
+
+    pid_t server = spawn(server_argv);
+    wait_server();
+
+    bench("spawn", spawn_argv);
+    bench("server", client_argv);
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    remove(socket_path);
+    remove(input);
+}
@@ -39,7 +39,7 @@ int ana_test(const char *path, unused const char *filename)
 
     struct ast_node *ast = gen_ast(path);
 
-    get_init_comment(yyin, msg_stream, path);
+    get_init_comment(&test_source, msg_stream, path);
 
     if (!setjmp(weak_fatal_error_buf)) {
         analysis_fn(ast);
@@ -124,6 +124,11 @@ int main()
     if (run("type_errors") < 0)
         return -1;
 
+    analysis_fn = ana_run;
+    ignore_warns = 1;
+    if (run("anal_run") < 0)
+        return -1;
+
     return 0;
 
     analysis_fn = ana_dead;
@@ -0,0 +1,90 @@
+/* sym_table.c - Test case for scoped symbol table.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/sym_table.h"
+#include "util/intern.h"
+#include "utils/test_utils.h"
+#include <stdio.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+int main() {
+    int outer = 1, inner = 2, deep = 3, other = 4;
+
+    {
+        /* Lazy initialization. */
+        struct sym_table t;
+        sym_table_init(&t);
+        ASSERT_EQ(t.index.capacity, 0);
+        ASSERT_TRUE(t.log.data == NULL);
+        ASSERT_TRUE(sym_table_get(&t, intern("a")) == NULL);
+        ASSERT_EQ(sym_table_depth(&t), 0);
+        sym_table_free(&t);
+    }
+
+    {
+        /* Shadowing restores outer binding. */
+        struct sym_table t;
+        sym_table_init(&t);
+
+        const char *a = intern("a");
+        const char *b = intern("b");
+
+        sym_table_put(&t, a, &outer);
+        sym_table_start_scope(&t);
+        sym_table_put(&t, a, &inner);
+        sym_table_put(&t, b, &other);
+        ASSERT_TRUE(sym_table_get(&t, a) == &inner);
+
+        sym_table_start_scope(&t);
+        /* Redeclaration in the same scope. */
+        sym_table_put(&t, a, &deep);
+        sym_table_put(&t, a, &other);
+        ASSERT_EQ(sym_table_depth(&t), 2);
+        ASSERT_TRUE(sym_table_get(&t, a) == &other);
+
+        sym_table_end_scope(&t);
+        ASSERT_TRUE(sym_table_get(&t, a) == &inner);
+        ASSERT_TRUE(sym_table_get(&t, b) == &other);
+
+        sym_table_end_scope(&t);
+        ASSERT_TRUE(sym_table_get(&t, a) == &outer);
+        ASSERT_TRUE(sym_table_get(&t, b) == NULL);
+        ASSERT_EQ(sym_table_depth(&t), 0);
+        ASSERT_EQ(t.log.count, 1);
+
+        sym_table_free(&t);
+    }
+
+    {
+        /* Scope bindings are visited in declaration order. */
+        struct sym_table t;
+        sym_table_init(&t);
+
+        char buf[32] = {0};
+        sym_table_put(&t, intern("global"), &outer);
+        sym_table_start_scope(&t);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            snprintf(buf, sizeof (buf), "var_%lu", i);
+            sym_table_put(&t, intern(buf), &inner);
+        }
+
+        uint64_t cnt = 0;
+        sym_table_scope_foreach(&t, b) {
+            snprintf(buf, sizeof (buf), "var_%lu", cnt++);
+            ASSERT_STREQ(b->name, buf);
+        }
+        ASSERT_EQ(cnt, 1000);
+
+        sym_table_end_scope(&t);
+        ASSERT_EQ(t.index.size, 1);
+        ASSERT_TRUE(sym_table_get(&t, intern("global")) == &outer);
+        ASSERT_TRUE(sym_table_get(&t, intern("var_1")) == NULL);
+
+        sym_table_free(&t);
+    }
+}
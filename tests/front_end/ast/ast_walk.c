@@ -0,0 +1,81 @@
+/* ast_walk.c - Test cases for deep AST traversal.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/anal.h"
+#include "front_end/ast/ast.h"
+#include "middle_end/ir/gen.h"
+#include "util/alloc.h"
+#include "util/intern.h"
+#include "utils/test_utils.h"
+#include <stdarg.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+/* Enough to overflow default 8MB stack of recursive
+   visitor. */
+#define DEPTH 100000
+
+static struct ast_node *stmts(uint64_t size, ...)
+{
+    va_list           args;
+    struct ast_node **list = weak_calloc(size, sizeof (struct ast_node *));
+
+    va_start(args, size);
+    for (uint64_t i = 0; i < size; ++i)
+        list[i] = va_arg(args, struct ast_node *);
+    va_end(args);
+
+    return ast_compound_init(size, list, 0, 0);
+}
+
+static struct ast_node *main_fn(struct ast_node *body)
+{
+    return stmts(1, ast_fn_decl_init(D_T_INT, 0, intern("main"), stmts(0), body, 0, 0));
+}
+
+/* int main() { int a = 1; return a + a + ... + a; } */
+static struct ast_node *long_expr()
+{
+    const char      *a    = intern("a");
+    struct ast_node *expr = ast_sym_init(a, 0, 0);
+
+    for (uint64_t i = 0; i < DEPTH; ++i)
+        expr = ast_binary_init(TOK_PLUS, expr, ast_sym_init(a, 0, 0), 0, 0);
+
+    return main_fn(stmts(2,
+        ast_var_decl_init(D_T_INT, a, NULL, 0, ast_int_init(1, 0, 0), 0, 0),
+        ast_ret_init(expr, 0, 0)
+    ));
+}
+
+/* int main() { { { ... { return 0; } ... } } } */
+static struct ast_node *nested_blocks()
+{
+    struct ast_node *block = stmts(1, ast_ret_init(ast_int_init(0, 0, 0), 0, 0));
+
+    for (uint64_t i = 0; i < DEPTH; ++i)
+        block = stmts(1, block);
+
+    return main_fn(block);
+}
+
+static void compile(const char *name, struct ast_node *ast)
+{
+    ana_run(ast);
+
+    struct ir_unit unit = ir_gen(ast);
+    ast_node_cleanup(ast);
+    ir_unit_cleanup(&unit);
+
+    printf("%s%s%s\n", color_green, name, color_end);
+}
+
+int main()
+{
+    compile("Long expression", long_expr());
+    compile("Nested blocks", nested_blocks());
+}
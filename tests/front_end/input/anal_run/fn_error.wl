@@ -0,0 +1,6 @@
+//E<4:5>: Arguments size mismatch: 1 got, but 0 expected
+int f() { return 0; }
+int main() {
+    f(1);
+    return f();
+}
\ No newline at end of file
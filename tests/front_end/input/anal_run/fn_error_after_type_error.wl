@@ -0,0 +1,7 @@
+//E<5:5>: Arguments size mismatch: 1 got, but 0 expected
+int f() { return 0; }
+int main() {
+    int a = 1 + 2.0;
+    f(1);
+    return a;
+}
\ No newline at end of file
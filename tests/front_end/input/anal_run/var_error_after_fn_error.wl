@@ -0,0 +1,6 @@
+//E<5:12>: Function `unknown` not found
+int f() {
+}
+int main() {
+    return unknown();
+}
\ No newline at end of file
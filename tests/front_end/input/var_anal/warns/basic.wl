@@ -1,5 +1,5 @@
-//W<6:5>: Variable `b` is never used
 //W<5:5>: Variable `a` is never used
+//W<6:5>: Variable `b` is never used
 //W<7:5>: Variable `c` is never used
 int main() {
     int a = 1;
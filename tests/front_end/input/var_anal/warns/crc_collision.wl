@@ -0,0 +1,7 @@
+//W<4:5>: Variable `plumless` is never used
+//W<5:5>: Variable `buckeroo` is never used
+int main() {
+    int plumless = 1;
+    int buckeroo = 2;
+    return 0;
+}
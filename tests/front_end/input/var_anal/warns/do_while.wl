@@ -1,6 +1,6 @@
+//W<6:5>: Variable `j` written, but never read
 //W<7:5>: Variable `k` is never used
 //W<8:5>: Variable `l` is never used
-//W<6:5>: Variable `j` written, but never read
 int main() {
     int i = 0;
     int j = 0;
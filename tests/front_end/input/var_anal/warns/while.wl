@@ -1,5 +1,5 @@
-//W<7:5>: Variable `l` is never used
 //W<5:5>: Variable `j` written, but never read
+//W<7:5>: Variable `l` is never used
 int main() {
     int i = 0;
     int j = 0;
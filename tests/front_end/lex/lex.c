@@ -0,0 +1,196 @@
+/* lex.c - Test case for native lexer.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/lex/lex.h"
+#include "util/source.h"
+#include "utils/test_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+static tok_array_t lex_with(struct source *s, void (*lex_fn)(struct source *))
+{
+    lex_init_state();
+    lex_fn(s);
+
+    /* Moved out, will be freed by caller. */
+    tok_array_t toks = *lex_consumed_tokens();
+    lex_init_state();
+
+    return toks;
+}
+
+static bool tok_eq(const struct token *e, const struct token *a)
+{
+    return e->type    == a->type    &&
+           e->data    == a->data    &&
+           e->line_no == a->line_no &&
+           e->col_no  == a->col_no  &&
+           e->offset  == a->offset  &&
+           e->len     == a->len;
+}
+
+static void tok_mismatch(uint64_t i, const struct token *e, const struct token *a)
+{
+    printf(
+        "token %lu: expected %s `%s` at %u:%u, got %s `%s` at %u:%u\n",
+        i,
+        tok_to_string(e->type), e->data ? e->data : "", e->line_no, e->col_no,
+        tok_to_string(a->type), a->data ? a->data : "", a->line_no, a->col_no
+    );
+}
+
+/* Native lexer must give exactly the same tokens as flex. Text
+   and location, recovered from source, must match those
+   tracked by native lexer when pulling tokens. */
+static int compare(const char *path, unused const char *filename)
+{
+    struct source s;
+    if (!source_open(&s, path))
+        weak_unreachable("Cannot open file `%s`", path);
+
+    tok_array_t expected = lex_with(&s, lex_source);
+    tok_array_t actual   = lex_with(&s, lex_native_source);
+
+    ASSERT_EQ(tok_array_count(&actual), tok_array_count(&expected));
+
+    struct lex_native lex;
+    struct token      pulled;
+    lex_native_init(&lex, &s);
+
+    for (uint64_t i = 0; i < tok_array_count(&expected); ++i) {
+        struct token e;
+        struct token a;
+        tok_array_get(&expected, i, &e);
+        tok_array_get(&actual, i, &a);
+
+        if (!tok_eq(&e, &a)) {
+            tok_mismatch(i, &e, &a);
+            return -1;
+        }
+
+        ASSERT_TRUE(lex_native_next(&lex, &pulled));
+
+        if (!tok_eq(&pulled, &a)) {
+            tok_mismatch(i, &pulled, &a);
+            return -1;
+        }
+    }
+
+    ASSERT_FALSE(lex_native_next(&lex, &pulled));
+
+    tok_array_free(&expected);
+    tok_array_free(&actual);
+    source_close(&s);
+
+    return 0;
+}
+
+/* Parallel lexer must give the same tokens as serial one. */
+static int compare_parallel(const char *path, uint32_t threads)
+{
+    struct source s;
+    if (!source_open(&s, path))
+        weak_unreachable("Cannot open file `%s`", path);
+
+    tok_array_t expected = lex_with(&s, lex_native_source);
+
+    lex_init_state();
+    lex_parallel_source(&s, threads);
+    tok_array_t actual = *lex_consumed_tokens();
+    lex_init_state();
+
+    ASSERT_EQ(tok_array_count(&actual), tok_array_count(&expected));
+
+    for (uint64_t i = 0; i < tok_array_count(&expected); ++i) {
+        ASSERT_EQ(actual.types.data[i], expected.types.data[i]);
+        ASSERT_EQ(actual.offsets.data[i], expected.offsets.data[i]);
+        ASSERT_EQ(actual.lens.data[i], expected.lens.data[i]);
+    }
+
+    tok_array_free(&expected);
+    tok_array_free(&actual);
+    source_close(&s);
+
+    return 0;
+}
+
+static int compare_text(const char *text)
+{
+    const char *path = "/tmp/__lex_test.wl";
+    FILE       *f    = fopen(path, "w");
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+    fputs(text, f);
+    fclose(f);
+
+    int rc = compare(path, NULL);
+    remove(path);
+    return rc;
+}
+
+int main()
+{
+    const char *dirs[] = {
+        "dead_anal",
+        "fn_anal",
+        "parser",
+        "sema_lower",
+        "sema_type",
+        "type_errors",
+        "var_anal/errors",
+        "var_anal/warns",
+        "eval",
+        "gen"
+    };
+
+    for (uint64_t i = 0; i < __weak_array_size(dirs); ++i)
+        if (do_on_each_file(dirs[i], compare) < 0)
+            return -1;
+
+    /* Corner cases of flex grammar. */
+    const char *texts[] = {
+        "",
+        "a-1 a - 1 --1 -1.5 1.x 1.5.5 -a",
+        "x*=2; x>>=1; x<<=1; a>=b>>c<=d<<e",
+        "/* a */ b /* c */ d\n/* no end\n",
+        "/*/ x */ /**/",
+        "// comment\nint a;\t\v\f\r\n// no newline",
+        "\"str \\\" esc\" \"multi\nline\" 'c' '\"' '''",
+        "if iff i int integer while whileX _ _1 __ returned struct",
+        "\n\n   \t  identifier_longer_than_sixteen_characters_for_vector_path\n"
+        "                                    12345678901234567890123456789\n"
+        "                                                             x"
+    };
+
+    for (uint64_t i = 0; i < __weak_array_size(texts); ++i)
+        if (compare_text(texts[i]) < 0)
+            return -1;
+
+    /* Large input, where chunks start inside multi-line
+       strings, which contain code and illegal characters. */
+    const char *path = "/tmp/__lex_parallel_test.wl";
+    FILE       *f    = fopen(path, "w");
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    for (uint64_t i = 0; i < 20000; ++i) {
+        fputs("int f(int a) { return a + 1; } // \"\n", f);
+        if (i % 7 == 0)
+            fputs("char *s = \"\nint g() { @ }\n\\\"\n\n// \\\"\n\";\n", f);
+        if (i % 13 == 0)
+            fputs("/* \" */ char c = '\"';\n", f);
+    }
+    fclose(f);
+
+    for (uint32_t threads = 1; threads <= 16; threads *= 2)
+        if (compare_parallel(path, threads) < 0)
+            return -1;
+
+    remove(path);
+}
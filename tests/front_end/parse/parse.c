@@ -4,9 +4,18 @@
  * This file is distributed under the MIT license.
  */
 
+#include "front_end/ast/ast_cache.h"
 #include "front_end/ast/ast_dump.h"
+#include "front_end/ast/ast_flat.h"
 #include "utils/test_utils.h"
 
+/* Without arena nodes of partially parsed declaration are
+   not tracked, so only lists are freed on compile error. */
+#if defined(__SANITIZE_ADDRESS__) && defined(CONFIG_USE_AST_ARENA)
+#include <sanitizer/lsan_interface.h>
+#define PARSE_TEST_LEAKS 1
+#endif /* __SANITIZE_ADDRESS__ && CONFIG_USE_AST_ARENA */
+
 void *diag_error_memstream = NULL;
 void *diag_warn_memstream = NULL;
 
@@ -17,12 +26,254 @@ void __parse_test(const char *path, unused const char *filename, FILE *out_strea
     ast_node_cleanup(ast);
 }
 
+/* Parser pulling tokens from bounded stream should
+   give the same output as with array of all tokens. */
+void __parse_stream_test(const char *path, unused const char *filename, FILE *out_stream)
+{
+    source_close(&test_source);
+    if (!source_open(&test_source, path))
+        weak_unreachable("Cannot open file `%s`", path);
+
+    weak_set_source(&test_source);
+
+    struct ast_node *ast = parse_source(&test_source);
+    ast_dump(out_stream, ast);
+    ast_node_cleanup(ast);
+}
+
+/* Parallel parser should give the same output as serial
+   one. Inputs are small, so each thread gets few or even
+   one declaration. */
+void __parse_parallel_test(const char *path, unused const char *filename, FILE *out_stream)
+{
+    tok_array_t *tokens = gen_tokens(path);
+    struct ast_node *ast = parse_parallel(tokens, 4);
+    lex_reset_state();
+    ast_dump(out_stream, ast);
+    ast_node_cleanup(ast);
+}
+
+/* Tree converted to flat form and back should give
+   the same output. */
+void __parse_flat_test(const char *path, unused const char *filename, FILE *out_stream)
+{
+    struct ast_node *ast  = gen_ast(path);
+    struct ast_flat  flat = {0};
+
+    ast_flat_build(&flat, ast);
+    ast_node_cleanup(ast);
+
+    ast = ast_flat_unflatten(&flat);
+    ast_flat_free(&flat);
+
+    ast_dump(out_stream, ast);
+    ast_node_cleanup(ast);
+}
+
+/* Tree stored to cache and loaded back should give the
+   same output. Entry must not be used for other contents. */
+void __parse_cache_test(const char *path, unused const char *filename, FILE *out_stream)
+{
+    const char      *cache = "/tmp/__parse_cache_test.wast";
+    struct ast_node *ast   = gen_ast(path);
+    struct source    other = test_source;
+
+    if (!ast_cache_store(cache, ast, &test_source))
+        weak_fatal_errno("ast_cache_store()");
+    ast_node_cleanup(ast);
+
+    other.size -= 1;
+    if (ast_cache_load(cache, &other) != NULL)
+        weak_unreachable("Cache entry loaded for other source");
+
+    ast = ast_cache_load(cache, &test_source);
+    if (!ast)
+        weak_unreachable("Cannot load cache entry");
+
+    ast_dump(out_stream, ast);
+    ast_node_cleanup(ast);
+    remove(cache);
+}
+
+/* Arena of the tree is current only while parse() runs,
+   so nodes created after it go to the heap. */
+int parse_arena_test()
+{
+    if (ast_arena_set(NULL) == NULL)
+        return 0;
+
+    printf("%sArena is left current after parse()%s\n", color_red, color_end);
+    return -1;
+}
+
+/* Of several invalid declarations, parsed by different
+   threads, error should be reported for the first one. */
+int parse_parallel_error_test()
+{
+    const char *path = "/tmp/__parse_parallel_error.wl";
+    FILE       *f    = fopen(path, "w");
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    fputs(
+        "int f() { return 1; }\n"
+        "int g() { return + ; }\n"
+        "struct s { int a; };\n"
+        "int h() { 1 2 3 }\n",
+        f
+    );
+    fclose(f);
+
+    char  *err    = NULL;
+    size_t _      = 0;
+    FILE  *stream = open_memstream(&err, &_);
+    int    rc     = 0;
+
+    diag_error_memstream = stream;
+    weak_set_source_filename(path);
+
+    tok_array_t *tokens = gen_tokens(path);
+
+    if (!setjmp(weak_fatal_error_buf)) {
+        unused struct ast_node *ast = parse_parallel(tokens, 4);
+        printf("%sError expected%s\n", color_red, color_end);
+        rc = -1;
+    } else {
+        fflush(stream);
+        if (!strstr(err, "E<2:")) {
+            printf("%sError at line 2 expected, got `%s`%s\n", color_red, err, color_end);
+            rc = -1;
+        }
+        /* Partial tree is released with its arena. */
+        if (parse_arena_test() < 0)
+            rc = -1;
+    }
+
+    diag_error_memstream = NULL;
+    lex_reset_state();
+    source_close(&test_source);
+    fclose(stream);
+    free(err);
+    remove(path);
+
+    return rc;
+}
+
+/* Parse `code` expecting compile error. */
+static int parse_error(const char *code, bool parallel)
+{
+    const char *path = "/tmp/__parse_error.wl";
+    FILE       *f    = fopen(path, "w");
+    int         rc   = 0;
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+
+    fputs(code, f);
+    fclose(f);
+
+    weak_diag_set_silent(1);
+    weak_set_source_filename(path);
+
+    tok_array_t *tokens = gen_tokens(path);
+
+    if (!setjmp(weak_fatal_error_buf)) {
+        unused struct ast_node *ast = parallel
+            ? parse_parallel(tokens, 4)
+            : parse(tokens);
+        printf("%sError expected%s\n", color_red, color_end);
+        rc = -1;
+    }
+
+    weak_diag_set_silent(0);
+    lex_reset_state();
+    source_close(&test_source);
+    remove(path);
+
+    return rc;
+}
+
+/* Lists (blocks, arguments, etc.) being parsed on compile
+   error should not leak. Checked with leak sanitizer only. */
+int parse_error_leak_test()
+{
+    const char *code =
+        "int f(int a, int b) {\n"
+        "    while (a < b) {\n"
+        "        int arr[2][2];\n"
+        "        g(a, arr[1][a + ], b);\n"
+        "    }\n"
+        "}\n";
+    const char *code_parallel =
+        "struct s { int a; int b; };\n"
+        "int f(int a) { if (a) { return g(a, 1); } return 0; }\n"
+        "int g(int a, int b) { { { return a + b } } }\n"
+        "int h() { return f(1, 2, 3); }\n";
+
+    if (parse_error(code, /*parallel=*/0) < 0)
+        return -1;
+
+    if (parse_error(code_parallel, /*parallel=*/1) < 0)
+        return -1;
+
+#ifdef PARSE_TEST_LEAKS
+    if (__lsan_do_recoverable_leak_check()) {
+        printf("%sMemory leaked on compile error%s\n", color_red, color_end);
+        return -1;
+    }
+#endif /* PARSE_TEST_LEAKS */
+
+    return 0;
+}
+
 int parse_test(const char *path, const char *filename)
 {
     return compare_with_comment(path, filename, __parse_test);
 }
 
+int parse_stream_test(const char *path, const char *filename)
+{
+    return compare_with_comment(path, filename, __parse_stream_test);
+}
+
+int parse_parallel_test(const char *path, const char *filename)
+{
+    return compare_with_comment(path, filename, __parse_parallel_test);
+}
+
+int parse_flat_test(const char *path, const char *filename)
+{
+    return compare_with_comment(path, filename, __parse_flat_test);
+}
+
+int parse_cache_test(const char *path, const char *filename)
+{
+    return compare_with_comment(path, filename, __parse_cache_test);
+}
+
 int main()
 {
-    return do_on_each_file("parser", parse_test);
+    if (parse_error_leak_test() < 0)
+        return -1;
+
+    if (do_on_each_file("parser", parse_test) < 0)
+        return -1;
+
+    if (do_on_each_file("parser", parse_stream_test) < 0)
+        return -1;
+
+    if (do_on_each_file("parser", parse_parallel_test) < 0)
+        return -1;
+
+    if (do_on_each_file("parser", parse_flat_test) < 0)
+        return -1;
+
+    if (do_on_each_file("parser", parse_cache_test) < 0)
+        return -1;
+
+    if (parse_arena_test() < 0)
+        return -1;
+
+    return parse_parallel_error_test();
 }
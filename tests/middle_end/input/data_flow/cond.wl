@@ -8,8 +8,6 @@
 //       8:   | t1 = 2
 //       9:   ret t1
 //fun __do(int t0):
-//       0:   int t1
-//       1:   t1 = 0
 //       2:   int t2
 //       3:   t2 = 0
 //       9:   ret t2
@@ -2,7 +2,7 @@
 //       0:   int t0
 //       1:   t0 = 0
 //       4:   | if t0 != 0 goto L6
-//       5:   | jmp L27
+//       5:   | jmp L35
 //       6:   | int t2
 //       7:   | t2 = 0
 //       8:   | | int t3
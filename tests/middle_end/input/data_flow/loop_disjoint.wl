@@ -30,7 +30,7 @@
 //       8:   | t0 = t0 + 1
 //       9:   | jmp L6
 //      10:   | if t1 != 0 goto L12
-//      11:   | jmp L14
+//      11:   | jmp L18
 //      12:   | t1 = t1 + 1
 //      13:   | jmp L10
 //      18:   int t3
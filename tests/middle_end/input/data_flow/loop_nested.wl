@@ -19,8 +19,6 @@
 //      17:   | jmp L6
 //      18:   ret t0
 //fun __do():
-//       0:   int t0
-//       1:   t0 = 0
 //       2:   int t1
 //       3:   t1 = 0
 //      18:   ret t1
@@ -16,6 +16,12 @@
 //idom(5) = 4
 //idom(6) = 3
 //idom(7) = 2
+//--------
+//block(0) idom = 0, df = ()
+//block(3) idom = 0, df = (7)
+//block(4) idom = 0, df = (7)
+//block(6) idom = 3, df = (7)
+//block(7) idom = 0, df = ()
 int main() {
     int r = 0;
     if (1) {
@@ -0,0 +1,62 @@
+//fun main():
+//       0:   int t0
+//       1:   t0 = 0
+//       2:   | int t1
+//       3:   | t1 = 0
+//       4:   | | | int t2
+//       5:   | | | t2 = t1 == t0
+//       6:   | | | if t2 != 0 goto L8
+//       7:   | | | jmp L11
+//       8:   | | | int t3
+//       9:   | | | t3 = t0 + 1
+//      10:   | | | t0 = t3
+//      11:   | | t1 = t1 + 1
+//      12:   | | int t4
+//      13:   | | t4 = t1 < 3
+//      14:   | | if t4 != 0 goto L4
+//      15:   | int t5
+//      16:   | t5 = t0 < 5
+//      17:   | if t5 != 0 goto L2
+//      18:   ret t0
+//--------
+//idom(0) = 0
+//idom(1) = 0
+//idom(2) = 1
+//idom(3) = 2
+//idom(4) = 3
+//idom(5) = 4
+//idom(6) = 5
+//idom(7) = 6
+//idom(8) = 6
+//idom(9) = 8
+//idom(10) = 9
+//idom(11) = 6
+//idom(12) = 11
+//idom(13) = 12
+//idom(14) = 13
+//idom(15) = 14
+//idom(16) = 15
+//idom(17) = 16
+//idom(18) = 17
+//--------
+//block(0) idom = 0, df = ()
+//block(2) idom = 0, df = (2)
+//block(4) idom = 2, df = (2, 4)
+//block(7) idom = 4, df = (11)
+//block(8) idom = 4, df = (11)
+//block(11) idom = 4, df = (2, 4)
+//block(15) idom = 11, df = (2)
+//block(18) idom = 15, df = ()
+int main() {
+    int r = 0;
+    do {
+        int i = 0;
+        do {
+            if (i == r) {
+                r = r + 1;
+            }
+            ++i;
+        } while (i < 3);
+    } while (r < 5);
+    return r;
+}
@@ -0,0 +1,86 @@
+//fun f(int t0):
+//       0:   int t1
+//       1:   t1 = 0
+//       2:   | int t2
+//       3:   | t2 = t0 == 1
+//       4:   | if t2 != 0 goto L6
+//       5:   | jmp L8
+//       6:   | t1 = 1
+//       7:   | jmp L15
+//       8:   | | int t3
+//       9:   | | t3 = t0 == 2
+//      10:   | | if t3 != 0 goto L12
+//      11:   | | jmp L14
+//      12:   | | t1 = 2
+//      13:   | | jmp L15
+//      14:   | | t1 = 3
+//      15:   | int t4
+//      16:   | t4 = t0 > t1
+//      17:   | if t4 != 0 goto L19
+//      18:   | jmp L20
+//      19:   | ret t0
+//      20:   ret t1
+//--------
+//idom(0) = 0
+//idom(1) = 0
+//idom(2) = 1
+//idom(3) = 2
+//idom(4) = 3
+//idom(5) = 4
+//idom(6) = 4
+//idom(7) = 6
+//idom(8) = 5
+//idom(9) = 8
+//idom(10) = 9
+//idom(11) = 10
+//idom(12) = 10
+//idom(13) = 12
+//idom(14) = 11
+//idom(15) = 4
+//idom(16) = 15
+//idom(17) = 16
+//idom(18) = 17
+//idom(19) = 17
+//idom(20) = 18
+//--------
+//block(0) idom = 0, df = ()
+//block(5) idom = 0, df = (15, 15)
+//block(6) idom = 0, df = (15)
+//block(8) idom = 5, df = (15, 15)
+//block(11) idom = 8, df = (15)
+//block(12) idom = 8, df = (15)
+//block(14) idom = 11, df = (15)
+//block(15) idom = 0, df = ()
+//block(18) idom = 15, df = ()
+//block(19) idom = 15, df = ()
+//block(20) idom = 18, df = ()
+//fun main():
+//       0:   int t0
+//       1:   t0 = call f(2)
+//       2:   ret t0
+//--------
+//idom(0) = 0
+//idom(1) = 0
+//idom(2) = 1
+//--------
+//block(0) idom = 0, df = ()
+int f(int a) {
+    int r = 0;
+    if (a == 1) {
+        r = 1;
+    } else {
+        if (a == 2) {
+            r = 2;
+        } else {
+            r = 3;
+        }
+    }
+    if (a > r) {
+        return a;
+    }
+    return r;
+}
+
+int main() {
+    return f(2);
+}
@@ -24,6 +24,12 @@
 //idom(9) = 8
 //idom(10) = 9
 //idom(11) = 7
+//--------
+//block(0) idom = 0, df = ()
+//block(4) idom = 0, df = (4)
+//block(7) idom = 4, df = ()
+//block(8) idom = 4, df = (4)
+//block(11) idom = 7, df = ()
 int main() {
     int r = 0;
     for (int i = 0; i < 2; ++i) {
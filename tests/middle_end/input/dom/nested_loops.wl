@@ -0,0 +1,99 @@
+//fun main():
+//       0:   int t0
+//       1:   t0 = 0
+//       2:   int t1
+//       3:   t1 = 0
+//       4:   | int t2
+//       5:   | t2 = t1 < 10
+//       6:   | if t2 != 0 goto L8
+//       7:   | jmp L31
+//       8:   | int t3
+//       9:   | t3 = 0
+//      10:   | | int t4
+//      11:   | | t4 = t3 < t1
+//      12:   | | if t4 != 0 goto L14
+//      13:   | | jmp L29
+//      14:   | | | int t5
+//      15:   | | | t5 = t3 == 5
+//      16:   | | | if t5 != 0 goto L18
+//      17:   | | | jmp L19
+//      18:   | | | jmp L29
+//      19:   | | t3 = t3 + 1
+//      20:   | | | int t6
+//      21:   | | | t6 = t3 == 3
+//      22:   | | | if t6 != 0 goto L24
+//      23:   | | | jmp L25
+//      24:   | | | jmp L10
+//      25:   | | int t7
+//      26:   | | t7 = t0 + t3
+//      27:   | | t0 = t7
+//      28:   | | jmp L10
+//      29:   | t1 = t1 + 1
+//      30:   | jmp L4
+//      31:   ret t0
+//--------
+//idom(0) = 0
+//idom(1) = 0
+//idom(2) = 1
+//idom(3) = 2
+//idom(4) = 3
+//idom(5) = 4
+//idom(6) = 5
+//idom(7) = 6
+//idom(8) = 6
+//idom(9) = 8
+//idom(10) = 9
+//idom(11) = 10
+//idom(12) = 11
+//idom(13) = 12
+//idom(14) = 12
+//idom(15) = 14
+//idom(16) = 15
+//idom(17) = 16
+//idom(18) = 16
+//idom(19) = 17
+//idom(20) = 19
+//idom(21) = 20
+//idom(22) = 21
+//idom(23) = 22
+//idom(24) = 22
+//idom(25) = 23
+//idom(26) = 25
+//idom(27) = 26
+//idom(28) = 27
+//idom(29) = 12
+//idom(30) = 29
+//idom(31) = 7
+//--------
+//block(0) idom = 0, df = ()
+//block(4) idom = 0, df = (4)
+//block(7) idom = 4, df = ()
+//block(8) idom = 4, df = (4)
+//block(10) idom = 8, df = (4, 10, 10)
+//block(13) idom = 10, df = (29)
+//block(14) idom = 10, df = (10, 10, 29)
+//block(17) idom = 14, df = (10, 10)
+//block(18) idom = 14, df = (29)
+//block(19) idom = 17, df = (10, 10)
+//block(23) idom = 19, df = (10)
+//block(24) idom = 19, df = (10)
+//block(25) idom = 23, df = (10)
+//block(29) idom = 10, df = (4)
+//block(31) idom = 7, df = ()
+int main() {
+    int r = 0;
+    for (int i = 0; i < 10; ++i) {
+        int j = 0;
+        while (j < i) {
+            if (j == 5) {
+                break;
+            }
+            ++j;
+            if (j == 3) {
+                continue;
+            }
+            r = r + j;
+        }
+    }
+    return r;
+}
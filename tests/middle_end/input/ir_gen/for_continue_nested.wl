@@ -35,7 +35,7 @@
 //      33:   | | | jmp L29
 //      34:   | | | t3 = t3 + 1
 //      35:   | | | jmp L29
-//      36:   | | jmp L29
+//      36:   | | jmp L8
 //      37:   | t0 = t0 - 1
 //      38:   | t1 = t1 - 1
 //      39:   | t2 = t2 - 1
@@ -2,21 +2,21 @@
 //       0:   int t0
 //       1:   int t1
 //       3:   int t3
-//       8:   int t4(@loop)
+//       8:   int t4
 //      10:   int t5
-//      15:   int t6(@loop)
+//      15:   int t6
 //       2:   int t2
 //       4:   t3 = 10 + 1
 //       5:   t2 = 100 + t3
 //       6:   t1 = 1000 + t2
 //       7:   t0 = t1
-//       9:   t4 = 0(@loop)
+//       9:   t4 = 0
 //      11:   | t5 = t4 < t0
 //      12:   | if t5 != 0 goto L14
 //      13:   | jmp L18
-//      14:   | t0 = t0(@noalias) - 1
-//      16:   | t6 = t4 <<= 1(@loop)
-//      17:   | jmp L12
+//      14:   | t0 = t0 - 1
+//      16:   | t6 = t4 <<= 1
+//      17:   | jmp L11
 //      18:   ret
 //fun f_2():
 //       0:   int t0
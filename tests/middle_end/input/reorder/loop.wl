@@ -1,6 +1,6 @@
 //fun main():
 //       0:   int t0
-//       4:   int t2(@loop)
+//       4:   int t2
 //       6:   int t3
 //       7:   int t4
 //       8:   int t5
@@ -12,7 +12,7 @@
 //       2:   int t1
 //       1:   t0 = 0
 //       3:   t1 = 0
-//       5:   t2 = 0(@loop)
+//       5:   t2 = 0
 //       9:   | t5 = 20 + 30
 //      10:   | t4 = 10 + t5
 //      11:   | t3 = t2 < t4
@@ -24,12 +24,12 @@
 //      21:   | | t6 = t7 == 0
 //      22:   | | if t6 != 0 goto L24
 //      23:   | | jmp L26
-//      24:   | | t0 = t0(@noalias) + 1
-//      25:   | | jmp L29
-//      26:   | | t0 = t0(@noalias) - 1
+//      24:   | | t0 = t0 + 1
+//      25:   | | jmp L28
+//      26:   | | t0 = t0 - 1
 //      28:   | t10 = t0 <<= 1
-//      29:   | t2 = t2(@noalias) + 1(@loop)
-//      30:   | jmp L10
+//      29:   | t2 = t2 + 1
+//      30:   | jmp L9
 //      31:   ret t0
 int main() {
     int result = 0;
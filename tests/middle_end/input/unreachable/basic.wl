@@ -3,7 +3,7 @@
 //       1:   t0 = 1
 //       2:   | if t0 != 0 goto L4
 //       3:   | jmp L8
-//       4:   | t0 = t0(@noalias) + 1
+//       4:   | t0 = t0 + 1
 //       5:   | jmp L2
 //       8:   ret 0
 int main() {
@@ -8,11 +8,11 @@
 //       6:   | ret 1
 //       9:   | | if t1 != 0 goto L11
 //      10:   | | jmp L17
-//      11:   | | t1 = t1(@noalias) - 1
+//      11:   | | t1 = t1 - 1
 //      12:   | | | if t0 != 0 goto L14
 //      13:   | | | jmp L15
 //      14:   | | | ret 2
-//      15:   | | t1 = t1(@noalias) + 1
+//      15:   | | t1 = t1 + 1
 //      16:   | | jmp L9
 //      17:   ret 0
 int main() {
@@ -5,13 +5,13 @@
 //       3:   t1 = t0
 //       4:   int t2
 //       5:   t2 = t1
-//       6:   int t3(@loop)
-//       7:   t3 = 0(@loop)
+//       6:   int t3
+//       7:   t3 = 0
 //       8:   | int t4
 //       9:   | t4 = t3 < t0
 //      10:   | if t4 != 0 goto L12
 //      11:   | jmp L39
-//      12:   | t0 = t0(@noalias) + 1
+//      12:   | t0 = t0 + 1
 //      13:   | | int t5
 //      14:   | | int t6
 //      15:   | | t6 = t3 % 2
@@ -19,7 +19,7 @@
 //      17:   | | if t5 != 0 goto L19
 //      18:   | | jmp L37
 //      19:   | | jmp L8
-//      37:   | t3 = t3(@noalias) + 1(@loop)
+//      37:   | t3 = t3 + 1
 //      38:   | jmp L8
 //      39:   ret t0
 int main() {
@@ -28,7 +28,7 @@ void cfg_edges_dump(FILE *stream, struct ir_fn_decl *decl)
     struct ir_node *it = decl->body;
 
     while (it) {
-        fprintf(stream, "% 3ld: cfg = %ld", it->instr_idx, it->cfg_block_no);
+        fprintf(stream, "% 3ld: cfg = %ld", it->instr_idx, ir_block_no(decl, it));
 
         if (it->cfg.preds.count > 0) {
             fprintf(stream, ", prev = (");
@@ -60,7 +60,6 @@ void __cfg_test(const char *path, const char *filename, FILE *out_stream)
 
     while (it) {
         struct ir_fn_decl *decl = it->ir;
-        ir_cfg_build(decl);
 
         ir_dump(out_stream, decl);
         ir_dump_cfg(cfg_stream, decl);
@@ -16,7 +16,7 @@ void ddg_dump(FILE *stream, struct ir_fn_decl *decl)
     struct ir_node *it = decl->body;
 
     while (it) {
-        ir_vector_t *ddgs = &it->ddg_stmts;
+        ir_vector_t *ddgs = ir_ddg(decl, it);
         fprintf(stream, "instr %2ld: depends on (", it->instr_idx);
         vector_foreach(*ddgs, i) {
             struct ir_node *stmt = vector_at(*ddgs, i);
@@ -38,7 +38,6 @@ void __ddg_test(const char *path, unused const char *filename, FILE *out_stream)
         struct ir_fn_decl *decl = it->ir;
 
         ir_ddg_build(decl);
-        ir_cfg_build(decl);
         ir_dump(out_stream, decl);
         fprintf(out_stream, "--------\n");
         ddg_dump(out_stream, decl);
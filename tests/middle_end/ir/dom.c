@@ -18,17 +18,40 @@ void idom_dump(FILE *stream, struct ir_fn_decl *decl)
     struct ir_node *it = decl->body;
 
     while (it) {
-        if (it->idom)
+        struct ir_node *idom = ir_dom(decl, it)->idom;
+
+        if (idom)
             fprintf(
                 stream, "idom(%ld) = %ld\n",
                 it->instr_idx,
-                it->idom->instr_idx
+                idom->instr_idx
             );
 
         it = it->next;
     }
 }
 
+/* Blocks are named by their first statements. */
+void block_dump(FILE *stream, struct ir_fn_decl *decl)
+{
+    vector_foreach(decl->blocks, i) {
+        struct ir_block *b = vector_at(decl->blocks, i);
+
+        fprintf(stream, "block(%ld)", b->first->instr_idx);
+
+        if (b->idom)
+            fprintf(stream, " idom = %ld", b->idom->first->instr_idx);
+
+        fprintf(stream, ", df = (");
+        vector_foreach(b->df, j) {
+            fprintf(stream, "%ld", vector_at(b->df, j)->first->instr_idx);
+            if (j < b->df.count - 1)
+                fprintf(stream, ", ");
+        }
+        fprintf(stream, ")\n");
+    }
+}
+
 void __dom_test(const char *path, const char *filename, FILE *out_stream)
 {
     char    dom_path[256]      = {0};
@@ -46,7 +69,6 @@ void __dom_test(const char *path, const char *filename, FILE *out_stream)
     while (it) {
         struct ir_fn_decl *decl = it->ir;
 
-        ir_cfg_build(decl);
         ir_dominator_tree(decl);
         ir_dominance_frontier(decl);
         ir_dump_dom_tree(dom_stream, decl);
@@ -54,6 +76,8 @@ void __dom_test(const char *path, const char *filename, FILE *out_stream)
         ir_dump(out_stream, decl);
         fprintf(out_stream, "--------\n");
         idom_dump(out_stream, decl);
+        fprintf(out_stream, "--------\n");
+        block_dump(out_stream, decl);
         it = it->next;
     }
 
@@ -0,0 +1,103 @@
+/* flat.c - Test case for flat IR form.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ir_dump.h"
+#include "middle_end/ir/ir_flat.h"
+#include "utils/test_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+static char *dump_list(struct ir_fn_decl *decl)
+{
+    char   *out  = NULL;
+    size_t  size = 0;
+    FILE   *mem  = open_memstream(&out, &size);
+
+    ir_dump(mem, decl);
+    fclose(mem);
+    return out;
+}
+
+static char *dump_flat(struct ir_flat_fn *fn)
+{
+    char   *out  = NULL;
+    size_t  size = 0;
+    FILE   *mem  = open_memstream(&out, &size);
+
+    ir_dump_flat(mem, fn);
+    fclose(mem);
+    return out;
+}
+
+static int compare(const char *what, const char *expected, const char *generated)
+{
+    if (strcmp(expected, generated) == 0)
+        return 0;
+
+    printf(
+        "%s%s mismatch:%s\n`%s`\ngot,\n`%s`\nexpected\n",
+        color_red, what, color_end,
+        generated, expected
+    );
+    return -1;
+}
+
+/* Flat form must be printed the same way as list it
+   was built from, and turned back into the same list. */
+static int check(struct ir_unit *unit, struct ir_fn_decl *decl)
+{
+    struct ir_flat_fn fn = {0};
+    int               rc = 0;
+
+    char *list = dump_list(decl);
+
+    ir_flat_build(&fn, decl);
+    char *flat = dump_flat(&fn);
+
+    ir_flat_unflatten(unit, &fn);
+    char *back = dump_list(decl);
+
+    if (compare("Flat", list, flat) < 0 ||
+        compare("Unflattened", list, back) < 0)
+        rc = -1;
+
+    ir_flat_free(&fn);
+    free(list);
+    free(flat);
+    free(back);
+    return rc;
+}
+
+int flat_test(const char *path, unused const char *filename)
+{
+    struct ir_unit  ir = gen_ir(path);
+    struct ir_node *it = ir.fn_decls;
+    int             rc = 0;
+
+    /* Unit generated later is current, but nodes must be
+       allocated from unit owning the function. */
+    struct ir_unit other = gen_ir(path);
+    ir_unit_cleanup(&other);
+
+    while (it && rc == 0) {
+        struct ir_fn_decl *decl = it->ir;
+
+        rc = check(&ir, decl);
+        it = it->next;
+    }
+
+    ir_unit_cleanup(&ir);
+    return rc;
+}
+
+int main()
+{
+    return do_on_each_file("ir_gen", flat_test);
+}
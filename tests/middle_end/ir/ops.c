@@ -0,0 +1,181 @@
+/* ops.c - Tests for edits of IR statement list.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "middle_end/ir/ssa.h"
+#include "middle_end/opt/opt.h"
+#include "utils/test_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+/* Pass editing list by ir_insert_*(), ir_erase()
+   and ir_redirect(). */
+void (*edit_fn)(struct ir_unit *);
+
+static int instr_idx_cmp(const void *lhs, const void *rhs)
+{
+    uint64_t l = (*(struct ir_node **) lhs)->instr_idx;
+    uint64_t r = (*(struct ir_node **) rhs)->instr_idx;
+
+    return (l > r) - (l < r);
+}
+
+static void edge_vector_dump(FILE *stream, ir_vector_t *v)
+{
+    vector_foreach(*v, i) {
+        fprintf(stream, "%ld", vector_at(*v, i)->instr_idx);
+        if (i < v->count - 1)
+            fprintf(stream, ", ");
+    }
+}
+
+/* Order of predecessors depends on order of edits, so
+   they are sorted. Order of successors is fixed: jump
+   target, then next statement. */
+static char *edges_dump(struct ir_fn_decl *decl)
+{
+    char   *buf    = NULL;
+    size_t  _      = 0;
+    FILE   *stream = open_memstream(&buf, &_);
+
+    for (struct ir_node *it = decl->body; it; it = it->next) {
+        ir_vector_t preds = {0};
+
+        vector_foreach(it->cfg.preds, i)
+            vector_push_back(preds, vector_at(it->cfg.preds, i));
+
+        if (preds.count > 1)
+            qsort(preds.data, preds.count, sizeof (struct ir_node *), instr_idx_cmp);
+
+        fprintf(stream, "% 3ld: prev = (", it->instr_idx);
+        edge_vector_dump(stream, &preds);
+        fprintf(stream, "), next = (");
+        edge_vector_dump(stream, &it->cfg.succs);
+        fprintf(stream, ")\n");
+
+        vector_free(preds);
+    }
+
+    fclose(stream);
+    return buf;
+}
+
+static bool block_has_pred(struct ir_block *block, struct ir_block *pred)
+{
+    vector_foreach(block->preds, i)
+        if (vector_at(block->preds, i) == pred)
+            return 1;
+
+    return 0;
+}
+
+/* Edits keep blocks valid, but not the same as built
+   from scratch: erased blocks stay empty and blocks are
+   not merged. So each block is checked to be made of
+   straight-line statements, entered only at the first
+   one and with edges of its last one.
+
+   \return Statement in wrong block or NULL. */
+static struct ir_node *blocks_check(struct ir_fn_decl *decl)
+{
+    for (struct ir_node *it = decl->body; it; it = it->next) {
+        struct ir_block *block = ir_block(decl, it);
+
+        if (!block || (it == decl->body && block->idx != 0))
+            return it;
+
+        if (it != block->first &&
+            (it->cfg.preds.count != 1 || vector_at(it->cfg.preds, 0) != it->prev))
+            return it;
+
+        if (it != block->last) {
+            if (!it->next || ir_block(decl, it->next) != block)
+                return it;
+            if (it->cfg.succs.count != 1 || vector_at(it->cfg.succs, 0) != it->next)
+                return it;
+            continue;
+        }
+
+        if (block->succs.count != it->cfg.succs.count)
+            return it;
+
+        vector_foreach(it->cfg.succs, i) {
+            struct ir_block *succ = ir_block(decl, vector_at(it->cfg.succs, i));
+
+            if (vector_at(block->succs, i) != succ || !block_has_pred(succ, block))
+                return it;
+        }
+    }
+
+    return NULL;
+}
+
+/* After edits statement edges must be the same as
+   built from scratch. */
+int ops_test(const char *path, unused const char *filename)
+{
+    struct ir_unit  ir = gen_ir(path);
+    struct ir_node *it = NULL;
+    int             rc = 0;
+
+    edit_fn(&ir);
+
+    for (it = ir.fn_decls; it && rc == 0; it = it->next) {
+        struct ir_fn_decl *decl   = it->ir;
+        struct ir_node    *wrong  = blocks_check(decl);
+        char              *edited = edges_dump(decl);
+
+        if (wrong) {
+            printf(
+                "%sWrong block of %ld in %s%s\n",
+                color_red, wrong->instr_idx, decl->name, color_end
+            );
+            rc = -1;
+        }
+
+        ir_cfg_build(decl);
+        char *built = edges_dump(decl);
+
+        if (strcmp(edited, built) != 0) {
+            printf(
+                "%sEdges mismatch in %s:%s\n`%s`\ngot,\n`%s`\nexpected\n",
+                color_red, decl->name, color_end,
+                edited, built
+            );
+            rc = -1;
+        }
+
+        free(edited);
+        free(built);
+    }
+
+    ir_unit_cleanup(&ir);
+    return rc;
+}
+
+int run(const char *dir, void (*fn)(struct ir_unit *))
+{
+    edit_fn = fn;
+
+    return do_on_each_file(dir, ops_test);
+}
+
+int main()
+{
+    if (run("unreachable", ir_opt_unreachable_code) < 0)
+        return -1;
+
+    if (run("data_flow", ir_opt_data_flow) < 0)
+        return -1;
+
+    if (run("reorder", ir_opt_reorder) < 0)
+        return -1;
+
+    if (run("ssa", ir_compute_ssa) < 0)
+        return -1;
+
+    return 0;
+}
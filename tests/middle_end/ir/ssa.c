@@ -27,14 +27,7 @@ void __ssa_test(const char *path, const char *filename, FILE *out_stream)
     struct ir_unit  ir = gen_ir(path);
     struct ir_node *it = ir.fn_decls;
 
-    while (it) {
-        struct ir_fn_decl *decl = it->ir;
-        ir_cfg_build(decl);
-        it = it->next;
-    }
-
-    it = ir.fn_decls;
-    ir_compute_ssa(it);
+    ir_compute_ssa(&ir);
 
     while (it) {
         struct ir_fn_decl *decl = it->ir;
@@ -21,7 +21,7 @@ void ddg_dump(FILE *stream, struct ir_fn_decl *decl)
     struct ir_node *it = decl->body;
 
     while (it) {
-        ir_vector_t *ddgs = &it->ddg_stmts;
+        ir_vector_t *ddgs = ir_ddg(decl, it);
         fprintf(stream, "instr %2ld: depends on (", it->instr_idx);
         vector_foreach(*ddgs, i) {
             struct ir_node *stmt = vector_at(*ddgs, i);
@@ -50,7 +50,6 @@ void __opt_test(const char *path, const char *filename, FILE *out_stream)
 
     while (it) {
         struct ir_fn_decl *decl = it->ir;
-        ir_cfg_build(decl);
         ir_ddg_build(decl);
 
         it = it->next;
@@ -106,13 +105,13 @@ int main()
         return -1;
 #endif
 
-#if 0
+#if 1
     opt_fn = ir_opt_reorder;
     if (run("reorder") < 0)
         return -1;
 #endif
 
-#if 0
+#if 1
     opt_fn = ir_opt_unreachable_code;
     if (run("unreachable") < 0)
         return -1;
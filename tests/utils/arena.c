@@ -0,0 +1,63 @@
+/* arena.c - Test case for region allocator.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/arena.h"
+#include "utils/test_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+int main() {
+    {
+        struct arena a;
+        arena_init(&a);
+
+        char *p = arena_alloc(&a, 3);
+        char *q = arena_alloc(&a, 5);
+        ASSERT_TRUE(p);
+        ASSERT_TRUE(q);
+        ASSERT_EQ((uintptr_t) p % 16, 0);
+        ASSERT_EQ((uintptr_t) q % 16, 0);
+        ASSERT_EQ(q - p, 16);
+        ASSERT_EQ(p[0], 0);
+        ASSERT_EQ(a.allocs, 2);
+        ASSERT_EQ(a.chunks_cnt, 1);
+
+        arena_release(&a);
+        ASSERT_EQ(a.chunks, NULL);
+        ASSERT_EQ(a.bytes, 0);
+    }
+
+    {
+        struct arena a;
+        arena_init(&a);
+
+        for (uint64_t i = 0; i < 100000; ++i) {
+            uint64_t *v = arena_new(&a, uint64_t);
+            ASSERT_EQ(*v, 0);
+            *v = i;
+        }
+        ASSERT_TRUE(a.chunks_cnt > 1);
+
+        /* Big block gets own chunk. */
+        uint64_t chunks = a.chunks_cnt;
+        char *big = arena_alloc(&a, ARENA_CHUNK_SIZE * 2);
+        big[ARENA_CHUNK_SIZE * 2 - 1] = 1;
+        ASSERT_EQ(a.chunks_cnt, chunks + 1);
+
+        arena_release(&a);
+    }
+
+    {
+        struct arena a;
+        arena_init(&a);
+
+        char *s = arena_strdup(&a, "identifier");
+        ASSERT_STREQ(s, "identifier");
+
+        arena_release(&a);
+    }
+}
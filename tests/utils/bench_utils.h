@@ -0,0 +1,102 @@
+/* bench_utils.h - Common functions for benchmarks.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "front_end/anal/anal.h"
+#include "front_end/ast/ast.h"
+#include "front_end/lex/lex.h"
+#include "front_end/parse/parse.h"
+#include "middle_end/ir/gen.h"
+#include "middle_end/ir/ir.h"
+#include "util/diagnostic.h"
+#include "util/source.h"
+#include "util/unreachable.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Monotonic time in seconds. */
+double bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Write input file at `path` with `gen`. */
+void bench_gen_file(const char *path, void (*gen)(FILE *))
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f)
+        weak_fatal_errno("fopen()");
+    gen(f);
+    fclose(f);
+}
+
+/* `n` small functions with loops and conditions, so
+   setup cost of each pass per function is visible. */
+void bench_gen_loop_fns(FILE *f, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; ++i)
+        fprintf(f,
+            "int f%lu(int a, int b) {\n"
+            "    int s = 0;\n"
+            "    for (int i = 0; i < b; ++i) {\n"
+            "        if (a > i) { s = s + a * i; } else { s = s - i; }\n"
+            "        while (s > 100) { s = s / 2; }\n"
+            "    }\n"
+            "    do { s = s + 1; } while (s < 10);\n"
+            "    return s;\n"
+            "}\n",
+            i
+        );
+
+    fputs("int main() { return 0; }\n", f);
+}
+
+/* Lex, parse, analyze and generate IR of file at `path`. */
+struct ir_unit bench_gen_ir(const char *path)
+{
+    struct source s;
+
+    if (!source_open(&s, path))
+        weak_fatal_errno("source_open()");
+
+    weak_set_source(&s);
+    lex_init_state();
+    lex_source(&s);
+
+    struct ast_node *ast = parse(lex_consumed_tokens());
+    lex_reset_state();
+
+    ana_run(ast);
+    struct ir_unit unit = ir_gen(ast);
+
+    ast_node_cleanup(ast);
+    source_close(&s);
+    return unit;
+}
+
+/* Time of `pass` run on each function of `unit`. */
+double bench_run_pass(struct ir_unit *unit, void (*pass)(struct ir_fn_decl *))
+{
+    double t = bench_now();
+
+    for (struct ir_node *it = unit->fn_decls; it; it = it->next)
+        pass(it->ir);
+
+    return bench_now() - t;
+}
+
+/* List walk touching only links, type and payload. Lower
+   bound of any per-statement work. */
+uint64_t bench_walk_sum;
+
+void bench_walk(struct ir_fn_decl *decl)
+{
+    for (struct ir_node *it = decl->body; it; it = it->next)
+        bench_walk_sum += it->type + (uint64_t) it->ir;
+}
@@ -0,0 +1,157 @@
+/* hashmap.c - Test case for hashmap.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/hashmap.h"
+#include "utils/test_utils.h"
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+int main() {
+    {
+        hashmap_t map = {0};
+        hashmap_init(&map, 4);
+        ASSERT_EQ(map.capacity, HASHMAP_GROUP_SIZE);
+
+        hashmap_put(&map, 1, 10);
+        hashmap_put(&map, 2, 20);
+        /* Overwrite does not change size. */
+        hashmap_put(&map, 1, 11);
+        hashmap_put(&map, 1, 12);
+        ASSERT_EQ(map.size, 2);
+
+        bool ok = 0;
+        ASSERT_EQ(hashmap_get(&map, 1, &ok), 12);
+        ASSERT_TRUE(ok);
+        ASSERT_EQ(hashmap_get(&map, 2, &ok), 20);
+        ASSERT_TRUE(ok);
+        hashmap_get(&map, 3, &ok);
+        ASSERT_FALSE(ok);
+
+        ASSERT_TRUE(hashmap_remove(&map, 1));
+        ASSERT_FALSE(hashmap_remove(&map, 1));
+        ASSERT_FALSE(hashmap_has(&map, 1));
+        ASSERT_TRUE(hashmap_has(&map, 2));
+        ASSERT_EQ(map.size, 1);
+
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Zero-initialized map is usable. */
+        hashmap_t map = {0};
+        ASSERT_FALSE(hashmap_has(&map, 0));
+        hashmap_put(&map, 0, 1);
+        ASSERT_TRUE(hashmap_has(&map, 0));
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Growth and iteration. */
+        hashmap_t map = {0};
+        hashmap_init(&map, 16);
+
+        const uint64_t n = 100000;
+        for (uint64_t i = 0; i < n; ++i)
+            hashmap_put(&map, i * 7, i);
+        ASSERT_EQ(map.size, n);
+
+        /* Insertion order. */
+        uint64_t cnt = 0;
+        hashmap_foreach(&map, k, v) {
+            ASSERT_EQ(k, v * 7);
+            ASSERT_EQ(v, cnt);
+            ++cnt;
+        }
+        ASSERT_EQ(cnt, n);
+
+        /* Remove inside the loop. */
+        hashmap_foreach(&map, k, v) {
+            if (v % 2 == 0)
+                hashmap_remove(&map, k);
+        }
+        ASSERT_EQ(map.size, n / 2);
+
+        bool ok = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t got = hashmap_get(&map, i * 7, &ok);
+            ASSERT_EQ(ok, i % 2 != 0);
+            if (ok)
+                ASSERT_EQ(got, i);
+        }
+
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Tombstones are reclaimed, so put/remove churn
+           does not grow the table. */
+        hashmap_t map = {0};
+        hashmap_init(&map, 64);
+        uint64_t cap = map.capacity;
+
+        for (uint64_t i = 0; i < 100000; ++i) {
+            hashmap_put(&map, i, i);
+            if (i >= 32)
+                ASSERT_TRUE(hashmap_remove(&map, i - 32));
+        }
+        ASSERT_EQ(map.size, 32);
+        ASSERT_EQ(map.capacity, cap);
+
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Overwrite keeps position. Deleted entries are compacted,
+           so iteration does not depend on removed ones. */
+        hashmap_t map = {0};
+        hashmap_init(&map, 4);
+
+        for (uint64_t i = 0; i < 1000; ++i)
+            hashmap_put(&map, i, i);
+        for (uint64_t i = 0; i < 1000; ++i)
+            if (i != 500 && i != 10)
+                hashmap_remove(&map, i);
+        hashmap_put(&map, 10, 1);
+        hashmap_put(&map, 2000, 2);
+
+        ASSERT_EQ(map.size, 3);
+        ASSERT_TRUE(map.entries_cnt <= 2 * map.size + HASHMAP_GROUP_SIZE);
+
+        uint64_t order[3] = {0};
+        uint64_t cnt = 0;
+        hashmap_foreach(&map, k, v) {
+            (void) v;
+            order[cnt++] = k;
+        }
+        ASSERT_EQ(cnt, 3);
+        ASSERT_EQ(order[0], 10);
+        ASSERT_EQ(order[1], 500);
+        ASSERT_EQ(order[2], 2000);
+
+        /* LIFO removal reclaims entries immediately. */
+        hashmap_remove(&map, 2000);
+        hashmap_remove(&map, 500);
+        ASSERT_EQ(map.entries_cnt, 1);
+
+        /* Reclaimed position is reused by live entry. */
+        hashmap_put(&map, 3000, 3);
+        cnt = 0;
+        hashmap_foreach(&map, k, v) {
+            (void) v;
+            order[cnt++] = k;
+        }
+        ASSERT_EQ(cnt, 2);
+        ASSERT_EQ(order[1], 3000);
+
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Deleted flag is not stored in entry. */
+        ASSERT_EQ(sizeof (hashmap_entry_t), 16);
+    }
+}
@@ -0,0 +1,80 @@
+/* intern.c - Test case for string interner.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/crc32.h"
+#include "util/hashmap.h"
+#include "util/intern.h"
+#include "utils/test_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+int main() {
+    {
+        const char *a = intern("identifier");
+        const char *b = intern_n("identifier_long", 10);
+        const char *c = intern("other");
+
+        ASSERT_TRUE(a == b);
+        ASSERT_TRUE(a != c);
+        ASSERT_STREQ(a, "identifier");
+        ASSERT_EQ(intern_id(a), intern_id(b));
+        ASSERT_TRUE(intern_id(a) != intern_id(c));
+        ASSERT_TRUE(intern_id(a) != INTERN_NO_ID);
+        ASSERT_TRUE(intern_str(intern_id(c)) == c);
+        ASSERT_EQ(intern_count(), 2);
+    }
+
+    {
+        /* These have equal CRC-32, which was used as symbol key. */
+        ASSERT_EQ(crc32_string("plumless"), crc32_string("buckeroo"));
+
+        const char *a = intern("plumless");
+        const char *b = intern("buckeroo");
+        ASSERT_TRUE(a != b);
+        ASSERT_TRUE(intern_id(a) != intern_id(b));
+
+        hashmap_t map = {0};
+        hashmap_put(&map, intern_id(a), 1);
+        hashmap_put(&map, intern_id(b), 2);
+        ASSERT_EQ(map.size, 2);
+
+        bool ok = 0;
+        ASSERT_EQ(hashmap_get(&map, intern_id(a), &ok), 1);
+        ASSERT_EQ(hashmap_get(&map, intern_id(b), &ok), 2);
+        hashmap_destroy(&map);
+    }
+
+    {
+        /* Force several rehashes. */
+        char buf[32] = {0};
+        for (uint64_t i = 0; i < 10000; ++i) {
+            snprintf(buf, sizeof (buf), "sym_%lu", i);
+            const char *s = intern(buf);
+            ASSERT_STREQ(s, buf);
+            ASSERT_TRUE(intern(buf) == s);
+        }
+        ASSERT_EQ(intern_count(), 10004);
+
+        snprintf(buf, sizeof (buf), "sym_%d", 1234);
+        ASSERT_STREQ(intern_str(intern_id(intern(buf))), "sym_1234");
+    }
+
+    {
+        /* Every prefix length, short and long hash paths. */
+        const char *long_name = "a_very_long_identifier_name_for_hash_test";
+        uint32_t    before    = intern_count();
+
+        for (uint64_t len = 0; len <= 40; ++len) {
+            const char *s = intern_n(long_name, len);
+            ASSERT_EQ(strlen(s), len);
+            ASSERT_TRUE(intern_n(long_name, len) == s);
+        }
+        ASSERT_EQ(intern_count(), before + 41);
+    }
+}
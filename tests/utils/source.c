@@ -0,0 +1,138 @@
+/* source.c - Test case for memory-mapped source.
+ * Copyright (C) 2024 epoll-reactor <glibcxx.chrono@gmail.com>
+ *
+ * This file is distributed under the MIT license.
+ */
+
+#include "util/source.h"
+#include "utils/test_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void *diag_error_memstream = NULL;
+void *diag_warn_memstream = NULL;
+
+static void write_file(const char *path, const char *data, uint64_t size)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        weak_fatal_errno("fopen()");
+    if (size > 0 && fwrite(data, 1, size, f) != size)
+        weak_fatal_errno("fwrite()");
+    fclose(f);
+}
+
+static void assert_line(struct source *s, uint64_t line_no, const char *expected)
+{
+    uint64_t    len  = 0;
+    const char *line = source_line(s, line_no, &len);
+
+    ASSERT_TRUE(line != NULL);
+    ASSERT_EQ(len, strlen(expected));
+    ASSERT_TRUE(strncmp(line, expected, len) == 0);
+}
+
+int main() {
+    const char *path = "/tmp/__source_test.wl";
+
+    {
+        const char *text = "int main() {\n\n    return 0;\n}";
+        write_file(path, text, strlen(text));
+
+        struct source s;
+        ASSERT_TRUE(source_open(&s, path));
+        ASSERT_EQ(s.size, strlen(text));
+        ASSERT_TRUE(memcmp(s.data, text, s.size) == 0);
+        /* Required by flex. */
+        ASSERT_EQ(s.data[s.size], '\0');
+        ASSERT_EQ(s.data[s.size + 1], '\0');
+
+        ASSERT_EQ(source_lines_count(&s), 4);
+        assert_line(&s, 1, "int main() {");
+        assert_line(&s, 2, "");
+        assert_line(&s, 3, "    return 0;");
+        assert_line(&s, 4, "}");
+
+        uint64_t len = 0;
+        ASSERT_TRUE(source_line(&s, 0, &len) == NULL);
+        ASSERT_TRUE(source_line(&s, 5, &len) == NULL);
+
+        source_close(&s);
+    }
+
+    {
+        /* Trailing newline does not start new line. Size is
+           multiple of page, so zero tail is on separate page. */
+        uint64_t page = sysconf(_SC_PAGESIZE);
+        char    *text = calloc(1, page + 1);
+
+        memset(text, 'a', page);
+        text[page - 1] = '\n';
+        write_file(path, text, page);
+
+        struct source s;
+        ASSERT_TRUE(source_open(&s, path));
+        ASSERT_EQ(source_lines_count(&s), 1);
+        ASSERT_EQ(s.data[s.size], '\0');
+        ASSERT_EQ(s.data[s.size + 1], '\0');
+
+        uint64_t len = 0;
+        ASSERT_TRUE(source_line(&s, 1, &len) == s.data);
+        ASSERT_EQ(len, page - 1);
+
+        source_close(&s);
+        free(text);
+    }
+
+    {
+        /* Empty file. */
+        write_file(path, "", 0);
+
+        struct source s;
+        ASSERT_TRUE(source_open(&s, path));
+        ASSERT_EQ(s.size, 0);
+        ASSERT_EQ(s.data[0], '\0');
+        assert_line(&s, 1, "");
+        source_close(&s);
+    }
+
+    {
+        /* Location of offset. Lines count does not fit in 16 bits. */
+        uint64_t lines = 70000;
+        char    *text  = calloc(1, lines * 3);
+
+        for (uint64_t i = 0; i < lines; ++i)
+            memcpy(text + i * 3, "ab\n", 3);
+        write_file(path, text, lines * 3);
+
+        struct source s;
+        ASSERT_TRUE(source_open(&s, path));
+
+        uint32_t line_no = 0;
+        uint32_t col_no  = 0;
+
+        source_locate(&s, 0, &line_no, &col_no);
+        ASSERT_EQ(line_no, 1);
+        ASSERT_EQ(col_no, 1);
+
+        source_locate(&s, 2, &line_no, &col_no);
+        ASSERT_EQ(line_no, 1);
+        ASSERT_EQ(col_no, 3);
+
+        source_locate(&s, 69999 * 3 + 1, &line_no, &col_no);
+        ASSERT_EQ(line_no, 70000);
+        ASSERT_EQ(col_no, 2);
+
+        source_close(&s);
+        free(text);
+    }
+
+    {
+        struct source s;
+        ASSERT_FALSE(source_open(&s, "/tmp/__source_test_missing.wl"));
+        ASSERT_TRUE(s.data == NULL);
+    }
+
+    remove(path);
+}
@@ -16,6 +16,7 @@
 #include "util/compiler.h"
 #include "util/diagnostic.h"
 #include "util/lexical.h"
+#include "util/source.h"
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
@@ -49,9 +50,15 @@
 #define __target_exec    "./"
 #endif /* CONFIG_USE_BACKEND_* */
 
-extern FILE *yyin;
-extern int yylex();
+#ifdef CONFIG_USE_NATIVE_LEXER
+/* Native lexer keeps no state between files. */
+#define yylex_destroy()
+#else
 extern int yylex_destroy();
+#endif /* CONFIG_USE_NATIVE_LEXER */
+
+/* Source of file being tested. Opened in gen_tokens(). */
+struct source test_source;
 
 /* Get string represented as comment placed in the very
    beginning of file. For example,
@@ -60,33 +67,26 @@ extern int yylex_destroy();
    // c.
    String "A,\nb,\nc." will be issued in output stream.
 
-   NOTE: Requires opened `yyin` stream.
+   NOTE: Requires opened `in` source.
    NOTE: If `filename` is not null, appends
          it to generate full compiler report. */
-void get_init_comment(FILE *in, FILE *out, const char *filename)
+void get_init_comment(const struct source *in, FILE *out, const char *filename)
 {
-    char   *line = NULL;
-    size_t  len  = 0;
-    ssize_t read = 0;
+    uint64_t len = 0;
 
-    fseek(in, 0, SEEK_SET);
+    for (uint64_t i = 1; i <= source_lines_count(in); ++i) {
+        const char *line = source_line(in, i, &len);
 
-    while ((read = getline(&line, &len, in)) != -1) {
-        if (read <= 2)
+        if (len <= 1)
             continue;
 
         if (strncmp(line, "//", 2) == 0) {
             if (filename)
                 fprintf(out, "%s: ", filename);
 
-            char *ptr = line + 2;
-            while (*ptr != '\n' && *ptr != '\0') {
-                fputc(*ptr++, out);
-            }
-            fputc('\n', out);
+            fprintf(out, "%.*s\n", (int) len - 2, line + 2);
         }
     }
-    free(line);
     fflush(out);
 }
 
@@ -119,7 +119,7 @@ int compare_with_comment(
     if (!setjmp(weak_fatal_error_buf)) {
         fn(path, filename, generated_stream);
 
-        get_init_comment(yyin, expected_stream, NULL);
+        get_init_comment(&test_source, expected_stream, NULL);
 
         fflush(generated_stream);
 
@@ -146,8 +146,8 @@ exit:
     return rc;
 }
 
-/* NOTE: `yylex` is opened in gen_tokens() and closed after `callback`
-         call. User should not touch this stream in their tests. */
+/* NOTE: `test_source` is opened in gen_tokens() and closed after
+         `callback` call. User should not touch it in their tests. */
 int do_on_each_file(
     const char  *dir,
     int        (*callback)(
@@ -195,7 +195,7 @@ int do_on_each_file(
 
         if (callback(fname, d->d_name) < 0) {
             rc = -1;
-            fclose(yyin);
+            source_close(&test_source);
             yylex_destroy();
             goto exit;
         } else {
@@ -203,7 +203,7 @@ int do_on_each_file(
             fflush(stdout);
         }
 
-        fclose(yyin);
+        source_close(&test_source);
         yylex_destroy();
     }
 
@@ -241,14 +241,12 @@ tok_array_t *gen_tokens(const char *filename)
 {
     lex_init_state();
 
-    if (!yyin) yyin = fopen(filename, "r");
-    else yyin = freopen(filename, "r", yyin);
-    if (yyin == NULL)
+    source_close(&test_source);
+    if (!source_open(&test_source, filename))
         weak_unreachable("Cannot open file `%s`", filename);
 
-    yylex();
-    fseek(yyin, 0, SEEK_SET);
-    weak_set_source_stream(yyin);
+    lex_source(&test_source);
+    weak_set_source(&test_source);
 
     return lex_consumed_tokens();
 }
@@ -256,7 +254,7 @@ tok_array_t *gen_tokens(const char *filename)
 struct ast_node *gen_ast(const char *filename)
 {
     tok_array_t *tokens = gen_tokens(filename);
-    struct ast_node *ast = parse(tokens->data, tokens->data + tokens->count);
+    struct ast_node *ast = parse(tokens);
     lex_reset_state();
     return ast;
 }